@@ -0,0 +1,215 @@
+#include "audio_packetizer.h"
+#include <algorithm>
+#include <cstring>
+
+// ============ AudioPacketizer Implementation ============
+
+AudioPacketizer::AudioPacketizer(int rate, int ms, uint8_t ch)
+    : sample_rate(rate),
+      frame_ms(ms),
+      channel(ch),
+      requested_ms(ms),
+      encodings(encodingBit(AudioEncoding::PCM16)),
+      requested_encodings(encodingBit(AudioEncoding::PCM16)),
+      frame_samples(0),
+      frame_channels(1),
+      pending_count(0),
+      pending_open(false),
+      pending_timestamp(0),
+      pending_capture(0),
+      ready(0),
+      clock(0),
+      closed(false),
+      marker_clock(0),
+      sequence(0) {
+    configure(ms);
+}
+
+void AudioPacketizer::setFrameDuration(int ms) {
+    requested_ms = std::min(std::max(ms, 5), 200);
+}
+
+void AudioPacketizer::setEncodings(uint32_t mask) {
+    requested_encodings = mask & ((1u << static_cast<unsigned>(AudioEncoding::COUNT)) - 1);
+}
+
+void AudioPacketizer::applyRequests() {
+    int ms = requested_ms.load(std::memory_order_relaxed);
+    if (ms != frame_ms) configure(ms);
+    encodings = requested_encodings.load(std::memory_order_relaxed);
+}
+
+void AudioPacketizer::configure(int ms) {
+    frame_ms = ms;
+    frame_samples = static_cast<size_t>(sample_rate) * ms / 1000;
+    pending.resize(frame_samples * frame_channels);
+    planar.resize(frame_channels == 2 ? pending.size() : 0);
+    pending_count = 0;
+    pending_open = false;
+}
+
+void AudioPacketizer::emitFrame() {
+    AudioFrameHeader header;
+    header.magic[0] = 'S';
+    header.magic[1] = 'D';
+    header.type = AUDIO_FRAME_TYPE;
+    header.flags = (pending_open ? AUDIO_FLAG_SQUELCH_OPEN : 0) | (pending_capture ? AUDIO_FLAG_CAPTURE_TIME : 0) |
+                   (frame_channels == 2 ? AUDIO_FLAG_STEREO : 0);
+    header.channel = channel;
+    header.samples = static_cast<uint16_t>(frame_samples);
+    header.sequence = sequence++;
+    header.timestamp = pending_timestamp;
+    AudioCaptureTime capture;
+    capture.capture_us = pending_capture / 1000;
+    const size_t head = sizeof(header) + (pending_capture ? sizeof(capture) : 0);
+
+    // Estéreo: L,R intercalados -> bloco L seguido do bloco R
+    const int16_t* pcm = pending.data();
+    if (frame_channels == 2) {
+        for (size_t i = 0; i < frame_samples; i++) {
+            planar[i] = pending[2 * i];
+            planar[frame_samples + i] = pending[2 * i + 1];
+        }
+        pcm = planar.data();
+    }
+
+    for (size_t e = 0; e < static_cast<size_t>(AudioEncoding::COUNT); e++) {
+        Output& o = outputs[e];
+        // Quadros prontos ficam contíguos; os buffers só crescem (sem alocação em regime)
+        if (o.offsets.size() < ready + 2) o.offsets.resize(ready + 2);
+        if (ready == 0) o.offsets[0] = 0;
+        size_t start = o.offsets[ready];
+        if (!(encodings & (1u << e))) {
+            o.offsets[ready + 1] = start;
+            continue;
+        }
+
+        AudioEncoding encoding = static_cast<AudioEncoding>(e);
+        size_t bytes = head + frame_channels * AudioProcessor::encodedBytes(encoding, frame_samples);
+        if (o.frames.size() < start + bytes) o.frames.resize(start + bytes);
+        uint8_t* out = &o.frames[start];
+
+        header.encoding = static_cast<uint8_t>(encoding);
+        std::memcpy(out, &header, sizeof(header));
+        if (pending_capture) std::memcpy(out + sizeof(header), &capture, sizeof(capture));
+        size_t written = head;
+        for (int c = 0; c < frame_channels; c++) {
+            written += AudioProcessor::encode(encoding, pcm + c * frame_samples, frame_samples,
+                                              o.adpcm[c], out + written);
+        }
+        o.offsets[ready + 1] = start + written;
+    }
+
+    if (ready_capture.size() < ready + 1) ready_capture.resize(ready + 1);
+    ready_capture[ready] = pending_capture;
+    ready++;
+    pending_count = 0;
+    pending_open = false;
+
+    // Nova duração e codificações só entram entre quadros
+    applyRequests();
+}
+
+void AudioPacketizer::emitMarker() {
+    AudioFrameHeader header;
+    header.magic[0] = 'S';
+    header.magic[1] = 'D';
+    header.type = AUDIO_FRAME_TYPE;
+    header.flags = 0;
+    header.channel = channel;
+    header.samples = 0;
+    header.sequence = sequence++;
+    header.timestamp = clock;
+
+    for (size_t e = 0; e < static_cast<size_t>(AudioEncoding::COUNT); e++) {
+        Output& o = outputs[e];
+        if (o.offsets.size() < ready + 2) o.offsets.resize(ready + 2);
+        if (ready == 0) o.offsets[0] = 0;
+        size_t start = o.offsets[ready];
+        o.offsets[ready + 1] = start;
+        if (!(encodings & (1u << e))) continue;
+
+        if (o.frames.size() < start + sizeof(header)) o.frames.resize(start + sizeof(header));
+        header.encoding = static_cast<uint8_t>(e);
+        std::memcpy(&o.frames[start], &header, sizeof(header));
+        o.offsets[ready + 1] = start + sizeof(header);
+    }
+
+    if (ready_capture.size() < ready + 1) ready_capture.resize(ready + 1);
+    ready_capture[ready] = 0;
+    ready++;
+    marker_clock = clock;
+}
+
+// Completa o quadro parcial com silêncio e o emite; retorna as amostras acrescentadas
+size_t AudioPacketizer::padPending() {
+    if (pending_count == 0) return 0;
+    size_t fill = frame_samples - pending_count;
+    std::fill(pending.begin() + pending_count * frame_channels, pending.end(), int16_t(0));
+    pending_count = frame_samples;
+    emitFrame();
+    return fill;
+}
+
+size_t AudioPacketizer::push(const int16_t* pcm, size_t n, bool squelch_open, uint64_t capture_ns, int channels) {
+    ready = 0;
+    closed = false;
+    if (channels != frame_channels) {
+        // Troca mono/estéreo só entre quadros
+        clock += padPending();
+        frame_channels = channels;
+        configure(frame_ms);
+    }
+    if (pending_count == 0) applyRequests();
+
+    size_t consumed = 0;
+    while (n > 0) {
+        if (pending_count == 0) {
+            pending_timestamp = clock;
+            pending_capture = capture_ns ? capture_ns + consumed * 1000000000ull / sample_rate : 0;
+        }
+
+        size_t take = std::min(n, frame_samples - pending_count);
+        std::memcpy(&pending[pending_count * frame_channels], pcm, take * frame_channels * sizeof(int16_t));
+        pending_count += take;
+        pending_open = pending_open || squelch_open;
+        clock += take;
+        pcm += take * frame_channels;
+        n -= take;
+        consumed += take;
+
+        if (pending_count == frame_samples) emitFrame();
+    }
+    return ready;
+}
+
+size_t AudioPacketizer::advanceClock(uint64_t n) {
+    ready = 0;
+    size_t fill = padPending();
+    clock += fill;
+    n = n > fill ? n - fill : 0;
+    clock += n;
+    return ready;
+}
+
+size_t AudioPacketizer::skipClosed(uint64_t n) {
+    ready = 0;
+    size_t fill = padPending();
+    clock += fill;
+    n = n > fill ? n - fill : 0;
+    applyRequests();
+    if (!closed || clock - marker_clock >= static_cast<uint64_t>(sample_rate)) emitMarker();
+    closed = true;
+    clock += n;
+    return ready;
+}
+
+void AudioPacketizer::reset() {
+    pending_count = 0;
+    pending_open = false;
+    ready = 0;
+    clock = 0;
+    closed = false;
+    marker_clock = 0;
+    sequence = 0;
+}
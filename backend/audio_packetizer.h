@@ -0,0 +1,132 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "audio_processor.h"
+
+// Cabeçalho dos quadros de áudio (little-endian, 20 bytes), seguido das
+// amostras do quadro no formato indicado por encoding (AudioEncoding):
+// PCM16 = samples * 2 bytes, MULAW = samples bytes,
+// IMA_ADPCM = ImaAdpcmBlockHeader + samples / 2 bytes.
+// Com AUDIO_FLAG_CAPTURE_TIME, um AudioCaptureTime (8 bytes) vem entre o
+// cabeçalho e as amostras. Com AUDIO_FLAG_STEREO vêm dois blocos de
+// samples amostras, L e depois R, cada um codificado como um quadro mono
+// (no ADPCM, cada canal com o seu ImaAdpcmBlockHeader).
+// Quadro com samples = 0 e sem AUDIO_FLAG_SQUELCH_OPEN: marcador de squelch
+// fechado (só o cabeçalho). timestamp = onde o silêncio começa.
+#pragma pack(push, 1)
+struct AudioFrameHeader {
+    uint8_t magic[2];      // 'S', 'D'
+    uint8_t type;          // AUDIO_FRAME_TYPE
+    uint8_t flags;         // AUDIO_FLAG_*
+    uint8_t channel;       // 0 = receptor principal, >0 = canal extra (ADD_CHANNEL)
+    uint8_t encoding;      // AudioEncoding
+    uint16_t samples;      // Amostras de áudio no quadro (por canal)
+    uint32_t sequence;     // +1 por quadro; buraco = perda
+    uint64_t timestamp;    // Relógio de amostras (taxa de áudio) da primeira amostra
+};
+
+// Instante de captura da primeira amostra do quadro no relógio monotônico
+// do servidor (µs, valor opaco para o cliente): o cliente devolve no eco
+// PLAYOUT e o servidor mede a latência fim a fim
+struct AudioCaptureTime {
+    uint64_t capture_us;
+};
+#pragma pack(pop)
+
+static const uint8_t AUDIO_FRAME_TYPE = 0x01;
+static const uint8_t AUDIO_FLAG_SQUELCH_OPEN = 0x01;
+static const uint8_t AUDIO_FLAG_CAPTURE_TIME = 0x02;
+static const uint8_t AUDIO_FLAG_STEREO = 0x04;
+
+// Empacota o áudio em quadros de duração fixa (ex.: 10/20/40 ms),
+// independente de quantas amostras cada processIQ produz. Com número de
+// sequência e timestamp, o cliente mantém um jitter buffer mínimo e
+// detecta perdas em vez de bufferizar demais. O mesmo quadro pode sair em
+// várias codificações ao mesmo tempo (mesma sequência e timestamp), uma
+// para cada grupo de clientes.
+class AudioPacketizer {
+public:
+    AudioPacketizer(int sample_rate = 48000, int frame_ms = 20, uint8_t channel = 0);
+
+    // Pode ser chamado de outra thread; vale a partir do próximo quadro
+    void setFrameDuration(int ms);
+    int getFrameDuration() const { return frame_ms; }
+    size_t samplesPerFrame() const { return frame_samples; }
+
+    // Máscara de codificações geradas (bit = 1 << AudioEncoding); vale a
+    // partir do próximo quadro. Padrão: só PCM16.
+    void setEncodings(uint32_t mask);
+    static uint32_t encodingBit(AudioEncoding e) { return 1u << static_cast<unsigned>(e); }
+
+    // Acumula PCM; retorna quantos quadros completos ficaram prontos
+    // (acessíveis por frame(i) até a próxima chamada). capture_ns é o
+    // instante de captura de pcm[0] (monotonicNs()); 0 = desconhecido,
+    // quadro sem AudioCaptureTime. channels = 2: n pares L,R intercalados;
+    // mudar o número de canais fecha o quadro parcial com silêncio.
+    size_t push(const int16_t* pcm, size_t n, bool squelch_open, uint64_t capture_ns = 0, int channels = 1);
+
+    // Pula n amostras no relógio (ex.: blocos IQ perdidos). Um quadro
+    // parcial é completado com silêncio e fica pronto.
+    size_t advanceClock(uint64_t n);
+
+    // Squelch fechado por n amostras: completa o quadro parcial com
+    // silêncio, avança o relógio e emite só o marcador (ao fechar e depois
+    // a cada segundo, para quem conectou no meio). Nada é codificado.
+    size_t skipClosed(uint64_t n);
+
+    size_t numFrames() const { return ready; }
+    // Quadro i na codificação e (vazio se e não estava na máscara)
+    const uint8_t* frame(size_t i, AudioEncoding e = AudioEncoding::PCM16) const {
+        const Output& o = outputs[static_cast<size_t>(e)];
+        return o.frames.data() + o.offsets[i];
+    }
+    size_t frameBytes(size_t i, AudioEncoding e = AudioEncoding::PCM16) const {
+        const Output& o = outputs[static_cast<size_t>(e)];
+        return o.offsets[i + 1] - o.offsets[i];
+    }
+    // Captura da primeira amostra do quadro i (ns, 0 = desconhecida)
+    uint64_t frameCaptureNs(size_t i) const { return ready_capture[i]; }
+
+    uint32_t nextSequence() const { return sequence; }
+    void reset();
+
+private:
+    int sample_rate;
+    int frame_ms;
+    uint8_t channel;
+    std::atomic<int> requested_ms;
+    uint32_t encodings;
+    std::atomic<uint32_t> requested_encodings;
+
+    size_t frame_samples;             // Por canal
+    int frame_channels;               // 1 = mono, 2 = estéreo intercalado
+    std::vector<int16_t> pending;     // Amostras do quadro em montagem
+    std::vector<int16_t> planar;      // pending separado por canal (estéreo)
+    size_t pending_count;
+    bool pending_open;                // Squelch abriu em algum momento do quadro
+    uint64_t pending_timestamp;
+    uint64_t pending_capture;         // ns; 0 = sem captura
+
+    // Quadros prontos desta chamada, contíguos, por codificação
+    struct Output {
+        std::vector<uint8_t> frames;
+        std::vector<size_t> offsets;  // Início de cada quadro (+ fim do último)
+        ImaAdpcmState adpcm[2];       // Um estado por canal
+    };
+    Output outputs[static_cast<size_t>(AudioEncoding::COUNT)];
+    size_t ready;
+    std::vector<uint64_t> ready_capture;
+
+    uint64_t clock;                   // Timestamp da próxima amostra
+    bool closed;                      // Último bloco foi skipClosed()
+    uint64_t marker_clock;            // Relógio do último marcador
+    uint32_t sequence;
+
+    void configure(int ms);
+    size_t padPending();
+    void emitFrame();
+    void emitMarker();
+    void applyRequests();
+};
@@ -1,7 +1,8 @@
 #include "audio_processor.h"
 #include <iostream>
-#include math>
+#include <cmath>
 #include <algorithm>
+#include <cstring>
 
 AudioProcessor::AudioProcessor()
     : agc_gain(1.0f),
@@ -12,15 +13,15 @@ AudioProcessor::AudioProcessor()
 
 AudioProcessor::~AudioProcessor() {}
 
-void AudioProcessor::processAudio(std::vector<float>& audio) {
-    if (audio.empty()) return;
+void AudioProcessor::processAudio(float* audio, size_t n) {
+    if (!audio || n == 0) return;
     
     // Encontrar RMS (Root Mean Square)
     float sum_sq = 0.0f;
-    for (float sample : audio) {
-        sum_sq += sample * sample;
+    for (size_t i = 0; i < n; i++) {
+        sum_sq += audio[i] * audio[i];
     }
-    float rms = std::sqrt(sum_sq / audio.size());
+    float rms = std::sqrt(sum_sq / n);
     
     // Evitar divisão por zero
     if (rms < 0.0001f) rms = 0.0001f;
@@ -42,31 +43,155 @@ void AudioProcessor::processAudio(std::vector<float>& audio) {
     }
     
     // Aplicar ganho AGC
-    for (auto& sample : audio) {
-        sample *= agc_gain;
+    for (size_t i = 0; i < n; i++) {
+        float sample = audio[i] * agc_gain;
         
         // Hard clipping para evitar distorção
         if (sample > 1.0f) sample = 1.0f;
         else if (sample < -1.0f) sample = -1.0f;
+        audio[i] = sample;
     }
 }
 
-std::vector<int16_t> AudioProcessor::floatToPCM16(const std::vector<float>& audio) {
-    std::vector<int16_t> pcm;
-    pcm.reserve(audio.size());
-    
-    for (float sample : audio) {
+size_t AudioProcessor::floatToPCM16(const float* audio, size_t n, int16_t* out) {
+    for (size_t i = 0; i < n; i++) {
         // Garantir intervalo [-1.0, 1.0]
-        float clipped = std::max(-1.0f, std::min(1.0f, sample));
+        float clipped = std::max(-1.0f, std::min(1.0f, audio[i]));
         
         // Converter para int16_t [-32768, 32767]
-        int32_t pcm_val = static_cast<int32_t>(clipped * 32767.0f);
-        pcm.push_back(static_cast<int16_t>(pcm_val));
+        out[i] = static_cast<int16_t>(static_cast<int32_t>(clipped * 32767.0f));
     }
     
-    return pcm;
+    return n;
 }
 
 void AudioProcessor::reset() {
     agc_gain = 1.0f;
 }
+
+// ============ Codificações compactas ============
+
+static const int IMA_STEPS[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+    253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+    11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+    32767
+};
+
+static const int IMA_INDEX_DELTA[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+size_t AudioProcessor::encodedBytes(AudioEncoding encoding, size_t n) {
+    switch (encoding) {
+        case AudioEncoding::IMA_ADPCM: return sizeof(ImaAdpcmBlockHeader) + (n + 1) / 2;
+        case AudioEncoding::MULAW: return n;
+        default: return n * sizeof(int16_t);
+    }
+}
+
+size_t AudioProcessor::encode(AudioEncoding encoding, const int16_t* pcm, size_t n,
+                              ImaAdpcmState& state, uint8_t* out) {
+    switch (encoding) {
+        case AudioEncoding::IMA_ADPCM: return encodeImaAdpcm(pcm, n, state, out);
+        case AudioEncoding::MULAW: return encodeMuLaw(pcm, n, out);
+        default:
+            std::memcpy(out, pcm, n * sizeof(int16_t));
+            return n * sizeof(int16_t);
+    }
+}
+
+size_t AudioProcessor::encodeMuLaw(const int16_t* pcm, size_t n, uint8_t* out) {
+    const int BIAS = 0x84;
+    const int CLIP = 32635;
+    for (size_t i = 0; i < n; i++) {
+        int sample = pcm[i];
+        int sign = (sample >> 8) & 0x80;
+        if (sign) sample = -sample;
+        if (sample > CLIP) sample = CLIP;
+        sample += BIAS;
+
+        // Segmento = posição do bit mais alto acima do bit 7
+        int exponent = 7;
+        for (int mask = 0x4000; (sample & mask) == 0 && exponent > 0; mask >>= 1) exponent--;
+        int mantissa = (sample >> (exponent + 3)) & 0x0F;
+        out[i] = static_cast<uint8_t>(~(sign | (exponent << 4) | mantissa));
+    }
+    return n;
+}
+
+size_t AudioProcessor::decodeMuLaw(const uint8_t* in, size_t n, int16_t* out) {
+    for (size_t i = 0; i < n; i++) {
+        int u = ~in[i] & 0xFF;
+        int exponent = (u >> 4) & 0x07;
+        int magnitude = (((u & 0x0F) << 3) + 0x84) << exponent;
+        magnitude -= 0x84;
+        out[i] = static_cast<int16_t>((u & 0x80) ? -magnitude : magnitude);
+    }
+    return n;
+}
+
+size_t AudioProcessor::encodeImaAdpcm(const int16_t* pcm, size_t n, ImaAdpcmState& state, uint8_t* out) {
+    ImaAdpcmBlockHeader header;
+    header.predictor = state.predictor;
+    header.index = state.index;
+    header.reserved = 0;
+    std::memcpy(out, &header, sizeof(header));
+    uint8_t* data = out + sizeof(header);
+
+    int predictor = state.predictor;
+    int index = state.index;
+    for (size_t i = 0; i < n; i++) {
+        int step = IMA_STEPS[index];
+        int diff = pcm[i] - predictor;
+        int code = 0;
+        if (diff < 0) { code = 8; diff = -diff; }
+
+        // Quantização em 3 bits de magnitude; delta reconstruído igual ao decodificador
+        int delta = step >> 3;
+        if (diff >= step) { code |= 4; diff -= step; delta += step; }
+        step >>= 1;
+        if (diff >= step) { code |= 2; diff -= step; delta += step; }
+        step >>= 1;
+        if (diff >= step) { code |= 1; delta += step; }
+
+        predictor += (code & 8) ? -delta : delta;
+        predictor = std::max(-32768, std::min(32767, predictor));
+        index = std::max(0, std::min(88, index + IMA_INDEX_DELTA[code]));
+
+        if (i & 1) data[i >> 1] |= static_cast<uint8_t>(code << 4);
+        else data[i >> 1] = static_cast<uint8_t>(code);
+    }
+
+    state.predictor = static_cast<int16_t>(predictor);
+    state.index = static_cast<uint8_t>(index);
+    return sizeof(header) + (n + 1) / 2;
+}
+
+size_t AudioProcessor::decodeImaAdpcm(const uint8_t* in, size_t bytes, size_t n, int16_t* out) {
+    if (bytes < sizeof(ImaAdpcmBlockHeader)) return 0;
+    ImaAdpcmBlockHeader header;
+    std::memcpy(&header, in, sizeof(header));
+    const uint8_t* data = in + sizeof(header);
+    n = std::min(n, (bytes - sizeof(header)) * 2);
+
+    int predictor = header.predictor;
+    int index = std::min<int>(header.index, 88);
+    for (size_t i = 0; i < n; i++) {
+        int code = (i & 1) ? (data[i >> 1] >> 4) : (data[i >> 1] & 0x0F);
+        int step = IMA_STEPS[index];
+        int delta = step >> 3;
+        if (code & 4) delta += step;
+        if (code & 2) delta += step >> 1;
+        if (code & 1) delta += step >> 2;
+        predictor += (code & 8) ? -delta : delta;
+        predictor = std::max(-32768, std::min(32767, predictor));
+        index = std::max(0, std::min(88, index + IMA_INDEX_DELTA[code]));
+        out[i] = static_cast<int16_t>(predictor);
+    }
+    return n;
+}
@@ -1,17 +1,58 @@
 #pragma once
 #include <vector>
-#include stdint>
+#include <cstdint>
+#include <cstddef>
+
+// Formato das amostras no fio (campo encoding do AudioFrameHeader)
+enum class AudioEncoding : uint8_t {
+    PCM16 = 0,      // 16 bits por amostra
+    IMA_ADPCM = 1,  // 4 bits por amostra, com bloco de estado no início do quadro
+    MULAW = 2,      // G.711 µ-law, 8 bits por amostra
+    COUNT = 3
+};
+
+// Estado do codificador IMA-ADPCM. Vai no início de cada quadro
+// (ImaAdpcmBlockHeader): o decodificador recomeça de qualquer quadro,
+// sem depender dos anteriores, então uma perda não se propaga.
+struct ImaAdpcmState {
+    int16_t predictor = 0;
+    uint8_t index = 0;      // Índice na tabela de passos (0..88)
+};
+
+#pragma pack(push, 1)
+struct ImaAdpcmBlockHeader {
+    int16_t predictor;
+    uint8_t index;
+    uint8_t reserved;
+};
+#pragma pack(pop)
 
 class AudioProcessor {
 public:
     AudioProcessor();
     ~AudioProcessor();
     
-    // Processar áudio com AGC
-    void processAudio(std::vector<float>& audio);
+    // Processar áudio com AGC (no próprio buffer)
+    void processAudio(float* audio, size_t n);
+    void processAudio(std::vector<float>& audio) { processAudio(audio.data(), audio.size()); }
+    
+    // Converter float para PCM 16-bit em out (capacidade >= n); retorna n
+    size_t floatToPCM16(const float* audio, size_t n, int16_t* out);
+    
+    // Codificações compactas (sem dependências externas). Todas retornam
+    // os bytes escritos; out precisa de encodedBytes(encoding, n).
+    static size_t encodedBytes(AudioEncoding encoding, size_t n);
+    static size_t encode(AudioEncoding encoding, const int16_t* pcm, size_t n,
+                         ImaAdpcmState& state, uint8_t* out);
+    
+    // G.711 µ-law: 1 byte por amostra
+    static size_t encodeMuLaw(const int16_t* pcm, size_t n, uint8_t* out);
+    static size_t decodeMuLaw(const uint8_t* in, size_t n, int16_t* out);
     
-    // Converter float para PCM 16-bit
-    std::vector<int16_t> floatToPCM16(const std::vector<float>& audio);
+    // IMA-ADPCM: ImaAdpcmBlockHeader + n/2 bytes (nibble baixo primeiro).
+    // decode retorna as amostras geradas.
+    static size_t encodeImaAdpcm(const int16_t* pcm, size_t n, ImaAdpcmState& state, uint8_t* out);
+    static size_t decodeImaAdpcm(const uint8_t* in, size_t bytes, size_t n, int16_t* out);
     
     // Resetar estado
     void reset();
@@ -0,0 +1,243 @@
+// Benchmark de throughput do DSP: Demodulator::processIQ em todos os modos
+// e tamanhos de bloco, e cada estágio do pipeline isolado. Reporta Msps e
+// fator de tempo real (1.0 = exatamente a taxa do estágio; 10 = um núcleo
+// aguenta ~10 canais) e grava JSON para comparar entre commits.
+//
+//   bench_dsp [--seconds 0.5] [--sizes 4096,16384,65536] [--json saida.json]
+#include "demodulator.h"
+#include "audio_processor.h"
+#include "channel.h"
+#include "cpu_features.h"
+#include "fm_discriminator.h"
+#include "iq_convert.h"
+#include "resampler.h"
+#include "sideband.h"
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifndef SPEEDSDR_GIT_REV
+#define SPEEDSDR_GIT_REV "unknown"
+#endif
+
+static const int INPUT_RATE = 2048000;
+static const int CHANNEL_RATE = 256000;
+static const int AUDIO_RATE = 48000;
+static const int VOICE_RATE = 16000;   // Taxa do canal de SSB/CW
+
+struct Result {
+    std::string stage;          // "demod" ou nome do estágio
+    std::string variant;        // Modo de demodulação, kernel etc.
+    size_t block_samples;       // Amostras de entrada por chamada
+    int rate;                   // Taxa de entrada do estágio (Hz)
+    double msps;
+    double rt_factor;
+};
+
+// ============ Medição ============
+
+// Chama fn até passar 'seconds' (em lotes, para o relógio não pesar);
+// retorna amostras de entrada processadas por segundo
+template <typename Fn>
+static double measure(Fn fn, size_t samples_per_call, double seconds) {
+    typedef std::chrono::steady_clock clock;
+    fn();   // Aquecimento: buffers internos no tamanho final
+    size_t calls = 0;
+    size_t batch = 1;
+    clock::time_point start = clock::now();
+    double elapsed = 0.0;
+    while (elapsed < seconds) {
+        for (size_t i = 0; i < batch; i++) fn();
+        calls += batch;
+        elapsed = std::chrono::duration<double>(clock::now() - start).count();
+        if (elapsed < seconds / 20) batch *= 2;
+    }
+    return static_cast<double>(calls) * samples_per_call / elapsed;
+}
+
+static Result makeResult(const std::string& stage, const std::string& variant,
+                         size_t block_samples, int rate, double samples_per_sec) {
+    Result r;
+    r.stage = stage;
+    r.variant = variant;
+    r.block_samples = block_samples;
+    r.rate = rate;
+    r.msps = samples_per_sec / 1e6;
+    r.rt_factor = samples_per_sec / rate;
+    std::printf("  %-14s %-8s %8zu amostras  %9.2f Msps  %8.1fx tempo real\n",
+                stage.c_str(), variant.c_str(), block_samples, r.msps, r.rt_factor);
+    return r;
+}
+
+// ============ Sinal de teste ============
+
+// Portadora com FM de 1 kHz (desvio 5 kHz) em uint8 intercalado
+static std::vector<uint8_t> makeIQ(size_t num_samples) {
+    std::vector<uint8_t> iq(num_samples * 2);
+    double phase = 0.0;
+    for (size_t k = 0; k < num_samples; k++) {
+        phase += 2.0 * M_PI * 5000.0 * std::sin(2.0 * M_PI * 1000.0 * k / INPUT_RATE) / INPUT_RATE;
+        iq[2 * k] = static_cast<uint8_t>(127.5 + 100.0 * std::cos(phase));
+        iq[2 * k + 1] = static_cast<uint8_t>(127.5 + 100.0 * std::sin(phase));
+    }
+    return iq;
+}
+
+static const char* modeName(DemodMode mode) {
+    switch (mode) {
+        case DemodMode::NFM: return "NFM";
+        case DemodMode::WFM: return "WFM";
+        case DemodMode::AM: return "AM";
+        case DemodMode::USB: return "USB";
+        case DemodMode::LSB: return "LSB";
+        case DemodMode::CW: return "CW";
+    }
+    return "?";
+}
+
+// ============ JSON ============
+
+static bool writeJson(const std::string& path, const std::vector<Result>& results, double seconds) {
+    FILE* f = std::fopen(path.c_str(), "w");
+    if (!f) return false;
+    const CpuFeatures& cpu = getCpuFeatures();
+    std::fprintf(f, "{\n  \"rev\": \"%s\",\n", SPEEDSDR_GIT_REV);
+    std::fprintf(f, "  \"cpu\": {\"sse2\": %s, \"avx2\": %s, \"fma\": %s, \"neon\": %s},\n",
+                 cpu.sse2 ? "true" : "false", cpu.avx2 ? "true" : "false",
+                 cpu.fma ? "true" : "false", cpu.neon ? "true" : "false");
+    std::fprintf(f, "  \"input_rate\": %d,\n  \"seconds_per_case\": %.3f,\n  \"results\": [\n",
+                 INPUT_RATE, seconds);
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& r = results[i];
+        std::fprintf(f, "    {\"stage\": \"%s\", \"variant\": \"%s\", \"block_samples\": %zu, \"rate\": %d, "
+                        "\"msps\": %.4f, \"rt_factor\": %.3f}%s\n",
+                     r.stage.c_str(), r.variant.c_str(), r.block_samples, r.rate,
+                     r.msps, r.rt_factor, i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(f, "  ]\n}\n");
+    return std::fclose(f) == 0;
+}
+
+// ============ Benchmark ============
+
+int main(int argc, char** argv) {
+    double seconds = 0.5;
+    std::string json_path;
+    std::vector<size_t> sizes = { 4096, 16384, 65536, 262144 };   // Bytes IQ por bloco
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--seconds" && i + 1 < argc) {
+            seconds = std::atof(argv[++i]);
+        } else if (arg == "--json" && i + 1 < argc) {
+            json_path = argv[++i];
+        } else if (arg == "--sizes" && i + 1 < argc) {
+            sizes.clear();
+            for (const char* p = argv[++i]; *p; ) {
+                size_t v = std::strtoul(p, const_cast<char**>(&p), 10);
+                if (v >= 64) sizes.push_back(v & ~size_t(1));
+                if (*p == ',') p++;
+                else if (*p) break;
+            }
+        } else {
+            std::fprintf(stderr, "uso: %s [--seconds S] [--sizes b1,b2,...] [--json arquivo]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (sizes.empty() || seconds <= 0.0) return 2;
+
+    size_t max_bytes = 0;
+    for (size_t s : sizes) max_bytes = std::max(max_bytes, s);
+    std::vector<uint8_t> iq = makeIQ(max_bytes / 2);
+
+    IQConverter converter;
+    std::printf("SpeedSDR DSP benchmark (rev %s, kernel IQ %s, entrada %d Hz)\n\n",
+                SPEEDSDR_GIT_REV, IQConverter::kernelName(converter.getKernel()), INPUT_RATE);
+
+    std::vector<Result> results;
+    const DemodMode modes[] = { DemodMode::NFM, DemodMode::WFM, DemodMode::AM,
+                                DemodMode::USB, DemodMode::LSB, DemodMode::CW };
+
+    // Pipeline completo: um Demodulator = um canal ouvido
+    std::printf("Demodulator::processIQ\n");
+    for (DemodMode mode : modes) {
+        for (size_t bytes : sizes) {
+            Demodulator demod(INPUT_RATE, CHANNEL_RATE);
+            demod.setMode(mode);
+            demod.reserve(bytes);
+            std::vector<float> audio(demod.maxOutputSamples(bytes));
+            double sps = measure([&] { demod.processIQ(iq.data(), bytes, audio.data(), audio.size()); },
+                                 bytes / 2, seconds);
+            results.push_back(makeResult("demod", modeName(mode), bytes / 2, INPUT_RATE, sps));
+        }
+    }
+
+    // Estágios isolados, cada um na sua taxa de entrada
+    std::printf("\nEstagios\n");
+    for (size_t bytes : sizes) {
+        size_t n = bytes / 2;
+
+        std::vector<std::complex<float>> baseband(n);
+        results.push_back(makeResult("convertIQData", IQConverter::kernelName(converter.getKernel()), n, INPUT_RATE,
+            measure([&] { converter.toComplex(iq.data(), n, baseband.data()); }, n, seconds)));
+
+        ChannelSelector channel(INPUT_RATE, CHANNEL_RATE, Demodulator::bandwidthForMode(DemodMode::WFM));
+        channel.setOffset(25000.0);
+        std::vector<std::complex<float>> chan(channel.maxOutput(n));
+        results.push_back(makeResult("channel", "nco+fir", n, INPUT_RATE,
+            measure([&] { channel.process(baseband.data(), n, chan.data()); }, n, seconds)));
+
+        // Estágios depois da decimação: blocos proporcionalmente menores
+        size_t nc = n * CHANNEL_RATE / INPUT_RATE;
+        std::vector<std::complex<float>> chan_in(nc);
+        for (size_t k = 0; k < nc; k++) chan_in[k] = std::polar(1.0f, static_cast<float>(0.3 * k));
+        std::vector<float> demod_out(nc);
+
+        const AtanMode atan_modes[] = { AtanMode::EXACT, AtanMode::POLY, AtanMode::LUT };
+        const char* atan_names[] = { "exact", "poly", "lut" };
+        for (int m = 0; m < 3; m++) {
+            FMDiscriminator disc(atan_modes[m]);
+            results.push_back(makeResult("discriminator", atan_names[m], nc, CHANNEL_RATE,
+                measure([&] { disc.process(chan_in.data(), nc, demod_out.data()); }, nc, seconds)));
+        }
+
+        size_t nv = n * VOICE_RATE / INPUT_RATE;
+        SidebandDemodulator ssb(VOICE_RATE);
+        ssb.configure(Sideband::UPPER, 300.0f, 2700.0f, 0.0f);
+        results.push_back(makeResult("sideband", ssb.isVectorized() ? "simd" : "scalar", nv, VOICE_RATE,
+            measure([&] { ssb.process(chan_in.data(), nv, demod_out.data()); }, nv, seconds)));
+
+        MultiStageDecimator<float> resampler(CHANNEL_RATE, AUDIO_RATE);
+        std::vector<float> audio(resampler.maxOutput(nc));
+        results.push_back(makeResult("resampler", "256k-48k", nc, CHANNEL_RATE,
+            measure([&] { resampler.process(demod_out.data(), nc, audio.data()); }, nc, seconds)));
+
+        size_t na = nc * AUDIO_RATE / CHANNEL_RATE;
+        std::vector<float> audio_in(na);
+        for (size_t k = 0; k < na; k++) audio_in[k] = 0.3f * std::sin(2.0f * 3.14159265f * 1000.0f * k / AUDIO_RATE);
+        std::vector<float> agc_buf(na);
+        std::vector<int16_t> pcm(na);
+        AudioProcessor agc;
+        results.push_back(makeResult("processAudio", "agc", na, AUDIO_RATE,
+            measure([&] {
+                std::memcpy(agc_buf.data(), audio_in.data(), na * sizeof(float));
+                agc.processAudio(agc_buf.data(), na);
+            }, na, seconds)));
+        results.push_back(makeResult("floatToPCM16", "pcm16", na, AUDIO_RATE,
+            measure([&] { agc.floatToPCM16(audio_in.data(), na, pcm.data()); }, na, seconds)));
+    }
+
+    if (!json_path.empty()) {
+        if (!writeJson(json_path, results, seconds)) {
+            std::fprintf(stderr, "Falha ao gravar %s\n", json_path.c_str());
+            return 1;
+        }
+        std::printf("\nResultados em %s\n", json_path.c_str());
+    }
+    return 0;
+}
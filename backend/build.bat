@@ -13,7 +13,7 @@ dir /B *.cpp *.h *.dll 2>nul
 
 echo.
 echo [INFO] Compilando...
-cl /EHsc /std:c++17 /W3 main.cpp /link /MACHINE:X86 ws2_32.lib rtlsdr.lib /OUT:%OUTNAME%
+cl /EHsc /std:c++17 /W3 main.cpp spectrum.cpp iq_stream.cpp channel.cpp resampler.cpp fft.cpp iq_convert.cpp cpu_features.cpp /link /MACHINE:X86 ws2_32.lib rtlsdr.lib /OUT:%OUTNAME%
 
 if errorlevel 1 (
   echo.
@@ -0,0 +1,114 @@
+#include "channel.h"
+#include <algorithm>
+#include <cmath>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// ============ NCO Implementation ============
+
+NCO::NCO(int rate)
+    : sample_rate(rate), offset(0.0), phase(0.0) {}
+
+void NCO::setOffset(double offset_hz) {
+    offset.store(offset_hz, std::memory_order_relaxed);
+}
+
+void NCO::mix(const std::complex<float>* in, size_t n, std::complex<float>* out) {
+    double f = offset.load(std::memory_order_relaxed);
+    if (f == 0.0) {
+        if (in != out) std::copy(in, in + n, out);
+        return;
+    }
+
+    const double dphi = -2.0 * M_PI * f / sample_rate;
+
+    // 4 osciladores intercalados (fases k, k+1, k+2, k+3) avançando 4 passos
+    // por iteração: cadeias independentes, sem dependência serial longa.
+    float osc_r[4], osc_i[4];
+    for (int l = 0; l < 4; l++) {
+        osc_r[l] = static_cast<float>(std::cos(phase + l * dphi));
+        osc_i[l] = static_cast<float>(std::sin(phase + l * dphi));
+    }
+    const float step_r = static_cast<float>(std::cos(4.0 * dphi));
+    const float step_i = static_cast<float>(std::sin(4.0 * dphi));
+
+    const float* src = reinterpret_cast<const float*>(in);
+    float* dst = reinterpret_cast<float*>(out);
+
+    size_t k = 0;
+    for (; k + 4 <= n; k += 4) {
+        for (int l = 0; l < 4; l++) {
+            float xr = src[2 * (k + l)], xi = src[2 * (k + l) + 1];
+            dst[2 * (k + l)]     = xr * osc_r[l] - xi * osc_i[l];
+            dst[2 * (k + l) + 1] = xr * osc_i[l] + xi * osc_r[l];
+
+            float r = osc_r[l] * step_r - osc_i[l] * step_i;
+            osc_i[l] = osc_r[l] * step_i + osc_i[l] * step_r;
+            osc_r[l] = r;
+        }
+    }
+    for (int l = 0; k < n; k++, l++) {
+        float xr = src[2 * k], xi = src[2 * k + 1];
+        dst[2 * k]     = xr * osc_r[l] - xi * osc_i[l];
+        dst[2 * k + 1] = xr * osc_i[l] + xi * osc_r[l];
+    }
+
+    // Fase exata do próximo bloco (a recorrência em float é descartada)
+    phase = std::fmod(phase + dphi * static_cast<double>(n), 2.0 * M_PI);
+}
+
+void NCO::reset() {
+    phase = 0.0;
+}
+
+// ============ ChannelSelector Implementation ============
+
+static std::vector<float> designChannelFilter(float bandwidth_hz, int channel_rate) {
+    // Corte em bw/2; transição de bw/2, no mínimo 1% da taxa (evita FIRs
+    // enormes nos modos estreitos)
+    float nyquist = 0.5f * channel_rate;
+    float cutoff = std::min(0.5f * bandwidth_hz, 0.9f * nyquist);
+    float transition = std::max(0.5f * bandwidth_hz, 0.01f * channel_rate);
+
+    // Transição que não cabe até a Nyquist (WFM: 200 kHz num canal de
+    // 256 kHz) põe o corte do FIR na própria Nyquist: meia dúzia de taps
+    // quase delta que não rejeitam nada. O decimador já limpou os aliases;
+    // sem taps, o canal passa direto.
+    if (transition >= 2.0f * (nyquist - cutoff)) return {};
+
+    return designLowpassFIR((cutoff + 0.5f * transition) / channel_rate,
+                            transition / channel_rate, 60.0f);
+}
+
+ChannelSelector::ChannelSelector(int in_rate, int ch_rate, float bandwidth_hz)
+    : input_rate(in_rate),
+      channel_rate(ch_rate),
+      bandwidth(bandwidth_hz),
+      nco(in_rate),
+      // Decimação projetada para a banda mais larga possível na taxa do canal:
+      // o FIR de canal é que define a seletividade de cada modo
+      decimator(in_rate, ch_rate, 0.4f * ch_rate),
+      channel_filter(designChannelFilter(bandwidth_hz, ch_rate)) {}
+
+void ChannelSelector::setBandwidth(float bandwidth_hz) {
+    if (bandwidth_hz == bandwidth) return;
+    bandwidth = bandwidth_hz;
+    channel_filter.setTaps(designChannelFilter(bandwidth_hz, channel_rate));
+}
+
+size_t ChannelSelector::process(const std::complex<float>* in, size_t n, std::complex<float>* out) {
+    if (mixed.size() < n) mixed.resize(n);
+
+    nco.mix(in, n, mixed.data());
+    size_t count = decimator.process(mixed.data(), n, out);
+    if (channel_filter.numTaps() > 1) channel_filter.process(out, count, out);
+    return count;
+}
+
+void ChannelSelector::reset() {
+    nco.reset();
+    decimator.reset();
+    channel_filter.reset();
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <atomic>
+#include <complex>
+#include <cstddef>
+#include <vector>
+#include "resampler.h"
+
+// Oscilador numericamente controlado: desloca o espectro de -offset Hz,
+// trazendo o sinal em +offset para DC. A fase é contínua entre blocos e
+// entre mudanças de frequência.
+class NCO {
+public:
+    explicit NCO(int sample_rate);
+
+    // Pode ser chamado de outra thread; vale a partir do próximo bloco
+    void setOffset(double offset_hz);
+    double getOffset() const { return offset.load(std::memory_order_relaxed); }
+
+    // out[k] = in[k] * exp(-j * 2pi * offset * t); in == out permitido
+    void mix(const std::complex<float>* in, size_t n, std::complex<float>* out);
+    void reset();
+
+private:
+    int sample_rate;
+    std::atomic<double> offset;
+    double phase;            // Radianos, mantido em double para não acumular erro
+};
+
+// Seleção de canal dentro da banda capturada:
+// NCO -> decimação complexa (meias-bandas) -> FIR de canal
+class ChannelSelector {
+public:
+    ChannelSelector(int input_rate, int channel_rate, float bandwidth_hz);
+
+    void setOffset(double offset_hz) { nco.setOffset(offset_hz); }
+    double getOffset() const { return nco.getOffset(); }
+
+    // Reprojeta o FIR de canal (chamar na thread de DSP)
+    void setBandwidth(float bandwidth_hz);
+    float getBandwidth() const { return bandwidth; }
+
+    size_t process(const std::complex<float>* in, size_t n, std::complex<float>* out);
+    size_t maxOutput(size_t n) const { return decimator.maxOutput(n); }
+    int getChannelRate() const { return channel_rate; }
+    // Atraso da última saída em relação à última entrada, em segundos
+    double outputLag() const { return decimator.outputLag() + channel_filter.groupDelay() / channel_rate; }
+    void reset();
+
+private:
+    int input_rate;
+    int channel_rate;
+    float bandwidth;
+    NCO nco;
+    MultiStageDecimator<std::complex<float>> decimator;
+    FIRFilter<std::complex<float>> channel_filter;
+    std::vector<std::complex<float>> mixed;
+};
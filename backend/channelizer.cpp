@@ -0,0 +1,209 @@
+#include "channelizer.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// ============ PolyphaseChannelizer Implementation ============
+
+PolyphaseChannelizer::PolyphaseChannelizer(int rate, size_t bins)
+    : sample_rate(rate),
+      num_bins(bins),
+      decimation(bins / 2),
+      fft(bins),
+      max_frames(0),
+      frames(0),
+      pending(0),
+      frame_index(0) {
+    // Protótipo: passa até 0.75 * espaçamento (um sinal a até meio canal do
+    // centro ainda cabe inteiro), rejeita a partir de 1.25 * espaçamento.
+    // Com saída a 2 * espaçamento, nada dobra para dentro da faixa útil.
+    double spacing = static_cast<double>(sample_rate) / num_bins;
+    prototype = designLowpassFIR(static_cast<float>(spacing / sample_rate),
+                                 static_cast<float>(0.5 * spacing / sample_rate));
+    size_t padded = (prototype.size() + num_bins - 1) / num_bins * num_bins;
+    prototype.resize(padded, 0.0f);
+
+    fold.resize(num_bins);
+    reset();
+}
+
+size_t PolyphaseChannelizer::binForOffset(double offset_hz) const {
+    long k = std::lround(offset_hz / binSpacing());
+    long m = static_cast<long>(num_bins);
+    return static_cast<size_t>(((k % m) + m) % m);
+}
+
+double PolyphaseChannelizer::binCenter(size_t k) const {
+    long signed_k = k < num_bins / 2 ? static_cast<long>(k) : static_cast<long>(k) - static_cast<long>(num_bins);
+    return signed_k * binSpacing();
+}
+
+size_t PolyphaseChannelizer::process(const std::complex<float>* in, size_t n) {
+    const size_t taps = prototype.size();
+    const size_t hist = taps - 1;
+    const size_t mask = num_bins - 1;
+
+    size_t needed = maxFrames(n);
+    if (needed > max_frames) {
+        max_frames = needed;
+        outputs.resize(num_bins * max_frames);
+    }
+
+    work.resize(hist + n);
+    std::copy(in, in + n, work.begin() + hist);
+
+    frames = 0;
+    for (size_t j = 0; j < n; j++) {
+        if (++pending < decimation) continue;
+        pending = 0;
+
+        // Janela + dobra: fold[r] = sum_p h[r + pM] * x[i - r - pM]
+        const std::complex<float>* x = &work[hist + j];
+        std::fill(fold.begin(), fold.end(), std::complex<float>(0.0f, 0.0f));
+        for (size_t t = 0; t < taps; t++) {
+            fold[t & mask] += x[-static_cast<ptrdiff_t>(t)] * prototype[t];
+        }
+
+        // Canal k: sum_r fold[r] e^{+j2pi kr/M}, depois (-1)^(k*m) por D = M/2
+        fft.inverse(fold.data());
+        const bool odd_frame = (frame_index & 1) != 0;
+        for (size_t k = 0; k < num_bins; k++) {
+            std::complex<float> y = fold[k];
+            if (odd_frame && (k & 1)) y = -y;
+            outputs[k * max_frames + frames] = y;
+        }
+
+        frames++;
+        frame_index++;
+    }
+
+    std::copy(work.end() - hist, work.end(), work.begin());
+    work.resize(hist);
+    return frames;
+}
+
+void PolyphaseChannelizer::reset() {
+    work.assign(prototype.size() - 1, std::complex<float>(0.0f, 0.0f));
+    frames = 0;
+    pending = 0;
+    frame_index = 0;
+}
+
+// ============ MultiChannelReceiver Implementation ============
+
+MultiChannelReceiver::MultiChannelReceiver(int rate, size_t num_bins, size_t num_threads)
+    : sample_rate(rate),
+      channelizer(rate, num_bins),
+      pool(num_threads) {
+    std::cout << "[Channelizer] " << num_bins << " canais de "
+              << channelizer.binSpacing() / 1000.0 << " kHz, saida "
+              << channelizer.outputRate() << " Hz, " << pool.numThreads() << " threads\n";
+}
+
+int MultiChannelReceiver::addChannel(double offset_hz, DemodMode mode) {
+    if (std::fabs(offset_hz) > 0.45 * sample_rate) return -1;
+
+    // Construção (com alocações) fora do lock para não travar o processamento
+    std::unique_ptr<Channel> ch(new Channel());
+    ch->offset_hz = offset_hz;
+    ch->bin = channelizer.binForOffset(offset_hz);
+
+    int rate = channelizer.outputRate();
+    ch->demod.reset(new Demodulator(rate, rate / 2));
+    ch->demod->setMode(mode);
+    // Ajuste fino: o channelizer já deixou o canal a menos de meio bin de DC
+    ch->demod->setOffset(offset_hz - channelizer.binCenter(ch->bin));
+    ch->audio_count = 0;
+    ch->squelch_open = true;
+    ch->started = false;
+
+    std::lock_guard<std::mutex> lock(channels_mutex);
+    for (int id = 1; id <= MAX_CHANNEL_ID; id++) {
+        bool used = std::any_of(channels.begin(), channels.end(),
+                                [id](const std::unique_ptr<Channel>& c) { return c->id == id; });
+        if (used) continue;
+        ch->id = id;
+        channels.push_back(std::move(ch));
+        return id;
+    }
+    return -1;
+}
+
+bool MultiChannelReceiver::removeChannel(int id) {
+    std::unique_ptr<Channel> removed;
+    {
+        std::lock_guard<std::mutex> lock(channels_mutex);
+        auto it = std::find_if(channels.begin(), channels.end(),
+                               [id](const std::unique_ptr<Channel>& c) { return c->id == id; });
+        if (it == channels.end()) return false;
+        removed = std::move(*it);
+        channels.erase(it);
+    }
+    return true;  // Destruição fora do lock
+}
+
+bool MultiChannelReceiver::setChannelMode(int id, DemodMode mode) {
+    std::lock_guard<std::mutex> lock(channels_mutex);
+    for (auto& c : channels) {
+        if (c->id == id) {
+            c->demod->setMode(mode);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool MultiChannelReceiver::setChannelSquelch(int id, const SquelchConfig& config) {
+    std::lock_guard<std::mutex> lock(channels_mutex);
+    for (auto& c : channels) {
+        if (c->id == id) {
+            c->demod->squelch().configure(config);
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t MultiChannelReceiver::numChannels() const {
+    std::lock_guard<std::mutex> lock(channels_mutex);
+    return channels.size();
+}
+
+void MultiChannelReceiver::process(const uint8_t* iq, size_t len, const AudioCallback& on_audio) {
+    std::lock_guard<std::mutex> lock(channels_mutex);
+    if (channels.empty()) return;
+
+    // Conversão e canalização uma única vez para todos os canais
+    size_t n = len / 2;
+    iq_buffer.resize(n);
+    converter.toComplex(iq, n, iq_buffer.data());
+    size_t frames = channelizer.process(iq_buffer.data(), n);
+    if (frames == 0) return;
+
+    for (auto& c : channels) {
+        size_t max_audio = c->demod->maxOutputForBaseband(frames);
+        if (c->audio.size() < max_audio) {
+            c->audio.resize(max_audio);
+            c->pcm.resize(max_audio);
+        }
+    }
+
+    // Cada canal é independente: demodulação + AGC + PCM em paralelo.
+    // Squelch fechado: só a demodulação (mantém filtros e piso de ruído)
+    pool.parallelFor(channels.size(), [this, frames](size_t i) {
+        Channel& c = *channels[i];
+        c.audio_count = c.demod->processBaseband(channelizer.binOutput(c.bin), frames,
+                                                 c.audio.data(), c.audio.size());
+        c.squelch_open = c.demod->squelchOpen();
+        if (!c.squelch_open) return;
+        c.agc.processAudio(c.audio.data(), c.audio_count);
+        c.agc.floatToPCM16(c.audio.data(), c.audio_count, c.pcm.data());
+    });
+
+    for (auto& c : channels) {
+        if (c->audio_count > 0) {
+            on_audio(c->id, c->squelch_open ? c->pcm.data() : nullptr, c->audio_count, c->squelch_open, !c->started);
+            c->started = true;
+        }
+    }
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "fft.h"
+#include "iq_convert.h"
+#include "demodulator.h"
+#include "audio_processor.h"
+#include "worker_pool.h"
+#include "aligned_buffer.h"
+
+// Banco de filtros polifásico com FFT (WOLA), sobreamostrado por 2:
+// M canais espaçados de fs/M, cada um com saída a 2*fs/M.
+// Custo por amostra de entrada: L/D MACs + uma FFT de M pontos a cada D
+// amostras, independente de quantos canais são usados depois.
+class PolyphaseChannelizer {
+public:
+    // num_bins deve ser potência de 2
+    PolyphaseChannelizer(int sample_rate, size_t num_bins);
+
+    // Processa n amostras; retorna o número de quadros gerados (amostras por canal)
+    size_t process(const std::complex<float>* in, size_t n);
+
+    // Saída do canal k do último process() (numFrames() amostras)
+    const std::complex<float>* binOutput(size_t k) const { return &outputs[k * max_frames]; }
+    size_t numFrames() const { return frames; }
+    size_t maxFrames(size_t n) const { return (n + pending + decimation - 1) / decimation; }
+
+    size_t numBins() const { return num_bins; }
+    double binSpacing() const { return static_cast<double>(sample_rate) / num_bins; }
+    int outputRate() const { return static_cast<int>(sample_rate / decimation); }
+
+    // Canal mais próximo de offset_hz e frequência central desse canal
+    size_t binForOffset(double offset_hz) const;
+    double binCenter(size_t k) const;
+
+    void reset();
+
+private:
+    int sample_rate;
+    size_t num_bins;        // M
+    size_t decimation;      // D = M/2
+    std::vector<float> prototype; // h[n] multiplica x[i - n]; tamanho múltiplo de M
+    FFT fft;
+
+    std::vector<std::complex<float>> work;    // Histórico + bloco atual
+    AlignedVector<std::complex<float>> fold;  // Vetor de M pontos da FFT
+    AlignedVector<std::complex<float>> outputs;
+    size_t max_frames;
+    size_t frames;
+    size_t pending;         // Amostras desde o último quadro
+    uint64_t frame_index;   // Paridade corrige a rotação de fase (D = M/2)
+};
+
+// Vários demoduladores independentes alimentados pelo mesmo RTL-SDR.
+// Os canais são extraídos pelo PolyphaseChannelizer e o resto do pipeline
+// (ajuste fino de offset, filtro de canal, demodulação, AGC, PCM) roda em
+// paralelo no WorkerPool, à taxa do canal.
+class MultiChannelReceiver {
+public:
+    // Callback por canal: id, PCM 16-bit a 48 kHz, número de amostras,
+    // squelch aberto e primeiro bloco do canal. Com o squelch fechado o PCM é
+    // nulo (AGC e conversão não rodam); as amostras só contam para o relógio.
+    // Os ids são reaproveitados: no primeiro bloco o estado por id (sequência
+    // e timestamp do áudio) deve recomeçar.
+    typedef std::function<void(int, const int16_t*, size_t, bool, bool)> AudioCallback;
+
+    // Ids de 1 a MAX_CHANNEL_ID: o id vai em um byte no cabeçalho do áudio
+    static const int MAX_CHANNEL_ID = 255;
+
+    MultiChannelReceiver(int sample_rate, size_t num_bins = 64, size_t num_threads = 0);
+
+    // offset_hz relativo ao centro do RTL-SDR; retorna o menor id livre, ou
+    // -1 se fora da banda ou sem id livre
+    int addChannel(double offset_hz, DemodMode mode);
+    bool removeChannel(int id);
+    bool setChannelMode(int id, DemodMode mode);
+    bool setChannelSquelch(int id, const SquelchConfig& config);
+    size_t numChannels() const;
+
+    // Bloco IQ bruto (uint8 intercalado) vindo do RTL-SDR
+    void process(const uint8_t* iq, size_t len, const AudioCallback& on_audio);
+
+private:
+    struct Channel {
+        int id;
+        double offset_hz;
+        size_t bin;
+        std::unique_ptr<Demodulator> demod;
+        AudioProcessor agc;
+        std::vector<float> audio;
+        std::vector<int16_t> pcm;
+        size_t audio_count;
+        bool squelch_open;
+        bool started;           // Já entregou áudio pelo callback
+    };
+
+    int sample_rate;
+    PolyphaseChannelizer channelizer;
+    IQConverter converter;
+    WorkerPool pool;
+    AlignedVector<std::complex<float>> iq_buffer;
+
+    mutable std::mutex channels_mutex;
+    std::vector<std::unique_ptr<Channel>> channels;
+};
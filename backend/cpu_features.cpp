@@ -0,0 +1,65 @@
+#include "cpu_features.h"
+
+#if defined(SPEEDSDR_X86)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#if defined(SPEEDSDR_X86)
+static void cpuid(int leaf, int subleaf, unsigned int regs[4]) {
+#if defined(_MSC_VER)
+    int r[4];
+    __cpuidex(r, leaf, subleaf);
+    for (int i = 0; i < 4; i++) regs[i] = static_cast<unsigned int>(r[i]);
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+// O SO precisa salvar os registradores YMM (XCR0 bits 1 e 2)
+static bool osSupportsAVX() {
+#if defined(_MSC_VER)
+    return (_xgetbv(0) & 0x6) == 0x6;
+#else
+    unsigned int eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (eax & 0x6) == 0x6;
+#endif
+}
+#endif
+
+static CpuFeatures detectCpuFeatures() {
+    CpuFeatures f;
+
+#if defined(SPEEDSDR_X86)
+    unsigned int regs[4];
+    cpuid(0, 0, regs);
+    unsigned int max_leaf = regs[0];
+
+    cpuid(1, 0, regs);
+    f.sse2 = (regs[3] & (1u << 26)) != 0;
+    bool osxsave = (regs[2] & (1u << 27)) != 0;
+    bool avx = (regs[2] & (1u << 28)) != 0;
+    f.fma = (regs[2] & (1u << 12)) != 0;
+
+    if (max_leaf >= 7 && osxsave && avx && osSupportsAVX()) {
+        cpuid(7, 0, regs);
+        f.avx2 = (regs[1] & (1u << 5)) != 0;
+    }
+    f.fma = f.fma && f.avx2;
+#endif
+
+#if defined(SPEEDSDR_NEON)
+    f.neon = true;  // Obrigatório em AArch64
+#endif
+
+    return f;
+}
+
+const CpuFeatures& getCpuFeatures() {
+    static const CpuFeatures features = detectCpuFeatures();
+    return features;
+}
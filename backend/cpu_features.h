@@ -0,0 +1,30 @@
+#pragma once
+
+// Detecção de recursos SIMD em tempo de execução (x86: SSE2/AVX2, ARM: NEON)
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SPEEDSDR_X86 1
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(__aarch64__) || defined(_M_ARM64)
+#define SPEEDSDR_NEON 1
+#endif
+
+// Permite compilar funções AVX2/SSE2 sem ativar -mavx2 no arquivo inteiro
+#if defined(SPEEDSDR_X86) && (defined(__GNUC__) || defined(__clang__))
+#define SPEEDSDR_TARGET_SSE2 __attribute__((target("sse2")))
+#define SPEEDSDR_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#define SPEEDSDR_TARGET_SSE2
+#define SPEEDSDR_TARGET_AVX2
+#endif
+
+struct CpuFeatures {
+    bool sse2 = false;
+    bool avx2 = false;
+    bool fma = false;
+    bool neon = false;
+};
+
+// Resultado em cache (detectado uma única vez)
+const CpuFeatures& getCpuFeatures();
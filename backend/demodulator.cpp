@@ -1,6 +1,23 @@
 #include "demodulator.h"
 #include <iostream>
 
+#define AUDIO_RATE 48000
+
+// Menor taxa intermediária aceitável por modo; a efetiva é a primeira
+// input_rate / 2^k que não fica abaixo dela (só meias-bandas no canal complexo)
+static const int NARROW_MIN_RATE = 24000;     // NFM/AM: 15 kHz de banda
+static const int VOICE_MIN_RATE = 12000;      // SSB/CW: 6 kHz de banda
+
+// Suavização pós-discriminador calibrada em 256 kHz; em outra taxa o polo
+// é reescalado para manter a mesma frequência de corte
+static const float SMOOTH_REF_RATE = 256000.0f;
+
+// Composto do WFM precisa chegar ao RDS (57 kHz +- 2.4 kHz)
+static const int STEREO_MIN_RATE = 128000;
+
+// Largura do filtro de CW em volta do tom de batimento
+static const float CW_FILTER_HZ = 500.0f;
+
 // ============ SimpleFilter Implementation ============
 
 SimpleFilter::SimpleFilter(float cutoff_ratio)
@@ -18,83 +35,63 @@ void SimpleFilter::reset() {
     prev_output = 0.0f;
 }
 
-// ============ LinearResampler Implementation ============
-
-LinearResampler::LinearResampler(int in_rate, int out_rate)
-    : input_rate(in_rate), output_rate(out_rate), phase(0.0f) {}
-
-LinearResampler::~LinearResampler() {}
-
-std::vector<float> LinearResampler::resample(const std::vector<float>& input) {
-    std::vector<float> output;
-    if (input.empty()) return output;
-    
-    for (float sample : input) {
-        buffer.push_back(sample);
-    }
-    
-    float ratio = static_cast<float>(input_rate) / static_cast<float>(output_rate);
-    
-    while (phase < static_cast<float>(buffer.size() - 1)) {
-        size_t idx = static_cast<size_t>(phase);
-        float frac = phase - idx;
-        
-        // Interpolação linear suave
-        float s0 = buffer[idx];
-        float s1 = buffer[idx + 1];
-        float sample = s0 * (1.0f - frac) + s1 * frac;
-        
-        output.push_back(sample);
-        phase += ratio;
-    }
-    
-    if (phase >= buffer.size() - 1) {
-        phase -= (buffer.size() - 1);
-        buffer.clear();
-    }
-    
-    return output;
-}
-
-void LinearResampler::reset() {
-    phase = 0.0f;
-    buffer.clear();
-}
-
 // ============ Demodulator Implementation ============
 
-Demodulator::Demodulator()
+Demodulator::ChannelPath::ChannelPath(int input_rate, int channel_rate, float bandwidth_hz)
+    : channel(input_rate, channel_rate, bandwidth_hz),
+      // Ex.: 256000 -> 64000 (meias-bandas) -> 48000 (polifásico 3/4);
+      // 32000 e 16000 só interpolam (3/2 e 3/1)
+      resampler(channel_rate, AUDIO_RATE) {}
+
+Demodulator::Demodulator(int input_rate, int channel_rate)
     : currentMode(DemodMode::WFM),
+      requestedMode(DemodMode::WFM),
       currentQuadMode(QuadMode::QUADRATURE),
-      prev_sample(0, 0),
-      prev_audio(0.0f) {
-    
-    // Resampler: 2048000 -> 48000
-    resampler = new LinearResampler(2048000, 48000);
-    
-    // Filtro antes (anti-aliasing, cutoff ~25kHz)
-    pre_filter = new SimpleFilter(25000.0f / 2048000.0f);
+      requestedQuadMode(QuadMode::QUADRATURE),
+      input_rate(input_rate),
+      max_channel_rate(channel_rate),
+      requested_ssb_low(300.0f),
+      requested_ssb_high(2700.0f),
+      requested_cw_pitch(700.0f),
+      requested_stereo(true),
+      path(nullptr),
+      // Filtro depois (audio, cutoff ~8kHz)
+      post_filter(8000.0f / 48000.0f),
+      // De-emphasis para WFM (75µs)
+      // tau = 75e-6, frequency = 1 / (2*pi*tau) ≈ 2122 Hz
+      deemph_filter(2122.0f / 48000.0f),
+      discriminator(AtanMode::POLY),
+      sideband(channelRateForMode(DemodMode::USB, input_rate, channel_rate)),
+      output_channels(1),
+      prev_audio(0.0f),
+      smooth_pole(0.5f) {
+    
+    // Um caminho por taxa intermediária distinta
+    const DemodMode modes[] = { DemodMode::WFM, DemodMode::NFM, DemodMode::AM,
+                                DemodMode::USB, DemodMode::LSB, DemodMode::CW };
+    for (DemodMode mode : modes) {
+        int rate = channelRateForMode(mode, this->input_rate, max_channel_rate);
+        bool exists = false;
+        for (const auto& p : paths) exists = exists || p->channel.getChannelRate() == rate;
+        if (!exists) paths.emplace_back(new ChannelPath(this->input_rate, rate, bandwidthForMode(mode)));
+    }
+    selectPath(currentMode);
     
-    // Filtro depois (audio, cutoff ~8kHz)
-    post_filter = new SimpleFilter(8000.0f / 48000.0f);
+    // Estéreo e RDS compartilham o PLL do piloto, na taxa do canal WFM
+    int composite_rate = channelRateForMode(DemodMode::WFM, this->input_rate, max_channel_rate);
+    if (composite_rate >= STEREO_MIN_RATE) {
+        stereo.reset(new StereoDecoder(composite_rate, AUDIO_RATE));
+        rds_decoder.reset(new RdsDecoder(composite_rate));
+    }
     
-    // De-emphasis para WFM (75µs)
-    // tau = 75e-6, frequency = 1 / (2*pi*tau) ≈ 2122 Hz
-    deemph_filter = new SimpleFilter(2122.0f / 48000.0f);
+    std::cout << "[Demod] Conversao IQ: " << IQConverter::kernelName(iq_converter.getKernel()) << "\n";
 }
 
-Demodulator::~Demodulator() {
-    delete resampler;
-    delete pre_filter;
-    delete post_filter;
-    delete deemph_filter;
-}
+Demodulator::~Demodulator() {}
 
 void Demodulator::setMode(DemodMode mode) {
-    if (currentMode != mode) {
-        currentMode = mode;
-        reset();
-        
+    // O estado de DSP só é tocado pela thread de processamento (applyRequestedMode)
+    if (requestedMode.exchange(mode) != mode) {
         std::cout << "[Demod] Modo: ";
         switch (mode) {
             case DemodMode::NFM: std::cout << "NFM (15kHz)\n"; break;
@@ -107,197 +104,276 @@ void Demodulator::setMode(DemodMode mode) {
     }
 }
 
-void Demodulator::setQuadMode(QuadMode mode) {
-    if (currentQuadMode != mode) {
-        currentQuadMode = mode;
-        reset();
+float Demodulator::bandwidthForMode(DemodMode mode) {
+    switch (mode) {
+        case DemodMode::NFM: return 15000.0f;
+        case DemodMode::WFM: return 200000.0f;
+        case DemodMode::AM:  return 10000.0f;
+        case DemodMode::USB: return 6000.0f;   // +-3 kHz em torno da portadora
+        case DemodMode::LSB: return 6000.0f;
+        case DemodMode::CW:  return 1000.0f;
     }
+    return 15000.0f;
 }
 
-void Demodulator::reset() {
-    prev_sample = std::complex<float>(0, 0);
-    prev_audio = 0.0f;
-    if (pre_filter) pre_filter->reset();
-    if (post_filter) post_filter->reset();
-    if (deemph_filter) deemph_filter->reset();
+int Demodulator::channelRateForMode(DemodMode mode, int input_rate, int max_rate) {
+    int min_rate = max_rate;
+    switch (mode) {
+        case DemodMode::WFM: return max_rate;
+        case DemodMode::NFM:
+        case DemodMode::AM:  min_rate = NARROW_MIN_RATE; break;
+        case DemodMode::USB:
+        case DemodMode::LSB:
+        case DemodMode::CW:  min_rate = VOICE_MIN_RATE; break;
+    }
+    if (min_rate >= max_rate) return max_rate;
+    
+    int rate = input_rate;
+    while (rate % 2 == 0 && rate / 2 >= min_rate) rate /= 2;
+    return std::min(rate, max_rate);
 }
 
-std::vector<std::complex<float>> Demodulator::convertIQData(const uint8_t* data, int len) {
-    std::vector<std::complex<float>> iq;
-    
-    for (int i = 0; i < len - 1; i += 2) {
-        float i_val = (static_cast<float>(data[i]) - 127.5f) / 127.5f;
-        float q_val = (static_cast<float>(data[i+1]) - 127.5f) / 127.5f;
-        iq.push_back(std::complex<float>(i_val, q_val));
+void Demodulator::selectPath(DemodMode mode) {
+    int rate = channelRateForMode(mode, input_rate, max_channel_rate);
+    for (const auto& p : paths) {
+        if (p->channel.getChannelRate() == rate) path = p.get();
     }
+    path->channel.setBandwidth(bandwidthForMode(mode));
     
-    return iq;
+    float base = (mode == DemodMode::NFM) ? 0.7f : 0.5f;
+    smooth_pole = std::pow(base, SMOOTH_REF_RATE / rate);
 }
 
-float Demodulator::fmDiscriminator(std::complex<float> sample) {
-    float mag = std::abs(sample);
-    if (mag < 0.001f) return 0.0f;
-    
-    sample /= mag;  // Normalizar
+void Demodulator::applyRequestedMode() {
+    DemodMode mode = requestedMode.load();
+    if (mode != currentMode) {
+        currentMode = mode;
+        selectPath(mode);
+        reset();
+    }
     
-    // Discriminador de fase
-    std::complex<float> product = sample * std::conj(prev_sample);
-    float phase = std::atan2(product.imag(), product.real());
+    QuadMode quad = requestedQuadMode.load();
+    if (quad != currentQuadMode) {
+        currentQuadMode = quad;
+        reset();
+    }
     
-    prev_sample = sample;
+    // Filtro de banda lateral: configure() não faz nada se nada mudou
+    if (mode == DemodMode::USB || mode == DemodMode::LSB) {
+        sideband.configure(mode == DemodMode::LSB ? Sideband::LOWER : Sideband::UPPER,
+                           requested_ssb_low.load(), requested_ssb_high.load(), 0.0f);
+    } else if (mode == DemodMode::CW) {
+        float pitch = requested_cw_pitch.load();
+        sideband.configure(Sideband::UPPER, pitch - 0.5f * CW_FILTER_HZ, pitch + 0.5f * CW_FILTER_HZ, pitch);
+    }
+}
+
+void Demodulator::setSSBPassband(float low_hz, float high_hz) {
+    if (low_hz < 0.0f || high_hz <= low_hz) return;
+    requested_ssb_low.store(low_hz);
+    requested_ssb_high.store(high_hz);
+}
+
+void Demodulator::setCWPitch(float bfo_hz) {
+    if (bfo_hz < CW_FILTER_HZ * 0.5f) return;
+    requested_cw_pitch.store(bfo_hz);
+}
+
+double Demodulator::outputLag() const {
+    if (currentMode == DemodMode::WFM && stereo) return path->channel.outputLag() + stereo->outputLag();
     
-    return phase;
+    double lag = path->channel.outputLag() + path->resampler.outputLag();
+    if (currentMode == DemodMode::USB || currentMode == DemodMode::LSB || currentMode == DemodMode::CW) {
+        lag += sideband.groupDelay() / path->channel.getChannelRate();
+    }
+    return lag;
+}
+
+void Demodulator::setOffset(double offset_hz) {
+    // Todos os caminhos: o modo pode mudar antes do próximo bloco
+    for (const auto& p : paths) p->channel.setOffset(offset_hz);
+}
+
+void Demodulator::setQuadMode(QuadMode mode) {
+    // Só registra; o reset dos filtros acontece na thread de DSP
+    requestedQuadMode.store(mode);
+}
+
+void Demodulator::setAtanMode(AtanMode mode) {
+    discriminator.setMode(mode);
+}
+
+void Demodulator::reset() {
+    discriminator.reset();
+    prev_audio = 0.0f;
+    path->channel.reset();
+    path->resampler.reset();
+    post_filter.reset();
+    deemph_filter.reset();
+    sideband.reset();
+    if (stereo) stereo->reset();
+    if (rds_decoder) rds_decoder->reset();
+    channel_squelch.reset();
+}
+
+void Demodulator::reserve(size_t max_len) {
+    iq_buffer.reserve(max_len / 2);
+    // O caminho mais largo tem a maior saída; vale para qualquer modo
+    size_t max_channel = 0;
+    for (const auto& p : paths) max_channel = std::max(max_channel, p->channel.maxOutput(max_len / 2));
+    channel_buffer.reserve(max_channel);
+    demod_buffer.reserve(max_channel);
+    if (stereo) stereo->reserve(max_channel);
+    if (rds_decoder) rds_decoder->reserve(max_channel);
+}
+
+size_t Demodulator::maxOutputSamples(size_t len) const {
+    return maxOutputForBaseband(len / 2);
+}
+
+size_t Demodulator::maxOutputForBaseband(size_t n) const {
+    // Maior entre os caminhos: o modo pode mudar entre o dimensionamento e o uso
+    size_t max_out = 0;
+    for (const auto& p : paths) max_out = std::max(max_out, p->resampler.maxOutput(p->channel.maxOutput(n)));
+    if (stereo) {
+        const ChannelSelector& wfm = paths.front()->channel;   // O primeiro caminho é o do WFM
+        max_out = std::max(max_out, 2 * stereo->maxOutput(wfm.maxOutput(n)));
+    }
+    return max_out;
+}
+
+size_t Demodulator::convertIQData(const uint8_t* data, size_t len) {
+    size_t num_samples = len / 2;
+    iq_buffer.resize(num_samples);
+    iq_converter.toComplex(data, num_samples, iq_buffer.data());
+    return num_samples;
 }
 
-std::vector<float> Demodulator::demodNFM(const std::vector<std::complex<float>>& iq) {
-    std::vector<float> demod_data;
-    demod_data.reserve(iq.size());
+size_t Demodulator::demodNFM(const std::complex<float>* iq, size_t n, float* out) {
+    float* demod_data = demod_buffer.data();
     
-    for (const auto& sample : iq) {
-        float demod_val = fmDiscriminator(sample) / M_PI;
-        
+    // Discriminador em bloco (saída já normalizada por pi)
+    discriminator.process(iq, n, demod_data);
+    
+    for (size_t i = 0; i < n; i++) {
         // Suavização
-        demod_val = prev_audio * 0.7f + demod_val * 0.3f;
-        prev_audio = demod_val;
-        
-        // Pré-filtro anti-aliasing
-        float filtered = pre_filter->process(demod_val);
-        demod_data.push_back(filtered);
+        demod_data[i] = prev_audio * smooth_pole + demod_data[i] * (1.0f - smooth_pole);
+        prev_audio = demod_data[i];
     }
     
-    // Resampling
-    auto resampled = resampler->resample(demod_data);
+    // Decimação com anti-aliasing
+    size_t count = path->resampler.process(demod_data, n, out);
     
     // Pós-filtro
-    for (auto& sample : resampled) {
-        sample = post_filter->process(sample);
+    for (size_t i = 0; i < count; i++) {
+        out[i] = post_filter.process(out[i]);
     }
     
-    return resampled;
+    return count;
 }
 
-std::vector<float> Demodulator::demodWFM(const std::vector<std::complex<float>>& iq) {
-    std::vector<float> demod_data;
-    demod_data.reserve(iq.size());
+size_t Demodulator::demodWFM(const std::complex<float>* iq, size_t n, float* out) {
+    float* demod_data = demod_buffer.data();
+    
+    discriminator.process(iq, n, demod_data);
     
-    for (const auto& sample : iq) {
-        float demod_val = fmDiscriminator(sample) / M_PI;
+    // Composto inteiro (piloto, L-R, RDS): sem a suavização do mono
+    if (stereo) {
+        bool allowed = requested_stereo.load();
+        stereo->setStereoAllowed(allowed);
+        size_t count = stereo->process(demod_data, n, out);
+        if (rds_decoder) rds_decoder->process(demod_data, stereo->pilotPhasor(), n);
         
+        if (!allowed) {
+            // Estéreo desligado: L = R, fica só um canal
+            for (size_t i = 0; i < count; i++) out[i] = out[2 * i];
+        } else {
+            output_channels = 2;
+        }
+        return count;
+    }
+    
+    for (size_t i = 0; i < n; i++) {
         // Suavização menor para WFM (para manter mais detalhes)
-        demod_val = prev_audio * 0.5f + demod_val * 0.5f;
-        prev_audio = demod_val;
-        
-        // Pré-filtro anti-aliasing (mais permissivo para WFM)
-        float filtered = pre_filter->process(demod_val);
-        demod_data.push_back(filtered);
+        demod_data[i] = prev_audio * smooth_pole + demod_data[i] * (1.0f - smooth_pole);
+        prev_audio = demod_data[i];
     }
     
-    // Resampling
-    auto resampled = resampler->resample(demod_data);
+    // Decimação com anti-aliasing
+    size_t count = path->resampler.process(demod_data, n, out);
     
     // De-emphasis 75µs (Brasil/Internacional)
-    for (auto& sample : resampled) {
-        sample = deemph_filter->process(sample);
-        sample = post_filter->process(sample);
+    for (size_t i = 0; i < count; i++) {
+        out[i] = post_filter.process(deemph_filter.process(out[i]));
     }
     
-    return resampled;
+    return count;
 }
 
-std::vector<float> Demodulator::demodAM(const std::vector<std::complex<float>>& iq) {
-    std::vector<float> demod_data;
-    demod_data.reserve(iq.size());
+size_t Demodulator::demodAM(const std::complex<float>* iq, size_t n, float* out) {
+    float* demod_data = demod_buffer.data();
     
-    for (const auto& sample : iq) {
-        // AM: magnitude do sinal
-        float magnitude = std::abs(sample);
-        
-        // Remover DC
-        demod_data.push_back(magnitude - 0.5f);
+    for (size_t i = 0; i < n; i++) {
+        // AM: magnitude do sinal, sem DC
+        demod_data[i] = std::abs(iq[i]) - 0.5f;
     }
     
-    auto resampled = resampler->resample(demod_data);
+    size_t count = path->resampler.process(demod_data, n, out);
     
-    for (auto& sample : resampled) {
-        sample = post_filter->process(sample);
+    for (size_t i = 0; i < count; i++) {
+        out[i] = post_filter.process(out[i]);
     }
     
-    return resampled;
+    return count;
 }
 
-std::vector<float> Demodulator::demodUSB(const std::vector<std::complex<float>>& iq) {
-    std::vector<float> demod_data;
+size_t Demodulator::demodSideband(const std::complex<float>* iq, size_t n, float* out) {
+    float* demod_data = demod_buffer.data();
     
-    for (const auto& sample : iq) {
-        // USB: I + Q
-        float demod = (sample.real() + sample.imag()) * 0.5f;
-        demod_data.push_back(demod);
-    }
+    // USB/LSB/CW: só a banda lateral escolhida, portadora no tom do BFO
+    sideband.process(iq, n, demod_data);
     
-    auto resampled = resampler->resample(demod_data);
+    size_t count = path->resampler.process(demod_data, n, out);
     
-    for (auto& sample : resampled) {
-        sample = post_filter->process(sample);
+    for (size_t i = 0; i < count; i++) {
+        out[i] = post_filter.process(out[i]);
     }
     
-    return resampled;
+    return count;
 }
 
-std::vector<float> Demodulator::demodLSB(const std::vector<std::complex<float>>& iq) {
-    std::vector<float> demod_data;
-    
-    for (const auto& sample : iq) {
-        // LSB: I - Q
-        float demod = (sample.real() - sample.imag()) * 0.5f;
-        demod_data.push_back(demod);
-    }
-    
-    auto resampled = resampler->resample(demod_data);
+size_t Demodulator::processIQ(const uint8_t* iqData, size_t len, float* out, size_t max_out) {
+    if (!iqData || !out || max_out < maxOutputSamples(len)) return 0;
     
-    for (auto& sample : resampled) {
-        sample = post_filter->process(sample);
-    }
-    
-    return resampled;
+    size_t n = convertIQData(iqData, len);
+    return processBaseband(iq_buffer.data(), n, out, max_out);
 }
 
-std::vector<float> Demodulator::demodCW(const std::vector<std::complex<float>>& iq) {
-    std::vector<float> demod_data;
-    
-    for (const auto& sample : iq) {
-        // CW: detecção de envolvente
-        float magnitude = std::abs(sample);
-        demod_data.push_back(magnitude);
-    }
-    
-    auto resampled = resampler->resample(demod_data);
+size_t Demodulator::processBaseband(const std::complex<float>* baseband, size_t n, float* out, size_t max_out) {
+    if (!baseband || !out || max_out < maxOutputForBaseband(n)) return 0;
     
-    for (auto& sample : resampled) {
-        sample = post_filter->process(sample);
-    }
+    applyRequestedMode();
     
-    return resampled;
-}
-
-std::vector<float> Demodulator::processIQ(const uint8_t* iqData, int len) {
-    auto iq = convertIQData(iqData, len);
+    // Canal selecionado (offset + filtro) na taxa intermediária do modo
+    channel_buffer.resize(path->channel.maxOutput(n));
+    n = path->channel.process(baseband, n, channel_buffer.data());
+    demod_buffer.resize(n);
+    const std::complex<float>* iq = channel_buffer.data();
+    output_channels = 1;
     
-    std::vector<float> audio;
+    // Potência do canal já filtrado: o ruído conta só na banda do modo
+    float power = 0.0f;
+    for (size_t k = 0; k < n; k++) power += std::norm(iq[k]);
+    if (n > 0) channel_squelch.update(power / n, static_cast<double>(n) / path->channel.getChannelRate());
     
     switch (currentMode) {
-        case DemodMode::NFM:
-            audio = demodNFM(iq);
-            break;
-        case DemodMode::WFM:
-            audio = demodWFM(iq);
-            break;
-        case DemodMode::AM:
-            audio = demodAM(iq);
-            break;
+        case DemodMode::NFM: return demodNFM(iq, n, out);
+        case DemodMode::WFM: return demodWFM(iq, n, out);
+        case DemodMode::AM:  return demodAM(iq, n, out);
         case DemodMode::USB:
-            audio = demodUSB(iq);
-            break;
         case DemodMode::LSB:
-            audio = demodLSB(iq);
-            break;
-        case Demo
+        case DemodMode::CW:  return demodSideband(iq, n, out);
+    }
+    
+    return 0;
+}
@@ -1,11 +1,21 @@
 #pragma once
-#include mplex>
+#include <complex>
 #include <vector>
-#include math>
-#include string>
+#include <cmath>
+#include <cstring>
 #include <algorithm>
-#include stdint>
-#include <deque>
+#include <cstdint>
+#include "resampler.h"
+#include "iq_convert.h"
+#include "fm_discriminator.h"
+#include "aligned_buffer.h"
+#include "channel.h"
+#include "sideband.h"
+#include "fm_stereo.h"
+#include "rds_decoder.h"
+#include "squelch.h"
+#include <atomic>
+#include <memory>
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -25,7 +35,7 @@ enum class QuadMode {
     Q_DIRECT = 1
 };
 
-// Filtro simples 1ª ordem para anti-aliasing
+// Filtro simples 1ª ordem (pós-filtro de áudio e de-emphasis)
 class SimpleFilter {
 public:
     SimpleFilter(float cutoff_ratio);
@@ -38,51 +48,126 @@ private:
     float prev_output;
 };
 
-// Resampler com interpolação linear
-class LinearResampler {
-public:
-    LinearResampler(int input_rate, int output_rate);
-    ~LinearResampler();
-    std::vector<float> resample(const std::vector<float>& input);
-    void reset();
-    
-private:
-    int input_rate;
-    int output_rate;
-    float phase;
-    std::deque<float> buffer;
-};
-
 class Demodulator {
 public:
-    Demodulator();
+    // input_rate: taxa do IQ de entrada; channel_rate: taxa intermediária do
+    // WFM (a maior). Os modos estreitos demodulam em taxas menores
+    // (channelRateForMode), cada uma com seu caminho de decimação.
+    Demodulator(int input_rate = 2048000, int channel_rate = 256000);
     ~Demodulator();
     
     void setMode(DemodMode mode);
     void setQuadMode(QuadMode mode);
+    void setAtanMode(AtanMode mode);
+    
+    // Sintonia fina dentro da banda capturada (Hz relativos ao centro do RTL-SDR).
+    // Thread-safe; não exige retune do hardware.
+    void setOffset(double offset_hz);
+    double getOffset() const { return path->channel.getOffset(); }
+    
+    // Banda passante de áudio do SSB (Hz, padrão 300..2700) e tom de
+    // batimento do CW (BFO, padrão 700 Hz; banda de 500 Hz em volta dele).
+    // Thread-safe; valem a partir do próximo bloco.
+    void setSSBPassband(float low_hz, float high_hz);
+    void setCWPitch(float bfo_hz);
+    float getSSBLow() const { return requested_ssb_low.load(); }
+    float getSSBHigh() const { return requested_ssb_high.load(); }
+    float getCWPitch() const { return requested_cw_pitch.load(); }
+    
+    // WFM estéreo (padrão ligado). Desligado, o WFM volta a sair mono; o
+    // RDS continua. Thread-safe; vale a partir do próximo bloco.
+    void setStereo(bool enabled) { requested_stereo.store(enabled); }
+    bool getStereo() const { return requested_stereo.load(); }
+    // Canais do último processIQ (1 ou 2)
+    int outputChannels() const { return output_channels; }
+    // Piloto travado no último bloco (só WFM com composto >= 128 kHz)
+    bool stereoLocked() const { return stereo && currentMode == DemodMode::WFM && stereo->isLocked(); }
+    // Decodificador RDS do WFM (nulo se a taxa do composto não comporta 57 kHz)
+    RdsDecoder* rds() { return rds_decoder.get(); }
     
-    std::vector<float> processIQ(const uint8_t* iqData, int len);
+    // Squelch pela potência do canal selecionado, atualizado a cada bloco.
+    // Desligado por padrão (sempre aberto); configure() é thread-safe.
+    Squelch& squelch() { return channel_squelch; }
+    bool squelchOpen() const { return channel_squelch.isOpen(); }
+    
+    static float bandwidthForMode(DemodMode mode);
+    // Taxa em que o modo é demodulado: input_rate / 2^k mais baixa que ainda
+    // cobre a banda (NFM/AM 32 kHz, SSB/CW 16 kHz a partir de 2.048 MHz);
+    // o WFM usa max_rate
+    static int channelRateForMode(DemodMode mode, int input_rate, int max_rate);
+    // Taxa intermediária do modo atual
+    int getChannelRate() const { return path->channel.getChannelRate(); }
+    
+    // Demodula len bytes IQ e escreve o áudio (48 kHz) em out.
+    // max_out deve ser >= maxOutputSamples(len); retorna o número de amostras
+    // por canal. Com outputChannels() == 2 (WFM estéreo) out recebe pares
+    // L,R intercalados: o dobro de floats.
+    // Não aloca memória depois que os buffers internos atingem o tamanho do bloco.
+    size_t processIQ(const uint8_t* iqData, size_t len, float* out, size_t max_out);
+    size_t maxOutputSamples(size_t len) const;
+    
+    // Mesmo pipeline a partir de IQ complexo já convertido (ex.: saída do channelizer)
+    size_t processBaseband(const std::complex<float>* iq, size_t n, float* out, size_t max_out);
+    size_t maxOutputForBaseband(size_t n) const;
+    
+    // Quanto a última amostra de áudio do último processIQ está atrás da
+    // última amostra IQ de entrada, em segundos: atraso de grupo dos FIRs
+    // (canal, decimadores, resampler) mais a fase dos decimadores. Os
+    // filtros IIR de 1ª ordem (pós-filtro, de-emphasis) ficam de fora.
+    double outputLag() const;
+    
+    // Pré-aloca os buffers internos para blocos de até max_len bytes
+    void reserve(size_t max_len);
     void reset();
     
 private:
     DemodMode currentMode;
+    std::atomic<DemodMode> requestedMode;  // setMode() de outra thread; aplicado em processIQ
     QuadMode currentQuadMode;
+    std::atomic<QuadMode> requestedQuadMode;  // setQuadMode() de outra thread; aplicado em processIQ
+    int input_rate;
+    int max_channel_rate;                  // Taxa do WFM
+    std::atomic<float> requested_ssb_low;  // Aplicados em processIQ, como o modo
+    std::atomic<float> requested_ssb_high;
+    std::atomic<float> requested_cw_pitch;
+    std::atomic<bool> requested_stereo;
+    
+    // Seleção de canal e reamostragem para 48 kHz numa taxa intermediária.
+    // Um por taxa distinta, construídos de antemão: trocar de modo não
+    // reprojeta os decimadores.
+    struct ChannelPath {
+        ChannelPath(int input_rate, int channel_rate, float bandwidth_hz);
+        ChannelSelector channel;               // NCO + decimação complexa + FIR de canal
+        MultiStageDecimator<float> resampler;  // Taxa do canal -> 48000 com anti-aliasing
+    };
+    std::vector<std::unique_ptr<ChannelPath>> paths;
+    ChannelPath* path;                     // Caminho do modo atual
     
-    LinearResampler* resampler;
-    SimpleFilter* pre_filter;      // Antes do resampling
-    SimpleFilter* post_filter;     // Depois do resampling
-    SimpleFilter* deemph_filter;   // De-emphasis para WFM
+    SimpleFilter post_filter;              // Depois do resampling
+    SimpleFilter deemph_filter;            // De-emphasis para WFM
     
-    std::complex<float> prev_sample;
+    FMDiscriminator discriminator;         // Discriminador em blocos (NFM/WFM)
+    SidebandDemodulator sideband;          // FIR passa-banda complexo + BFO (USB/LSB/CW)
+    std::unique_ptr<StereoDecoder> stereo; // Multiplex do WFM (piloto, L-R, de-emphasis)
+    std::unique_ptr<RdsDecoder> rds_decoder;
+    int output_channels;
+    Squelch channel_squelch;
     float prev_audio;
+    float smooth_pole;                     // Suavização pós-discriminador, ajustada à taxa do canal
+    
+    IQConverter iq_converter;              // Kernel SIMD escolhido em tempo de execução
+    
+    // Buffers de trabalho reaproveitados entre chamadas
+    AlignedVector<std::complex<float>> iq_buffer;
+    AlignedVector<std::complex<float>> channel_buffer;
+    AlignedVector<float> demod_buffer;
     
-    std::vector<std::complex<float>> convertIQData(const uint8_t* data, int len);
-    float fmDiscriminator(std::complex<float> sample);
+    size_t convertIQData(const uint8_t* data, size_t len);
+    void applyRequestedMode();
+    void selectPath(DemodMode mode);
     
-    std::vector<float> demodNFM(const std::vector<std::complex<float>>& iq);
-    std::vector<float> demodWFM(const std::vector<std::complex<float>>& iq);
-    std::vector<float> demodAM(const std::vector<std::complex<float>>& iq);
-    std::vector<float> demodUSB(const std::vector<std::complex<float>>& iq);
-    std::vector<float> demodLSB(const std::vector<std::complex<float>>& iq);
-    std::vector<float> demodCW(const std::vector<std::complex<float>>& iq);
+    size_t demodNFM(const std::complex<float>* iq, size_t n, float* out);
+    size_t demodWFM(const std::complex<float>* iq, size_t n, float* out);
+    size_t demodAM(const std::complex<float>* iq, size_t n, float* out);
+    size_t demodSideband(const std::complex<float>* iq, size_t n, float* out);
 };
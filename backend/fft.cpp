@@ -0,0 +1,66 @@
+#include "fft.h"
+#include <cmath>
+#include <utility>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+FFT::FFT(size_t size) : n(1) {
+    while (n < size) n <<= 1;
+
+    twiddles.resize(n / 2);
+    for (size_t k = 0; k < n / 2; k++) {
+        double angle = -2.0 * M_PI * k / n;
+        twiddles[k] = std::complex<float>(static_cast<float>(std::cos(angle)),
+                                          static_cast<float>(std::sin(angle)));
+    }
+
+    size_t bits = 0;
+    while ((size_t(1) << bits) < n) bits++;
+    bitrev.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        size_t r = 0;
+        for (size_t b = 0; b < bits; b++) {
+            if (i & (size_t(1) << b)) r |= size_t(1) << (bits - 1 - b);
+        }
+        bitrev[i] = r;
+    }
+}
+
+void FFT::forward(std::complex<float>* data) const {
+    transform(data, false);
+}
+
+void FFT::inverse(std::complex<float>* data) const {
+    transform(data, true);
+}
+
+void FFT::transform(std::complex<float>* data, bool inverse) const {
+    for (size_t i = 0; i < n; i++) {
+        if (i < bitrev[i]) std::swap(data[i], data[bitrev[i]]);
+    }
+
+    float* d = reinterpret_cast<float*>(data);
+    const float sign = inverse ? -1.0f : 1.0f;
+
+    for (size_t len = 2; len <= n; len <<= 1) {
+        const size_t half = len / 2;
+        const size_t stride = n / len;
+        for (size_t start = 0; start < n; start += len) {
+            for (size_t k = 0; k < half; k++) {
+                // Aritmética complexa explícita (evita as checagens de NaN de std::complex)
+                const float wr = twiddles[k * stride].real();
+                const float wi = sign * twiddles[k * stride].imag();
+                float* a = d + 2 * (start + k);
+                float* b = d + 2 * (start + k + half);
+                const float tr = b[0] * wr - b[1] * wi;
+                const float ti = b[0] * wi + b[1] * wr;
+                b[0] = a[0] - tr;
+                b[1] = a[1] - ti;
+                a[0] += tr;
+                a[1] += ti;
+            }
+        }
+    }
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+// FFT complexa radix-2 in-place (tamanho potência de 2).
+// Twiddles e tabela de bit-reverso pré-calculados no construtor;
+// transform() não aloca.
+class FFT {
+public:
+    explicit FFT(size_t size);
+
+    // Direta: X[k] = sum x[n] e^{-j2pi kn/N} (sem normalização)
+    void forward(std::complex<float>* data) const;
+    // Inversa: x[n] = sum X[k] e^{+j2pi kn/N} (sem o fator 1/N)
+    void inverse(std::complex<float>* data) const;
+
+    size_t size() const { return n; }
+
+private:
+    size_t n;
+    std::vector<std::complex<float>> twiddles;   // e^{-j2pi k/N}, k < N/2
+    std::vector<size_t> bitrev;
+
+    void transform(std::complex<float>* data, bool inverse) const;
+};
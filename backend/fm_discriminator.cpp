@@ -0,0 +1,306 @@
+#include "fm_discriminator.h"
+#include "cpu_features.h"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(SPEEDSDR_X86)
+#include <immintrin.h>
+#endif
+#if defined(SPEEDSDR_NEON)
+#include <arm_neon.h>
+#endif
+
+static const float PI_F = 3.14159265358979f;
+static const float HALF_PI_F = 1.57079632679490f;
+
+// atan(a) para a em [0, 1]: polinômio minimax ímpar de grau 11
+static const float ATAN_C1 = 0.99997726f;
+static const float ATAN_C3 = -0.33262347f;
+static const float ATAN_C5 = 0.19354346f;
+static const float ATAN_C7 = -0.11643287f;
+static const float ATAN_C9 = 0.05265332f;
+static const float ATAN_C11 = -0.01172120f;
+
+static const int ATAN_LUT_SIZE = 1024;
+
+// ============ Arco-tangente escalar ============
+
+static inline float atanPoly01(float a) {
+    float s = a * a;
+    return a * (ATAN_C1 + s * (ATAN_C3 + s * (ATAN_C5 + s * (ATAN_C7 + s * (ATAN_C9 + s * ATAN_C11)))));
+}
+
+struct AtanTable {
+    float values[ATAN_LUT_SIZE + 1];
+    AtanTable() {
+        for (int i = 0; i <= ATAN_LUT_SIZE; i++) {
+            values[i] = static_cast<float>(std::atan(static_cast<double>(i) / ATAN_LUT_SIZE));
+        }
+    }
+};
+
+static const float* atanLUT() {
+    static const AtanTable table;
+    return table.values;
+}
+
+static inline float atanLut01(float a) {
+    const float* lut = atanLUT();
+    float pos = a * ATAN_LUT_SIZE;
+    int idx = static_cast<int>(pos);
+    if (idx >= ATAN_LUT_SIZE) return lut[ATAN_LUT_SIZE];
+    float frac = pos - idx;
+    return lut[idx] + (lut[idx + 1] - lut[idx]) * frac;
+}
+
+// Redução de octante comum aos modos POLY e LUT
+template <float (*Atan01)(float)>
+static inline float atan2Octant(float y, float x) {
+    float ax = std::fabs(x);
+    float ay = std::fabs(y);
+    float mx = ax > ay ? ax : ay;
+    float mn = ax > ay ? ay : ax;
+    if (mx == 0.0f) return 0.0f;
+
+    float r = Atan01(mn / mx);
+    if (ay > ax) r = HALF_PI_F - r;
+    if (x < 0.0f) r = PI_F - r;
+    return y < 0.0f ? -r : r;
+}
+
+float FMDiscriminator::atan2Approx(float y, float x, AtanMode mode) {
+    switch (mode) {
+        case AtanMode::POLY: return atan2Octant<atanPoly01>(y, x);
+        case AtanMode::LUT: return atan2Octant<atanLut01>(y, x);
+        case AtanMode::EXACT:
+        default: return std::atan2(y, x);
+    }
+}
+
+// ============ Kernels escalares ============
+// Todos calculam out[j] = gain * arg(in[j + 1] * conj(in[j])) para j em [0, n)
+
+template <AtanMode Mode>
+static void blockScalar(const std::complex<float>* in, size_t n, float gain, float* out) {
+    for (size_t j = 0; j < n; j++) {
+        float pr = in[j].real(), pi = in[j].imag();
+        float xr = in[j + 1].real(), xi = in[j + 1].imag();
+        float re = xr * pr + xi * pi;
+        float im = xi * pr - xr * pi;
+        out[j] = gain * FMDiscriminator::atan2Approx(im, re, Mode);
+    }
+}
+
+// ============ SSE2 ============
+
+#if defined(SPEEDSDR_X86)
+SPEEDSDR_TARGET_SSE2
+static inline __m128 atan2PolySSE2(__m128 y, __m128 x) {
+    const __m128 sign_mask = _mm_set1_ps(-0.0f);
+    __m128 ax = _mm_andnot_ps(sign_mask, x);
+    __m128 ay = _mm_andnot_ps(sign_mask, y);
+    __m128 mx = _mm_max_ps(ax, ay);
+    __m128 mn = _mm_min_ps(ax, ay);
+    __m128 a = _mm_div_ps(mn, _mm_max_ps(mx, _mm_set1_ps(1e-30f)));
+    __m128 s = _mm_mul_ps(a, a);
+
+    __m128 r = _mm_set1_ps(ATAN_C11);
+    r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(ATAN_C9));
+    r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(ATAN_C7));
+    r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(ATAN_C5));
+    r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(ATAN_C3));
+    r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(ATAN_C1));
+    r = _mm_mul_ps(r, a);
+
+    // |y| > |x| -> pi/2 - r
+    __m128 swap = _mm_cmpgt_ps(ay, ax);
+    r = _mm_or_ps(_mm_and_ps(swap, _mm_sub_ps(_mm_set1_ps(HALF_PI_F), r)), _mm_andnot_ps(swap, r));
+    // x < 0 -> pi - r
+    __m128 neg_x = _mm_cmplt_ps(x, _mm_setzero_ps());
+    r = _mm_or_ps(_mm_and_ps(neg_x, _mm_sub_ps(_mm_set1_ps(PI_F), r)), _mm_andnot_ps(neg_x, r));
+    // Sinal de y
+    return _mm_xor_ps(r, _mm_and_ps(y, sign_mask));
+}
+
+SPEEDSDR_TARGET_SSE2
+static void blockPolySSE2(const std::complex<float>* in, size_t n, float gain, float* out) {
+    const float* f = reinterpret_cast<const float*>(in);
+    const __m128 g = _mm_set1_ps(gain);
+
+    size_t j = 0;
+    for (; j + 4 <= n; j += 4) {
+        // Anterior: in[j..j+3], atual: in[j+1..j+4]
+        __m128 p0 = _mm_loadu_ps(f + 2 * j);
+        __m128 p1 = _mm_loadu_ps(f + 2 * j + 4);
+        __m128 x0 = _mm_loadu_ps(f + 2 * j + 2);
+        __m128 x1 = _mm_loadu_ps(f + 2 * j + 6);
+
+        __m128 pr = _mm_shuffle_ps(p0, p1, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 pi = _mm_shuffle_ps(p0, p1, _MM_SHUFFLE(3, 1, 3, 1));
+        __m128 xr = _mm_shuffle_ps(x0, x1, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 xi = _mm_shuffle_ps(x0, x1, _MM_SHUFFLE(3, 1, 3, 1));
+
+        __m128 re = _mm_add_ps(_mm_mul_ps(xr, pr), _mm_mul_ps(xi, pi));
+        __m128 im = _mm_sub_ps(_mm_mul_ps(xi, pr), _mm_mul_ps(xr, pi));
+        _mm_storeu_ps(out + j, _mm_mul_ps(atan2PolySSE2(im, re), g));
+    }
+    blockScalar<AtanMode::POLY>(in + j, n - j, gain, out + j);
+}
+
+// ============ AVX2 ============
+
+SPEEDSDR_TARGET_AVX2
+static inline __m256 atan2PolyAVX2(__m256 y, __m256 x) {
+    const __m256 sign_mask = _mm256_set1_ps(-0.0f);
+    __m256 ax = _mm256_andnot_ps(sign_mask, x);
+    __m256 ay = _mm256_andnot_ps(sign_mask, y);
+    __m256 mx = _mm256_max_ps(ax, ay);
+    __m256 mn = _mm256_min_ps(ax, ay);
+    __m256 a = _mm256_div_ps(mn, _mm256_max_ps(mx, _mm256_set1_ps(1e-30f)));
+    __m256 s = _mm256_mul_ps(a, a);
+
+    __m256 r = _mm256_set1_ps(ATAN_C11);
+    r = _mm256_fmadd_ps(r, s, _mm256_set1_ps(ATAN_C9));
+    r = _mm256_fmadd_ps(r, s, _mm256_set1_ps(ATAN_C7));
+    r = _mm256_fmadd_ps(r, s, _mm256_set1_ps(ATAN_C5));
+    r = _mm256_fmadd_ps(r, s, _mm256_set1_ps(ATAN_C3));
+    r = _mm256_fmadd_ps(r, s, _mm256_set1_ps(ATAN_C1));
+    r = _mm256_mul_ps(r, a);
+
+    r = _mm256_blendv_ps(r, _mm256_sub_ps(_mm256_set1_ps(HALF_PI_F), r), _mm256_cmp_ps(ay, ax, _CMP_GT_OQ));
+    r = _mm256_blendv_ps(r, _mm256_sub_ps(_mm256_set1_ps(PI_F), r), _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_LT_OQ));
+    return _mm256_xor_ps(r, _mm256_and_ps(y, sign_mask));
+}
+
+SPEEDSDR_TARGET_AVX2
+static void blockPolyAVX2(const std::complex<float>* in, size_t n, float gain, float* out) {
+    const float* f = reinterpret_cast<const float*>(in);
+    const __m256 g = _mm256_set1_ps(gain);
+
+    size_t j = 0;
+    for (; j + 8 <= n; j += 8) {
+        __m256 p0 = _mm256_loadu_ps(f + 2 * j);
+        __m256 p1 = _mm256_loadu_ps(f + 2 * j + 8);
+        __m256 x0 = _mm256_loadu_ps(f + 2 * j + 2);
+        __m256 x1 = _mm256_loadu_ps(f + 2 * j + 10);
+
+        // Desintercala por faixa de 128 bits: ordem [0 1 4 5 2 3 6 7]
+        __m256 pr = _mm256_shuffle_ps(p0, p1, _MM_SHUFFLE(2, 0, 2, 0));
+        __m256 pi = _mm256_shuffle_ps(p0, p1, _MM_SHUFFLE(3, 1, 3, 1));
+        __m256 xr = _mm256_shuffle_ps(x0, x1, _MM_SHUFFLE(2, 0, 2, 0));
+        __m256 xi = _mm256_shuffle_ps(x0, x1, _MM_SHUFFLE(3, 1, 3, 1));
+
+        __m256 re = _mm256_fmadd_ps(xr, pr, _mm256_mul_ps(xi, pi));
+        __m256 im = _mm256_fmsub_ps(xi, pr, _mm256_mul_ps(xr, pi));
+        __m256 r = _mm256_mul_ps(atan2PolyAVX2(im, re), g);
+
+        // Restaura a ordem natural das amostras
+        r = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(r), 0xD8));
+        _mm256_storeu_ps(out + j, r);
+    }
+    blockPolySSE2(in + j, n - j, gain, out + j);
+}
+#endif
+
+// ============ NEON ============
+
+#if defined(SPEEDSDR_NEON)
+static inline float32x4_t atan2PolyNEON(float32x4_t y, float32x4_t x) {
+    float32x4_t ax = vabsq_f32(x);
+    float32x4_t ay = vabsq_f32(y);
+    float32x4_t mx = vmaxq_f32(ax, ay);
+    float32x4_t mn = vminq_f32(ax, ay);
+
+    // Recíproco com duas iterações de Newton-Raphson
+    float32x4_t den = vmaxq_f32(mx, vdupq_n_f32(1e-30f));
+    float32x4_t inv = vrecpeq_f32(den);
+    inv = vmulq_f32(vrecpsq_f32(den, inv), inv);
+    inv = vmulq_f32(vrecpsq_f32(den, inv), inv);
+    float32x4_t a = vmulq_f32(mn, inv);
+    float32x4_t s = vmulq_f32(a, a);
+
+    float32x4_t r = vdupq_n_f32(ATAN_C11);
+    r = vmlaq_f32(vdupq_n_f32(ATAN_C9), r, s);
+    r = vmlaq_f32(vdupq_n_f32(ATAN_C7), r, s);
+    r = vmlaq_f32(vdupq_n_f32(ATAN_C5), r, s);
+    r = vmlaq_f32(vdupq_n_f32(ATAN_C3), r, s);
+    r = vmlaq_f32(vdupq_n_f32(ATAN_C1), r, s);
+    r = vmulq_f32(r, a);
+
+    r = vbslq_f32(vcgtq_f32(ay, ax), vsubq_f32(vdupq_n_f32(HALF_PI_F), r), r);
+    r = vbslq_f32(vcltq_f32(x, vdupq_n_f32(0.0f)), vsubq_f32(vdupq_n_f32(PI_F), r), r);
+    uint32x4_t ysign = vandq_u32(vreinterpretq_u32_f32(y), vdupq_n_u32(0x80000000u));
+    return vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(r), ysign));
+}
+
+static void blockPolyNEON(const std::complex<float>* in, size_t n, float gain, float* out) {
+    const float* f = reinterpret_cast<const float*>(in);
+
+    size_t j = 0;
+    for (; j + 4 <= n; j += 4) {
+        float32x4x2_t p = vld2q_f32(f + 2 * j);
+        float32x4x2_t x = vld2q_f32(f + 2 * j + 2);
+        float32x4_t re = vmlaq_f32(vmulq_f32(x.val[0], p.val[0]), x.val[1], p.val[1]);
+        float32x4_t im = vmlsq_f32(vmulq_f32(x.val[1], p.val[0]), x.val[0], p.val[1]);
+        vst1q_f32(out + j, vmulq_n_f32(atan2PolyNEON(im, re), gain));
+    }
+    blockScalar<AtanMode::POLY>(in + j, n - j, gain, out + j);
+}
+#endif
+
+// ============ FMDiscriminator Implementation ============
+
+FMDiscriminator::FMDiscriminator(AtanMode m, float g)
+    : mode(m), gain(g), prev_sample(0.0f, 0.0f), block_fn(nullptr) {
+    setMode(m);
+}
+
+void FMDiscriminator::setMode(AtanMode m) {
+    mode = m;
+    const CpuFeatures& cpu = getCpuFeatures();
+
+    switch (mode) {
+        case AtanMode::EXACT:
+            block_fn = blockScalar<AtanMode::EXACT>;
+            break;
+        case AtanMode::LUT:
+            block_fn = blockScalar<AtanMode::LUT>;
+            break;
+        case AtanMode::POLY:
+        default:
+            block_fn = blockScalar<AtanMode::POLY>;
+#if defined(SPEEDSDR_X86)
+            if (cpu.avx2 && cpu.fma) block_fn = blockPolyAVX2;
+            else if (cpu.sse2) block_fn = blockPolySSE2;
+#endif
+#if defined(SPEEDSDR_NEON)
+            if (cpu.neon) block_fn = blockPolyNEON;
+#endif
+            break;
+    }
+    (void)cpu;
+}
+
+bool FMDiscriminator::isVectorized() const {
+    return block_fn != blockScalar<AtanMode::EXACT> &&
+           block_fn != blockScalar<AtanMode::LUT> &&
+           block_fn != blockScalar<AtanMode::POLY>;
+}
+
+void FMDiscriminator::process(const std::complex<float>* in, size_t n, float* out) {
+    if (n == 0) return;
+
+    // Primeira amostra usa o estado do bloco anterior
+    std::complex<float> product = in[0] * std::conj(prev_sample);
+    out[0] = gain * atan2Approx(product.imag(), product.real(), mode);
+
+    // Restante do bloco: pares (in[k-1], in[k]) dentro do próprio buffer
+    block_fn(in, n - 1, gain, out + 1);
+
+    prev_sample = in[n - 1];
+}
+
+void FMDiscriminator::reset() {
+    prev_sample = std::complex<float>(0.0f, 0.0f);
+}
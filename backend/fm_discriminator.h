@@ -0,0 +1,37 @@
+#pragma once
+#include <complex>
+#include <cstddef>
+
+// Arco-tangente usada pelo discriminador
+enum class AtanMode {
+    EXACT = 0,    // std::atan2 (referência)
+    POLY = 1,     // Polinômio minimax de grau 11, erro máx. < 3e-6 rad (com SIMD)
+    LUT = 2       // Tabela de 1025 pontos com interpolação linear, erro máx. < 5e-7 rad
+};
+
+// Discriminador FM em blocos: out[k] = gain * arg(x[k] * conj(x[k-1])).
+// Não normaliza as amostras (a diferença de fase não depende da magnitude)
+// e guarda a última amostra do bloco para o próximo.
+class FMDiscriminator {
+public:
+    explicit FMDiscriminator(AtanMode mode = AtanMode::POLY, float gain = 1.0f / 3.14159265358979f);
+
+    void process(const std::complex<float>* in, size_t n, float* out);
+    void reset();
+
+    void setMode(AtanMode mode);
+    AtanMode getMode() const { return mode; }
+    void setGain(float g) { gain = g; }
+
+    // true se o modo atual está usando um kernel SIMD
+    bool isVectorized() const;
+
+    // Arco-tangente escalar do modo pedido (exposto para testes e benchmarks)
+    static float atan2Approx(float y, float x, AtanMode mode);
+
+private:
+    AtanMode mode;
+    float gain;
+    std::complex<float> prev_sample;
+    void (*block_fn)(const std::complex<float>*, size_t, float, float*);
+};
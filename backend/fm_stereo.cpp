@@ -0,0 +1,115 @@
+#include "fm_stereo.h"
+#include <algorithm>
+#include <cmath>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+static const double PILOT_HZ = 19000.0;
+static const double PILOT_DEVIATION_HZ = 6750.0;  // 9% de 75 kHz
+static const double PLL_BANDWIDTH_HZ = 20.0;
+static const double PLL_MAX_OFFSET_HZ = 50.0;     // Erro de relógio do RTL-SDR fica bem abaixo
+static const float LOCK_ON = 0.5f;                // Nível relativo do piloto (histerese)
+static const float LOCK_OFF = 0.25f;
+static const double LOCK_TIME_S = 0.05;
+static const double BLEND_TIME_S = 0.1;
+
+static const float AUDIO_PASSBAND_HZ = 15000.0f;
+static const float AUDIO_STOPBAND_HZ = 18500.0f;
+
+// ============ StereoDecoder Implementation ============
+
+StereoDecoder::StereoDecoder(int comp_rate, int aud_rate, float deemphasis_us)
+    : composite_rate(comp_rate),
+      audio_rate(aud_rate),
+      step(std::polar(1.0f, static_cast<float>(2.0 * M_PI * PILOT_HZ / comp_rate))),
+      phasor(1.0f, 0.0f),
+      freq_offset(0.0f),
+      max_offset(static_cast<float>(2.0 * M_PI * PLL_MAX_OFFSET_HZ / comp_rate)),
+      // Saída do discriminador = 2 * desvio / taxa (ganho 1/pi)
+      pilot_norm(static_cast<float>(comp_rate / PILOT_DEVIATION_HZ)),
+      lock_alpha(static_cast<float>(1.0 / (LOCK_TIME_S * comp_rate))),
+      lock_level(0.0f),
+      locked(false),
+      stereo_allowed(true),
+      blend(0.0f),
+      blend_step(static_cast<float>(1.0 / (BLEND_TIME_S * aud_rate))),
+      // Um polo com constante de tempo tau (75 us nas Américas, 50 us na Europa)
+      deemph_alpha(static_cast<float>(1.0 - std::exp(-1.0 / (deemphasis_us * 1e-6 * aud_rate)))),
+      deemph_left(0.0f),
+      deemph_right(0.0f),
+      decimator(comp_rate, aud_rate, AUDIO_PASSBAND_HZ),
+      audio_filter(designLowpassFIR(0.5f * (AUDIO_PASSBAND_HZ + AUDIO_STOPBAND_HZ) / aud_rate,
+                                    (AUDIO_STOPBAND_HZ - AUDIO_PASSBAND_HZ) / aud_rate, 60.0f)) {
+    // PLL de 2ª ordem, zeta = 0.707: kp = 2 zeta wn, ki = wn^2 (por amostra)
+    double wn = 2.0 * M_PI * PLL_BANDWIDTH_HZ / comp_rate;
+    kp = static_cast<float>(2.0 * 0.7071 * wn);
+    ki = static_cast<float>(wn * wn);
+}
+
+void StereoDecoder::reserve(size_t max_n) {
+    pilot.reserve(max_n);
+    packed.reserve(max_n);
+    audio.reserve(decimator.maxOutput(max_n));
+}
+
+size_t StereoDecoder::process(const float* mpx, size_t n, float* out) {
+    pilot.resize(n);
+    packed.resize(n);
+
+    // PLL e demodulação de L-R amostra a amostra (o laço é serial)
+    std::complex<float> z = phasor;
+    float level = lock_level;
+    for (size_t k = 0; k < n; k++) {
+        const float x = mpx[k];
+        const float c = z.real(), s = z.imag();
+
+        // Detector de fase: piloto sen(phi) * cos(theta) ~ sen(phi - theta) / 2
+        float err = x * c * pilot_norm;
+        freq_offset = std::min(std::max(freq_offset + ki * err, -max_offset), max_offset);
+        float dtheta = kp * err + freq_offset;
+        level += lock_alpha * (x * s * pilot_norm - level);
+
+        pilot[k] = z;
+        packed[k] = std::complex<float>(x, x * 4.0f * s * c);   // 2 sen(2 theta) = 4 sen cos
+
+        // Avança w0 + correção (rotação de ângulo pequeno) e renormaliza
+        z *= step;
+        z = std::complex<float>(z.real() - dtheta * z.imag(), z.imag() + dtheta * z.real());
+        z *= 1.5f - 0.5f * std::norm(z);
+    }
+    phasor = z;
+    lock_level = level;
+    if (!locked && level > LOCK_ON) locked = true;
+    else if (locked && level < LOCK_OFF) locked = false;
+
+    // Soma e diferença juntas até 48 kHz
+    audio.resize(decimator.maxOutput(n));
+    size_t count = decimator.process(packed.data(), n, audio.data());
+    audio_filter.process(audio.data(), count, audio.data());
+
+    const float target = (locked && stereo_allowed) ? 1.0f : 0.0f;
+    for (size_t i = 0; i < count; i++) {
+        blend += std::min(std::max(target - blend, -blend_step), blend_step);
+        const float sum = audio[i].real();
+        const float diff = audio[i].imag() * blend;
+        deemph_left += deemph_alpha * (sum + diff - deemph_left);
+        deemph_right += deemph_alpha * (sum - diff - deemph_right);
+        out[2 * i] = deemph_left;
+        out[2 * i + 1] = deemph_right;
+    }
+    return count;
+}
+
+void StereoDecoder::reset() {
+    phasor = std::complex<float>(1.0f, 0.0f);
+    freq_offset = 0.0f;
+    lock_level = 0.0f;
+    locked = false;
+    blend = 0.0f;
+    deemph_left = 0.0f;
+    deemph_right = 0.0f;
+    decimator.reset();
+    audio_filter.reset();
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <complex>
+#include <cstddef>
+#include "aligned_buffer.h"
+#include "resampler.h"
+
+// Decodificador estéreo do multiplex de FM, na taxa do composto (saída do
+// discriminador WFM, >= 128 kHz):
+//  - PLL de 2ª ordem no piloto de 19 kHz; o fasor do piloto de cada amostra
+//    fica disponível para o RDS (57 kHz = 3x a fase)
+//  - L-R demodulado com 2 sen(2 theta) (38 kHz coerente com o piloto)
+//  - Soma e diferença viajam juntas como parte real e imaginária de um fluxo
+//    complexo: mesmos decimadores e filtros, atrasos casados por construção
+//  - De-emphasis idêntica em L e R
+// Sem piloto (ou com estéreo desligado) desliza para mono em ~100 ms.
+class StereoDecoder {
+public:
+    StereoDecoder(int composite_rate, int audio_rate, float deemphasis_us = 75.0f);
+
+    // mpx: n amostras do discriminador. out: pares L,R intercalados na taxa
+    // de áudio (2 * maxOutput(n) floats); retorna o número de pares.
+    size_t process(const float* mpx, size_t n, float* out);
+    size_t maxOutput(size_t n) const { return decimator.maxOutput(n); }
+
+    // Fasor do piloto (e^{j theta}, piloto = sen theta) de cada amostra do último process()
+    const std::complex<float>* pilotPhasor() const { return pilot.data(); }
+
+    // false força mono (L = R = soma); o PLL continua rodando para o RDS
+    void setStereoAllowed(bool allowed) { stereo_allowed = allowed; }
+    bool isLocked() const { return locked; }
+    // Amplitude do piloto em relação à nominal (9% do desvio de 75 kHz)
+    float pilotLevel() const { return lock_level; }
+
+    // Atraso da última saída em relação à última amostra do composto (s)
+    double outputLag() const { return decimator.outputLag() + audio_filter.groupDelay() / audio_rate; }
+
+    void reserve(size_t max_n);
+    void reset();
+
+private:
+    int composite_rate;
+    int audio_rate;
+
+    // PLL
+    std::complex<float> step;       // e^{j w0}, w0 = 19 kHz
+    std::complex<float> phasor;
+    float freq_offset;              // Integrador do laço (rad/amostra)
+    float max_offset;
+    float kp;
+    float ki;
+    float pilot_norm;               // 2 / amplitude nominal do piloto
+    float lock_alpha;
+    float lock_level;
+    bool locked;
+
+    bool stereo_allowed;
+    float blend;                    // 0 = mono, 1 = estéreo pleno
+    float blend_step;
+
+    float deemph_alpha;
+    float deemph_left;
+    float deemph_right;
+
+    MultiStageDecimator<std::complex<float>> decimator;  // Composto -> áudio, banda de 15 kHz
+    FIRFilter<std::complex<float>> audio_filter;         // Corta o resto do piloto (19 kHz)
+
+    AlignedVector<std::complex<float>> pilot;
+    AlignedVector<std::complex<float>> packed;           // soma + j * diferença
+    AlignedVector<std::complex<float>> audio;
+};
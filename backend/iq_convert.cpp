@@ -0,0 +1,278 @@
+#include "iq_convert.h"
+#include "cpu_features.h"
+
+#if defined(SPEEDSDR_X86)
+#include <immintrin.h>
+#endif
+#if defined(SPEEDSDR_NEON)
+#include <arm_neon.h>
+#endif
+
+// (x - 127.5) / 127.5 = x * SCALE - 1
+static const float IQ_SCALE = 1.0f / 127.5f;
+
+// ============ Escalar ============
+
+static void interleavedScalar(const uint8_t* in, size_t n, float* out) {
+    for (size_t k = 0; k < 2 * n; k++) {
+        out[k] = static_cast<float>(in[k]) * IQ_SCALE - 1.0f;
+    }
+}
+
+static void planarScalar(const uint8_t* in, size_t n, float* i_out, float* q_out) {
+    for (size_t k = 0; k < n; k++) {
+        i_out[k] = static_cast<float>(in[2 * k]) * IQ_SCALE - 1.0f;
+        q_out[k] = static_cast<float>(in[2 * k + 1]) * IQ_SCALE - 1.0f;
+    }
+}
+
+// ============ Tabela (LUT) ============
+
+struct IQLookupTable {
+    float values[256];
+    IQLookupTable() {
+        for (int v = 0; v < 256; v++) values[v] = static_cast<float>(v) * IQ_SCALE - 1.0f;
+    }
+};
+
+static const float* iqLUT() {
+    static const IQLookupTable table;
+    return table.values;
+}
+
+static void interleavedLUT(const uint8_t* in, size_t n, float* out) {
+    const float* lut = iqLUT();
+    for (size_t k = 0; k < 2 * n; k++) out[k] = lut[in[k]];
+}
+
+static void planarLUT(const uint8_t* in, size_t n, float* i_out, float* q_out) {
+    const float* lut = iqLUT();
+    for (size_t k = 0; k < n; k++) {
+        i_out[k] = lut[in[2 * k]];
+        q_out[k] = lut[in[2 * k + 1]];
+    }
+}
+
+// ============ SSE2 ============
+
+#if defined(SPEEDSDR_X86)
+SPEEDSDR_TARGET_SSE2
+static void interleavedSSE2(const uint8_t* in, size_t n, float* out) {
+    const size_t bytes = 2 * n;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 scale = _mm_set1_ps(IQ_SCALE);
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    size_t k = 0;
+    for (; k + 16 <= bytes; k += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + k));
+        __m128i lo16 = _mm_unpacklo_epi8(v, zero);
+        __m128i hi16 = _mm_unpackhi_epi8(v, zero);
+
+        __m128 f0 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo16, zero));
+        __m128 f1 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo16, zero));
+        __m128 f2 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi16, zero));
+        __m128 f3 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi16, zero));
+
+        _mm_storeu_ps(out + k,      _mm_sub_ps(_mm_mul_ps(f0, scale), one));
+        _mm_storeu_ps(out + k + 4,  _mm_sub_ps(_mm_mul_ps(f1, scale), one));
+        _mm_storeu_ps(out + k + 8,  _mm_sub_ps(_mm_mul_ps(f2, scale), one));
+        _mm_storeu_ps(out + k + 12, _mm_sub_ps(_mm_mul_ps(f3, scale), one));
+    }
+    interleavedScalar(in + k, (bytes - k) / 2, out + k);
+}
+
+SPEEDSDR_TARGET_SSE2
+static void planarSSE2(const uint8_t* in, size_t n, float* i_out, float* q_out) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i low_mask = _mm_set1_epi16(0x00FF);
+    const __m128 scale = _mm_set1_ps(IQ_SCALE);
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    size_t k = 0;
+    for (; k + 8 <= n; k += 8) {
+        // 16 bytes = 8 pares IQ; I nos bytes pares, Q nos ímpares
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 2 * k));
+        __m128i i16 = _mm_and_si128(v, low_mask);
+        __m128i q16 = _mm_srli_epi16(v, 8);
+
+        __m128 i0 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(i16, zero));
+        __m128 i1 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(i16, zero));
+        __m128 q0 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(q16, zero));
+        __m128 q1 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(q16, zero));
+
+        _mm_storeu_ps(i_out + k,     _mm_sub_ps(_mm_mul_ps(i0, scale), one));
+        _mm_storeu_ps(i_out + k + 4, _mm_sub_ps(_mm_mul_ps(i1, scale), one));
+        _mm_storeu_ps(q_out + k,     _mm_sub_ps(_mm_mul_ps(q0, scale), one));
+        _mm_storeu_ps(q_out + k + 4, _mm_sub_ps(_mm_mul_ps(q1, scale), one));
+    }
+    planarScalar(in + 2 * k, n - k, i_out + k, q_out + k);
+}
+
+// ============ AVX2 ============
+
+SPEEDSDR_TARGET_AVX2
+static void interleavedAVX2(const uint8_t* in, size_t n, float* out) {
+    const size_t bytes = 2 * n;
+    const __m256 scale = _mm256_set1_ps(IQ_SCALE);
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    size_t k = 0;
+    for (; k + 32 <= bytes; k += 32) {
+        for (size_t j = 0; j < 32; j += 8) {
+            __m128i b = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + k + j));
+            __m256 f = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(b));
+            _mm256_storeu_ps(out + k + j, _mm256_fmsub_ps(f, scale, one));
+        }
+    }
+    interleavedSSE2(in + k, (bytes - k) / 2, out + k);
+}
+
+SPEEDSDR_TARGET_AVX2
+static void planarAVX2(const uint8_t* in, size_t n, float* i_out, float* q_out) {
+    const __m256i low_mask = _mm256_set1_epi16(0x00FF);
+    const __m256 scale = _mm256_set1_ps(IQ_SCALE);
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    size_t k = 0;
+    for (; k + 16 <= n; k += 16) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + 2 * k));
+        __m256i i16 = _mm256_and_si256(v, low_mask);
+        __m256i q16 = _mm256_srli_epi16(v, 8);
+
+        // Cada metade de 128 bits vira 8 floats (mantém a ordem das amostras)
+        __m256 i0 = _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm256_castsi256_si128(i16)));
+        __m256 i1 = _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm256_extracti128_si256(i16, 1)));
+        __m256 q0 = _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm256_castsi256_si128(q16)));
+        __m256 q1 = _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm256_extracti128_si256(q16, 1)));
+
+        _mm256_storeu_ps(i_out + k,     _mm256_fmsub_ps(i0, scale, one));
+        _mm256_storeu_ps(i_out + k + 8, _mm256_fmsub_ps(i1, scale, one));
+        _mm256_storeu_ps(q_out + k,     _mm256_fmsub_ps(q0, scale, one));
+        _mm256_storeu_ps(q_out + k + 8, _mm256_fmsub_ps(q1, scale, one));
+    }
+    planarSSE2(in + 2 * k, n - k, i_out + k, q_out + k);
+}
+#endif
+
+// ============ NEON ============
+
+#if defined(SPEEDSDR_NEON)
+static inline float32x4_t neonScale(uint16x4_t v, float32x4_t scale, float32x4_t one) {
+    return vsubq_f32(vmulq_f32(vcvtq_f32_u32(vmovl_u16(v)), scale), one);
+}
+
+static void interleavedNEON(const uint8_t* in, size_t n, float* out) {
+    const size_t bytes = 2 * n;
+    const float32x4_t scale = vdupq_n_f32(IQ_SCALE);
+    const float32x4_t one = vdupq_n_f32(1.0f);
+
+    size_t k = 0;
+    for (; k + 16 <= bytes; k += 16) {
+        uint8x16_t v = vld1q_u8(in + k);
+        uint16x8_t lo = vmovl_u8(vget_low_u8(v));
+        uint16x8_t hi = vmovl_u8(vget_high_u8(v));
+        vst1q_f32(out + k,      neonScale(vget_low_u16(lo), scale, one));
+        vst1q_f32(out + k + 4,  neonScale(vget_high_u16(lo), scale, one));
+        vst1q_f32(out + k + 8,  neonScale(vget_low_u16(hi), scale, one));
+        vst1q_f32(out + k + 12, neonScale(vget_high_u16(hi), scale, one));
+    }
+    interleavedScalar(in + k, (bytes - k) / 2, out + k);
+}
+
+static void planarNEON(const uint8_t* in, size_t n, float* i_out, float* q_out) {
+    const float32x4_t scale = vdupq_n_f32(IQ_SCALE);
+    const float32x4_t one = vdupq_n_f32(1.0f);
+
+    size_t k = 0;
+    for (; k + 8 <= n; k += 8) {
+        uint8x8x2_t v = vld2_u8(in + 2 * k);  // Desintercala I/Q
+        uint16x8_t i16 = vmovl_u8(v.val[0]);
+        uint16x8_t q16 = vmovl_u8(v.val[1]);
+        vst1q_f32(i_out + k,     neonScale(vget_low_u16(i16), scale, one));
+        vst1q_f32(i_out + k + 4, neonScale(vget_high_u16(i16), scale, one));
+        vst1q_f32(q_out + k,     neonScale(vget_low_u16(q16), scale, one));
+        vst1q_f32(q_out + k + 4, neonScale(vget_high_u16(q16), scale, one));
+    }
+    planarScalar(in + 2 * k, n - k, i_out + k, q_out + k);
+}
+#endif
+
+// ============ IQConverter Implementation ============
+
+IQKernel IQConverter::resolve(IQKernel requested) {
+    const CpuFeatures& cpu = getCpuFeatures();
+
+    switch (requested) {
+        case IQKernel::AVX2:
+            if (cpu.avx2 && cpu.fma) return IQKernel::AVX2;
+            return resolve(IQKernel::SSE2);
+        case IQKernel::SSE2:
+            if (cpu.sse2) return IQKernel::SSE2;
+            return IQKernel::SCALAR;
+        case IQKernel::NEON:
+            if (cpu.neon) return IQKernel::NEON;
+            return IQKernel::SCALAR;
+        case IQKernel::SCALAR:
+        case IQKernel::LUT:
+            return requested;
+        case IQKernel::AUTO:
+        default:
+            if (cpu.avx2 && cpu.fma) return IQKernel::AVX2;
+            if (cpu.sse2) return IQKernel::SSE2;
+            if (cpu.neon) return IQKernel::NEON;
+            return IQKernel::LUT;
+    }
+}
+
+IQConverter::IQConverter(IQKernel requested)
+    : kernel(resolve(requested)),
+      interleaved_fn(interleavedScalar),
+      planar_fn(planarScalar) {
+    switch (kernel) {
+        case IQKernel::LUT:
+            interleaved_fn = interleavedLUT;
+            planar_fn = planarLUT;
+            break;
+#if defined(SPEEDSDR_X86)
+        case IQKernel::SSE2:
+            interleaved_fn = interleavedSSE2;
+            planar_fn = planarSSE2;
+            break;
+        case IQKernel::AVX2:
+            interleaved_fn = interleavedAVX2;
+            planar_fn = planarAVX2;
+            break;
+#endif
+#if defined(SPEEDSDR_NEON)
+        case IQKernel::NEON:
+            interleaved_fn = interleavedNEON;
+            planar_fn = planarNEON;
+            break;
+#endif
+        default:
+            kernel = IQKernel::SCALAR;
+            break;
+    }
+}
+
+void IQConverter::toComplex(const uint8_t* in, size_t num_samples, std::complex<float>* out) const {
+    // std::complex<float> tem o mesmo layout de float[2]
+    interleaved_fn(in, num_samples, reinterpret_cast<float*>(out));
+}
+
+void IQConverter::toPlanar(const uint8_t* in, size_t num_samples, float* i_out, float* q_out) const {
+    planar_fn(in, num_samples, i_out, q_out);
+}
+
+const char* IQConverter::kernelName(IQKernel kernel) {
+    switch (kernel) {
+        case IQKernel::AUTO: return "auto";
+        case IQKernel::SCALAR: return "scalar";
+        case IQKernel::LUT: return "lut";
+        case IQKernel::SSE2: return "sse2";
+        case IQKernel::AVX2: return "avx2";
+        case IQKernel::NEON: return "neon";
+    }
+    return "unknown";
+}
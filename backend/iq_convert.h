@@ -0,0 +1,40 @@
+#pragma once
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+
+// Implementações disponíveis para a conversão uint8 IQ -> float
+enum class IQKernel {
+    AUTO = 0,     // Melhor disponível na CPU atual
+    SCALAR = 1,
+    LUT = 2,      // Tabela de 256 entradas
+    SSE2 = 3,
+    AVX2 = 4,
+    NEON = 5
+};
+
+// Conversor de amostras do RTL-SDR (bytes sem sinal, I/Q intercalados)
+// para float em [-1, 1]. A saída é sempre do chamador e deve ter
+// espaço para num_samples amostras; buffers alinhados (AlignedVector) são
+// recomendados mas não obrigatórios.
+class IQConverter {
+public:
+    explicit IQConverter(IQKernel kernel = IQKernel::AUTO);
+
+    // Intercalado: out[k] = (I, Q)
+    void toComplex(const uint8_t* in, size_t num_samples, std::complex<float>* out) const;
+
+    // Planar: i_out[k] = I, q_out[k] = Q
+    void toPlanar(const uint8_t* in, size_t num_samples, float* i_out, float* q_out) const;
+
+    IQKernel getKernel() const { return kernel; }
+    static const char* kernelName(IQKernel kernel);
+
+    // Resolve AUTO e rebaixa kernels não suportados pela CPU
+    static IQKernel resolve(IQKernel requested);
+
+private:
+    IQKernel kernel;
+    void (*interleaved_fn)(const uint8_t*, size_t, float*);
+    void (*planar_fn)(const uint8_t*, size_t, float*, float*);
+};
@@ -0,0 +1,358 @@
+#include "iq_recorder.h"
+#include <algorithm>
+#include <cmath>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+static const size_t DIRECT_ALIGN = 4096;
+
+static std::string jsonEscape(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        if (static_cast<unsigned char>(c) >= 0x20) out += c;
+    }
+    return out;
+}
+
+// ============ SigMF ============
+
+std::string sigmfDateTime(double offset_seconds) {
+    std::time_t t = std::time(nullptr) + static_cast<std::time_t>(std::floor(offset_seconds));
+    std::tm tm;
+#ifdef _WIN32
+    gmtime_s(&tm, &t);
+#else
+    gmtime_r(&t, &tm);
+#endif
+    char buf[32];
+    std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", &tm);
+    return buf;
+}
+
+bool writeSigMFMeta(const std::string& base_path, const RecordingInfo& info, const std::string& datetime,
+                    const std::vector<SigMFCapture>& captures, const std::vector<SigMFAnnotation>& annotations,
+                    uint64_t dropped_bytes) {
+    std::string json = "{\n  \"global\": {\n";
+    json += "    \"core:datatype\": \"cu8\",\n";
+    json += "    \"core:sample_rate\": " + std::to_string(info.sample_rate) + ",\n";
+    json += "    \"core:version\": \"1.0.0\",\n";
+    json += "    \"core:hw\": \"" + jsonEscape(info.hardware) + "\",\n";
+    json += "    \"core:recorder\": \"SpeedSDR Pro\",\n";
+    if (!info.description.empty())
+        json += "    \"core:description\": \"" + jsonEscape(info.description) + "\",\n";
+    json += "    \"speedsdr:gain_db\": " + std::to_string(info.gain_db) + ",\n";
+    json += "    \"speedsdr:dropped_bytes\": " + std::to_string(dropped_bytes) + "\n";
+    json += "  },\n  \"captures\": [\n";
+    for (size_t i = 0; i < captures.size(); i++) {
+        json += "    {\"core:sample_start\": " + std::to_string(captures[i].sample_start) +
+                ", \"core:global_index\": " + std::to_string(captures[i].global_index) +
+                ", \"core:frequency\": " + std::to_string(captures[i].frequency);
+        if (i == 0) json += ", \"core:datetime\": \"" + datetime + "\"";
+        json += i + 1 < captures.size() ? "},\n" : "}\n";
+    }
+    json += "  ],\n  \"annotations\": [\n";
+    for (size_t i = 0; i < annotations.size(); i++) {
+        json += "    {\"core:sample_start\": " + std::to_string(annotations[i].sample_start) +
+                ", \"core:sample_count\": " + std::to_string(annotations[i].sample_count) +
+                ", \"core:comment\": \"" + jsonEscape(annotations[i].comment) + "\"}";
+        json += i + 1 < annotations.size() ? ",\n" : "\n";
+    }
+    json += "  ]\n}\n";
+
+    FILE* f = std::fopen((base_path + ".sigmf-meta").c_str(), "wb");
+    if (!f) return false;
+    bool ok = std::fwrite(json.data(), 1, json.size(), f) == json.size();
+    return std::fclose(f) == 0 && ok;
+}
+
+// ============ IQRecorder Implementation ============
+
+IQRecorder::IQRecorder(size_t block_bytes, size_t num_blocks, bool direct)
+    : ring(num_blocks, block_bytes, DIRECT_ALIGN),
+      direct_io(direct),
+      recording(false),
+      writer_running(false),
+      fill_slot(nullptr),
+      fill_len(0),
+      produced(0),
+      global_bytes(0),
+      consumed(0),
+      expected_bytes(0),
+      fd(-1),
+      file(nullptr),
+      file_direct(false),
+      bytes_written(0),
+      dropped_blocks(0),
+      dropped_bytes(0) {
+    slot_start.assign(ring.capacity(), 0);
+}
+
+IQRecorder::~IQRecorder() {
+    stop();
+}
+
+bool IQRecorder::start(const std::string& path, const RecordingInfo& recording_info) {
+    stop();
+
+    std::lock_guard<std::mutex> lock(producer_mutex);
+    if (!openData(path + ".sigmf-data")) {
+        std::cerr << "[Recorder] Falha ao abrir " << path << ".sigmf-data\n";
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> meta_lock(meta_mutex);
+        base_path = path;
+        info = recording_info;
+        start_time = sigmfDateTime();
+        events.clear();
+        gaps.clear();
+    }
+    writeMeta();
+
+    fill_slot = nullptr;
+    fill_len = 0;
+    global_bytes = 0;
+    expected_bytes = 0;
+    bytes_written = 0;
+    dropped_blocks = 0;
+    dropped_bytes = 0;
+
+    writer_running = true;
+    writer = std::thread(&IQRecorder::writerLoop, this);
+    recording = true;
+    std::cout << "[Recorder] Gravando em " << path << ".sigmf-data"
+              << (file_direct ? " (O_DIRECT)" : "") << "\n";
+    return true;
+}
+
+void IQRecorder::stop() {
+    {
+        std::lock_guard<std::mutex> lock(producer_mutex);
+        if (!recording && !writer.joinable()) return;
+        recording = false;
+        // Bloco parcial vai para o disco junto com o resto
+        if (fill_slot && fill_len > 0) {
+            slot_start[produced & (ring.capacity() - 1)] = global_bytes - fill_len;
+            ring.commitWrite(fill_len);
+            produced++;
+        }
+        fill_slot = nullptr;
+        fill_len = 0;
+    }
+
+    writer_running = false;
+    if (writer.joinable()) writer.join();
+    closeData();
+    writeMeta();
+
+    std::cout << "[Recorder] Gravacao encerrada: " << bytes_written.load() << " bytes, "
+              << dropped_blocks.load() << " bloco(s) descartado(s)\n";
+}
+
+void IQRecorder::write(const uint8_t* iq, size_t len) {
+    if (!recording.load(std::memory_order_relaxed)) return;
+
+    std::unique_lock<std::mutex> lock(producer_mutex, std::try_to_lock);
+    if (!lock.owns_lock() || !recording) return;   // start()/stop() em andamento
+
+    const size_t mask = ring.capacity() - 1;
+    while (len > 0) {
+        if (!fill_slot) {
+            fill_slot = ring.acquireWrite();
+            if (!fill_slot) {
+                // Disco atrasado: descarta o resto do bloco de entrada
+                dropped_blocks.fetch_add(1, std::memory_order_relaxed);
+                dropped_bytes.fetch_add(len, std::memory_order_relaxed);
+                global_bytes.fetch_add(len, std::memory_order_relaxed);
+                return;
+            }
+            fill_len = 0;
+        }
+
+        size_t take = std::min(len, ring.slotSize() - fill_len);
+        std::memcpy(fill_slot + fill_len, iq, take);
+        fill_len += take;
+        iq += take;
+        len -= take;
+        global_bytes.fetch_add(take, std::memory_order_relaxed);
+
+        if (fill_len == ring.slotSize()) {
+            slot_start[produced & mask] = global_bytes.load(std::memory_order_relaxed) - fill_len;
+            ring.commitWrite(fill_len);
+            produced++;
+            fill_slot = nullptr;
+            fill_len = 0;
+        }
+    }
+}
+
+void IQRecorder::annotateRetune(uint64_t freq_hz) {
+    if (!recording) return;
+    std::lock_guard<std::mutex> lock(meta_mutex);
+    events.push_back({ global_bytes.load() / 2, freq_hz, std::string() });
+}
+
+void IQRecorder::annotate(const std::string& comment) {
+    if (!recording) return;
+    std::lock_guard<std::mutex> lock(meta_mutex);
+    events.push_back({ global_bytes.load() / 2, 0, comment });
+}
+
+RecorderStats IQRecorder::getStats() const {
+    RecorderStats st;
+    st.recording = recording;
+    {
+        std::lock_guard<std::mutex> lock(meta_mutex);
+        st.path = base_path;
+    }
+    st.bytes_written = bytes_written;
+    st.dropped_blocks = dropped_blocks;
+    st.dropped_bytes = dropped_bytes;
+    st.queued_blocks = ring.size();
+    st.capacity_blocks = ring.capacity();
+    return st;
+}
+
+void IQRecorder::writerLoop() {
+    const size_t mask = ring.capacity() - 1;
+    while (writer_running || ring.size() > 0) {
+        if (!ring.waitForData(100)) continue;
+
+        size_t len = 0;
+        const uint8_t* data = ring.acquireRead(len);
+        if (!data) continue;
+
+        // Início fora do esperado = blocos descartados antes deste
+        uint64_t start = slot_start[consumed & mask];
+        if (start != expected_bytes) {
+            std::lock_guard<std::mutex> lock(meta_mutex);
+            gaps.push_back({ start / 2, (start - expected_bytes) / 2 });
+        }
+        expected_bytes = start + len;
+
+        writeBlock(data, len);
+        consumed++;
+        ring.releaseRead();
+    }
+}
+
+bool IQRecorder::openData(const std::string& path) {
+    file_direct = false;
+#ifdef _WIN32
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) return false;
+    std::setvbuf(f, nullptr, _IONBF, 0);   // Blocos já são grandes
+    file = f;
+    return true;
+#else
+    int flags = O_WRONLY | O_CREAT | O_TRUNC;
+#ifdef O_DIRECT
+    if (direct_io) {
+        fd = ::open(path.c_str(), flags | O_DIRECT, 0644);
+        if (fd >= 0) {
+            file_direct = true;
+            return true;
+        }
+        // Sistemas de arquivos sem O_DIRECT (tmpfs, alguns FUSE): escrita normal
+    }
+#endif
+    fd = ::open(path.c_str(), flags, 0644);
+    return fd >= 0;
+#endif
+}
+
+void IQRecorder::writeBlock(const uint8_t* data, size_t len) {
+#ifdef _WIN32
+    size_t written = std::fwrite(data, 1, len, static_cast<FILE*>(file));
+    bytes_written += written;
+#else
+    // O_DIRECT exige tamanho múltiplo de 4 KB: só o último bloco pode ser
+    // parcial; ele é completado aqui e o arquivo truncado no fechamento
+    size_t to_write = file_direct ? (len + DIRECT_ALIGN - 1) / DIRECT_ALIGN * DIRECT_ALIGN : len;
+    size_t done = 0;
+    while (done < to_write) {
+        ssize_t r = ::write(fd, data + done, to_write - done);
+        if (r <= 0) {
+            std::cerr << "[Recorder] Erro de escrita: " << std::strerror(errno) << "\n";
+            break;
+        }
+        done += static_cast<size_t>(r);
+    }
+    bytes_written += std::min(done, len);
+#endif
+}
+
+void IQRecorder::closeData() {
+#ifdef _WIN32
+    if (file) std::fclose(static_cast<FILE*>(file));
+    file = nullptr;
+#else
+    if (fd < 0) return;
+    if (file_direct && ::ftruncate(fd, static_cast<off_t>(bytes_written.load())) != 0) {
+        std::cerr << "[Recorder] Falha ao truncar o arquivo\n";
+    }
+    ::close(fd);
+    fd = -1;
+#endif
+}
+
+void IQRecorder::writeMeta() {
+    std::lock_guard<std::mutex> lock(meta_mutex);
+    if (base_path.empty()) return;
+
+    // Índice global -> índice no arquivo, descontando os descartes
+    // anteriores; um evento dentro de um trecho descartado vai para a retomada
+    auto fileSample = [this](uint64_t global) {
+        uint64_t lost = 0;
+        for (const Gap& g : gaps) {
+            if (g.global_sample > global && g.global_sample - g.lost_samples <= global) global = g.global_sample;
+            if (g.global_sample <= global) lost += g.lost_samples;
+        }
+        return global - std::min(global, lost);
+    };
+
+    // Capturas: início, cada retune e cada retomada depois de descarte
+    std::vector<SigMFCapture> captures;
+    std::vector<const Event*> retunes;
+    for (const Event& e : events) {
+        if (e.freq_hz) retunes.push_back(&e);
+    }
+    uint64_t freq = info.center_freq;
+    captures.push_back({ 0, 0, freq });
+    size_t r = 0, g = 0;
+    while (r < retunes.size() || g < gaps.size()) {
+        bool take_retune = g >= gaps.size() ||
+            (r < retunes.size() && retunes[r]->global_sample < gaps[g].global_sample);
+        uint64_t global = take_retune ? retunes[r]->global_sample : gaps[g].global_sample;
+        if (take_retune) freq = retunes[r++]->freq_hz;
+        else g++;
+        uint64_t sample = fileSample(global);
+        if (captures.back().sample_start == sample) captures.pop_back();
+        captures.push_back({ sample, global, freq });
+    }
+
+    std::vector<SigMFAnnotation> annotations;
+    for (const Event& e : events) {
+        std::string comment = e.freq_hz ? "retune " + std::to_string(e.freq_hz) + " Hz" : e.comment;
+        annotations.push_back({ fileSample(e.global_sample), 0, comment });
+    }
+    for (const Gap& gap : gaps) {
+        annotations.push_back({ fileSample(gap.global_sample), 0,
+                                std::to_string(gap.lost_samples) + " amostras descartadas" });
+    }
+
+    if (!writeSigMFMeta(base_path, info, start_time, captures, annotations, dropped_bytes)) {
+        std::cerr << "[Recorder] Falha ao gravar " << base_path << ".sigmf-meta\n";
+    }
+}
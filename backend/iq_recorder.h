@@ -0,0 +1,130 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "spsc_ring.h"
+
+// Metadados fixos de uma gravação (bloco "global" do SigMF)
+struct RecordingInfo {
+    int sample_rate = 2048000;
+    uint64_t center_freq = 0;
+    float gain_db = 0.0f;
+    std::string hardware = "RTL-SDR";
+    std::string description;
+};
+
+struct SigMFCapture {
+    uint64_t sample_start;      // Índice no arquivo
+    uint64_t global_index;      // Índice no fluxo do RTL-SDR
+    uint64_t frequency;
+};
+
+struct SigMFAnnotation {
+    uint64_t sample_start;
+    uint64_t sample_count;
+    std::string comment;
+};
+
+// Data/hora UTC no formato ISO 8601 do SigMF (agora + offset_seconds)
+std::string sigmfDateTime(double offset_seconds = 0.0);
+// Grava base_path.sigmf-meta (cu8); datetime vai na primeira captura
+bool writeSigMFMeta(const std::string& base_path, const RecordingInfo& info, const std::string& datetime,
+                    const std::vector<SigMFCapture>& captures, const std::vector<SigMFAnnotation>& annotations,
+                    uint64_t dropped_bytes);
+
+struct RecorderStats {
+    bool recording;
+    std::string path;           // Caminho base (sem extensão)
+    uint64_t bytes_written;
+    uint64_t dropped_blocks;    // Blocos de entrada descartados (anel cheio)
+    uint64_t dropped_bytes;
+    size_t queued_blocks;       // Blocos aguardando o disco
+    size_t capacity_blocks;
+};
+
+// Gravador de IQ bruto (cu8) em pares SigMF .sigmf-data/.sigmf-meta.
+// write() só copia para um bloco grande pré-alocado de um anel SPSC (não
+// bloqueia nem aloca: pode ser chamado do callback USB); uma thread
+// escreve os blocos cheios no disco. A memória fica limitada ao anel; se o
+// disco atrasar, os blocos novos são descartados, contados e marcados no
+// .sigmf-meta (nova captura com core:global_index + anotação).
+// No Linux, com direct_io, o arquivo é aberto com O_DIRECT (blocos de 4 KB
+// alinhados) para não encher o page cache em gravações longas.
+class IQRecorder {
+public:
+    // block_bytes é arredondado para múltiplo de 4096
+    IQRecorder(size_t block_bytes = 1 << 20, size_t num_blocks = 32, bool direct_io = true);
+    ~IQRecorder();
+
+    // Abre base_path.sigmf-data e grava o .sigmf-meta inicial; false se falhar
+    bool start(const std::string& base_path, const RecordingInfo& info);
+    // Esvazia o anel, fecha o arquivo e regrava o .sigmf-meta completo
+    void stop();
+    bool isRecording() const { return recording.load(std::memory_order_relaxed); }
+
+    // ---- Produtor (uma thread só: callback USB) ----
+    void write(const uint8_t* iq, size_t len);
+
+    // ---- Qualquer thread ----
+    // Retune: nova captura SigMF (core:frequency) a partir da amostra atual
+    void annotateRetune(uint64_t freq_hz);
+    // Anotação livre na amostra atual (ex.: mudança de ganho)
+    void annotate(const std::string& comment);
+
+    RecorderStats getStats() const;
+
+private:
+    struct Event {
+        uint64_t global_sample;     // Índice no fluxo do RTL-SDR (inclui descartes)
+        uint64_t freq_hz;           // 0 = não é retune
+        std::string comment;
+    };
+    struct Gap {
+        uint64_t global_sample;     // Onde os dados voltam
+        uint64_t lost_samples;
+    };
+
+    SPSCSlotRing ring;
+    std::vector<uint64_t> slot_start;   // Byte global do início de cada slot
+    bool direct_io;
+
+    std::atomic<bool> recording;
+    std::atomic<bool> writer_running;
+    std::thread writer;
+
+    // Produtor: try_lock só disputa com start()/stop(), nunca espera
+    std::mutex producer_mutex;
+    uint8_t* fill_slot;
+    size_t fill_len;
+    uint64_t produced;                  // Slots publicados
+    std::atomic<uint64_t> global_bytes; // Bytes recebidos desde o start (inclui descartes)
+
+    // Escritor
+    uint64_t consumed;
+    uint64_t expected_bytes;
+    int fd;
+    void* file;                         // FILE* onde não há O_DIRECT
+    bool file_direct;
+
+    std::atomic<uint64_t> bytes_written;
+    std::atomic<uint64_t> dropped_blocks;
+    std::atomic<uint64_t> dropped_bytes;
+
+    // Metadados (sob meta_mutex)
+    mutable std::mutex meta_mutex;
+    std::string base_path;
+    RecordingInfo info;
+    std::string start_time;
+    std::vector<Event> events;
+    std::vector<Gap> gaps;
+
+    void writerLoop();
+    void writeBlock(const uint8_t* data, size_t len);
+    bool openData(const std::string& path);
+    void closeData();
+    void writeMeta();
+};
@@ -0,0 +1,648 @@
+#include "iq_source.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#pragma comment (lib, "Ws2_32.lib")
+typedef SOCKET sock_t;
+#define SOCK_INVALID INVALID_SOCKET
+#define sock_close closesocket
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+typedef int sock_t;
+#define SOCK_INVALID (-1)
+#define sock_close ::close
+#endif
+
+#ifndef SPEEDSDR_NO_RTLSDR
+#include <rtl-sdr.h>
+#endif
+
+#ifdef MSG_NOSIGNAL
+#define SOURCE_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SOURCE_SEND_FLAGS 0
+#endif
+
+static const double PI = 3.14159265358979323846;
+static const int RECV_TIMEOUT_MS = 200;         // Para stop() ser atendido sem fechar o socket
+static const int RTLTCP_RCVBUF = 1 << 20;       // Absorve atrasos curtos da thread de leitura
+
+// ============ createIQSource ============
+
+static bool endsWith(const std::string& s, const std::string& suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+std::unique_ptr<IQSource> createIQSource(const std::string& spec, uint32_t sample_rate) {
+    std::string kind = spec.substr(0, spec.find(':'));
+    std::string arg = spec.size() > kind.size() ? spec.substr(kind.size() + 1) : "";
+
+    if (kind == "rtlsdr") {
+#ifndef SPEEDSDR_NO_RTLSDR
+        uint32_t index = arg.empty() ? 0 : static_cast<uint32_t>(std::strtoul(arg.c_str(), nullptr, 10));
+        return std::unique_ptr<IQSource>(new RtlSdrSource(index, sample_rate));
+#else
+        std::cerr << "[Fonte] Build sem librtlsdr\n";
+        return nullptr;
+#endif
+    }
+    if (kind == "rtltcp") {
+        std::string host = arg.empty() ? "127.0.0.1" : arg;
+        int port = 1234;
+        size_t colon = arg.rfind(':');
+        if (colon != std::string::npos) {
+            host = arg.substr(0, colon);
+            port = std::atoi(arg.c_str() + colon + 1);
+        }
+        if (port <= 0 || port > 65535) return nullptr;
+        return std::unique_ptr<IQSource>(new RtlTcpSource(host, port, sample_rate));
+    }
+    if (kind == "file") {
+        // Sufixos no fim; o caminho pode conter ':' (C:\...)
+        bool realtime = true, loop = false;
+        for (;;) {
+            if (endsWith(arg, ":fast")) { realtime = false; arg.resize(arg.size() - 5); }
+            else if (endsWith(arg, ":loop")) { loop = true; arg.resize(arg.size() - 5); }
+            else break;
+        }
+        if (arg.empty()) return nullptr;
+        return std::unique_ptr<IQSource>(new FileSource(arg, sample_rate, realtime, loop));
+    }
+    if (kind == "synth") {
+        return std::unique_ptr<IQSource>(new SyntheticSource(sample_rate, arg != "fast"));
+    }
+    return nullptr;
+}
+
+#ifndef SPEEDSDR_NO_RTLSDR
+// ============ RtlSdrSource Implementation ============
+
+RtlSdrSource::RtlSdrSource(uint32_t device_index, uint32_t rate)
+    : index(device_index), sample_rate(rate), dev(nullptr), stopping(false) {}
+
+RtlSdrSource::~RtlSdrSource() {
+    close();
+}
+
+bool RtlSdrSource::open() {
+    stopping = false;
+    if (dev) return true;
+    uint32_t count = rtlsdr_get_device_count();
+    if (count == 0) {
+        std::cerr << "[RTL-SDR] Nenhum dispositivo detectado\n";
+        return false;
+    }
+    std::cout << "[RTL-SDR] Dispositivos encontrados: " << count << "\n";
+    if (index >= count || rtlsdr_open(&dev, index) < 0) {
+        std::cerr << "[RTL-SDR] Falha ao abrir o dispositivo " << index << "\n";
+        dev = nullptr;
+        return false;
+    }
+    rtlsdr_set_sample_rate(dev, sample_rate);
+    rtlsdr_reset_buffer(dev);
+    return true;
+}
+
+void RtlSdrSource::close() {
+    if (!dev) return;
+    rtlsdr_close(dev);
+    dev = nullptr;
+}
+
+int RtlSdrSource::run(IQCallback callback, void* ctx, size_t block_size) {
+    if (stopping) return 0;
+    if (!dev) return -1;
+    int r = rtlsdr_read_async(dev, callback, ctx, 0, static_cast<uint32_t>(block_size));
+    return stopping ? 0 : (r != 0 ? -1 : 0);
+}
+
+void RtlSdrSource::stop() {
+    stopping = true;
+    if (dev) rtlsdr_cancel_async(dev);
+}
+
+bool RtlSdrSource::setCenterFreq(uint32_t hz) {
+    return dev && rtlsdr_set_center_freq(dev, hz) == 0;
+}
+
+bool RtlSdrSource::setSampleRate(uint32_t rate) {
+    if (!dev || rtlsdr_set_sample_rate(dev, rate) != 0) return false;
+    sample_rate = rate;
+    return true;
+}
+
+bool RtlSdrSource::setGain(int tenth_db) {
+    return dev && rtlsdr_set_tuner_gain_mode(dev, 1) == 0 && rtlsdr_set_tuner_gain(dev, tenth_db) == 0;
+}
+
+bool RtlSdrSource::setAutoGain(bool enabled) {
+    return dev && rtlsdr_set_tuner_gain_mode(dev, enabled ? 0 : 1) == 0;
+}
+
+bool RtlSdrSource::setDirectSampling(int mode) {
+    return dev && rtlsdr_set_direct_sampling(dev, mode) == 0;
+}
+
+bool RtlSdrSource::setFreqCorrection(int ppm) {
+    return dev && rtlsdr_set_freq_correction(dev, ppm) == 0;
+}
+#endif
+
+// ============ RtlTcpSource Implementation ============
+
+static bool socketTimedOut() {
+#ifdef _WIN32
+    int e = WSAGetLastError();
+    return e == WSAETIMEDOUT || e == WSAEWOULDBLOCK;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+}
+
+RtlTcpSource::RtlTcpSource(const std::string& h, int p, uint32_t rate, int connect_attempts)
+    : host(h),
+      port(p),
+      sample_rate(rate),
+      attempts(std::max(connect_attempts, 1)),
+      fd(static_cast<intptr_t>(SOCK_INVALID)),
+      stopping(false),
+      tuner_type(0),
+      freq(0),
+      gain(-1),
+      auto_gain(false),
+      direct_sampling(0),
+      ppm(0) {
+#ifdef _WIN32
+    WSADATA wsaData;
+    WSAStartup(MAKEWORD(2, 2), &wsaData);
+#endif
+}
+
+RtlTcpSource::~RtlTcpSource() {
+    close();
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+bool RtlTcpSource::connectOnce() {
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* res = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &res) != 0) return false;
+
+    sock_t s = SOCK_INVALID;
+    for (addrinfo* ai = res; ai; ai = ai->ai_next) {
+        s = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (s == SOCK_INVALID) continue;
+        if (connect(s, ai->ai_addr, static_cast<int>(ai->ai_addrlen)) == 0) break;
+        sock_close(s);
+        s = SOCK_INVALID;
+    }
+    freeaddrinfo(res);
+    if (s == SOCK_INVALID) return false;
+
+    int one = 1;
+    int rcvbuf = RTLTCP_RCVBUF;
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&one), sizeof(one));
+    setsockopt(s, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char*>(&rcvbuf), sizeof(rcvbuf));
+#ifdef _WIN32
+    DWORD tv = RECV_TIMEOUT_MS;
+#else
+    timeval tv;
+    tv.tv_sec = 0;
+    tv.tv_usec = RECV_TIMEOUT_MS * 1000;
+#endif
+    setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&tv), sizeof(tv));
+
+    // Cabeçalho: "RTL0", tipo do sintonizador e número de ganhos (big-endian)
+    uint8_t header[12];
+    size_t got = 0;
+    int idle = 0;
+    while (got < sizeof(header) && idle < 5000 / RECV_TIMEOUT_MS) {
+        int n = recv(s, reinterpret_cast<char*>(header) + got, static_cast<int>(sizeof(header) - got), 0);
+        if (n > 0) { got += n; continue; }
+        if (n < 0 && socketTimedOut()) { idle++; continue; }
+        break;
+    }
+    if (got < sizeof(header) || std::memcmp(header, "RTL0", 4) != 0) {
+        std::cerr << "[rtl_tcp] Resposta inesperada de " << host << ":" << port << "\n";
+        sock_close(s);
+        return false;
+    }
+    tuner_type = (uint32_t(header[4]) << 24) | (uint32_t(header[5]) << 16) | (uint32_t(header[6]) << 8) | header[7];
+    std::lock_guard<std::mutex> lock(send_mutex);
+    fd = static_cast<intptr_t>(s);
+    return true;
+}
+
+bool RtlTcpSource::open() {
+    stopping = false;
+    return reconnect();
+}
+
+bool RtlTcpSource::reconnect() {
+    if (fd != static_cast<intptr_t>(SOCK_INVALID)) return true;
+
+    // O rtl_tcp pode ainda estar subindo: tenta de novo com recuo em vez
+    // de esperar um tempo fixo
+    int delay_ms = 100;
+    for (int i = 0; i < attempts; i++) {
+        if (connectOnce()) break;
+        if (i + 1 == attempts) {
+            std::cerr << "[rtl_tcp] Sem conexao com " << host << ":" << port << "\n";
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms));
+        delay_ms = std::min(delay_ms * 2, 2000);
+    }
+    std::cout << "[rtl_tcp] Conectado a " << host << ":" << port << " (sintonizador " << tuner_type << ")\n";
+
+    // Reaplica o estado (primeira conexão ou reconexão)
+    std::lock_guard<std::mutex> lock(send_mutex);
+    bool ok = sendLocked(CMD_SET_SAMPLE_RATE, sample_rate);
+    if (freq) ok = ok && sendLocked(CMD_SET_FREQ, freq);
+    if (ppm) ok = ok && sendLocked(CMD_SET_FREQ_CORRECTION, static_cast<uint32_t>(ppm));
+    if (direct_sampling) ok = ok && sendLocked(CMD_SET_DIRECT_SAMPLING, static_cast<uint32_t>(direct_sampling));
+    if (auto_gain) {
+        ok = ok && sendLocked(CMD_SET_GAIN_MODE, 0);
+    } else if (gain >= 0) {
+        ok = ok && sendLocked(CMD_SET_GAIN_MODE, 1) && sendLocked(CMD_SET_GAIN, static_cast<uint32_t>(gain));
+    }
+    return ok;
+}
+
+void RtlTcpSource::closeSocket() {
+    if (fd == static_cast<intptr_t>(SOCK_INVALID)) return;
+    sock_close(static_cast<sock_t>(fd));
+    fd = static_cast<intptr_t>(SOCK_INVALID);
+}
+
+void RtlTcpSource::close() {
+    std::lock_guard<std::mutex> lock(send_mutex);
+    closeSocket();
+}
+
+int RtlTcpSource::run(IQCallback callback, void* ctx, size_t block_size) {
+    if (stopping) return 0;
+    if (fd == static_cast<intptr_t>(SOCK_INVALID) && !reconnect()) return -1;
+
+    std::vector<unsigned char> block(block_size & ~size_t(1));
+    size_t fill = 0;
+    sock_t s = static_cast<sock_t>(fd);
+    while (!stopping) {
+        int n = recv(s, reinterpret_cast<char*>(block.data()) + fill, static_cast<int>(block.size() - fill), 0);
+        if (n > 0) {
+            fill += n;
+            if (fill == block.size()) {
+                callback(block.data(), static_cast<uint32_t>(fill), ctx);
+                fill = 0;
+            }
+            continue;
+        }
+        if (n < 0 && socketTimedOut()) continue;
+
+        // Conexão caiu: o próximo run() reconecta e reenvia o estado
+        std::cerr << "[rtl_tcp] Conexao encerrada pelo servidor\n";
+        close();
+        return -1;
+    }
+    return 0;
+}
+
+void RtlTcpSource::stop() {
+    stopping = true;    // recv tem timeout: run() sai em até RECV_TIMEOUT_MS
+}
+
+bool RtlTcpSource::sendLocked(uint8_t command, uint32_t value) {
+    if (fd == static_cast<intptr_t>(SOCK_INVALID)) return false;
+    uint8_t msg[5] = {
+        command,
+        static_cast<uint8_t>(value >> 24), static_cast<uint8_t>(value >> 16),
+        static_cast<uint8_t>(value >> 8), static_cast<uint8_t>(value)
+    };
+    return send(static_cast<sock_t>(fd), reinterpret_cast<const char*>(msg), sizeof(msg), SOURCE_SEND_FLAGS) == sizeof(msg);
+}
+
+bool RtlTcpSource::sendCommand(uint8_t command, uint32_t value) {
+    std::lock_guard<std::mutex> lock(send_mutex);
+    return sendLocked(command, value);
+}
+
+bool RtlTcpSource::setCenterFreq(uint32_t hz) {
+    std::lock_guard<std::mutex> lock(send_mutex);
+    freq = hz;
+    return sendLocked(CMD_SET_FREQ, hz);
+}
+
+bool RtlTcpSource::setSampleRate(uint32_t rate) {
+    std::lock_guard<std::mutex> lock(send_mutex);
+    sample_rate = rate;
+    return sendLocked(CMD_SET_SAMPLE_RATE, rate);
+}
+
+bool RtlTcpSource::setGain(int tenth_db) {
+    std::lock_guard<std::mutex> lock(send_mutex);
+    gain = tenth_db;
+    auto_gain = false;
+    return sendLocked(CMD_SET_GAIN_MODE, 1) && sendLocked(CMD_SET_GAIN, static_cast<uint32_t>(tenth_db));
+}
+
+bool RtlTcpSource::setAutoGain(bool enabled) {
+    std::lock_guard<std::mutex> lock(send_mutex);
+    auto_gain = enabled;
+    return sendLocked(CMD_SET_GAIN_MODE, enabled ? 0 : 1);
+}
+
+bool RtlTcpSource::setDirectSampling(int mode) {
+    std::lock_guard<std::mutex> lock(send_mutex);
+    direct_sampling = mode;
+    return sendLocked(CMD_SET_DIRECT_SAMPLING, static_cast<uint32_t>(mode));
+}
+
+bool RtlTcpSource::setFreqCorrection(int value) {
+    std::lock_guard<std::mutex> lock(send_mutex);
+    ppm = value;
+    return sendLocked(CMD_SET_FREQ_CORRECTION, static_cast<uint32_t>(value));
+}
+
+// ============ FileSource Implementation ============
+
+// Taxa do .sigmf-meta ao lado do .sigmf-data; 0 se não houver
+static uint32_t sigmfSampleRate(const std::string& meta_path) {
+    std::ifstream in(meta_path);
+    if (!in) return 0;
+    std::stringstream ss;
+    ss << in.rdbuf();
+    std::string json = ss.str();
+
+    size_t dt = json.find("\"core:datatype\"");
+    if (dt != std::string::npos) {
+        size_t open_quote = json.find('"', json.find(':', dt + 15));
+        if (json.compare(open_quote, 5, "\"cu8\"") != 0) {
+            std::cerr << "[Fonte] " << meta_path << ": apenas core:datatype cu8 e suportado\n";
+        }
+    }
+    size_t key = json.find("\"core:sample_rate\"");
+    if (key == std::string::npos) return 0;
+    size_t colon = json.find(':', key + 18);
+    if (colon == std::string::npos) return 0;
+    return static_cast<uint32_t>(std::strtod(json.c_str() + colon + 1, nullptr));
+}
+
+FileSource::FileSource(const std::string& p, uint32_t rate, bool rt, bool lp)
+    : path(p),
+      sample_rate(rate),
+      realtime(rt),
+      loop(lp),
+      data(nullptr),
+      length(0),
+      mapping(nullptr),
+      stopping(false) {}
+
+FileSource::~FileSource() {
+    close();
+}
+
+bool FileSource::open() {
+    stopping = false;
+    if (data) return true;
+
+    std::string data_path = path;
+    if (endsWith(path, ".sigmf-meta")) data_path = path.substr(0, path.size() - 4) + "data";
+    if (endsWith(data_path, ".sigmf-data")) {
+        uint32_t rate = sigmfSampleRate(data_path.substr(0, data_path.size() - 4) + "meta");
+        if (rate) sample_rate = rate;
+    }
+
+    // MAP_PRIVATE / FILE_MAP_COPY: o callback recebe ponteiro não-const e o
+    // arquivo nunca é alterado (cópia na escrita)
+#ifdef _WIN32
+    HANDLE file = CreateFileA(data_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        std::cerr << "[Fonte] Falha ao abrir " << data_path << "\n";
+        return false;
+    }
+    LARGE_INTEGER size;
+    GetFileSizeEx(file, &size);
+    length = static_cast<size_t>(size.QuadPart);
+    HANDLE map = length ? CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr) : nullptr;
+    CloseHandle(file);
+    if (!map) {
+        std::cerr << "[Fonte] Falha ao mapear " << data_path << "\n";
+        return false;
+    }
+    data = static_cast<uint8_t*>(MapViewOfFile(map, FILE_MAP_COPY, 0, 0, 0));
+    if (!data) {
+        CloseHandle(map);
+        return false;
+    }
+    mapping = map;
+#else
+    int fd = ::open(data_path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "[Fonte] Falha ao abrir " << data_path << "\n";
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        ::close(fd);
+        std::cerr << "[Fonte] Arquivo vazio: " << data_path << "\n";
+        return false;
+    }
+    length = static_cast<size_t>(st.st_size);
+    void* p = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        std::cerr << "[Fonte] Falha ao mapear " << data_path << "\n";
+        return false;
+    }
+    madvise(p, length, MADV_SEQUENTIAL);
+    data = static_cast<uint8_t*>(p);
+#endif
+    length &= ~size_t(1);   // Amostras I/Q inteiras
+    std::cout << "[Fonte] " << data_path << ": " << length / 2 << " amostras a " << sample_rate
+              << " Hz (" << (realtime ? "tempo real" : "maxima velocidade") << (loop ? ", em loop" : "") << ")\n";
+    return true;
+}
+
+void FileSource::close() {
+    if (!data) return;
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+    CloseHandle(static_cast<HANDLE>(mapping));
+    mapping = nullptr;
+#else
+    munmap(data, length);
+#endif
+    data = nullptr;
+    length = 0;
+}
+
+int FileSource::run(IQCallback callback, void* ctx, size_t block_size) {
+    if (!data) return -1;
+    block_size &= ~size_t(1);
+    if (block_size == 0) return -1;
+
+    // Ritmo pelo relógio monotônico: prazo de cada bloco = início + amostras / taxa
+    typedef std::chrono::steady_clock clock;
+    clock::time_point start = clock::now();
+    uint64_t delivered = 0;
+    size_t pos = 0;
+    while (!stopping) {
+        if (pos >= length) {
+            if (!loop) break;
+            pos = 0;
+        }
+        size_t n = std::min(block_size, length - pos);
+        if (realtime) {
+            std::this_thread::sleep_until(start + std::chrono::duration_cast<clock::duration>(
+                std::chrono::duration<double>(static_cast<double>(delivered) / (2.0 * sample_rate))));
+        }
+        callback(data + pos, static_cast<uint32_t>(n), ctx);
+        pos += n;
+        delivered += n;
+    }
+    return 0;
+}
+
+// ============ SyntheticSource Implementation ============
+
+// Tabela de seno com fase em 32 bits (volta completa = 2^32)
+static const int SINE_BITS = 12;
+static float sine_table[1 << SINE_BITS];
+
+static bool fillSineTable() {
+    for (int i = 0; i < (1 << SINE_BITS); i++) {
+        sine_table[i] = static_cast<float>(std::sin(2.0 * PI * i / (1 << SINE_BITS)));
+    }
+    return true;
+}
+
+static void initSineTable() {
+    static const bool ready = fillSineTable();   // Inicialização estática: thread-safe
+    (void)ready;
+}
+
+static inline float tableSin(uint32_t phase) {
+    return sine_table[phase >> (32 - SINE_BITS)];
+}
+
+static inline float tableCos(uint32_t phase) {
+    return sine_table[(phase + 0x40000000u) >> (32 - SINE_BITS)];
+}
+
+static inline int32_t phaseStep(double hz, uint32_t rate) {
+    return static_cast<int32_t>(std::llround(hz / rate * 4294967296.0));
+}
+
+SyntheticSource::SyntheticSource(uint32_t rate, bool rt)
+    : sample_rate(rate), realtime(rt), center_freq(100000000), noise(0.02), stopping(false) {
+    initSineTable();
+}
+
+bool SyntheticSource::setSampleRate(uint32_t rate) {
+    if (rate == 0) return false;
+    sample_rate = rate;
+    return true;
+}
+
+int SyntheticSource::run(IQCallback callback, void* ctx, size_t block_size) {
+    block_size &= ~size_t(1);
+    if (block_size == 0) return -1;
+
+    // Sinais padrão em torno da frequência atual: WFM no centro + 300 kHz,
+    // NFM em -200 kHz, AM em +600 kHz e um tom puro em -500 kHz
+    if (signals.empty()) {
+        double fc = center_freq.load();
+        signals.push_back({ fc + 300e3, 0.25, 1, 75e3 });
+        signals.push_back({ fc - 200e3, 0.15, 1, 5e3 });
+        signals.push_back({ fc + 600e3, 0.15, 2, 0.8 });
+        signals.push_back({ fc - 500e3, 0.05, 0, 0.0 });
+    }
+
+    std::vector<unsigned char> block(block_size);
+    std::vector<uint32_t> carrier(signals.size(), 0);
+    uint32_t tone_phase = 0;
+    uint32_t rng = 0x12345678u;
+
+    typedef std::chrono::steady_clock clock;
+    clock::time_point start = clock::now();
+    double elapsed = 0.0;   // Segundos de sinal já entregues
+    while (!stopping) {
+        uint32_t rate = sample_rate.load(std::memory_order_relaxed);
+        double fc = center_freq.load(std::memory_order_relaxed);
+        int32_t tone_step = phaseStep(1000.0, rate);
+
+        // Passos por bloco: o retune vale a partir do bloco seguinte
+        struct Osc { int32_t step; int32_t dev_step; float amp; float index; int mod; };
+        Osc osc[16];
+        size_t num = std::min<size_t>(signals.size(), 16);
+        for (size_t k = 0; k < num; k++) {
+            const Signal& sg = signals[k];
+            osc[k].step = phaseStep(sg.freq_hz - fc, rate);
+            osc[k].dev_step = sg.modulation == 1 ? phaseStep(sg.deviation_hz, rate) : 0;
+            osc[k].index = sg.modulation == 2 ? static_cast<float>(sg.deviation_hz) : 0.0f;
+            osc[k].amp = static_cast<float>(sg.amplitude);
+            osc[k].mod = sg.modulation;
+        }
+        float noise_amp = static_cast<float>(noise) * 127.5f;
+
+        for (size_t i = 0; i < block_size; i += 2) {
+            float tone = tableSin(tone_phase);
+            tone_phase += static_cast<uint32_t>(tone_step);
+            float re = 0.0f, im = 0.0f;
+            for (size_t k = 0; k < num; k++) {
+                float a = osc[k].amp;
+                if (osc[k].mod == 2) a *= 1.0f + osc[k].index * tone;
+                re += a * tableCos(carrier[k]);
+                im += a * tableSin(carrier[k]);
+                carrier[k] += static_cast<uint32_t>(osc[k].step + static_cast<int32_t>(osc[k].dev_step * tone));
+            }
+            // Ruído triangular barato (xorshift)
+            rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+            float ni = (static_cast<int>(rng & 0xFF) - static_cast<int>((rng >> 8) & 0xFF)) / 255.0f;
+            float nq = (static_cast<int>((rng >> 16) & 0xFF) - static_cast<int>(rng >> 24)) / 255.0f;
+
+            float vi = 127.5f + re * 127.5f + ni * noise_amp;
+            float vq = 127.5f + im * 127.5f + nq * noise_amp;
+            block[i] = static_cast<unsigned char>(std::min(std::max(vi, 0.0f), 255.0f));
+            block[i + 1] = static_cast<unsigned char>(std::min(std::max(vq, 0.0f), 255.0f));
+        }
+
+        if (realtime) {
+            std::this_thread::sleep_until(start + std::chrono::duration_cast<clock::duration>(
+                std::chrono::duration<double>(elapsed)));
+        }
+        callback(block.data(), static_cast<uint32_t>(block_size), ctx);
+        elapsed += static_cast<double>(block_size / 2) / rate;
+    }
+    return 0;
+}
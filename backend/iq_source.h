@@ -0,0 +1,223 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Mesmo formato do callback do librtlsdr: bloco de IQ uint8 intercalado
+typedef void (*IQCallback)(unsigned char* buf, uint32_t len, void* ctx);
+
+// Fonte de IQ bruto (uint8 I/Q intercalados, como o RTL-SDR entrega).
+// run() bloqueia a thread chamadora entregando blocos de block_size bytes
+// ao callback até stop() ou fim/erro; os setters podem ser chamados de
+// outras threads enquanto run() executa. Fontes sem hardware ignoram o que
+// não se aplica (ganho num arquivo, por exemplo) e retornam false.
+class IQSource {
+public:
+    virtual ~IQSource() {}
+
+    virtual bool open() = 0;
+    virtual void close() = 0;
+
+    // Retorna 0 quando parado por stop() ou fim da fonte; < 0 em erro.
+    // stop() vale até o próximo open()
+    virtual int run(IQCallback callback, void* ctx, size_t block_size) = 0;
+    virtual void stop() = 0;
+
+    virtual bool setCenterFreq(uint32_t hz) = 0;
+    virtual bool setSampleRate(uint32_t rate) = 0;
+    virtual bool setGain(int tenth_db) = 0;          // Ganho manual em décimos de dB
+    virtual bool setAutoGain(bool enabled) = 0;
+    virtual bool setDirectSampling(int mode) = 0;    // 0 = off, 1 = I, 2 = Q
+    virtual bool setFreqCorrection(int ppm) = 0;
+
+    virtual uint32_t getSampleRate() const = 0;
+    virtual const char* name() const = 0;
+};
+
+// Cria a fonte a partir de uma especificação textual:
+//   rtlsdr[:índice]             dongle local (librtlsdr)
+//   rtltcp:host[:porta]         servidor rtl_tcp (porta padrão 1234)
+//   file:caminho[:fast|:loop]   arquivo cu8 / .sigmf-data mapeado em memória
+//   synth[:fast]                sinais sintéticos (tons, FM, AM, ruído)
+// Retorna nullptr se a especificação for inválida ou a fonte não estiver
+// disponível neste build.
+std::unique_ptr<IQSource> createIQSource(const std::string& spec, uint32_t sample_rate);
+
+#ifndef SPEEDSDR_NO_RTLSDR
+struct rtlsdr_dev;
+
+// Dongle local via librtlsdr (rtlsdr_read_async)
+class RtlSdrSource : public IQSource {
+public:
+    explicit RtlSdrSource(uint32_t device_index = 0, uint32_t sample_rate = 2048000);
+    ~RtlSdrSource();
+
+    bool open() override;
+    void close() override;
+    int run(IQCallback callback, void* ctx, size_t block_size) override;
+    void stop() override;
+
+    bool setCenterFreq(uint32_t hz) override;
+    bool setSampleRate(uint32_t rate) override;
+    bool setGain(int tenth_db) override;
+    bool setAutoGain(bool enabled) override;
+    bool setDirectSampling(int mode) override;
+    bool setFreqCorrection(int ppm) override;
+
+    uint32_t getSampleRate() const override { return sample_rate; }
+    const char* name() const override { return "rtlsdr"; }
+
+private:
+    uint32_t index;
+    uint32_t sample_rate;
+    struct rtlsdr_dev* dev;
+    std::atomic<bool> stopping;
+};
+#endif
+
+// Cliente nativo do protocolo rtl_tcp: cabeçalho "RTL0" de 12 bytes, depois
+// IQ contínuo; comandos de 5 bytes (código + uint32 big-endian). Substitui o
+// spawn + setTimeout do server.js: open() tenta conectar com recuo até o
+// servidor responder.
+class RtlTcpSource : public IQSource {
+public:
+    // Comandos do rtl_tcp
+    enum Command : uint8_t {
+        CMD_SET_FREQ = 0x01,
+        CMD_SET_SAMPLE_RATE = 0x02,
+        CMD_SET_GAIN_MODE = 0x03,
+        CMD_SET_GAIN = 0x04,
+        CMD_SET_FREQ_CORRECTION = 0x05,
+        CMD_SET_AGC_MODE = 0x08,
+        CMD_SET_DIRECT_SAMPLING = 0x09,
+        CMD_SET_OFFSET_TUNING = 0x0a
+    };
+
+    RtlTcpSource(const std::string& host, int port = 1234, uint32_t sample_rate = 2048000,
+                 int connect_attempts = 10);
+    ~RtlTcpSource();
+
+    bool open() override;
+    void close() override;
+    int run(IQCallback callback, void* ctx, size_t block_size) override;
+    void stop() override;
+
+    // Guardam o valor e enviam; numa reconexão tudo é reenviado
+    bool setCenterFreq(uint32_t hz) override;
+    bool setSampleRate(uint32_t rate) override;
+    bool setGain(int tenth_db) override;
+    bool setAutoGain(bool enabled) override;
+    bool setDirectSampling(int mode) override;
+    bool setFreqCorrection(int ppm) override;
+
+    // Comando cru (ex.: CMD_SET_OFFSET_TUNING); false se desconectado
+    bool sendCommand(uint8_t command, uint32_t value);
+
+    uint32_t getSampleRate() const override { return sample_rate; }
+    const char* name() const override { return "rtltcp"; }
+    uint32_t tunerType() const { return tuner_type; }
+
+private:
+    std::string host;
+    int port;
+    uint32_t sample_rate;
+    int attempts;
+    intptr_t fd;                    // socket_t (SOCKET no Windows)
+    std::atomic<bool> stopping;
+    uint32_t tuner_type;
+
+    // Estado do sintonizador (sob send_mutex; comandos vêm de outras threads)
+    std::mutex send_mutex;
+    uint32_t freq;
+    int gain;
+    bool auto_gain;
+    int direct_sampling;
+    int ppm;
+
+    bool connectOnce();
+    bool reconnect();               // Conecta com recuo e reenvia o estado
+    bool sendLocked(uint8_t command, uint32_t value);
+    void closeSocket();
+};
+
+// Replay de arquivo cu8 (ou .sigmf-data: a taxa vem do .sigmf-meta)
+// mapeado em memória: os blocos saem direto do mapeamento, sem cópia.
+// Em tempo real por padrão; fast entrega o mais rápido possível (benchmark).
+class FileSource : public IQSource {
+public:
+    FileSource(const std::string& path, uint32_t sample_rate = 2048000, bool realtime = true, bool loop = false);
+    ~FileSource();
+
+    bool open() override;
+    void close() override;
+    int run(IQCallback callback, void* ctx, size_t block_size) override;
+    void stop() override { stopping = true; }
+
+    bool setCenterFreq(uint32_t) override { return false; }
+    bool setSampleRate(uint32_t) override { return false; }
+    bool setGain(int) override { return false; }
+    bool setAutoGain(bool) override { return false; }
+    bool setDirectSampling(int) override { return false; }
+    bool setFreqCorrection(int) override { return false; }
+
+    uint32_t getSampleRate() const override { return sample_rate; }
+    const char* name() const override { return "file"; }
+    size_t size() const { return length; }
+
+private:
+    std::string path;
+    uint32_t sample_rate;
+    bool realtime;
+    bool loop;
+    uint8_t* data;
+    size_t length;
+    void* mapping;                  // HANDLE do mapeamento no Windows
+    std::atomic<bool> stopping;
+};
+
+// Gerador sintético: sinais em frequências absolutas (por padrão WFM, NFM e
+// AM modulados por 1 kHz e um tom puro perto da frequência inicial) mais
+// ruído; retunes deslocam os sinais como num receptor real. Osciladores por
+// tabela, sem trigonometria por amostra. Tempo real ou o mais rápido possível.
+class SyntheticSource : public IQSource {
+public:
+    struct Signal {
+        double freq_hz;             // Frequência absoluta
+        double amplitude;           // Fração do fundo de escala
+        int modulation;             // 0 = tom, 1 = FM, 2 = AM
+        double deviation_hz;        // FM: desvio de pico; AM: índice (0..1)
+    };
+
+    SyntheticSource(uint32_t sample_rate = 2048000, bool realtime = true);
+
+    bool open() override { stopping = false; return true; }
+    void close() override {}
+    int run(IQCallback callback, void* ctx, size_t block_size) override;
+    void stop() override { stopping = true; }
+
+    bool setCenterFreq(uint32_t hz) override { center_freq = hz; return true; }
+    bool setSampleRate(uint32_t rate) override;
+    bool setGain(int) override { return true; }
+    bool setAutoGain(bool) override { return true; }
+    bool setDirectSampling(int) override { return false; }
+    bool setFreqCorrection(int) override { return false; }
+
+    uint32_t getSampleRate() const override { return sample_rate; }
+    const char* name() const override { return "synth"; }
+
+    // Substitui os sinais gerados (antes de run())
+    void setSignals(const std::vector<Signal>& s) { signals = s; }
+    void setNoiseLevel(double level) { noise = level; }
+
+private:
+    std::atomic<uint32_t> sample_rate;  // Aplicada no próximo bloco
+    bool realtime;
+    std::atomic<uint32_t> center_freq;
+    std::vector<Signal> signals;
+    double noise;
+    std::atomic<bool> stopping;
+};
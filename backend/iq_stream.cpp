@@ -0,0 +1,316 @@
+#include "iq_stream.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+static const int MIN_OUTPUT_RATE = 1000;
+static const uint32_t RICE_ESCAPE = 24;     // Quociente >= isso: valor cru a seguir
+static const int RICE_RAW_BITS = 17;        // zigzag(delta de int16) < 2^17
+
+// ============ Código de Rice ============
+
+static inline uint32_t zigzag(int32_t v) {
+    return (static_cast<uint32_t>(v) << 1) ^ static_cast<uint32_t>(v >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t u) {
+    return static_cast<int32_t>(u >> 1) ^ -static_cast<int32_t>(u & 1);
+}
+
+// Escritor de bits, MSB primeiro
+struct BitWriter {
+    uint8_t* out;
+    size_t pos;
+    uint32_t acc;
+    int bits;
+
+    explicit BitWriter(uint8_t* o) : out(o), pos(0), acc(0), bits(0) {}
+
+    void put(uint32_t value, int count) {
+        for (int i = count - 1; i >= 0; i--) {
+            acc = (acc << 1) | ((value >> i) & 1);
+            if (++bits == 8) {
+                out[pos++] = static_cast<uint8_t>(acc);
+                acc = 0;
+                bits = 0;
+            }
+        }
+    }
+
+    void ones(uint32_t count) {
+        while (count >= 16) { put(0xFFFF, 16); count -= 16; }
+        if (count) put((1u << count) - 1, static_cast<int>(count));
+    }
+
+    size_t finish() {
+        if (bits) out[pos++] = static_cast<uint8_t>(acc << (8 - bits));
+        acc = 0;
+        bits = 0;
+        return pos;
+    }
+};
+
+struct BitReader {
+    const uint8_t* in;
+    size_t len;
+    size_t pos;
+    int bit;
+
+    BitReader(const uint8_t* i, size_t l) : in(i), len(l), pos(0), bit(0) {}
+
+    bool get(uint32_t& value, int count) {
+        value = 0;
+        for (int i = 0; i < count; i++) {
+            if (pos >= len) return false;
+            value = (value << 1) | ((in[pos] >> (7 - bit)) & 1);
+            if (++bit == 8) { bit = 0; pos++; }
+        }
+        return true;
+    }
+};
+
+// Maior saída possível: cada valor com escape + bits crus
+static size_t riceMaxBytes(size_t values) {
+    return (values * (RICE_ESCAPE + RICE_RAW_BITS) + 7) / 8;
+}
+
+static uint8_t chooseRiceK(const int16_t* x, size_t n) {
+    uint64_t sum = 0;
+    int32_t prev_i = 0, prev_q = 0;
+    for (size_t k = 0; k + 1 < n; k += 2) {
+        sum += zigzag(x[k] - prev_i) + zigzag(x[k + 1] - prev_q);
+        prev_i = x[k];
+        prev_q = x[k + 1];
+    }
+    // k ~ log2(média): minimiza o tamanho para resíduos ~ Laplace
+    uint8_t k = 0;
+    while (k < 16 && (static_cast<uint64_t>(n) << (k + 1)) < sum) k++;
+    return k;
+}
+
+static size_t riceEncode(const int16_t* x, size_t n, uint8_t k, uint8_t* out) {
+    BitWriter w(out);
+    int32_t prev[2] = { 0, 0 };
+    for (size_t i = 0; i < n; i++) {
+        uint32_t u = zigzag(x[i] - prev[i & 1]);
+        prev[i & 1] = x[i];
+        uint32_t q = u >> k;
+        if (q >= RICE_ESCAPE) {
+            w.ones(RICE_ESCAPE);
+            w.put(u, RICE_RAW_BITS);
+        } else {
+            w.ones(q);
+            w.put(0, 1);
+            if (k) w.put(u & ((1u << k) - 1), k);
+        }
+    }
+    return w.finish();
+}
+
+static bool riceDecode(const uint8_t* in, size_t len, uint8_t k, size_t n, int16_t* x) {
+    BitReader r(in, len);
+    int32_t prev[2] = { 0, 0 };
+    for (size_t i = 0; i < n; i++) {
+        uint32_t q = 0, bit = 1, u = 0;
+        while (q < RICE_ESCAPE) {
+            if (!r.get(bit, 1)) return false;
+            if (!bit) break;
+            q++;
+        }
+        if (q >= RICE_ESCAPE) {
+            if (!r.get(u, RICE_RAW_BITS)) return false;
+        } else {
+            uint32_t low = 0;
+            if (k && !r.get(low, k)) return false;
+            u = (q << k) | low;
+        }
+        prev[i & 1] += unzigzag(u);
+        x[i] = static_cast<int16_t>(prev[i & 1]);
+    }
+    return true;
+}
+
+// ============ IQStreamer Implementation ============
+
+// Menor taxa potência-de-2 que ainda cobre a banda com folga para o FIR de canal
+static int decimatedRate(int sample_rate, float bandwidth_hz) {
+    int rate = sample_rate;
+    while (rate % 2 == 0 && rate / 2 >= MIN_OUTPUT_RATE && rate / 2 >= 1.5f * bandwidth_hz) rate /= 2;
+    return rate;
+}
+
+IQStreamer::IQStreamer(int rate, const IQStreamSettings& s)
+    : sample_rate(rate),
+      settings(s),
+      requested_offset(s.offset_hz),
+      requested_bandwidth(s.bandwidth_hz),
+      requested_format(s.format),
+      requested_compress(s.compress),
+      output_rate(rate),
+      frame_samples(0),
+      frame_size(0),
+      sequence(0),
+      clock(0) {
+    configure();
+}
+
+void IQStreamer::setOffset(double offset_hz) {
+    double limit = 0.5 * sample_rate;
+    requested_offset = std::min(std::max(offset_hz, -limit), limit);
+}
+
+void IQStreamer::setBandwidth(float bandwidth_hz) {
+    requested_bandwidth = std::min(std::max(bandwidth_hz, 500.0f), static_cast<float>(sample_rate));
+}
+
+void IQStreamer::setFormat(uint8_t format) {
+    if (format == IQ_FORMAT_INT8 || format == IQ_FORMAT_INT16) requested_format = format;
+}
+
+void IQStreamer::setCompression(bool enabled) {
+    requested_compress = enabled;
+}
+
+void IQStreamer::configure() {
+    output_rate = decimatedRate(sample_rate, settings.bandwidth_hz);
+    selector.reset(new ChannelSelector(sample_rate, output_rate, settings.bandwidth_hz));
+    selector->setOffset(settings.offset_hz);
+
+    frame_samples = std::max<size_t>(static_cast<size_t>(output_rate) * settings.frame_ms / 1000, 1);
+    pending.clear();
+    pending.reserve(2 * frame_samples);
+    clock = 0;
+}
+
+void IQStreamer::applySettings() {
+    settings.format = requested_format.load();
+    settings.compress = requested_compress.load();
+
+    double offset = requested_offset.load();
+    if (offset != settings.offset_hz) {
+        settings.offset_hz = offset;
+        selector->setOffset(offset);   // NCO mantém a fase: sem reconfigurar
+    }
+
+    float bandwidth = requested_bandwidth.load();
+    if (bandwidth != settings.bandwidth_hz) {
+        settings.bandwidth_hz = bandwidth;
+        if (decimatedRate(sample_rate, bandwidth) == output_rate) selector->setBandwidth(bandwidth);
+        else configure();
+    }
+}
+
+bool IQStreamer::process(const uint8_t* iq, size_t len) {
+    const size_t n = len / 2;
+    if (input.size() < n) input.resize(n);
+    converter.toComplex(iq, n, input.data());
+    return processBaseband(input.data(), n);
+}
+
+bool IQStreamer::processBaseband(const std::complex<float>* iq, size_t n) {
+    applySettings();
+    if (n == 0) return false;
+
+    size_t max_out = selector->maxOutput(n);
+    if (decimated.size() < max_out) decimated.resize(max_out);
+    size_t count = selector->process(iq, n, decimated.data());
+
+    // Quantização em int16; int8 é derivado na montagem do quadro
+    for (size_t k = 0; k < count; k++) {
+        float i = std::min(std::max(decimated[k].real(), -1.0f), 1.0f) * 32767.0f;
+        float q = std::min(std::max(decimated[k].imag(), -1.0f), 1.0f) * 32767.0f;
+        pending.push_back(static_cast<int16_t>(std::lrint(i)));
+        pending.push_back(static_cast<int16_t>(std::lrint(q)));
+    }
+
+    if (pending.size() / 2 < frame_samples) return false;
+    emitFrame();
+    return true;
+}
+
+void IQStreamer::emitFrame() {
+    const size_t samples = pending.size() / 2;
+    const size_t values = pending.size();
+
+    // int8: mesma escala do RTL-SDR (8 bits mais significativos)
+    if (settings.format == IQ_FORMAT_INT8) {
+        for (size_t k = 0; k < values; k++) pending[k] = static_cast<int16_t>(pending[k] >> 8);
+    }
+
+    IQFrameHeader header;
+    header.format = settings.format;
+    header.coding = settings.compress ? IQ_CODING_DELTA_RICE : IQ_CODING_RAW;
+    header.samples = static_cast<uint32_t>(samples);
+    header.sample_rate = static_cast<uint32_t>(output_rate);
+    header.offset_hz = static_cast<int32_t>(std::lrint(settings.offset_hz));
+    header.sequence = sequence++;
+    header.timestamp = clock;
+
+    size_t max_bytes = maxFrameBytes(samples, settings.format, settings.compress);
+    if (frame_data.size() < max_bytes) frame_data.resize(max_bytes);
+    frame_size = encode(header, pending.data(), frame_data.data());
+    clock += samples;
+    pending.clear();
+}
+
+size_t IQStreamer::maxFrameBytes(size_t samples, uint8_t format, bool compress) {
+    const size_t values = samples * 2;
+    size_t bytes_per_value = format == IQ_FORMAT_INT8 ? 1 : 2;
+    return sizeof(IQFrameHeader) + (compress ? riceMaxBytes(values) : values * bytes_per_value);
+}
+
+size_t IQStreamer::encode(IQFrameHeader header, const int16_t* iq, uint8_t* out) {
+    const size_t values = static_cast<size_t>(header.samples) * 2;
+    const bool compress = header.coding == IQ_CODING_DELTA_RICE;
+
+    header.magic[0] = 'S';
+    header.magic[1] = 'D';
+    header.type = IQ_FRAME_TYPE;
+    header.rice_k = compress ? chooseRiceK(iq, values) : 0;
+    header.reserved = 0;
+    uint8_t* payload = out + sizeof(header);
+
+    size_t payload_size;
+    if (compress) {
+        payload_size = riceEncode(iq, values, header.rice_k, payload);
+    } else if (header.format == IQ_FORMAT_INT8) {
+        for (size_t k = 0; k < values; k++) payload[k] = static_cast<uint8_t>(static_cast<int8_t>(iq[k]));
+        payload_size = values;
+    } else {
+        std::memcpy(payload, iq, values * sizeof(int16_t));
+        payload_size = values * sizeof(int16_t);
+    }
+
+    std::memcpy(out, &header, sizeof(header));
+    return sizeof(header) + payload_size;
+}
+
+size_t IQStreamer::decode(const uint8_t* frame, size_t len, int16_t* out) {
+    IQFrameHeader header;
+    if (len < sizeof(header)) return 0;
+    std::memcpy(&header, frame, sizeof(header));
+    if (header.magic[0] != 'S' || header.magic[1] != 'D' || header.type != IQ_FRAME_TYPE) return 0;
+
+    const uint8_t* payload = frame + sizeof(header);
+    const size_t payload_len = len - sizeof(header);
+    const size_t values = static_cast<size_t>(header.samples) * 2;
+
+    if (header.coding == IQ_CODING_DELTA_RICE) {
+        if (!riceDecode(payload, payload_len, header.rice_k, values, out)) return 0;
+    } else if (header.format == IQ_FORMAT_INT8) {
+        if (payload_len < values) return 0;
+        for (size_t k = 0; k < values; k++) out[k] = static_cast<int8_t>(payload[k]);
+    } else {
+        if (payload_len < values * sizeof(int16_t)) return 0;
+        std::memcpy(out, payload, values * sizeof(int16_t));
+    }
+    return header.samples;
+}
+
+void IQStreamer::reset() {
+    selector->reset();
+    pending.clear();
+    frame_size = 0;
+    sequence = 0;
+    clock = 0;
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include <atomic>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "channel.h"
+#include "iq_convert.h"
+#include "aligned_buffer.h"
+
+// Cabeçalho dos quadros de IQ (little-endian, 32 bytes), seguido das
+// amostras I/Q intercaladas no formato/codificação indicados.
+#pragma pack(push, 1)
+struct IQFrameHeader {
+    uint8_t magic[2];      // 'S', 'D'
+    uint8_t type;          // IQ_FRAME_TYPE
+    uint8_t format;        // IQ_FORMAT_*
+    uint8_t coding;        // IQ_CODING_*
+    uint8_t rice_k;        // Parâmetro de Rice do quadro (IQ_CODING_DELTA_RICE)
+    uint16_t reserved;
+    uint32_t samples;      // Amostras complexas no quadro
+    uint32_t sample_rate;  // Taxa de saída (após decimação)
+    int32_t offset_hz;     // Centro em relação ao centro do RTL-SDR
+    uint32_t sequence;
+    uint64_t timestamp;    // Índice (à taxa de saída) da primeira amostra
+};
+#pragma pack(pop)
+
+static const uint8_t IQ_FRAME_TYPE = 0x03;
+static const uint8_t IQ_FORMAT_INT8 = 0;
+static const uint8_t IQ_FORMAT_INT16 = 1;
+static const uint8_t IQ_CODING_RAW = 0;
+// Sem perdas: diferença de cada componente para a anterior do mesmo
+// quadro (a primeira contra zero), zigzag e código de Rice com k por quadro.
+// Cada quadro decodifica sozinho.
+static const uint8_t IQ_CODING_DELTA_RICE = 1;
+
+// Parâmetros do streaming de IQ. Alterações feitas por outra thread
+// (setters do IQStreamer) valem a partir do próximo bloco.
+struct IQStreamSettings {
+    double offset_hz = 0.0;        // Centro da fatia pedida
+    float bandwidth_hz = 200000.0f;
+    uint8_t format = IQ_FORMAT_INT16;
+    bool compress = false;
+    int frame_ms = 20;             // Duração mínima de cada quadro
+};
+
+// Streaming de IQ reduzido para clientes remotos: desloca a fatia pedida
+// para DC, decima (potência de 2, a menor taxa >= 1.5 * banda) e quantiza
+// em int8/int16, com codificação sem perdas opcional. Em vez dos ~4 MB/s
+// do IQ bruto, uma fatia de 25 kHz em int16 fica em ~130 KB/s.
+class IQStreamer {
+public:
+    IQStreamer(int sample_rate, const IQStreamSettings& settings = IQStreamSettings());
+
+    // Podem ser chamados de outra thread
+    void setOffset(double offset_hz);
+    void setBandwidth(float bandwidth_hz);
+    void setFormat(uint8_t format);
+    void setCompression(bool enabled);
+
+    // Bloco IQ bruto (uint8 intercalado); true quando há quadro novo em frame()
+    bool process(const uint8_t* iq, size_t len);
+    // Mesmo bloco já convertido para complexo (n amostras): vários streamers
+    // alimentados pelo mesmo RTL-SDR convertem o bloco uma vez só
+    bool processBaseband(const std::complex<float>* iq, size_t n);
+
+    const uint8_t* frame() const { return frame_data.data(); }
+    size_t frameSize() const { return frame_size; }
+    int outputRate() const { return output_rate; }
+
+    // Decodifica um quadro (qualquer formato/codificação) para int16
+    // intercalado, na escala do formato (int8 fica em -128..127); out precisa
+    // de 2 * header.samples. Retorna as amostras complexas ou 0 se inválido.
+    static size_t decode(const uint8_t* frame, size_t len, int16_t* out);
+
+    // Monta um quadro com os campos de header (format, coding, samples,
+    // sample_rate, offset_hz, sequence, timestamp) e 2 * samples valores I/Q
+    // intercalados na escala do formato, como decode() devolve. magic, type
+    // e rice_k são preenchidos aqui; out precisa de maxFrameBytes(). Retorna
+    // o tamanho do quadro.
+    static size_t encode(IQFrameHeader header, const int16_t* iq, uint8_t* out);
+    static size_t maxFrameBytes(size_t samples, uint8_t format, bool compress);
+
+    void reset();
+
+private:
+    int sample_rate;
+    IQStreamSettings settings;
+
+    // Pedidos de outra thread, aplicados entre blocos
+    std::atomic<double> requested_offset;
+    std::atomic<float> requested_bandwidth;
+    std::atomic<uint8_t> requested_format;
+    std::atomic<bool> requested_compress;
+
+    int output_rate;
+    std::unique_ptr<ChannelSelector> selector;
+    IQConverter converter;
+    AlignedVector<std::complex<float>> input;
+    std::vector<std::complex<float>> decimated;
+    std::vector<int16_t> pending;    // I/Q quantizados aguardando o quadro (intercalados)
+    size_t frame_samples;
+
+    std::vector<uint8_t> frame_data;
+    size_t frame_size;
+    uint32_t sequence;
+    uint64_t clock;                  // Amostras de saída já emitidas
+
+    void applySettings();
+    void configure();
+    void emitFrame();
+};
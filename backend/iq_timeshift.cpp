@@ -0,0 +1,225 @@
+#include "iq_timeshift.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+static const size_t PAGE_ALIGN = 4096;
+static const size_t HUGE_PAGE = 2 << 20;
+static const size_t DUMP_CHUNK = 1 << 20;
+static const size_t OVERWRITE_MARGIN = 1 << 20;   // Folga para o produtor não alcançar a leitura
+static const int STALL_TIMEOUT_MS = 2000;         // Fonte parada no pós-trigger: encerra a captura
+
+// ============ IQTimeShift Implementation ============
+
+IQTimeShift::IQTimeShift(int rate, double seconds, bool huge_pages)
+    : sample_rate(rate),
+      buffer(nullptr),
+      capacity(0),
+      mapped(false),
+      huge(false),
+      write_pos(0),
+      capturing(false),
+      stopping(false),
+      completed(0),
+      overwritten(0) {
+    size_t bytes = static_cast<size_t>(std::max(seconds, 1.0) * rate) * 2;
+    capacity = (bytes + PAGE_ALIGN - 1) / PAGE_ALIGN * PAGE_ALIGN;
+
+#ifdef _WIN32
+    (void)huge_pages;   // Large pages no Windows exigem privilégio: só VirtualAlloc
+    buffer = static_cast<uint8_t*>(VirtualAlloc(nullptr, capacity, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+    mapped = buffer != nullptr;
+#else
+#ifdef MAP_HUGETLB
+    if (huge_pages) {
+        // Huge pages reservadas (vm.nr_hugepages); quase sempre indisponíveis
+        size_t huge_bytes = (capacity + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+        void* p = mmap(nullptr, huge_bytes, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED) {
+            buffer = static_cast<uint8_t*>(p);
+            capacity = huge_bytes;
+            mapped = true;
+            huge = true;
+        }
+    }
+#endif
+    if (!buffer) {
+        void* p = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p != MAP_FAILED) {
+            buffer = static_cast<uint8_t*>(p);
+            mapped = true;
+#ifdef MADV_HUGEPAGE
+            // Transparent huge pages: menos falhas de TLB no anel inteiro
+            if (huge_pages) huge = madvise(p, capacity, MADV_HUGEPAGE) == 0;
+#endif
+        }
+    }
+#endif
+    if (!buffer) buffer = static_cast<uint8_t*>(::operator new(capacity));
+
+    // Toca todas as páginas agora: nenhuma falha de página no callback USB
+    std::memset(buffer, 0x80, capacity);
+}
+
+IQTimeShift::~IQTimeShift() {
+    stopping = true;
+    if (dump_thread.joinable()) dump_thread.join();
+
+    if (!mapped) {
+        ::operator delete(buffer);
+        return;
+    }
+#ifdef _WIN32
+    VirtualFree(buffer, 0, MEM_RELEASE);
+#else
+    munmap(buffer, capacity);
+#endif
+}
+
+void IQTimeShift::write(const uint8_t* iq, size_t len) {
+    uint64_t pos = write_pos.load(std::memory_order_relaxed);
+    while (len > 0) {
+        size_t offset = static_cast<size_t>(pos % capacity);
+        size_t take = std::min(len, capacity - offset);
+        std::memcpy(buffer + offset, iq, take);
+        iq += take;
+        len -= take;
+        pos += take;
+    }
+    write_pos.store(pos, std::memory_order_release);
+}
+
+bool IQTimeShift::trigger(const std::string& base_path, double pre_seconds, double post_seconds,
+                          const RecordingInfo& info, const std::string& reason) {
+    std::lock_guard<std::mutex> lock(trigger_mutex);
+    if (capturing) return false;
+    if (dump_thread.joinable()) dump_thread.join();
+
+    // Posições em bytes, sempre em amostras inteiras (I/Q)
+    uint64_t now = write_pos.load(std::memory_order_acquire) & ~uint64_t(1);
+    uint64_t max_pre = capacity > 2 * OVERWRITE_MARGIN ? capacity - 2 * OVERWRITE_MARGIN : capacity / 2;
+    uint64_t pre = static_cast<uint64_t>(std::max(pre_seconds, 0.0) * sample_rate) * 2;
+    // post sem limite viraria uma gravação contínua sem como cancelar
+    double post_s = std::min(std::max(post_seconds, 0.0), static_cast<double>(capacity) / (2.0 * sample_rate));
+    uint64_t post = static_cast<uint64_t>(post_s * sample_rate) * 2;
+    pre = std::min(pre, std::min<uint64_t>(max_pre, now)) & ~uint64_t(1);
+
+    capturing = true;
+    overwritten = 0;
+    dump_thread = std::thread(&IQTimeShift::dump, this, base_path, now - pre, now, now + post, info, reason);
+    std::cout << "[TimeShift] Captura disparada (" << reason << "): "
+              << static_cast<double>(pre) / (2.0 * sample_rate) << " s antes, "
+              << static_cast<double>(post) / (2.0 * sample_rate) << " s depois -> " << base_path << ".sigmf-data\n";
+    return true;
+}
+
+void IQTimeShift::dump(std::string base_path, uint64_t start, uint64_t trigger_pos, uint64_t end,
+                       RecordingInfo info, std::string reason) {
+    // Hora da primeira amostra da janela, não a do início da gravação
+    std::string datetime = sigmfDateTime(-static_cast<double>(trigger_pos - start) / (2.0 * sample_rate));
+    FILE* f = std::fopen((base_path + ".sigmf-data").c_str(), "wb");
+    if (!f) {
+        std::cerr << "[TimeShift] Falha ao abrir " << base_path << ".sigmf-data\n";
+        capturing = false;
+        return;
+    }
+
+    std::vector<SigMFCapture> captures;
+    std::vector<SigMFAnnotation> annotations;
+    captures.push_back({ 0, start / 2, info.center_freq });
+
+    uint64_t pos = start;
+    uint64_t file_bytes = 0;
+    uint64_t skipped_before_trigger = 0;   // Pulados antes do trigger: fora do arquivo
+    uint64_t last_avail = 0;
+    auto last_progress = std::chrono::steady_clock::now();
+    while (pos < end && !stopping) {
+        uint64_t avail = write_pos.load(std::memory_order_acquire);
+        if (avail <= pos) {
+            // Pós-trigger ainda não chegou; fonte parada (fim de arquivo, rtl_tcp
+            // caiu) fecha a captura com o que houver em vez de esperar para sempre
+            auto now = std::chrono::steady_clock::now();
+            if (avail != last_avail) {
+                last_avail = avail;
+                last_progress = now;
+            } else if (now - last_progress > std::chrono::milliseconds(STALL_TIMEOUT_MS)) {
+                annotations.push_back({ file_bytes / 2, 0, "fonte parada: captura encerrada" });
+                std::cerr << "[TimeShift] Fonte parada, captura encerrada antes do fim\n";
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+
+        // O produtor já passou por cima: pula para o trecho ainda válido
+        if (avail - pos > capacity - OVERWRITE_MARGIN) {
+            uint64_t resume = (avail - (capacity - OVERWRITE_MARGIN) + 1) & ~uint64_t(1);
+            overwritten += resume - pos;
+            if (pos < trigger_pos) skipped_before_trigger += std::min(resume, trigger_pos) - pos;
+            annotations.push_back({ file_bytes / 2, 0, std::to_string((resume - pos) / 2) + " amostras sobrescritas" });
+            captures.push_back({ file_bytes / 2, resume / 2, info.center_freq });
+            pos = resume;
+            continue;
+        }
+
+        size_t offset = static_cast<size_t>(pos % capacity);
+        size_t chunk = static_cast<size_t>(std::min<uint64_t>(std::min(end, avail) - pos, DUMP_CHUNK));
+        chunk = std::min(chunk, capacity - offset);
+        if (std::fwrite(buffer + offset, 1, chunk, f) != chunk) {
+            std::cerr << "[TimeShift] Erro de escrita\n";
+            break;
+        }
+        // Sobrescrito durante a escrita: o trecho no arquivo pode estar misturado
+        if (write_pos.load(std::memory_order_acquire) - pos > capacity) {
+            overwritten += chunk;
+            annotations.push_back({ file_bytes / 2, chunk / 2, "trecho sobrescrito durante a gravacao" });
+        }
+        pos += chunk;
+        file_bytes += chunk;
+    }
+    std::fclose(f);
+
+    uint64_t trigger_file = trigger_pos - start - skipped_before_trigger;
+    annotations.push_back({ trigger_file / 2, 0, "trigger: " + reason });
+    std::sort(annotations.begin(), annotations.end(),
+              [](const SigMFAnnotation& a, const SigMFAnnotation& b) { return a.sample_start < b.sample_start; });
+
+    if (!writeSigMFMeta(base_path, info, datetime, captures, annotations, overwritten)) {
+        std::cerr << "[TimeShift] Falha ao gravar " << base_path << ".sigmf-meta\n";
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        completed++;
+        last_path = base_path;
+    }
+    std::cout << "[TimeShift] Captura gravada: " << file_bytes << " bytes"
+              << (overwritten ? " (com trechos sobrescritos)" : "") << "\n";
+    capturing = false;
+}
+
+TimeShiftStats IQTimeShift::getStats() const {
+    TimeShiftStats st;
+    uint64_t pos = write_pos.load(std::memory_order_relaxed);
+    st.capacity_seconds = static_cast<double>(capacity) / (2.0 * sample_rate);
+    st.buffered_seconds = static_cast<double>(std::min<uint64_t>(pos, capacity)) / (2.0 * sample_rate);
+    st.huge_pages = huge;
+    st.capturing = capturing;
+    st.overwritten_bytes = overwritten;
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    st.captures = completed;
+    st.last_path = last_path;
+    return st;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "iq_recorder.h"
+
+struct TimeShiftStats {
+    double capacity_seconds;
+    double buffered_seconds;     // Quanto do passado está disponível agora
+    bool huge_pages;             // Memória em huge pages (Linux)
+    bool capturing;
+    uint64_t captures;           // Capturas concluídas
+    std::string last_path;
+    uint64_t overwritten_bytes;  // Da última captura: sobrescritos antes de ir ao disco
+};
+
+// Anel circular grande de IQ bruto (uint8, como sai do rtl_callback),
+// dimensionado em segundos: 60 s a 2.048 Msps = ~240 MB, alocados e
+// tocados uma vez na criação (huge pages quando possível).
+// write() só copia (sem lock nem alocação). trigger() marca o instante e
+// uma thread grava em SigMF a janela [trigger - pre, trigger + post]
+// direto da memória do anel, esperando o pós-trigger chegar; o pipeline ao
+// vivo não é afetado. Trechos sobrescritos antes de chegar ao disco (pre
+// quase do tamanho do anel e disco lento) são contados e anotados. Se a
+// fonte para no meio do pós-trigger, a captura fecha depois de 2 s parada.
+class IQTimeShift {
+public:
+    IQTimeShift(int sample_rate, double seconds, bool huge_pages = true);
+    ~IQTimeShift();
+
+    // ---- Produtor (uma thread só: callback USB) ----
+    void write(const uint8_t* iq, size_t len);
+
+    // ---- Qualquer thread ----
+    // Inicia a gravação de base_path.sigmf-data/.sigmf-meta; false se já
+    // houver captura em andamento. reason vai como anotação no trigger.
+    // pre e post ficam limitados ao tamanho do anel.
+    bool trigger(const std::string& base_path, double pre_seconds, double post_seconds,
+                 const RecordingInfo& info, const std::string& reason);
+    bool isCapturing() const { return capturing.load(std::memory_order_relaxed); }
+
+    TimeShiftStats getStats() const;
+
+private:
+    int sample_rate;
+    uint8_t* buffer;
+    size_t capacity;                  // Bytes, múltiplo de 4096
+    bool mapped;                      // mmap/VirtualAlloc (senão operator new)
+    bool huge;
+
+    std::atomic<uint64_t> write_pos;  // Bytes recebidos desde a criação
+
+    std::atomic<bool> capturing;
+    std::atomic<bool> stopping;
+    std::thread dump_thread;
+    std::mutex trigger_mutex;
+
+    mutable std::mutex stats_mutex;
+    uint64_t completed;
+    std::string last_path;
+    std::atomic<uint64_t> overwritten;
+
+    void dump(std::string base_path, uint64_t start, uint64_t trigger_pos, uint64_t end,
+              RecordingInfo info, std::string reason);
+};
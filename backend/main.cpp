@@ -7,6 +7,8 @@
 #include <ws2tcpip.h>
 #include <string>
 #include <rtl-sdr.h>
+#include "spectrum.h"
+#include "iq_stream.h"
 
 #pragma comment(lib, "ws2_32.lib")
 #pragma comment(lib, "rtlsdr.lib")
@@ -20,32 +22,73 @@ std::atomic<uint32_t> center_freq(145350000);
 std::atomic<int> rf_gain(40);
 rtlsdr_dev_t* dev = nullptr;
 
-// Função de callback do RTL-SDR
-void rtl_callback(unsigned char* buf, uint32_t len, void* ctx) {
-    SOCKET client = *(SOCKET*)ctx;
+// Estado de cada conexão usado pelo callback do RTL-SDR
+struct StreamContext {
+    SOCKET client;
+    SpectrumEngine spectrum;
+    IQStreamer iq;                     // Fatia de IQ decimada (SET_IQ_STREAM)
+    std::atomic<bool> iq_enabled;
+    std::atomic<bool> raw_iq;          // IQ bruto para o frontend que demodula no navegador (SET_RAW_IQ)
     
-    // Envia dados IQ via WebSocket (formato binário)
+    explicit StreamContext(SOCKET c)
+        : client(c), spectrum(SAMPLE_RATE), iq(SAMPLE_RATE), iq_enabled(false), raw_iq(false) {}
+};
+
+// Frame binário WebSocket: cabeçalho e payload numa única chamada
+// (scatter-gather, sem cópia)
+void send_binary(SOCKET client, const uint8_t* frame, size_t frame_len) {
     unsigned char ws_header[10];
     ws_header[0] = 0x82; // FIN + Binary frame
+    ULONG header_len = 2;
     
-    if (len < 126) {
-        ws_header[1] = len;
-        send(client, (char*)ws_header, 2, 0);
-        send(client, (char*)buf, len, 0);
-    } else if (len < 65536) {
+    if (frame_len < 126) {
+        ws_header[1] = static_cast<unsigned char>(frame_len);
+    } else if (frame_len < 65536) {
         ws_header[1] = 126;
-        ws_header[2] = (len >> 8) & 0xFF;
-        ws_header[3] = len & 0xFF;
-        send(client, (char*)ws_header, 4, 0);
-        send(client, (char*)buf, len, 0);
+        ws_header[2] = (frame_len >> 8) & 0xFF;
+        ws_header[3] = frame_len & 0xFF;
+        header_len = 4;
+    } else {
+        ws_header[1] = 127;
+        for (int i = 0; i < 8; i++) ws_header[2 + i] = (uint64_t(frame_len) >> (56 - 8 * i)) & 0xFF;
+        header_len = 10;
+    }
+    
+    WSABUF bufs[2];
+    bufs[0].buf = (char*)ws_header;
+    bufs[0].len = header_len;
+    bufs[1].buf = (char*)frame;
+    bufs[1].len = static_cast<ULONG>(frame_len);
+    DWORD sent = 0;
+    WSASend(client, bufs, 2, &sent, 0, NULL, NULL);
+}
+
+// Função de callback do RTL-SDR
+void rtl_callback(unsigned char* buf, uint32_t len, void* ctx) {
+    StreamContext* stream = (StreamContext*)ctx;
+    
+    // Cliente que ainda demodula no navegador pediu o IQ bruto (~4 MB/s):
+    // ele trata todo frame binário como IQ cu8, então só o IQ bruto sai
+    if (stream->raw_iq) {
+        send_binary(stream->client, buf, len);
+        return;
+    }
+    
+    // Padrão: só os quadros de espectro já quantizados e, se pedida, a
+    // fatia de IQ decimada
+    if (stream->spectrum.process(buf, len)) {
+        send_binary(stream->client, stream->spectrum.frame(), stream->spectrum.frameSize());
+    }
+    if (stream->iq_enabled && stream->iq.process(buf, len)) {
+        send_binary(stream->client, stream->iq.frame(), stream->iq.frameSize());
     }
 }
 
 // Thread de leitura do RTL-SDR
-void rtl_reader_thread(SOCKET client) {
+void rtl_reader_thread(StreamContext* stream) {
     std::cout << "[RTL-SDR] Thread iniciada\n";
     
-    while (running && rtlsdr_read_async(dev, rtl_callback, &client, 0, BUFFER_SIZE) == 0) {
+    while (running && rtlsdr_read_async(dev, rtl_callback, stream, 0, BUFFER_SIZE) == 0) {
         std::this_thread::sleep_for(std::chrono::milliseconds(10));
     }
     
@@ -93,7 +136,8 @@ void handle_client(SOCKET client) {
         std::cout << "[WebSocket] Cliente conectado\n";
         
         // Inicia thread de leitura do RTL-SDR
-        std::thread rtl_thread(rtl_reader_thread, client);
+        StreamContext stream(client);
+        std::thread rtl_thread(rtl_reader_thread, &stream);
         
         // Recebe comandos do cliente
         while (running) {
@@ -137,6 +181,39 @@ void handle_client(SOCKET client) {
                         rtlsdr_set_tuner_gain(dev, gain * 10);
                         std::cout << "[RTL-SDR] Ganho: " << gain << " dB\n";
                     }
+                } else if (payload.find("\"type\":\"SET_SPECTRUM\"") != std::string::npos) {
+                    size_t pos;
+                    if ((pos = payload.find("\"fps\":")) != std::string::npos)
+                        stream.spectrum.setFrameRate(std::stof(payload.substr(pos + 6)));
+                    if ((pos = payload.find("\"bins\":")) != std::string::npos)
+                        stream.spectrum.setDisplayBins(std::stoul(payload.substr(pos + 7)));
+                    if ((pos = payload.find("\"fft\":")) != std::string::npos)
+                        stream.spectrum.setFFTSize(std::stoul(payload.substr(pos + 6)));
+                    if ((pos = payload.find("\"peak_hold\":")) != std::string::npos)
+                        stream.spectrum.setPeakHold(payload.compare(pos + 12, 4, "true") == 0 ||
+                                                    payload.compare(pos + 12, 1, "1") == 0);
+                    size_t min_pos = payload.find("\"min_db\":");
+                    size_t max_pos = payload.find("\"max_db\":");
+                    if (min_pos != std::string::npos && max_pos != std::string::npos)
+                        stream.spectrum.setRange(std::stof(payload.substr(min_pos + 9)),
+                                                 std::stof(payload.substr(max_pos + 9)));
+                } else if (payload.find("\"type\":\"SET_RAW_IQ\"") != std::string::npos) {
+                    // {"enabled": bool}: IQ bruto no lugar do espectro e da fatia decimada
+                    stream.raw_iq = payload.find("\"enabled\":false") == std::string::npos;
+                    std::cout << "[IQ] IQ bruto " << (stream.raw_iq ? "ligado" : "desligado") << "\n";
+                } else if (payload.find("\"type\":\"SET_IQ_STREAM\"") != std::string::npos) {
+                    // {"offset": Hz, "bandwidth": Hz, "format": 8|16, "compress": bool, "enabled": bool}
+                    size_t pos;
+                    if ((pos = payload.find("\"offset\":")) != std::string::npos)
+                        stream.iq.setOffset(std::stod(payload.substr(pos + 9)));
+                    if ((pos = payload.find("\"bandwidth\":")) != std::string::npos)
+                        stream.iq.setBandwidth(std::stof(payload.substr(pos + 12)));
+                    if ((pos = payload.find("\"format\":")) != std::string::npos)
+                        stream.iq.setFormat(std::stoi(payload.substr(pos + 9)) == 8 ? IQ_FORMAT_INT8 : IQ_FORMAT_INT16);
+                    if ((pos = payload.find("\"compress\":")) != std::string::npos)
+                        stream.iq.setCompression(payload.compare(pos + 11, 4, "true") == 0);
+                    stream.iq_enabled = payload.find("\"enabled\":false") == std::string::npos;
+                    std::cout << "[IQ] Streaming " << (stream.iq_enabled ? "ligado" : "desligado") << "\n";
                 }
             }
         }
@@ -0,0 +1,264 @@
+#include "pipeline_stats.h"
+#include <algorithm>
+#include <cstdio>
+
+static const int PROM_FIRST_BUCKET = 10;    // 2^10 ns ~ 1 us: abaixo disso tudo vai no primeiro
+static const int PROM_LAST_BUCKET = 30;     // 2^31 ns ~ 2.1 s: acima disso só +Inf
+
+// ============ LatencyHistogram Implementation ============
+
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+int LatencyHistogram::bucketFor(uint64_t ns) {
+    // floor(log2(ns)) sem intrínsecos (o build x86 de 32 bits não tem clz de 64)
+    int b = 0;
+    if (ns >> 32) { ns >>= 32; b += 32; }
+    if (ns >> 16) { ns >>= 16; b += 16; }
+    if (ns >> 8) { ns >>= 8; b += 8; }
+    if (ns >> 4) { ns >>= 4; b += 4; }
+    if (ns >> 2) { ns >>= 2; b += 2; }
+    if (ns >> 1) { b += 1; }
+    return std::min(b, NUM_BUCKETS - 1);
+}
+
+void LatencyHistogram::record(uint64_t ns) {
+    buckets[bucketFor(ns)].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    sum_ns.fetch_add(ns, std::memory_order_relaxed);
+    uint64_t prev = max_ns.load(std::memory_order_relaxed);
+    while (ns > prev && !max_ns.compare_exchange_weak(prev, ns, std::memory_order_relaxed)) {
+    }
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const {
+    Snapshot s;
+    for (int i = 0; i < NUM_BUCKETS; i++) s.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+    s.count = count.load(std::memory_order_relaxed);
+    s.sum_ns = sum_ns.load(std::memory_order_relaxed);
+    s.max_ns = max_ns.load(std::memory_order_relaxed);
+    return s;
+}
+
+void LatencyHistogram::reset() {
+    for (int i = 0; i < NUM_BUCKETS; i++) buckets[i].store(0, std::memory_order_relaxed);
+    count.store(0, std::memory_order_relaxed);
+    sum_ns.store(0, std::memory_order_relaxed);
+    max_ns.store(0, std::memory_order_relaxed);
+}
+
+double LatencyHistogram::Snapshot::percentile(double p) const {
+    // A soma dos baldes é a referência (count pode estar um passo à frente)
+    uint64_t total = 0;
+    for (int i = 0; i < NUM_BUCKETS; i++) total += buckets[i];
+    if (total == 0) return 0.0;
+
+    double rank = std::min(std::max(p, 0.0), 1.0) * total;
+    uint64_t seen = 0;
+    for (int i = 0; i < NUM_BUCKETS; i++) {
+        if (buckets[i] == 0) continue;
+        if (seen + buckets[i] >= rank) {
+            double lo = i == 0 ? 0.0 : static_cast<double>(uint64_t(1) << i);
+            double hi = static_cast<double>(uint64_t(1) << (i + 1));
+            double v = lo + (hi - lo) * (rank - seen) / buckets[i];
+            return std::min(v, static_cast<double>(max_ns));
+        }
+        seen += buckets[i];
+    }
+    return static_cast<double>(max_ns);
+}
+
+static std::string fmt(const char* format, double v) {
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), format, v);
+    return buf;
+}
+
+void appendHistogramJson(std::string& out, const char* name, const LatencyHistogram::Snapshot& s) {
+    out += "\"";
+    out += name;
+    out += "\":{\"count\":" + std::to_string(s.count) +
+           ",\"mean_us\":" + fmt("%.3f", s.meanNs() / 1000.0) +
+           ",\"p50_us\":" + fmt("%.3f", s.percentile(0.50) / 1000.0) +
+           ",\"p90_us\":" + fmt("%.3f", s.percentile(0.90) / 1000.0) +
+           ",\"p99_us\":" + fmt("%.3f", s.percentile(0.99) / 1000.0) +
+           ",\"max_us\":" + fmt("%.3f", s.max_ns / 1000.0) + "}";
+}
+
+void appendHistogramPrometheus(std::string& out, const char* metric, const std::string& labels,
+                               const LatencyHistogram::Snapshot& s) {
+    std::string sep = labels.empty() ? "" : labels + ",";
+    uint64_t cumulative = 0;
+    for (int i = 0; i < PROM_FIRST_BUCKET; i++) cumulative += s.buckets[i];
+    for (int i = PROM_FIRST_BUCKET; i <= PROM_LAST_BUCKET; i++) {
+        cumulative += s.buckets[i];
+        double le = static_cast<double>(uint64_t(1) << (i + 1)) * 1e-9;
+        out += std::string(metric) + "_bucket{" + sep + "le=\"" + fmt("%.9g", le) + "\"} " +
+               std::to_string(cumulative) + "\n";
+    }
+    for (int i = PROM_LAST_BUCKET + 1; i < LatencyHistogram::NUM_BUCKETS; i++) cumulative += s.buckets[i];
+    out += std::string(metric) + "_bucket{" + sep + "le=\"+Inf\"} " + std::to_string(cumulative) + "\n";
+    std::string braces = labels.empty() ? "" : "{" + labels + "}";
+    out += std::string(metric) + "_sum" + braces + " " + fmt("%.9f", s.sum_ns * 1e-9) + "\n";
+    out += std::string(metric) + "_count" + braces + " " + std::to_string(cumulative) + "\n";
+}
+
+// ============ PipelineStats Implementation ============
+
+PipelineStats::PipelineStats() : start_ns(monotonicNs()) {
+    for (int i = 0; i < static_cast<int>(PipelineCounter::COUNT); i++) counters[i].store(0);
+    for (int i = 0; i < static_cast<int>(PipelineGauge::COUNT); i++) gauges[i].store(0);
+}
+
+void PipelineStats::recordQueueDepth(size_t depth) {
+    set(PipelineGauge::IQ_QUEUE_DEPTH, depth);
+    if (depth > get(PipelineGauge::IQ_QUEUE_MAX)) set(PipelineGauge::IQ_QUEUE_MAX, depth);   // Um escritor só
+}
+
+const char* PipelineStats::stageName(PipelineStage s) {
+    switch (s) {
+        case PipelineStage::IQ_DEQUEUE: return "iq_dequeue";
+        case PipelineStage::DEMOD: return "demod";
+        case PipelineStage::CHANNELS: return "channels";
+        case PipelineStage::SPECTRUM: return "spectrum";
+        case PipelineStage::AGC: return "agc";
+        case PipelineStage::PCM: return "pcm";
+        case PipelineStage::SEND: return "send";
+        case PipelineStage::BLOCK: return "block";
+        default: return "unknown";
+    }
+}
+
+const char* PipelineStats::counterName(PipelineCounter c) {
+    switch (c) {
+        case PipelineCounter::IQ_BLOCKS: return "iq_blocks";
+        case PipelineCounter::IQ_BYTES: return "iq_bytes";
+        case PipelineCounter::IQ_OVERRUNS: return "iq_overruns";
+        case PipelineCounter::AUDIO_SAMPLES: return "audio_samples";
+        case PipelineCounter::AUDIO_SQUELCHED: return "audio_squelched_samples";
+        case PipelineCounter::AUDIO_FRAMES: return "audio_frames";
+        case PipelineCounter::SPECTRUM_FRAMES: return "spectrum_frames";
+        case PipelineCounter::RECORDER_DROPS: return "recorder_dropped_blocks";
+        default: return "unknown";
+    }
+}
+
+const char* PipelineStats::gaugeName(PipelineGauge g) {
+    switch (g) {
+        case PipelineGauge::IQ_QUEUE_DEPTH: return "iq_queue_depth";
+        case PipelineGauge::IQ_QUEUE_MAX: return "iq_queue_max";
+        case PipelineGauge::IQ_QUEUE_CAPACITY: return "iq_queue_capacity";
+        case PipelineGauge::CLIENTS: return "clients";
+        default: return "unknown";
+    }
+}
+
+void PipelineStats::appendJson(std::string& out) const {
+    out += "\"uptime_s\":" + fmt("%.3f", (monotonicNs() - start_ns.load()) * 1e-9) + ",\"stages\":{";
+    for (int i = 0; i < static_cast<int>(PipelineStage::COUNT); i++) {
+        if (i) out += ",";
+        appendHistogramJson(out, stageName(static_cast<PipelineStage>(i)), stages[i].snapshot());
+    }
+    out += "},\"counters\":{";
+    for (int i = 0; i < static_cast<int>(PipelineCounter::COUNT); i++) {
+        if (i) out += ",";
+        out += std::string("\"") + counterName(static_cast<PipelineCounter>(i)) + "\":" +
+               std::to_string(counters[i].load(std::memory_order_relaxed));
+    }
+    out += "},\"gauges\":{";
+    for (int i = 0; i < static_cast<int>(PipelineGauge::COUNT); i++) {
+        if (i) out += ",";
+        out += std::string("\"") + gaugeName(static_cast<PipelineGauge>(i)) + "\":" +
+               std::to_string(gauges[i].load(std::memory_order_relaxed));
+    }
+    out += "}";
+}
+
+void PipelineStats::appendPrometheus(std::string& out) const {
+    out += "# HELP speedsdr_stage_seconds Tempo por bloco IQ em cada estagio do pipeline\n"
+           "# TYPE speedsdr_stage_seconds histogram\n";
+    for (int i = 0; i < static_cast<int>(PipelineStage::COUNT); i++) {
+        appendHistogramPrometheus(out, "speedsdr_stage_seconds",
+                                  std::string("stage=\"") + stageName(static_cast<PipelineStage>(i)) + "\"",
+                                  stages[i].snapshot());
+    }
+    for (int i = 0; i < static_cast<int>(PipelineCounter::COUNT); i++) {
+        std::string name = std::string("speedsdr_") + counterName(static_cast<PipelineCounter>(i)) + "_total";
+        out += "# TYPE " + name + " counter\n" + name + " " +
+               std::to_string(counters[i].load(std::memory_order_relaxed)) + "\n";
+    }
+    for (int i = 0; i < static_cast<int>(PipelineGauge::COUNT); i++) {
+        std::string name = std::string("speedsdr_") + gaugeName(static_cast<PipelineGauge>(i));
+        out += "# TYPE " + name + " gauge\n" + name + " " +
+               std::to_string(gauges[i].load(std::memory_order_relaxed)) + "\n";
+    }
+    out += "# TYPE speedsdr_uptime_seconds gauge\nspeedsdr_uptime_seconds " +
+           fmt("%.3f", (monotonicNs() - start_ns.load()) * 1e-9) + "\n";
+}
+
+void PipelineStats::reset() {
+    for (int i = 0; i < static_cast<int>(PipelineStage::COUNT); i++) stages[i].reset();
+    for (int i = 0; i < static_cast<int>(PipelineCounter::COUNT); i++) counters[i].store(0, std::memory_order_relaxed);
+    set(PipelineGauge::IQ_QUEUE_MAX, 0);
+    start_ns.store(monotonicNs());
+}
+
+// ============ PlayoutTracker Implementation ============
+
+static const uint64_t MAX_PLAYOUT_NS = 60ull * 1000000000ull;
+
+bool PlayoutTracker::playout(uint32_t client_id, uint64_t capture_us, double delay_ms, uint64_t now_ns) {
+    uint64_t capture_ns = capture_us * 1000;
+    double latency = static_cast<double>(now_ns) - static_cast<double>(capture_ns) - std::max(delay_ms, 0.0) * 1e6;
+    if (capture_us == 0 || latency <= 0.0 || latency > static_cast<double>(MAX_PLAYOUT_NS)) return false;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unique_ptr<LatencyHistogram>& h = clients[client_id];
+    if (!h) h.reset(new LatencyHistogram());
+    h->record(static_cast<uint64_t>(latency));
+    return true;
+}
+
+void PlayoutTracker::prune(const std::vector<uint32_t>& live_ids) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto it = clients.begin(); it != clients.end();) {
+        if (std::find(live_ids.begin(), live_ids.end(), it->first) == live_ids.end()) it = clients.erase(it);
+        else ++it;
+    }
+}
+
+void PlayoutTracker::appendJson(std::string& out) const {
+    appendHistogramJson(out, "server", server.snapshot());
+    out += ",\"clients\":[";
+    std::lock_guard<std::mutex> lock(mutex);
+    bool first = true;
+    for (const auto& c : clients) {
+        if (!first) out += ",";
+        first = false;
+        // Mesmo formato do histograma, com o id na frente
+        std::string h;
+        appendHistogramJson(h, "x", c.second->snapshot());
+        out += "{\"id\":" + std::to_string(c.first) + "," + h.substr(h.find('{') + 1);
+    }
+    out += "]";
+}
+
+void PlayoutTracker::appendPrometheus(std::string& out) const {
+    out += "# HELP speedsdr_capture_to_queue_seconds Captura da 1a amostra do quadro ate o quadro enfileirado\n"
+           "# TYPE speedsdr_capture_to_queue_seconds histogram\n";
+    appendHistogramPrometheus(out, "speedsdr_capture_to_queue_seconds", "", server.snapshot());
+    out += "# HELP speedsdr_client_playout_latency_seconds Captura ate a reproducao no cliente (eco PLAYOUT)\n"
+           "# TYPE speedsdr_client_playout_latency_seconds histogram\n";
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& c : clients) {
+        appendHistogramPrometheus(out, "speedsdr_client_playout_latency_seconds",
+                                  "client=\"" + std::to_string(c.first) + "\"", c.second->snapshot());
+    }
+}
+
+void PlayoutTracker::reset() {
+    server.reset();
+    std::lock_guard<std::mutex> lock(mutex);
+    clients.clear();
+}
@@ -0,0 +1,165 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Relógio monotônico em ns (steady_clock; dezenas de ns por leitura)
+inline uint64_t monotonicNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Histograma de latências com baldes log2 (balde i = [2^i, 2^(i+1)) ns).
+// record() são só atomics relaxed, sem lock nem alocação: pode ficar
+// ligado no caminho quente. Vários escritores são permitidos.
+class LatencyHistogram {
+public:
+    static const int NUM_BUCKETS = 36;      // Até ~68 s
+
+    struct Snapshot {
+        uint64_t buckets[NUM_BUCKETS];
+        uint64_t count;
+        uint64_t sum_ns;
+        uint64_t max_ns;
+
+        // Quantil estimado (interpolação dentro do balde), em ns
+        double percentile(double p) const;
+        double meanNs() const { return count ? static_cast<double>(sum_ns) / count : 0.0; }
+    };
+
+    LatencyHistogram();
+
+    void record(uint64_t ns);
+    // Tempo desde start_ns (monotonicNs()); retorna o instante atual para encadear estágios
+    uint64_t recordSince(uint64_t start_ns) {
+        uint64_t now = monotonicNs();
+        record(now - start_ns);
+        return now;
+    }
+
+    Snapshot snapshot() const;
+    void reset();
+
+    static int bucketFor(uint64_t ns);
+
+private:
+    std::atomic<uint64_t> buckets[NUM_BUCKETS];
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> sum_ns;
+    std::atomic<uint64_t> max_ns;
+};
+
+// Renderização compartilhada pelo STATS (JSON) e pelo /metrics (Prometheus)
+// "nome":{"count":..,"mean_us":..,"p50_us":..,"p90_us":..,"p99_us":..,"max_us":..}
+void appendHistogramJson(std::string& out, const char* name, const LatencyHistogram::Snapshot& s);
+// Histograma Prometheus em segundos (_bucket{le=..}, _sum, _count); labels
+// extras no formato 'stage="demod"' (ou vazio). Não escreve # HELP/# TYPE.
+void appendHistogramPrometheus(std::string& out, const char* metric, const std::string& labels,
+                               const LatencyHistogram::Snapshot& s);
+
+enum class PipelineStage {
+    IQ_DEQUEUE = 0,     // acquireRead do anel SPSC
+    DEMOD,              // Demodulator::processIQ
+    CHANNELS,           // MultiChannelReceiver (canais extras)
+    SPECTRUM,           // SpectrumEngine
+    AGC,                // AudioProcessor::processAudio
+    PCM,                // floatToPCM16
+    SEND,               // Empacotar e enfileirar os quadros para os clientes
+    BLOCK,              // Bloco IQ inteiro, do dequeue ao último envio
+    COUNT
+};
+
+enum class PipelineCounter {
+    IQ_BLOCKS = 0,      // Blocos IQ processados
+    IQ_BYTES,
+    IQ_OVERRUNS,        // Blocos descartados com o anel cheio
+    AUDIO_SAMPLES,      // Amostras de áudio do canal principal
+    AUDIO_SQUELCHED,    // Dessas, com o squelch fechado (sem AGC, codificação nem envio)
+    AUDIO_FRAMES,       // Quadros de áudio enfileirados (todas as codificações)
+    SPECTRUM_FRAMES,
+    RECORDER_DROPS,     // Blocos descartados pelo gravador SigMF
+    COUNT
+};
+
+enum class PipelineGauge {
+    IQ_QUEUE_DEPTH = 0, // Slots ocupados no anel ao retirar um bloco
+    IQ_QUEUE_MAX,       // Pico desde o início
+    IQ_QUEUE_CAPACITY,
+    CLIENTS,
+    COUNT
+};
+
+// Instrumentação do pipeline: histogramas por estágio, contadores e
+// medidores, escritos pela thread de DSP e lidos por qualquer thread.
+class PipelineStats {
+public:
+    PipelineStats();
+
+    LatencyHistogram& stage(PipelineStage s) { return stages[static_cast<int>(s)]; }
+    const LatencyHistogram& stage(PipelineStage s) const { return stages[static_cast<int>(s)]; }
+
+    void add(PipelineCounter c, uint64_t n = 1) {
+        counters[static_cast<int>(c)].fetch_add(n, std::memory_order_relaxed);
+    }
+    void set(PipelineCounter c, uint64_t v) { counters[static_cast<int>(c)].store(v, std::memory_order_relaxed); }
+    uint64_t get(PipelineCounter c) const { return counters[static_cast<int>(c)].load(std::memory_order_relaxed); }
+
+    void set(PipelineGauge g, uint64_t v) { gauges[static_cast<int>(g)].store(v, std::memory_order_relaxed); }
+    uint64_t get(PipelineGauge g) const { return gauges[static_cast<int>(g)].load(std::memory_order_relaxed); }
+    // Profundidade atual do anel IQ; mantém o pico
+    void recordQueueDepth(size_t depth);
+
+    static const char* stageName(PipelineStage s);
+    static const char* counterName(PipelineCounter c);
+    static const char* gaugeName(PipelineGauge g);
+
+    // "stages":{...},"counters":{...},"gauges":{...},"uptime_s":.. (sem chaves externas)
+    void appendJson(std::string& out) const;
+    // Métricas speedsdr_* no formato de exposição de texto do Prometheus
+    void appendPrometheus(std::string& out) const;
+
+    void reset();
+
+private:
+    LatencyHistogram stages[static_cast<int>(PipelineStage::COUNT)];
+    std::atomic<uint64_t> counters[static_cast<int>(PipelineCounter::COUNT)];
+    std::atomic<uint64_t> gauges[static_cast<int>(PipelineGauge::COUNT)];
+    std::atomic<uint64_t> start_ns;
+};
+
+// Latência fim a fim do áudio: captura do bloco IQ (rtl_callback) ->
+// quadro enfileirado no servidor -> início da reprodução no cliente.
+// O cliente devolve o AudioCaptureTime do quadro no eco PLAYOUT; a medida
+// inclui a volta do eco pela rede (em LAN, bem abaixo de 1 ms).
+class PlayoutTracker {
+public:
+    // Thread de DSP: quadro enfileirado com a 1ª amostra capturada em capture_ns
+    void frameQueued(uint64_t capture_ns, uint64_t now_ns) {
+        if (capture_ns && now_ns > capture_ns) server.record(now_ns - capture_ns);
+    }
+
+    // Thread de I/O: eco do cliente. delay_ms = há quanto tempo (relógio do
+    // cliente) o quadro começou a tocar quando o eco saiu. false se o valor
+    // for implausível (relógio de outro processo, eco muito atrasado).
+    bool playout(uint32_t client_id, uint64_t capture_us, double delay_ms, uint64_t now_ns);
+
+    // Esquece clientes que não estão mais conectados
+    void prune(const std::vector<uint32_t>& live_ids);
+
+    // "server":{..},"clients":[{"id":..,"count":..,"p50_us":..}] (sem chaves externas)
+    void appendJson(std::string& out) const;
+    void appendPrometheus(std::string& out) const;
+
+    void reset();
+
+private:
+    LatencyHistogram server;
+    mutable std::mutex mutex;
+    std::map<uint32_t, std::unique_ptr<LatencyHistogram>> clients;
+};
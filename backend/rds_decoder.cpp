@@ -0,0 +1,271 @@
+#include "rds_decoder.h"
+#include <algorithm>
+#include <cstring>
+
+static const int RDS_SAMPLE_RATE = 19000;       // 16 amostras por bit (1187.5 bit/s)
+static const float RDS_BANDWIDTH_HZ = 2400.0f;  // Bifásico: lóbulo principal até 2375 Hz
+static const float PHASE_ENERGY_DECAY = 0.99f;
+
+static const int BLOCK_BITS = 26;
+static const int MAX_RECENT_ERRORS = 24;        // Cada erro soma 2, cada acerto tira 1
+
+// g(x) = x^10 + x^8 + x^7 + x^5 + x^4 + x^3 + 1, sem o termo x^10
+static const uint16_t RDS_POLY = 0x1B9;
+
+// Palavras de offset somadas à verificação de cada bloco
+static const uint16_t OFFSET_A = 0x0FC;
+static const uint16_t OFFSET_B = 0x198;
+static const uint16_t OFFSET_C = 0x168;
+static const uint16_t OFFSET_CP = 0x350;   // C' (grupos versão B)
+static const uint16_t OFFSET_D = 0x1B4;
+
+// Palavra de verificação de 10 bits dos 16 bits de dados (resto de m(x) x^10 / g(x))
+static uint16_t checkword(uint16_t data) {
+    uint16_t reg = 0;
+    for (int bit = 15; bit >= 0; bit--) {
+        bool feedback = (((data >> bit) & 1) != 0) != (((reg >> 9) & 1) != 0);
+        reg = static_cast<uint16_t>((reg << 1) & 0x3FF);
+        if (feedback) reg ^= RDS_POLY;
+    }
+    return reg;
+}
+
+// Posição no grupo (0 = A, 1 = B, 2 = C/C', 3 = D) de um bloco de 26 bits, ou -1
+static int blockPosition(uint32_t block) {
+    uint16_t offset = checkword(static_cast<uint16_t>(block >> 10)) ^ static_cast<uint16_t>(block & 0x3FF);
+    switch (offset) {
+        case OFFSET_A: return 0;
+        case OFFSET_B: return 1;
+        case OFFSET_C:
+        case OFFSET_CP: return 2;
+        case OFFSET_D: return 3;
+        default: return -1;
+    }
+}
+
+// O conjunto de caracteres do RDS coincide com o ASCII só na faixa imprimível
+static char rdsChar(uint8_t c) {
+    if (c >= 0x20 && c < 0x7F) return static_cast<char>(c);
+    return c >= 0x80 ? '?' : ' ';
+}
+
+// ============ RdsDecoder Implementation ============
+
+RdsDecoder::RdsDecoder(int composite_rate)
+    : decimator(composite_rate, RDS_SAMPLE_RATE, RDS_BANDWIDTH_HZ) {
+    reset();
+}
+
+void RdsDecoder::reserve(size_t max_n) {
+    mixed.reserve(max_n);
+    baseband.reserve(decimator.maxOutput(max_n));
+}
+
+void RdsDecoder::process(const float* mpx, const std::complex<float>* pilot, size_t n) {
+    // 57 kHz = 3x a fase do piloto
+    mixed.resize(n);
+    for (size_t k = 0; k < n; k++) {
+        std::complex<float> z = pilot[k];
+        std::complex<float> z3 = z * z * z;
+        mixed[k] = mpx[k] * std::conj(z3);
+    }
+
+    baseband.resize(decimator.maxOutput(n));
+    size_t count = decimator.process(mixed.data(), n, baseband.data());
+
+    for (size_t i = 0; i < count; i++) {
+        unsigned phase = sample_index % SAMPLES_PER_BIT;
+        window[phase] = baseband[i];
+
+        // Símbolo bifásico terminando aqui: 1ª metade - 2ª metade
+        std::complex<float> symbol(0.0f, 0.0f);
+        for (int m = 0; m < SAMPLES_PER_BIT; m++) {
+            const std::complex<float>& x = window[(phase + 1 + m) % SAMPLES_PER_BIT];
+            if (m < SAMPLES_PER_BIT / 2) symbol += x;
+            else symbol -= x;
+        }
+        phase_energy[phase] = phase_energy[phase] * PHASE_ENERGY_DECAY + std::norm(symbol);
+
+        if (phase == bit_phase) {
+            // Diferencial: inversão de fase entre símbolos = bit 1
+            float d = (symbol * std::conj(prev_symbol)).real();
+            prev_symbol = symbol;
+            pushBit(d < 0.0f ? 1 : 0);
+        }
+
+        // Fase de bit com mais energia (acompanha a deriva do relógio do RTL)
+        if (phase == SAMPLES_PER_BIT - 1) {
+            bit_phase = static_cast<unsigned>(std::max_element(phase_energy, phase_energy + SAMPLES_PER_BIT) - phase_energy);
+        }
+        sample_index++;
+    }
+}
+
+void RdsDecoder::pushBit(int bit) {
+    shift_reg = ((shift_reg << 1) | static_cast<uint32_t>(bit)) & ((1u << BLOCK_BITS) - 1);
+    bits_since_block++;
+
+    if (!synced) {
+        // Busca: dois blocos válidos consecutivos, a 26 bits um do outro
+        int position = blockPosition(shift_reg);
+        if (position < 0) return;
+        if (last_block >= 0 && bits_since_block == BLOCK_BITS && position == (last_block + 1) % 4) {
+            synced = true;
+            recent_errors = 0;
+            std::fill(block_ok, block_ok + 4, false);
+            expected_block = position;
+            bits_since_block = BLOCK_BITS;
+        } else {
+            last_block = position;
+            bits_since_block = 0;
+            return;
+        }
+    }
+
+    if (bits_since_block < BLOCK_BITS) return;
+    bits_since_block = 0;
+
+    if (expected_block == 0) std::fill(block_ok, block_ok + 4, false);
+    if (blockPosition(shift_reg) == expected_block) {
+        handleBlock(expected_block, static_cast<uint16_t>(shift_reg >> 10));
+        if (recent_errors > 0) recent_errors--;
+    } else {
+        error_count++;
+        recent_errors += 2;
+        if (recent_errors > MAX_RECENT_ERRORS) {
+            synced = false;
+            last_block = -1;
+            return;
+        }
+    }
+
+    if (expected_block == 3) decodeGroup();
+    expected_block = (expected_block + 1) % 4;
+}
+
+void RdsDecoder::handleBlock(int position, uint16_t data) {
+    blocks[position] = data;
+    block_ok[position] = true;
+}
+
+void RdsDecoder::decodeGroup() {
+    if (block_ok[0] && blocks[0] != pi_code) {
+        pi_code = blocks[0];
+        changed = true;
+    }
+    if (!block_ok[1]) return;
+    group_count++;
+
+    const uint16_t b = blocks[1];
+    const int group_type = b >> 12;
+    const bool version_b = (b & 0x0800) != 0;
+    const uint8_t new_pty = static_cast<uint8_t>((b >> 5) & 0x1F);
+    const bool new_tp = (b & 0x0400) != 0;
+    if (new_pty != pty || new_tp != tp) {
+        pty = new_pty;
+        tp = new_tp;
+        changed = true;
+    }
+
+    if (group_type == 0 && block_ok[3]) {
+        // PS: 2 caracteres por grupo, 4 segmentos
+        unsigned addr = b & 0x3;
+        ps_buf[2 * addr] = rdsChar(static_cast<uint8_t>(blocks[3] >> 8));
+        ps_buf[2 * addr + 1] = rdsChar(static_cast<uint8_t>(blocks[3] & 0xFF));
+        ps_mask |= 1u << addr;
+        if (ps_mask == 0xF) {
+            if (std::memcmp(ps_text, ps_buf, 8) != 0) {
+                std::memcpy(ps_text, ps_buf, 8);
+                ps_text[8] = '\0';
+                changed = true;
+            }
+            ps_mask = 0;
+        }
+    } else if (group_type == 2) {
+        // RadioText: flag A/B trocada = texto novo
+        int ab = (b >> 4) & 1;
+        if (ab != rt_ab) {
+            rt_ab = ab;
+            std::memset(rt_buf, ' ', sizeof(rt_buf));
+            rt_mask = 0;
+        }
+        unsigned addr = b & 0xF;
+        if (!version_b && block_ok[2] && block_ok[3]) {
+            // 2A: 4 caracteres por grupo (C e D), até 64
+            const uint16_t words[2] = { blocks[2], blocks[3] };
+            for (int w = 0; w < 2; w++) {
+                uint8_t hi = static_cast<uint8_t>(words[w] >> 8), lo = static_cast<uint8_t>(words[w] & 0xFF);
+                rt_buf[4 * addr + 2 * w] = hi == 0x0D ? '\r' : rdsChar(hi);
+                rt_buf[4 * addr + 2 * w + 1] = lo == 0x0D ? '\r' : rdsChar(lo);
+            }
+            rt_mask |= 1u << addr;
+            publishRadioText(16, 4);
+        } else if (version_b && block_ok[3]) {
+            // 2B: 2 caracteres por grupo (D), até 32
+            uint8_t hi = static_cast<uint8_t>(blocks[3] >> 8), lo = static_cast<uint8_t>(blocks[3] & 0xFF);
+            rt_buf[2 * addr] = hi == 0x0D ? '\r' : rdsChar(hi);
+            rt_buf[2 * addr + 1] = lo == 0x0D ? '\r' : rdsChar(lo);
+            rt_mask |= 1u << addr;
+            publishRadioText(16, 2);
+        }
+    }
+}
+
+void RdsDecoder::publishRadioText(size_t segments, size_t chars_per_segment) {
+    // Só publica com todos os segmentos até o fim da mensagem (0x0D ou o último)
+    size_t end = segments * chars_per_segment;
+    for (size_t s = 0; s < segments; s++) {
+        if (!(rt_mask & (1u << s))) return;
+        const char* seg = rt_buf + s * chars_per_segment;
+        const char* cr = static_cast<const char*>(std::memchr(seg, '\r', chars_per_segment));
+        if (cr) {
+            end = static_cast<size_t>(cr - rt_buf);
+            break;
+        }
+    }
+    while (end > 0 && rt_buf[end - 1] == ' ') end--;
+
+    if (std::strlen(rt_text) != end || std::memcmp(rt_text, rt_buf, end) != 0) {
+        std::memcpy(rt_text, rt_buf, end);
+        rt_text[end] = '\0';
+        changed = true;
+    }
+}
+
+bool RdsDecoder::takeChanged() {
+    bool c = changed;
+    changed = false;
+    return c;
+}
+
+void RdsDecoder::reset() {
+    decimator.reset();
+    std::fill(window, window + SAMPLES_PER_BIT, std::complex<float>(0.0f, 0.0f));
+    std::fill(phase_energy, phase_energy + SAMPLES_PER_BIT, 0.0f);
+    sample_index = 0;
+    bit_phase = 0;
+    prev_symbol = std::complex<float>(0.0f, 0.0f);
+
+    shift_reg = 0;
+    synced = false;
+    bits_since_block = 0;
+    last_block = -1;
+    expected_block = 0;
+    recent_errors = 0;
+    std::fill(blocks, blocks + 4, uint16_t(0));
+    std::fill(block_ok, block_ok + 4, false);
+
+    pi_code = 0;
+    pty = 0;
+    tp = false;
+    std::memset(ps_buf, ' ', sizeof(ps_buf));
+    ps_mask = 0;
+    std::memset(rt_buf, ' ', sizeof(rt_buf));
+    rt_mask = 0;
+    rt_ab = -1;
+    ps_text[0] = '\0';
+    rt_text[0] = '\0';
+    changed = false;
+    group_count = 0;
+    error_count = 0;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include "aligned_buffer.h"
+#include "resampler.h"
+
+// Decodificador RDS (IEC 62106) a partir do composto de FM.
+// A subportadora de 57 kHz é travada no 3º harmônico do piloto: em vez de
+// outro PLL, o composto é misturado com o cubo do fasor do StereoDecoder e
+// decimado para 19 kHz = 16 amostras por bit (o relógio de bit também é
+// piloto / 16). BPSK bifásico com codificação diferencial: a detecção é
+// Re(s_k * conj(s_k-1)), imune à fase da portadora. Depois: sincronismo de
+// blocos pela palavra de verificação + offset (A, B, C/C', D) e extração de
+// PI, PTY, PS (grupo 0) e RadioText (grupo 2).
+class RdsDecoder {
+public:
+    explicit RdsDecoder(int composite_rate);
+
+    // mpx e pilot: n amostras do composto e o fasor do piloto de cada uma
+    void process(const float* mpx, const std::complex<float>* pilot, size_t n);
+
+    // true se PI, PTY, PS ou RadioText mudaram desde a última chamada
+    bool takeChanged();
+
+    bool isSynced() const { return synced; }
+    uint16_t programId() const { return pi_code; }
+    uint8_t programType() const { return pty; }
+    bool trafficProgram() const { return tp; }
+    const char* programService() const { return ps_text; }   // 8 caracteres ou vazio
+    const char* radioText() const { return rt_text; }        // Até 64 caracteres ou vazio
+    uint64_t groups() const { return group_count; }
+    uint64_t blockErrors() const { return error_count; }
+
+    void reserve(size_t max_n);
+    void reset();
+
+private:
+    static const int SAMPLES_PER_BIT = 16;
+
+    MultiStageDecimator<std::complex<float>> decimator;  // Composto -> 19 kHz, banda de 2.4 kHz
+    AlignedVector<std::complex<float>> mixed;
+    AlignedVector<std::complex<float>> baseband;
+
+    // Temporização de bit: janela das últimas 16 amostras e energia média
+    // do símbolo bifásico em cada uma das 16 fases possíveis
+    std::complex<float> window[SAMPLES_PER_BIT];
+    float phase_energy[SAMPLES_PER_BIT];
+    unsigned sample_index;
+    unsigned bit_phase;
+    std::complex<float> prev_symbol;
+
+    // Sincronismo de blocos
+    uint32_t shift_reg;             // Últimos 26 bits
+    bool synced;
+    int bits_since_block;
+    int last_block;                 // Posição (0..3) do último bloco válido na busca
+    int expected_block;
+    int recent_errors;              // Com decaimento: perde o sincronismo se acumular
+    uint16_t blocks[4];
+    bool block_ok[4];
+
+    // Dados
+    uint16_t pi_code;
+    uint8_t pty;
+    bool tp;
+    char ps_buf[8];
+    unsigned ps_mask;
+    char rt_buf[64];
+    uint32_t rt_mask;
+    int rt_ab;
+    char ps_text[9];
+    char rt_text[65];
+    bool changed;
+    uint64_t group_count;
+    uint64_t error_count;
+
+    void pushBit(int bit);
+    void handleBlock(int position, uint16_t data);
+    void decodeGroup();
+    void publishRadioText(size_t segments, size_t chars_per_segment);
+};
@@ -0,0 +1,331 @@
+#include "resampler.h"
+#include <cmath>
+#include <numeric>
+#include <algorithm>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// ============ Projeto de filtros ============
+
+// Função de Bessel modificada de ordem zero (série)
+static double besselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    double half = x * 0.5;
+    for (int k = 1; k < 32; k++) {
+        term *= (half / k) * (half / k);
+        sum += term;
+        if (term < 1e-12 * sum) break;
+    }
+    return sum;
+}
+
+static double kaiserBeta(float attenuation_db) {
+    if (attenuation_db > 50.0f) return 0.1102 * (attenuation_db - 8.7);
+    if (attenuation_db >= 21.0f) {
+        return 0.5842 * std::pow(attenuation_db - 21.0, 0.4) + 0.07886 * (attenuation_db - 21.0);
+    }
+    return 0.0;
+}
+
+static double kaiserWindow(int n, int num_taps, double beta) {
+    if (num_taps <= 1) return 1.0;
+    double r = 2.0 * n / (num_taps - 1) - 1.0;
+    return besselI0(beta * std::sqrt(std::max(0.0, 1.0 - r * r))) / besselI0(beta);
+}
+
+int estimateFIRTaps(float transition, float attenuation_db) {
+    transition = std::max(transition, 1e-4f);
+    int taps = static_cast<int>(std::ceil((attenuation_db - 8.0f) / (2.285f * 2.0f * M_PI * transition))) + 1;
+    return std::max(taps, 3);
+}
+
+std::vector<float> designLowpassFIR(float cutoff, float transition, float attenuation_db) {
+    int num_taps = estimateFIRTaps(transition, attenuation_db);
+    if ((num_taps & 1) == 0) num_taps++;  // Ordem par -> atraso de grupo inteiro
+
+    double beta = kaiserBeta(attenuation_db);
+    double center = (num_taps - 1) * 0.5;
+    std::vector<float> taps(num_taps);
+
+    double sum = 0.0;
+    for (int n = 0; n < num_taps; n++) {
+        double x = n - center;
+        double sinc = (x == 0.0) ? 2.0 * cutoff
+                                 : std::sin(2.0 * M_PI * cutoff * x) / (M_PI * x);
+        double h = sinc * kaiserWindow(n, num_taps, beta);
+        taps[n] = static_cast<float>(h);
+        sum += h;
+    }
+
+    // Ganho unitário em DC
+    for (auto& t : taps) t = static_cast<float>(t / sum);
+    return taps;
+}
+
+// ============ FIRFilter Implementation ============
+
+template <typename T>
+FIRFilter<T>::FIRFilter(const std::vector<float>& taps) {
+    setTaps(taps);
+}
+
+template <typename T>
+void FIRFilter<T>::setTaps(const std::vector<float>& taps) {
+    taps_rev.assign(taps.rbegin(), taps.rend());
+    if (taps_rev.empty()) taps_rev.push_back(1.0f);
+    reset();
+}
+
+template <typename T>
+void FIRFilter<T>::process(const T* in, size_t n, T* out) {
+    const size_t num = taps_rev.size();
+    const size_t hist = num - 1;
+
+    if (work.size() < hist) work.assign(hist, T());
+    work.resize(hist + n);
+    std::copy(in, in + n, work.begin() + hist);
+
+    for (size_t i = 0; i < n; i++) {
+        const T* x = &work[i];
+        T acc = T();
+        for (size_t k = 0; k < num; k++) {
+            acc += x[k] * taps_rev[k];
+        }
+        out[i] = acc;
+    }
+
+    std::copy(work.end() - hist, work.end(), work.begin());
+    work.resize(hist);
+}
+
+template <typename T>
+void FIRFilter<T>::reset() {
+    work.assign(taps_rev.size() - 1, T());
+}
+
+// ============ HalfBandDecimator Implementation ============
+
+template <typename T>
+HalfBandDecimator<T>::HalfBandDecimator(int taps)
+    : center_coeff(0.5f), num_taps(taps), phase(0) {
+    // Forma 4k+3: extremidades não-nulas, centro no meio
+    if (num_taps < 7) num_taps = 7;
+    while ((num_taps - 3) % 4 != 0) num_taps++;
+
+    double beta = kaiserBeta(70.0f);
+    int half = (num_taps - 1) / 2;
+
+    // Taps ímpares d = 1, 3, 5, ... (os pares são zero por construção)
+    double sum = 0.0;
+    for (int d = 1; d <= half; d += 2) {
+        double h = std::sin(M_PI * d * 0.5) / (M_PI * d) * kaiserWindow(half + d, num_taps, beta);
+        coeffs.push_back(static_cast<float>(h));
+        sum += 2.0 * h;
+    }
+
+    // Normalizar: centro = 0.5 e soma total = 1
+    for (auto& c : coeffs) c = static_cast<float>(c * 0.5 / sum);
+}
+
+template <typename T>
+size_t HalfBandDecimator<T>::process(const T* in, size_t n, T* out) {
+    const size_t hist = static_cast<size_t>(num_taps - 1);
+    const size_t half = hist / 2;
+    const size_t pairs = coeffs.size();
+
+    if (work.size() < hist) work.assign(hist, T());
+    work.resize(hist + n);
+    std::copy(in, in + n, work.begin() + hist);
+
+    size_t count = 0;
+    size_t i = hist + phase;
+    for (; i < hist + n; i += 2) {
+        // Amostra mais nova em work[i]; centro do filtro em work[i - half]
+        const T* c = &work[i - half];
+        T acc = c[0] * center_coeff;
+        for (size_t m = 0; m < pairs; m++) {
+            const size_t d = 2 * m + 1;
+            acc += (c[-static_cast<ptrdiff_t>(d)] + c[d]) * coeffs[m];
+        }
+        out[count++] = acc;
+    }
+    phase = i - (hist + n);
+
+    // Guardar as últimas amostras como histórico do próximo bloco
+    std::copy(work.end() - hist, work.end(), work.begin());
+    work.resize(hist);
+    return count;
+}
+
+template <typename T>
+void HalfBandDecimator<T>::reset() {
+    phase = 0;
+    work.assign(static_cast<size_t>(num_taps - 1), T());
+}
+
+// ============ PolyphaseResampler Implementation ============
+
+template <typename T>
+PolyphaseResampler<T>::PolyphaseResampler(int interpolation, int decimation, float cutoff, float transition)
+    : L(interpolation), M(decimation), time_acc(0) {
+    std::vector<float> proto = designLowpassFIR(cutoff, transition);
+    group_delay = (proto.size() - 1) * 0.5;   // Antes do preenchimento com zeros
+
+    taps_per_phase = static_cast<int>((proto.size() + L - 1) / L);
+    proto.resize(static_cast<size_t>(taps_per_phase) * L, 0.0f);
+
+    // Fase p usa h[p + j*L]; ganho L compensa a inserção de zeros
+    bank.resize(proto.size());
+    for (int p = 0; p < L; p++) {
+        for (int j = 0; j < taps_per_phase; j++) {
+            bank[p * taps_per_phase + j] = proto[p + j * L] * L;
+        }
+    }
+}
+
+template <typename T>
+size_t PolyphaseResampler<T>::process(const T* in, size_t n, T* out) {
+    const size_t hist = static_cast<size_t>(taps_per_phase - 1);
+
+    if (work.size() < hist) work.assign(hist, T());
+    work.resize(hist + n);
+    std::copy(in, in + n, work.begin() + hist);
+
+    size_t count = 0;
+    size_t t = time_acc;
+    const size_t limit = n * L;
+    while (t < limit) {
+        const size_t idx = hist + t / L;
+        const float* h = &bank[(t % L) * taps_per_phase];
+        const T* x = &work[idx];
+
+        T acc = T();
+        for (int j = 0; j < taps_per_phase; j++) {
+            acc += x[-j] * h[j];
+        }
+        out[count++] = acc;
+        t += M;
+    }
+    time_acc = t - limit;
+
+    std::copy(work.end() - hist, work.end(), work.begin());
+    work.resize(hist);
+    return count;
+}
+
+template <typename T>
+size_t PolyphaseResampler<T>::maxOutput(size_t n) const {
+    return (n * L) / M + 2;
+}
+
+template <typename T>
+void PolyphaseResampler<T>::reset() {
+    time_acc = 0;
+    work.assign(static_cast<size_t>(taps_per_phase - 1), T());
+}
+
+// ============ MultiStageDecimator Implementation ============
+
+template <typename T>
+MultiStageDecimator<T>::MultiStageDecimator(int in_rate, int out_rate, float passband_hz)
+    : input_rate(in_rate), output_rate(out_rate) {
+    float passband = passband_hz > 0.0f ? passband_hz : 0.4f * output_rate;
+
+    // Estágios meia-banda enquanto a taxa ainda for >= saída depois de dividir por 2
+    int rate = input_rate;
+    while (rate % 2 == 0 && rate / 2 >= output_rate) {
+        // Só precisa rejeitar o que dobraria para dentro de [0, passband]
+        float transition = (rate * 0.5f - 2.0f * passband) / rate;
+        halfbands.emplace_back(estimateFIRTaps(transition));
+        rate /= 2;
+    }
+
+    // Passo racional restante (ex.: 64000 -> 48000 = 3/4)
+    if (rate != output_rate) {
+        int g = std::gcd(rate, output_rate);
+        int L = output_rate / g;
+        int M = rate / g;
+
+        float narrow = static_cast<float>(std::min(rate, output_rate));
+        passband = std::min(passband, 0.45f * narrow);
+        float stop = narrow - passband;
+        float upsampled = static_cast<float>(rate) * L;
+
+        polyphase.reset(new PolyphaseResampler<T>(L, M,
+            0.5f * (passband + stop) / upsampled,
+            (stop - passband) / upsampled));
+    }
+}
+
+template <typename T>
+size_t MultiStageDecimator<T>::maxOutput(size_t n) const {
+    for (size_t s = 0; s < halfbands.size(); s++) n = (n + 1) / 2;
+    if (polyphase) n = polyphase->maxOutput(n);
+    return n;
+}
+
+template <typename T>
+size_t MultiStageDecimator<T>::process(const T* in, size_t n, T* out) {
+    if (halfbands.empty() && !polyphase) {
+        std::copy(in, in + n, out);
+        return n;
+    }
+
+    const T* src = in;
+    size_t count = n;
+    std::vector<T>* bufs[2] = { &stage_a, &stage_b };
+
+    for (size_t s = 0; s < halfbands.size(); s++) {
+        bool last = (s + 1 == halfbands.size()) && !polyphase;
+        T* dst = out;
+        if (!last) {
+            std::vector<T>& buf = *bufs[s & 1];
+            if (buf.size() < (count + 1) / 2) buf.resize((count + 1) / 2);
+            dst = buf.data();
+        }
+        count = halfbands[s].process(src, count, dst);
+        src = dst;
+    }
+
+    if (polyphase) {
+        count = polyphase->process(src, count, out);
+    }
+    return count;
+}
+
+template <typename T>
+double MultiStageDecimator<T>::outputLag() const {
+    double lag = 0.0;
+    double rate = input_rate;
+    for (const auto& hb : halfbands) {
+        lag += hb.outputLag() / rate;
+        rate *= 0.5;
+    }
+    if (polyphase) lag += polyphase->outputLag() / rate;
+    return lag;
+}
+
+template <typename T>
+std::vector<T> MultiStageDecimator<T>::resample(const std::vector<T>& input) {
+    std::vector<T> output(maxOutput(input.size()));
+    output.resize(process(input.data(), input.size(), output.data()));
+    return output;
+}
+
+template <typename T>
+void MultiStageDecimator<T>::reset() {
+    for (auto& hb : halfbands) hb.reset();
+    if (polyphase) polyphase->reset();
+}
+
+template class FIRFilter<float>;
+template class FIRFilter<std::complex<float>>;
+template class HalfBandDecimator<float>;
+template class HalfBandDecimator<std::complex<float>>;
+template class PolyphaseResampler<float>;
+template class PolyphaseResampler<std::complex<float>>;
+template class MultiStageDecimator<float>;
+template class MultiStageDecimator<std::complex<float>>;
@@ -0,0 +1,112 @@
+#pragma once
+#include <complex>
+#include <vector>
+#include <cstddef>
+#include <memory>
+
+// Projeta um FIR passa-baixa (sinc janelado com Kaiser).
+// cutoff e transition normalizados pela taxa de amostragem (0..0.5).
+std::vector<float> designLowpassFIR(float cutoff, float transition, float attenuation_db = 70.0f);
+
+// Número de taps necessário para a atenuação/transição pedidas (estimativa de Kaiser)
+int estimateFIRTaps(float transition, float attenuation_db = 70.0f);
+
+// FIR simples (sem mudança de taxa) com histórico entre blocos
+template <typename T>
+class FIRFilter {
+public:
+    explicit FIRFilter(const std::vector<float>& taps);
+
+    void setTaps(const std::vector<float>& taps);
+    void process(const T* in, size_t n, T* out);
+    void reset();
+
+    size_t numTaps() const { return taps_rev.size(); }
+    // Atraso de grupo (fase linear), em amostras
+    double groupDelay() const { return (taps_rev.size() - 1) * 0.5; }
+
+private:
+    std::vector<float> taps_rev;  // Invertidos: produto escalar direto com o histórico
+    std::vector<T> work;
+};
+
+// Decimador meia-banda (fator 2): só calcula as amostras de saída mantidas
+// e aproveita os coeficientes nulos e a simetria do filtro.
+template <typename T>
+class HalfBandDecimator {
+public:
+    // num_taps é arredondado para a forma 4k+3
+    explicit HalfBandDecimator(int num_taps);
+
+    // Retorna o número de amostras escritas em out (no máximo (n + 1) / 2)
+    size_t process(const T* in, size_t n, T* out);
+    void reset();
+
+    // Quanto a última saída está atrás da última entrada, em amostras de
+    // entrada: atraso de grupo + amostras consumidas depois dela (fase)
+    double outputLag() const { return (num_taps - 1) * 0.5 + (1.0 - static_cast<double>(phase)); }
+
+private:
+    std::vector<float> coeffs;   // Apenas os taps ímpares não-nulos (metade simétrica)
+    float center_coeff;
+    int num_taps;
+    size_t phase;                // 0 ou 1: paridade da próxima saída
+    std::vector<T> work;         // Histórico + bloco atual (capacidade reaproveitada)
+};
+
+// Resampler polifásico racional L/M: só calcula as saídas usadas
+template <typename T>
+class PolyphaseResampler {
+public:
+    PolyphaseResampler(int interpolation, int decimation, float cutoff, float transition);
+
+    size_t process(const T* in, size_t n, T* out);
+    size_t maxOutput(size_t n) const;
+    void reset();
+
+    // Idem HalfBandDecimator::outputLag (fração de amostra pela fase time_acc)
+    double outputLag() const {
+        return (group_delay + M - static_cast<double>(time_acc)) / L - 1.0;
+    }
+
+private:
+    int L;
+    int M;
+    int taps_per_phase;
+    double group_delay;          // Do protótipo, em amostras da taxa interpolada (L x entrada)
+    std::vector<float> bank;     // L fases x taps_per_phase (ordem invertida por fase)
+    size_t time_acc;             // Posição da próxima saída em unidades de 1/L amostra
+    std::vector<T> work;
+};
+
+// Decimação em vários estágios: cascata de meias-bandas + polifásico final
+// para o passo racional restante. Ex.: 2048000 -> 64000 (5x meia-banda) -> 48000 (3/4).
+template <typename T>
+class MultiStageDecimator {
+public:
+    // passband_hz: faixa útil a ser preservada (padrão 0.4 * output_rate)
+    MultiStageDecimator(int input_rate, int output_rate, float passband_hz = 0.0f);
+
+    size_t process(const T* in, size_t n, T* out);
+    size_t maxOutput(size_t n) const;
+
+    // Conveniência: aloca o vetor de saída a cada chamada
+    std::vector<T> resample(const std::vector<T>& input);
+    void reset();
+
+    int getInputRate() const { return input_rate; }
+    int getOutputRate() const { return output_rate; }
+    int getHalfBandStages() const { return static_cast<int>(halfbands.size()); }
+
+    // Atraso, em segundos, do instante representado pela última saída em
+    // relação à última entrada (atraso de grupo de todos os estágios + fase)
+    double outputLag() const;
+
+private:
+    int input_rate;
+    int output_rate;
+    std::vector<HalfBandDecimator<T>> halfbands;
+    std::unique_ptr<PolyphaseResampler<T>> polyphase;  // nulo se a razão for potência de 2
+    std::vector<T> stage_a;
+    std::vector<T> stage_b;
+};
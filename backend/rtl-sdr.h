@@ -27,6 +27,11 @@ uint32_t rtlsdr_get_sample_rate(rtlsdr_dev_t *dev);
 int rtlsdr_set_tuner_gain_mode(rtlsdr_dev_t *dev, int manual);
 int rtlsdr_set_tuner_gain(rtlsdr_dev_t *dev, int gain);
 int rtlsdr_get_tuner_gain(rtlsdr_dev_t *dev);
+int rtlsdr_set_agc_mode(rtlsdr_dev_t *dev, int on);
+
+// Correção do cristal (ppm) e amostragem direta (0 = off, 1 = I, 2 = Q)
+int rtlsdr_set_freq_correction(rtlsdr_dev_t *dev, int ppm);
+int rtlsdr_set_direct_sampling(rtlsdr_dev_t *dev, int on);
 
 // Buffer e leitura
 int rtlsdr_reset_buffer(rtlsdr_dev_t *dev);
@@ -0,0 +1,227 @@
+#include "scanner.h"
+#include "pipeline_stats.h"
+#include <algorithm>
+#include <cmath>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+static const double USABLE_FRACTION = 0.85;  // Fora disso o filtro anti-aliasing do RTL já atenua
+static const double SETTLE_S = 0.04;         // PLL do tuner + transferências USB em voo
+static const size_t SCAN_AVERAGES = 8;       // FFTs por medição (8 ms a 2.048 Msps com 2048 pontos)
+static const float HOLD_HYSTERESIS_DB = 3.0f;
+
+// ============ WidebandScanner Implementation ============
+
+WidebandScanner::WidebandScanner(int rate, size_t fft_size)
+    : sample_rate(rate),
+      fft(fft_size),
+      request_pending(false),
+      running(false),
+      current(0),
+      window_center(0.0),
+      settle_until(0),
+      sweep_start(0),
+      averages(0),
+      segment_fill(0),
+      locked(false),
+      lock_freq(0.0),
+      lock_level(-120.0f),
+      last_active(0),
+      sweep_count(0),
+      last_sweep_s(0.0) {
+    const size_t n = fft.size();
+
+    // Blackman-Harris de 4 termos, como o espectro. Normalizado pela banda
+    // equivalente de ruído: somar os bins de um canal dá a potência dele
+    // na mesma escala do squelch do demodulador (fundo de escala = 0 dBFS).
+    window_fn.resize(n);
+    double sum_sq = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        double x = 2.0 * M_PI * i / n;
+        double w = 0.35875 - 0.48829 * std::cos(x) + 0.14128 * std::cos(2 * x) - 0.01168 * std::cos(3 * x);
+        window_fn[i] = static_cast<float>(w);
+        sum_sq += w * w;
+    }
+    power_scale = static_cast<float>(1.0 / (n * sum_sq));
+
+    segment.resize(n);
+    accum.assign(n, 0.0f);
+}
+
+void WidebandScanner::start(const ScanRange& r) {
+    std::lock_guard<std::mutex> lock(request_mutex);
+    requested = r;
+    if (requested.end_hz < requested.start_hz) std::swap(requested.start_hz, requested.end_hz);
+    requested.step_hz = std::max(requested.step_hz, 1000.0);
+    requested.dwell_s = std::max(requested.dwell_s, 0.0f);
+    running = true;
+    request_pending = true;
+}
+
+void WidebandScanner::stop() {
+    running = false;
+    request_pending = true;
+}
+
+void WidebandScanner::applyRequest() {
+    std::lock_guard<std::mutex> lock(request_mutex);
+    range = requested;
+    request_pending = false;
+}
+
+void WidebandScanner::planWindows() {
+    windows.clear();
+    const size_t total = static_cast<size_t>((range.end_hz - range.start_hz) / range.step_hz + 1e-6) + 1;
+    const size_t per_window = std::max<size_t>(1, static_cast<size_t>(USABLE_FRACTION * sample_rate / range.step_hz));
+
+    for (size_t first = 0; first < total; first += per_window) {
+        Window w;
+        w.first = first;
+        w.count = std::min(per_window, total - first);
+        w.center_hz = range.start_hz + (first + (w.count - 1) * 0.5) * range.step_hz;
+        // O centro cai entre dois canais: o pico de DC do RTL não vira atividade
+        if (w.count % 2 == 1) w.center_hz += 0.5 * range.step_hz;
+        w.center_hz = std::round(w.center_hz);
+        windows.push_back(w);
+    }
+}
+
+void WidebandScanner::tuneWindow(size_t index, const RetuneCallback& retune) {
+    // Faixa que cabe numa janela só: mede de novo sem retune
+    bool moved = windows[index].center_hz != window_center;
+    current = index;
+    window_center = windows[index].center_hz;
+    if (moved) {
+        retune(static_cast<uint32_t>(window_center));
+        settle_until = monotonicNs() + static_cast<uint64_t>(SETTLE_S * 1e9);
+    }
+    std::fill(accum.begin(), accum.end(), 0.0f);
+    averages = 0;
+    segment_fill = 0;
+}
+
+float WidebandScanner::channelPower(double offset_hz, float bw_hz) const {
+    // accum está com DC no centro: bin k = (k - n/2) * fs / n
+    const long n = static_cast<long>(fft.size());
+    const double bin_hz = static_cast<double>(sample_rate) / n;
+    long lo = static_cast<long>(std::ceil((offset_hz - 0.5 * bw_hz) / bin_hz)) + n / 2;
+    long hi = static_cast<long>(std::floor((offset_hz + 0.5 * bw_hz) / bin_hz)) + n / 2;
+    lo = std::max(lo, 0L);
+    hi = std::min(hi, n - 1);
+    float sum = 0.0f;
+    for (long k = lo; k <= hi; k++) sum += accum[k];
+    return sum * power_scale / static_cast<float>(averages);
+}
+
+static float toDb(float power) {
+    return 10.0f * std::log10(std::max(power, 1e-12f));
+}
+
+bool WidebandScanner::evaluate(uint64_t capture_ns, const RetuneCallback& retune) {
+    const float bw = range.channel_bw_hz > 0.0f ? range.channel_bw_hz : static_cast<float>(0.8 * range.step_hz);
+    const bool was_locked = locked;
+
+    if (locked) {
+        // Travado: só o canal seguido importa; a janela continua sintonizada
+        lock_level = toDb(channelPower(lock_freq - window_center, bw));
+        if (lock_level >= range.threshold_dbfs - HOLD_HYSTERESIS_DB) {
+            last_active = capture_ns;
+        } else if (capture_ns - last_active >= static_cast<uint64_t>(range.dwell_s * 1e9)) {
+            locked = false;
+        }
+        if (locked) {
+            std::fill(accum.begin(), accum.end(), 0.0f);
+            averages = 0;
+            return false;
+        }
+    } else {
+        // Todos os canais da janela contra o limiar, com a mesma média de FFTs
+        const Window& w = windows[current];
+        int best = -1;
+        float best_level = range.threshold_dbfs;
+        for (size_t i = 0; i < w.count; i++) {
+            double freq = range.start_hz + (w.first + i) * range.step_hz;
+            float level = toDb(channelPower(freq - window_center, bw));
+            if (level < range.threshold_dbfs) continue;
+            sweep_hits.push_back({ freq, level });
+            if (level >= best_level) {
+                best_level = level;
+                best = static_cast<int>(i);
+            }
+        }
+        if (best >= 0) {
+            locked = true;
+            lock_freq = range.start_hz + (w.first + best) * range.step_hz;
+            lock_level = best_level;
+            last_active = capture_ns;
+            std::fill(accum.begin(), accum.end(), 0.0f);
+            averages = 0;
+            return true;
+        }
+    }
+
+    // Próxima janela; a última fecha a varredura
+    bool changed = was_locked;
+    size_t next = current + 1;
+    if (next == windows.size()) {
+        next = 0;
+        sweep_count++;
+        last_sweep_s = (capture_ns - sweep_start) / 1e9;
+        sweep_start = capture_ns;
+        last_hits.swap(sweep_hits);
+        sweep_hits.clear();
+        changed = true;
+    }
+    tuneWindow(next, retune);
+    return changed;
+}
+
+bool WidebandScanner::process(const uint8_t* iq, size_t len, uint64_t capture_ns, const RetuneCallback& retune) {
+    bool changed = false;
+    if (request_pending.load()) {
+        applyRequest();
+        changed = true;
+        locked = false;
+        sweep_hits.clear();
+        last_hits.clear();
+        if (running) {
+            planWindows();
+            sweep_count = 0;
+            sweep_start = capture_ns;
+            window_center = 0.0;
+            tuneWindow(0, retune);
+        }
+    }
+    if (!running || windows.empty()) return changed;
+
+    // Blocos capturados antes do tuner assentar (ou ainda da janela anterior)
+    if (capture_ns < settle_until) return changed;
+
+    const size_t n = fft.size();
+    size_t count = len / 2;
+    size_t pos = 0;
+    while (pos < count) {
+        size_t take = std::min(count - pos, n - segment_fill);
+        converter.toComplex(iq + 2 * pos, take, segment.data() + segment_fill);
+        segment_fill += take;
+        pos += take;
+        if (segment_fill < n) break;
+
+        for (size_t i = 0; i < n; i++) segment[i] *= window_fn[i];
+        fft.forward(segment.data());
+        const size_t half = n / 2;
+        for (size_t k = 0; k < n; k++) accum[k] += std::norm(segment[(k + half) & (n - 1)]);
+        averages++;
+        segment_fill = 0;
+
+        if (averages == SCAN_AVERAGES) {
+            size_t before = current;
+            changed |= evaluate(capture_ns, retune);
+            // Retune: o resto do bloco ainda é da janela anterior
+            if (current != before || capture_ns < settle_until) break;
+        }
+    }
+    return changed;
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include <atomic>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "fft.h"
+#include "iq_convert.h"
+#include "aligned_buffer.h"
+
+// Faixa a varrer (ScannerConfig do frontend, em Hz e segundos)
+struct ScanRange {
+    double start_hz = 144000000.0;
+    double end_hz = 148000000.0;
+    double step_hz = 12500.0;
+    float channel_bw_hz = 0.0f;      // Banda medida por canal; 0 = 80% do passo
+    float threshold_dbfs = -60.0f;   // Potência do canal (dBFS) que conta como atividade
+    float dwell_s = 2.0f;            // Permanência depois da última atividade
+};
+
+// Canal acima do limiar na última medição
+struct ScanHit {
+    double freq_hz;
+    float level_dbfs;
+};
+
+// Scanner de banda larga: em vez de sintonizar cada passo e esperar,
+// sintoniza o hardware uma vez por janela (~1.7 MHz úteis de 2.048 MHz),
+// espera o tuner assentar, faz a média de algumas FFTs e mede todos os
+// canais da janela de uma vez. Com atividade, trava no canal mais forte por
+// offset (o demodulador segue o NCO, sem retune) enquanto houver sinal e
+// por dwell_s depois; então segue para a próxima janela.
+// Roda na thread de DSP, alimentado pelos mesmos blocos IQ do demodulador.
+class WidebandScanner {
+public:
+    // Retune do hardware para a frequência central da próxima janela
+    typedef std::function<void(uint32_t)> RetuneCallback;
+
+    WidebandScanner(int sample_rate, size_t fft_size = 2048);
+
+    // Podem ser chamados de outra thread; valem no próximo process()
+    void start(const ScanRange& range);
+    void stop();
+    bool isRunning() const { return running.load(std::memory_order_relaxed); }
+
+    // Thread de DSP: bloco IQ bruto capturado em capture_ns (monotonicNs()).
+    // Retorna true se o estado mudou (nova varredura, travou ou destravou).
+    bool process(const uint8_t* iq, size_t len, uint64_t capture_ns, const RetuneCallback& retune);
+
+    // Estado (thread de DSP, depois de process())
+    bool isLocked() const { return locked; }
+    double lockedFreq() const { return lock_freq; }
+    double lockedOffset() const { return lock_freq - window_center; }
+    float lockedLevel() const { return lock_level; }
+    double centerFreq() const { return window_center; }
+    const std::vector<ScanHit>& hits() const { return last_hits; }
+    uint64_t sweeps() const { return sweep_count; }
+    double lastSweepSeconds() const { return last_sweep_s; }
+    size_t numWindows() const { return windows.size(); }
+
+private:
+    struct Window {
+        double center_hz;
+        size_t first;       // Índice do primeiro canal da faixa
+        size_t count;
+    };
+
+    int sample_rate;
+    FFT fft;
+    IQConverter converter;
+    std::vector<float> window_fn;
+    float power_scale;      // 1 / (sum w)^2 / ENBW: soma dos bins = potência do canal
+
+    std::mutex request_mutex;
+    ScanRange requested;
+    std::atomic<bool> request_pending;
+    std::atomic<bool> running;
+
+    ScanRange range;
+    std::vector<Window> windows;
+    size_t current;
+    double window_center;
+    uint64_t settle_until;  // Blocos capturados antes disso ainda são do retune
+    uint64_t sweep_start;
+
+    AlignedVector<std::complex<float>> segment;
+    std::vector<float> accum;
+    size_t averages;
+    size_t segment_fill;
+
+    bool locked;
+    double lock_freq;
+    float lock_level;
+    uint64_t last_active;
+    std::vector<ScanHit> sweep_hits;    // Varredura em andamento
+    std::vector<ScanHit> last_hits;     // Última varredura completa
+    uint64_t sweep_count;
+    double last_sweep_s;
+
+    void applyRequest();
+    void planWindows();
+    void tuneWindow(size_t index, const RetuneCallback& retune);
+    bool evaluate(uint64_t capture_ns, const RetuneCallback& retune);
+    float channelPower(double offset_hz, float bw_hz) const;
+};
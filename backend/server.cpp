@@ -1,190 +1,1057 @@
 #include "server.h"
 #include <iostream>
-#include <sstream>
 #include <vector>
 #include <algorithm>
-#include <wincrypt.h>
+#include <cstring>
+#include <cctype>
+#include <deque>
 
-// CORREÇÃO AQUI: Adicionar Advapi32.lib para funções de hash (SHA1)
-#pragma comment(lib, "Crypt32.lib")
-#pragma comment(lib, "Advapi32.lib")
+#ifdef _WIN32
+#define poll WSAPoll
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <cerrno>
+#endif
 
-WebSocketServer::WebSocketServer(int p) : port(p), serverSocket(INVALID_SOCKET), running(false) {
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#define SPEEDSDR_EPOLL 1
+#endif
+
+#ifndef _WIN32
+#define INVALID_SOCKET (-1)
+#define SOCKET_ERROR (-1)
+#define closesocket close
+#endif
+
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS MSG_NOSIGNAL     // Cliente que fechou não derruba o processo com SIGPIPE
+#else
+#define SEND_FLAGS 0
+#endif
+
+static const size_t MAX_HANDSHAKE_BYTES = 8192;
+static const size_t MAX_MESSAGE_BYTES = 1 << 20;
+
+// ============ Utilitários de socket ============
+
+static bool setNonBlocking(socket_t s) {
+#ifdef _WIN32
+    u_long mode = 1;
+    return ioctlsocket(s, FIONBIO, &mode) == 0;
+#else
+    int flags = fcntl(s, F_GETFL, 0);
+    return flags >= 0 && fcntl(s, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+static bool wouldBlock() {
+#ifdef _WIN32
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+}
+
+// ============ SHA-1 (RFC 3174), só para o handshake ============
+
+static inline uint32_t rotl32(uint32_t x, int n) {
+    return (x << n) | (x >> (32 - n));
+}
+
+static void sha1(const uint8_t* data, size_t len, uint8_t digest[20]) {
+    uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+
+    // Mensagem + 0x80 + zeros + comprimento em bits (big-endian, 64 bits)
+    std::vector<uint8_t> msg(data, data + len);
+    msg.push_back(0x80);
+    while (msg.size() % 64 != 56) msg.push_back(0);
+    uint64_t bits = static_cast<uint64_t>(len) * 8;
+    for (int i = 7; i >= 0; i--) msg.push_back(static_cast<uint8_t>(bits >> (i * 8)));
+
+    uint32_t w[80];
+    for (size_t block = 0; block < msg.size(); block += 64) {
+        for (int i = 0; i < 16; i++) {
+            const uint8_t* p = &msg[block + i * 4];
+            w[i] = (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+        }
+        for (int i = 16; i < 80; i++) w[i] = rotl32(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; i++) {
+            uint32_t f, k;
+            if (i < 20)      { f = (b & c) | (~b & d);           k = 0x5A827999; }
+            else if (i < 40) { f = b ^ c ^ d;                    k = 0x6ED9EBA1; }
+            else if (i < 60) { f = (b & c) | (b & d) | (c & d);  k = 0x8F1BBCDC; }
+            else             { f = b ^ c ^ d;                    k = 0xCA62C1D6; }
+            uint32_t temp = rotl32(a, 5) + f + e + k + w[i];
+            e = d; d = c; c = rotl32(b, 30); b = a; a = temp;
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+    }
+
+    for (int i = 0; i < 5; i++) {
+        digest[i * 4] = static_cast<uint8_t>(h[i] >> 24);
+        digest[i * 4 + 1] = static_cast<uint8_t>(h[i] >> 16);
+        digest[i * 4 + 2] = static_cast<uint8_t>(h[i] >> 8);
+        digest[i * 4 + 3] = static_cast<uint8_t>(h[i]);
+    }
+}
+
+// ============ Estruturas internas ============
+
+// Mensagem pronta para o fio: cabeçalhos WebSocket de cada fragmento e
+// fatias do payload compartilhado, na ordem de envio (para writev/WSASend)
+struct WebSocketServer::OutFrame {
+    struct Piece {
+        const uint8_t* data;
+        size_t len;
+    };
+
+    Payload payload;
+    std::vector<uint8_t> headers;
+    std::vector<Piece> pieces;
+    size_t total = 0;
+};
+
+static const size_t MAX_GATHER = 64;   // Fatias por chamada de writev/WSASend
+
+struct WebSocketServer::Client {
+    // Mensagem pronta para envio; o frame é compartilhado entre os clientes
+    struct Message {
+        FramePtr frame;
+        StreamKind kind;
+        std::chrono::steady_clock::time_point queued_at;
+    };
+
+    socket_t fd;
+    size_t loop;
+    uint32_t id;
+    std::string address;
+    std::atomic<bool> open;        // Handshake concluído
+    std::atomic<bool> closing;     // Fechar assim que possível (erro, close frame ou política)
+    std::atomic<uint32_t> group;
+
+    // Só a thread de I/O dona do cliente mexe aqui
+    std::vector<uint8_t> in;
+    std::vector<uint8_t> message;  // Fragmentos da mensagem em montagem
+    uint8_t message_opcode;
+
+    // Fila de saída: broadcast (thread de DSP) e I/O disputam sob out_mutex
+    std::mutex out_mutex;
+    std::deque<Message> queue;
+    size_t head_offset;            // Bytes de queue.front() já enviados
+    size_t queued_bytes;
+    bool want_write;               // Interesse de escrita armado no poller
+    bool in_ready;                 // Já está na lista de prontos da thread de I/O
+
+    // Métricas (sob out_mutex)
+    size_t max_queued;
+    uint64_t sent_messages;
+    uint64_t sent_bytes;
+    uint64_t dropped;
+    uint64_t coalesced;
+
+    Client(socket_t s, size_t l, uint32_t client_id)
+        : fd(s), loop(l), id(client_id), open(false), closing(false), group(0), message_opcode(0),
+          head_offset(0), queued_bytes(0), want_write(false), in_ready(false),
+          max_queued(0), sent_messages(0), sent_bytes(0), dropped(0), coalesced(0) {}
+};
+
+struct WebSocketServer::IOLoop {
+    std::thread thread;
+    // Clientes com fila nova para drenar (marcados por enqueue)
+    std::mutex ready_mutex;
+    std::vector<Client*> ready;
+    std::vector<Client*> draining;  // Cópia local usada pela thread de I/O
+#ifdef SPEEDSDR_EPOLL
+    int epoll_fd = -1;
+    int wake_fd = -1;              // eventfd: acorda o epoll_wait (fila nova ou stop())
+#endif
+};
+
+// ============ WebSocketServer Implementation ============
+
+WebSocketServer::WebSocketServer(int p, int io_threads)
+    : port(p),
+      num_loops(std::max(io_threads, 1)),
+      serverSocket(INVALID_SOCKET),
+      running(false),
+      nextLoop(0),
+      nextClientId(1),
+      maxFragment(1 << 20) {
+#ifdef _WIN32
     WSADATA wsaData;
     WSAStartup(MAKEWORD(2, 2), &wsaData);
+#endif
 }
 
 WebSocketServer::~WebSocketServer() {
-    running = false;
-    closesocket(serverSocket);
+    stop();
+#ifdef _WIN32
     WSACleanup();
+#endif
 }
 
 void WebSocketServer::setOnMessage(std::function<void(std::string)> callback) {
     onMessageCallback = callback;
 }
 
+void WebSocketServer::setOnClientMessage(std::function<void(uint32_t, std::string)> callback) {
+    onClientMessageCallback = callback;
+}
+
+void WebSocketServer::setOnConnect(std::function<void(uint32_t, std::string)> callback) {
+    onConnectCallback = callback;
+}
+
+void WebSocketServer::setHttpHandler(std::function<bool(const std::string&, std::string&)> handler) {
+    httpHandler = handler;
+}
+
+bool WebSocketServer::setClientGroup(uint32_t client_id, uint32_t group) {
+    std::lock_guard<std::mutex> lock(clientMutex);
+    for (auto& c : clients) {
+        if (c->id != client_id) continue;
+        c->group = group;
+        return true;
+    }
+    return false;
+}
+
+size_t WebSocketServer::numClientsInGroup(uint32_t group) const {
+    std::lock_guard<std::mutex> lock(clientMutex);
+    size_t count = 0;
+    for (const auto& c : clients) {
+        if (c->open && c->group == group) count++;
+    }
+    return count;
+}
+
+void WebSocketServer::setMaxFragmentSize(size_t bytes) {
+    maxFragment = bytes;
+}
+
+void WebSocketServer::setSendQueueLimits(const SendQueueLimits& l) {
+    std::lock_guard<std::mutex> lock(clientMutex);
+    limits = l;
+    limits.max_messages = std::max<size_t>(limits.max_messages, 1);
+}
+
+size_t WebSocketServer::numClients() const {
+    std::lock_guard<std::mutex> lock(clientMutex);
+    size_t count = 0;
+    for (const auto& c : clients) {
+        if (c->open) count++;
+    }
+    return count;
+}
+
+std::vector<ClientStats> WebSocketServer::getClientStats() const {
+    std::vector<ClientStats> result;
+    auto now = std::chrono::steady_clock::now();
+
+    std::lock_guard<std::mutex> lock(clientMutex);
+    for (const auto& c : clients) {
+        if (!c->open) continue;
+        std::lock_guard<std::mutex> out_lock(c->out_mutex);
+        ClientStats st;
+        st.id = c->id;
+        st.address = c->address;
+        st.queued_messages = c->queue.size();
+        st.queued_bytes = c->queued_bytes;
+        st.max_queued_messages = c->max_queued;
+        st.lag_ms = c->queue.empty() ? 0.0
+            : std::chrono::duration<double, std::milli>(now - c->queue.front().queued_at).count();
+        st.sent_messages = c->sent_messages;
+        st.sent_bytes = c->sent_bytes;
+        st.dropped = c->dropped;
+        st.coalesced = c->coalesced;
+        st.group = c->group;
+        result.push_back(st);
+    }
+    return result;
+}
+
 void WebSocketServer::start() {
     struct addrinfo* result = NULL;
     struct addrinfo hints;
 
-    ZeroMemory(&hints, sizeof(hints));
+    memset(&hints, 0, sizeof(hints));
     hints.ai_family = AF_INET;
     hints.ai_socktype = SOCK_STREAM;
     hints.ai_protocol = IPPROTO_TCP;
     hints.ai_flags = AI_PASSIVE;
 
     std::string portStr = std::to_string(port);
-    getaddrinfo(NULL, portStr.c_str(), &hints, &result);
+    if (getaddrinfo(NULL, portStr.c_str(), &hints, &result) != 0 || !result) {
+        std::cerr << "[WebSocket] getaddrinfo falhou\n";
+        return;
+    }
 
     serverSocket = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
-    bind(serverSocket, result->ai_addr, (int)result->ai_addrlen);
+    if (serverSocket == INVALID_SOCKET) {
+        freeaddrinfo(result);
+        std::cerr << "[WebSocket] Falha ao criar socket\n";
+        return;
+    }
+
+    int yes = 1;
+    setsockopt(serverSocket, SOL_SOCKET, SO_REUSEADDR, (const char*)&yes, sizeof(yes));
+
+    if (bind(serverSocket, result->ai_addr, (int)result->ai_addrlen) == SOCKET_ERROR ||
+        listen(serverSocket, SOMAXCONN) == SOCKET_ERROR) {
+        freeaddrinfo(result);
+        closesocket(serverSocket);
+        serverSocket = INVALID_SOCKET;
+        std::cerr << "[WebSocket] Falha no bind (porta " << port << " ocupada?)\n";
+        return;
+    }
     freeaddrinfo(result);
+    setNonBlocking(serverSocket);
 
-    listen(serverSocket, SOMAXCONN);
     running = true;
+    for (int i = 0; i < num_loops; i++) {
+        std::unique_ptr<IOLoop> loop(new IOLoop());
+#ifdef SPEEDSDR_EPOLL
+        loop->epoll_fd = epoll_create1(0);
+        loop->wake_fd = eventfd(0, EFD_NONBLOCK);
+        epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.ptr = loop.get();
+        epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, loop->wake_fd, &ev);
+        if (i == 0) {
+            ev.data.ptr = nullptr;     // nullptr = socket de escuta
+            epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, serverSocket, &ev);
+        }
+#endif
+        loops.push_back(std::move(loop));
+    }
+    loopsToWake.assign(loops.size(), false);
+    for (int i = 0; i < num_loops; i++) {
+        loops[i]->thread = std::thread(&WebSocketServer::ioLoop, this, static_cast<size_t>(i));
+    }
+
+    std::cout << "Servidor WebSocket iniciado na porta " << port
+              << " (" << num_loops << " threads de I/O)" << std::endl;
+}
 
-    std::cout << "Servidor WebSocket iniciado na porta " << port << std::endl;
-    std::thread(&WebSocketServer::acceptLoop, this).detach();
+void WebSocketServer::stop() {
+    if (!running.exchange(false)) return;
+
+    for (size_t i = 0; i < loops.size(); i++) {
+        wakeLoop(i);
+        if (loops[i]->thread.joinable()) loops[i]->thread.join();
+    }
+
+    std::lock_guard<std::mutex> lock(clientMutex);
+    for (auto& c : clients) closesocket(c->fd);
+    clients.clear();
+#ifdef SPEEDSDR_EPOLL
+    for (auto& loop : loops) {
+        close(loop->epoll_fd);
+        close(loop->wake_fd);
+    }
+#endif
+    loops.clear();
+    if (serverSocket != INVALID_SOCKET) {
+        closesocket(serverSocket);
+        serverSocket = INVALID_SOCKET;
+    }
+}
+
+void WebSocketServer::wakeLoop(size_t index) {
+#ifdef SPEEDSDR_EPOLL
+    uint64_t one = 1;
+    if (write(loops[index]->wake_fd, &one, sizeof(one)) < 0) {}
+#else
+    (void)index;   // poll() acorda sozinho pelo timeout curto
+#endif
 }
 
-void WebSocketServer::acceptLoop() {
+void WebSocketServer::ioLoop(size_t index) {
+    IOLoop& loop = *loops[index];
+#ifdef SPEEDSDR_EPOLL
+    epoll_event events[64];
+
     while (running) {
-        SOCKET clientSocket = accept(serverSocket, NULL, NULL);
-        if (clientSocket != INVALID_SOCKET) {
-            std::thread(&WebSocketServer::handleClient, this, clientSocket).detach();
+        int n = epoll_wait(loop.epoll_fd, events, 64, 500);
+        for (int i = 0; i < n; i++) {
+            void* tag = events[i].data.ptr;
+            if (tag == nullptr) {
+                acceptClients();
+                continue;
+            }
+            if (tag == &loop) {
+                uint64_t count;
+                if (read(loop.wake_fd, &count, sizeof(count)) < 0) {}
+                continue;
+            }
+
+            uint32_t ev = events[i].events;
+            serviceClient(*static_cast<Client*>(tag),
+                          (ev & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) != 0,
+                          (ev & EPOLLOUT) != 0);
+        }
+        flushReady(loop);
+    }
+#else
+    // poll()/WSAPoll: o conjunto é remontado a cada volta; o timeout curto
+    // faz as filas novas e as mudanças de interesse valerem rapidamente
+    std::vector<pollfd> fds;
+    std::vector<Client*> owners;
+
+    while (running) {
+        flushReady(loop);
+
+        fds.clear();
+        owners.clear();
+        if (index == 0) {
+            pollfd p;
+            p.fd = serverSocket;
+            p.events = POLLIN;
+            p.revents = 0;
+            fds.push_back(p);
+            owners.push_back(nullptr);
+        }
+        {
+            std::lock_guard<std::mutex> lock(clientMutex);
+            for (auto& c : clients) {
+                if (c->loop != index) continue;
+                pollfd p;
+                p.fd = c->fd;
+                p.events = POLLIN;
+                {
+                    std::lock_guard<std::mutex> out_lock(c->out_mutex);
+                    if (c->want_write) p.events |= POLLOUT;
+                }
+                p.revents = 0;
+                fds.push_back(p);
+                owners.push_back(c.get());
+            }
+        }
+        if (fds.empty()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+
+        int n = poll(fds.data(), static_cast<unsigned long>(fds.size()), 10);
+        if (n <= 0) continue;
+
+        for (size_t i = 0; i < fds.size(); i++) {
+            if (fds[i].revents == 0) continue;
+            if (!owners[i]) {
+                acceptClients();
+                continue;
+            }
+            serviceClient(*owners[i],
+                          (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) != 0,
+                          (fds[i].revents & POLLOUT) != 0);
         }
     }
+#endif
 }
 
-std::string WebSocketServer::base64_encode(const unsigned char* input, int length) {
-    static const char* kBase64 = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-    std::string output;
-    int val = 0, valb = -6;
-    for (int i = 0; i < length; ++i) {
-        val = (val << 8) + input[i];
-        valb += 8;
-        while (valb >= 0) {
-            output.push_back(kBase64[(val >> valb) & 0x3F]);
-            valb -= 6;
+void WebSocketServer::flushReady(IOLoop& loop) {
+    {
+        std::lock_guard<std::mutex> lock(loop.ready_mutex);
+        loop.draining.swap(loop.ready);
+    }
+    // Só esta thread fecha seus clientes: os ponteiros da lista seguem válidos
+    for (Client* client : loop.draining) {
+        {
+            std::lock_guard<std::mutex> lock(client->out_mutex);
+            client->in_ready = false;
         }
+        serviceClient(*client, false, true);
     }
-    if (valb > -6) output.push_back(kBase64[((val << 8) >> (valb + 8)) & 0x3F]);
-    while (output.size() % 4) output.push_back('=');
-    return output;
+    loop.draining.clear();
+}
+
+void WebSocketServer::serviceClient(Client& client, bool readable, bool writable) {
+    if (readable && !handleReadable(client)) {
+        closeClient(client);
+        return;
+    }
+    if (writable) flushClient(client);
+
+    if (client.closing) {
+        // Deixa sair o que falta (ex.: close frame) antes de fechar
+        {
+            std::lock_guard<std::mutex> lock(client.out_mutex);
+            if (!client.queue.empty()) return;
+        }
+        closeClient(client);
+    }
+}
+
+void WebSocketServer::acceptClients() {
+    while (running) {
+        sockaddr_in peer;
+        socklen_t peer_len = sizeof(peer);
+        socket_t s = accept(serverSocket, (sockaddr*)&peer, &peer_len);
+        if (s == INVALID_SOCKET) return;   // Sem mais conexões pendentes
+
+        setNonBlocking(s);
+        int yes = 1;
+        setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (const char*)&yes, sizeof(yes));
+
+        char host[INET_ADDRSTRLEN] = "?";
+        inet_ntop(AF_INET, &peer.sin_addr, host, sizeof(host));
+
+        std::lock_guard<std::mutex> lock(clientMutex);
+        size_t loop = nextLoop++ % loops.size();
+        clients.emplace_back(new Client(s, loop, nextClientId++));
+        clients.back()->address = std::string(host) + ":" + std::to_string(ntohs(peer.sin_port));
+#ifdef SPEEDSDR_EPOLL
+        epoll_event ev;
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.ptr = clients.back().get();
+        epoll_ctl(loops[loop]->epoll_fd, EPOLL_CTL_ADD, s, &ev);
+#endif
+    }
+}
+
+void WebSocketServer::closeClient(Client& client) {
+#ifdef SPEEDSDR_EPOLL
+    epoll_ctl(loops[client.loop]->epoll_fd, EPOLL_CTL_DEL, client.fd, NULL);
+#endif
+    Client* target = &client;
+
+    // Tudo sob clientMutex: broadcastFrame/sendText (threads de DSP e de I/O)
+    // percorrem a lista com ele travado e não podem enfileirar num cliente
+    // sendo destruído. Marcado como fechando, enqueue() também o ignora.
+    std::lock_guard<std::mutex> lock(clientMutex);
+    {
+        std::lock_guard<std::mutex> out_lock(client.out_mutex);
+        client.closing = true;
+    }
+    {
+        IOLoop& loop = *loops[client.loop];
+        std::lock_guard<std::mutex> ready_lock(loop.ready_mutex);
+        loop.ready.erase(std::remove(loop.ready.begin(), loop.ready.end(), target), loop.ready.end());
+    }
+
+    if (client.open) {
+        std::cout << "Cliente " << client.id << " (" << client.address << ") desconectado";
+        if (client.dropped > 0) std::cout << ", " << client.dropped << " mensagens descartadas";
+        std::cout << std::endl;
+    }
+    closesocket(client.fd);
+    clients.erase(std::remove_if(clients.begin(), clients.end(),
+                                 [target](const std::unique_ptr<Client>& c) { return c.get() == target; }),
+                  clients.end());
 }
 
-bool WebSocketServer::handshake(SOCKET clientSocket) {
-    char buffer[4096];
-    int bytesReceived = recv(clientSocket, buffer, 4096, 0);
-    if (bytesReceived <= 0) return false;
+bool WebSocketServer::handleReadable(Client& client) {
+    uint8_t buffer[16384];
+    while (true) {
+        int bytesReceived = recv(client.fd, (char*)buffer, sizeof(buffer), 0);
+        if (bytesReceived > 0) {
+            client.in.insert(client.in.end(), buffer, buffer + bytesReceived);
+            continue;
+        }
+        if (bytesReceived < 0 && wouldBlock()) break;
+        return false;   // Fechado pelo cliente ou erro
+    }
+
+    if (!client.open && !handshake(client)) return true;
+    parseFrames(client);
+    return true;
+}
+
+bool WebSocketServer::handshake(Client& client) {
+    static const char terminator[] = "\r\n\r\n";
+    auto end = std::search(client.in.begin(), client.in.end(), terminator, terminator + 4);
+    if (end == client.in.end()) {
+        if (client.in.size() > MAX_HANDSHAKE_BYTES) client.closing = true;
+        return false;   // Cabeçalho ainda incompleto
+    }
 
-    std::string request(buffer, bytesReceived);
-    std::string keyHeader = "Sec-WebSocket-Key: ";
-    size_t keyStart = request.find(keyHeader);
-    
-    if (keyStart == std::string::npos) return false;
+    std::string request(client.in.begin(), end + 4);
+    client.in.erase(client.in.begin(), end + 4);
+
+    // Alvo da requisição: "GET /?audio=adpcm HTTP/1.1"
+    std::string target;
+    size_t targetStart = request.find(' ');
+    if (targetStart != std::string::npos) {
+        size_t targetEnd = request.find(' ', targetStart + 1);
+        if (targetEnd != std::string::npos) target = request.substr(targetStart + 1, targetEnd - targetStart - 1);
+    }
+
+    // Nome do cabeçalho não diferencia maiúsculas
+    std::string lower(request);
+    std::transform(lower.begin(), lower.end(), lower.begin(),
+                   [](unsigned char ch) { return static_cast<char>(std::tolower(ch)); });
+    std::string keyHeader = "sec-websocket-key:";
+    size_t keyStart = lower.find(keyHeader);
+
+    if (keyStart == std::string::npos) {
+        // HTTP simples (ex.: /metrics): responde e fecha
+        std::string body;
+        if (httpHandler && request.compare(0, 4, "GET ") == 0 && httpHandler(target, body)) {
+            sendControl(client, buildRaw("HTTP/1.1 200 OK\r\n"
+                                         "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                                         "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                                         "Connection: close\r\n\r\n" + body));
+        } else if (httpHandler) {
+            sendControl(client, buildRaw("HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n"));
+        }
+        client.closing = true;
+        return false;
+    }
 
     keyStart += keyHeader.length();
     size_t keyEnd = request.find("\r\n", keyStart);
     std::string clientKey = request.substr(keyStart, keyEnd - keyStart);
+    clientKey.erase(0, clientKey.find_first_not_of(" \t"));
+    clientKey.erase(clientKey.find_last_not_of(" \t") + 1);
 
     std::string magic = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
     std::string combined = clientKey + magic;
 
-    HCRYPTPROV hProv = 0;
-    HCRYPTHASH hHash = 0;
-    DWORD hashLen = 20;
-    BYTE hash[20];
-    
-    // Estas funções precisam de Advapi32.lib
-    if(CryptAcquireContext(&hProv, NULL, NULL, PROV_RSA_FULL, CRYPT_VERIFYCONTEXT)) {
-        CryptCreateHash(hProv, CALG_SHA1, 0, 0, &hHash);
-        CryptHashData(hHash, (BYTE*)combined.c_str(), combined.length(), 0);
-        CryptGetHashParam(hHash, HP_HASHVAL, hash, &hashLen, 0);
-        CryptDestroyHash(hHash);
-        CryptReleaseContext(hProv, 0);
-    }
-
+    uint8_t hash[20];
+    sha1(reinterpret_cast<const uint8_t*>(combined.data()), combined.size(), hash);
     std::string acceptKey = base64_encode(hash, 20);
 
-    std::string response = 
+    std::string response =
         "HTTP/1.1 101 Switching Protocols\r\n"
         "Upgrade: websocket\r\n"
         "Connection: Upgrade\r\n"
         "Sec-WebSocket-Accept: " + acceptKey + "\r\n\r\n";
 
-    send(clientSocket, response.c_str(), response.length(), 0);
+    sendControl(client, buildRaw(response));
+    if (onConnectCallback) onConnectCallback(client.id, target);
+
+    client.open = true;
+    std::cout << "Cliente conectado!" << std::endl;
     return true;
 }
 
-void WebSocketServer::handleClient(SOCKET clientSocket) {
-    if (!handshake(clientSocket)) {
-        closesocket(clientSocket);
-        return;
+void WebSocketServer::parseFrames(Client& client) {
+    std::vector<uint8_t>& in = client.in;
+    size_t pos = 0;
+
+    while (in.size() - pos >= 2) {
+        const uint8_t* p = &in[pos];
+        bool fin = (p[0] & 0x80) != 0;
+        uint8_t opcode = p[0] & 0x0F;
+        bool masked = (p[1] & 0x80) != 0;
+        uint64_t len = p[1] & 0x7F;
+        size_t header = 2;
+
+        if (len == 126) {
+            if (in.size() - pos < 4) break;
+            len = (uint64_t(p[2]) << 8) | p[3];
+            header = 4;
+        } else if (len == 127) {
+            if (in.size() - pos < 10) break;
+            len = 0;
+            for (int i = 0; i < 8; i++) len = (len << 8) | p[2 + i];
+            header = 10;
+        }
+        if (len > MAX_MESSAGE_BYTES) {
+            client.closing = true;
+            return;
+        }
+
+        size_t mask_at = header;
+        if (masked) header += 4;
+        if (in.size() - pos < header + len) break;   // Frame incompleto
+
+        uint8_t* payload = &in[pos + header];
+        if (masked) {
+            const uint8_t* mask = &in[pos + mask_at];
+            for (size_t i = 0; i < len; i++) payload[i] ^= mask[i & 3];
+        }
+
+        if (opcode == 0x8) {
+            // Close: responde e encerra
+            sendControl(client, buildFrame(0x8, nullptr, 0));
+            client.closing = true;
+            return;
+        } else if (opcode == 0x9) {
+            // Ping -> pong com o mesmo payload
+            sendControl(client, buildFrame(0xA, payload, static_cast<size_t>(len)));
+        } else if (opcode <= 0x2) {
+            if (opcode != 0x0) {
+                client.message_opcode = opcode;
+                client.message.clear();
+            }
+            if (client.message.size() + len > MAX_MESSAGE_BYTES) {
+                client.closing = true;
+                return;
+            }
+            client.message.insert(client.message.end(), payload, payload + len);
+
+            if (fin) {
+                if (!client.message.empty()) {
+                    std::string text(client.message.begin(), client.message.end());
+                    if (onClientMessageCallback) onClientMessageCallback(client.id, text);
+                    if (onMessageCallback) onMessageCallback(text);
+                }
+                client.message.clear();
+            }
+        }
+
+        pos += header + static_cast<size_t>(len);
+    }
+
+    in.erase(in.begin(), in.begin() + pos);
+}
+
+void WebSocketServer::setWriteInterest(Client& client, bool enabled) {
+    // Chamar com client.out_mutex travado
+    if (client.want_write == enabled) return;
+    client.want_write = enabled;
+#ifdef SPEEDSDR_EPOLL
+    epoll_event ev;
+    ev.events = EPOLLIN | EPOLLRDHUP | (enabled ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+    ev.data.ptr = &client;
+    epoll_ctl(loops[client.loop]->epoll_fd, EPOLL_CTL_MOD, client.fd, &ev);
+#endif
+}
+
+bool WebSocketServer::enqueue(Client& client, const FramePtr& frame, StreamKind kind) {
+    // Chamar com client.out_mutex travado. Retorna true se o cliente
+    // precisa entrar na lista de prontos da sua thread de I/O.
+    if (client.closing) return false;
+
+    const size_t len = frame->total;
+    const size_t first_free = client.head_offset > 0 ? 1 : 0;   // A cabeça parcial não pode sair
+
+    auto policyFor = [&](StreamKind k) {
+        if (k == StreamKind::AUDIO) return limits.audio;
+        if (k == StreamKind::SPECTRUM) return limits.spectrum;
+        return limits.data;
+    };
+    const DropPolicy policy = policyFor(kind);
+
+    if (kind != StreamKind::CONTROL) {
+        // COALESCE: se já há uma do mesmo tipo esperando, só troca o conteúdo
+        if (policy == DropPolicy::COALESCE) {
+            for (size_t i = client.queue.size(); i > first_free; i--) {
+                Client::Message& m = client.queue[i - 1];
+                if (m.kind != kind) continue;
+                client.queued_bytes = client.queued_bytes - m.frame->total + len;
+                m.frame = frame;
+                client.coalesced++;
+                return false;
+            }
+        }
+
+        auto full = [&]() {
+            return client.queue.size() >= limits.max_messages ||
+                   client.queued_bytes + len > limits.max_bytes;
+        };
+
+        if (full() && policy == DropPolicy::DISCONNECT) {
+            // A fila cheia pode ser de áudio/espectro que já seriam descartados:
+            // abre espaço com eles (mais antigos primeiro) antes de derrubar o
+            // cliente, senão um ouvinte lento tolerado cai na próxima mensagem DATA
+            for (size_t i = first_free; i < client.queue.size() && full();) {
+                const StreamKind k = client.queue[i].kind;
+                if (k == StreamKind::CONTROL || policyFor(k) == DropPolicy::DISCONNECT) {
+                    i++;
+                    continue;
+                }
+                client.queued_bytes -= client.queue[i].frame->total;
+                client.queue.erase(client.queue.begin() + i);
+                client.dropped++;
+            }
+        }
+
+        if (full()) {
+            if (policy == DropPolicy::DISCONNECT) {
+                std::cout << "Cliente " << client.id << " (" << client.address
+                          << ") desconectado: fila de saida cheia" << std::endl;
+                client.closing = true;
+                shutdown(client.fd, 2);   // A thread de I/O vê o fechamento e limpa
+                return false;
+            }
+            if (policy == DropPolicy::DROP_OLDEST) {
+                for (size_t i = first_free; i < client.queue.size() && full();) {
+                    if (client.queue[i].kind != kind) {
+                        i++;
+                        continue;
+                    }
+                    client.queued_bytes -= client.queue[i].frame->total;
+                    client.queue.erase(client.queue.begin() + i);
+                    client.dropped++;
+                }
+            }
+            if (full()) {
+                client.dropped++;   // Nada do mesmo tipo para abrir espaço: descarta a nova
+                return false;
+            }
+        }
     }
 
+    Client::Message m;
+    m.frame = frame;
+    m.kind = kind;
+    m.queued_at = std::chrono::steady_clock::now();
+    client.queue.push_back(std::move(m));
+    client.queued_bytes += len;
+    client.max_queued = std::max(client.max_queued, client.queue.size());
+
+    if (client.in_ready || client.want_write) return false;   // Já será drenado
+    client.in_ready = true;
+    return true;
+}
+
+void WebSocketServer::sendControl(Client& client, const FramePtr& frame) {
+    // Na própria thread de I/O: enfileira e tenta enviar já
     {
-        std::lock_guard<std::mutex> lock(clientMutex);
-        clients.push_back(clientSocket);
-        std::cout << "Cliente conectado!" << std::endl;
+        std::lock_guard<std::mutex> lock(client.out_mutex);
+        if (enqueue(client, frame, StreamKind::CONTROL)) client.in_ready = false;
     }
+    flushClient(client);
+}
 
-    char buffer[4096];
-    while (running) {
-        int bytesReceived = recv(clientSocket, buffer, 4096, 0);
-        if (bytesReceived <= 0) break;
-        
-        uint8_t opcode = buffer[0] & 0x0F;
-        if (opcode == 8) break; 
+void WebSocketServer::flushClient(Client& client) {
+    std::lock_guard<std::mutex> lock(client.out_mutex);
+    while (!client.queue.empty()) {
+        // Junta cabeçalhos e payloads de várias mensagens numa só chamada
+#ifdef _WIN32
+        WSABUF iov[MAX_GATHER];
+#else
+        iovec iov[MAX_GATHER];
+#endif
+        size_t count = 0;
+        size_t skip = client.head_offset;
+        for (size_t m = 0; m < client.queue.size() && count < MAX_GATHER; m++) {
+            for (const OutFrame::Piece& piece : client.queue[m].frame->pieces) {
+                if (skip >= piece.len) {
+                    skip -= piece.len;
+                    continue;
+                }
+                if (count == MAX_GATHER) break;
+#ifdef _WIN32
+                iov[count].buf = (char*)(piece.data + skip);
+                iov[count].len = static_cast<ULONG>(piece.len - skip);
+#else
+                iov[count].iov_base = const_cast<uint8_t*>(piece.data + skip);
+                iov[count].iov_len = piece.len - skip;
+#endif
+                count++;
+                skip = 0;
+            }
+        }
 
-        uint8_t lenByte = buffer[1] & 0x7F;
-        int payloadStart = 2;
-        if (lenByte == 126) payloadStart = 4;
-        
-        uint8_t mask[4];
-        memcpy(mask, buffer + payloadStart, 4);
-        payloadStart += 4;
+        long sent;
+        uint64_t write_start = monotonicNs();
+#ifdef _WIN32
+        DWORD bytes = 0;
+        sent = WSASend(client.fd, iov, static_cast<DWORD>(count), &bytes, 0, NULL, NULL) == 0
+            ? static_cast<long>(bytes) : -1;
+#else
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = count;
+        sent = static_cast<long>(sendmsg(client.fd, &msg, SEND_FLAGS));
+#endif
+        uint64_t write_end = writeLatency.recordSince(write_start);
+        if (sent < 0 && wouldBlock()) {
+            setWriteInterest(client, true);   // Socket cheio: espera EPOLLOUT
+            return;
+        }
+        if (sent <= 0) {
+            client.closing = true;
+            client.queue.clear();
+            client.queued_bytes = 0;
+            client.head_offset = 0;
+            return;
+        }
 
-        std::string message;
-        for (int i = 0; i < lenByte && (payloadStart + i) < bytesReceived; i++) {
-            message += (char)(buffer[payloadStart + i] ^ mask[i % 4]);
+        // Avança sobre as mensagens completas
+        size_t advance = static_cast<size_t>(sent);
+        client.sent_bytes += advance;
+        while (advance > 0) {
+            size_t remaining = client.queue.front().frame->total - client.head_offset;
+            if (advance < remaining) {
+                client.head_offset += advance;
+                break;
+            }
+            advance -= remaining;
+            client.queued_bytes -= client.queue.front().frame->total;
+            queueLatency.record(write_end - static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                client.queue.front().queued_at.time_since_epoch()).count()));
+            client.queue.pop_front();
+            client.head_offset = 0;
+            client.sent_messages++;
         }
+    }
+    setWriteInterest(client, false);
+}
 
-        if (onMessageCallback && !message.empty()) {
-            onMessageCallback(message);
+std::string WebSocketServer::base64_encode(const unsigned char* input, int length) {
+    static const char* kBase64 = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string output;
+    int val = 0, valb = -6;
+    for (int i = 0; i < length; ++i) {
+        val = (val << 8) + input[i];
+        valb += 8;
+        while (valb >= 0) {
+            output.push_back(kBase64[(val >> valb) & 0x3F]);
+            valb -= 6;
         }
     }
+    if (valb > -6) output.push_back(kBase64[((val << 8) >> (valb + 8)) & 0x3F]);
+    while (output.size() % 4) output.push_back('=');
+    return output;
+}
 
-    {
-        std::lock_guard<std::mutex> lock(clientMutex);
-        clients.erase(std::remove(clients.begin(), clients.end(), clientSocket), clients.end());
+static size_t writeHeader(uint8_t* out, uint8_t first, uint64_t len) {
+    out[0] = first;
+    if (len <= 125) {
+        out[1] = static_cast<uint8_t>(len);
+        return 2;
+    }
+    if (len <= 65535) {
+        out[1] = 126;
+        out[2] = (len >> 8) & 0xFF;
+        out[3] = len & 0xFF;
+        return 4;
     }
-    closesocket(clientSocket);
-    std::cout << "Cliente desconectado." << std::endl;
+    // Forma de 64 bits (bit mais alto sempre zero)
+    out[1] = 127;
+    for (int i = 0; i < 8; i++) out[2 + i] = static_cast<uint8_t>(len >> (56 - 8 * i));
+    return 10;
 }
 
-void WebSocketServer::broadcast(const std::vector<uint8_t>& data) {
-    std::lock_guard<std::mutex> lock(clientMutex);
-    for (SOCKET client : clients) {
-        sendFrame(client, data, true);
+WebSocketServer::FramePtr WebSocketServer::buildFrame(uint8_t opcode, const Payload& payload, size_t max_fragment) {
+    std::shared_ptr<OutFrame> frame = std::make_shared<OutFrame>();
+    frame->payload = payload;
+
+    const size_t len = payload ? payload->size() : 0;
+    const size_t fragment = (max_fragment == 0 || len == 0) ? std::max<size_t>(len, 1) : max_fragment;
+    const size_t num_fragments = len == 0 ? 1 : (len + fragment - 1) / fragment;
+
+    // Primeiro fragmento leva o opcode, os outros são continuação (0x0);
+    // FIN só no último
+    frame->headers.resize(num_fragments * 10);
+    std::vector<size_t> header_len(num_fragments);
+    for (size_t f = 0; f < num_fragments; f++) {
+        size_t chunk = std::min(fragment, len - std::min(len, f * fragment));
+        uint8_t first = (f == 0 ? opcode : 0x0) | (f + 1 == num_fragments ? 0x80 : 0x00);
+        header_len[f] = writeHeader(&frame->headers[f * 10], first, chunk);
     }
+
+    // Ponteiros só depois de headers ter o tamanho final
+    for (size_t f = 0; f < num_fragments; f++) {
+        size_t offset = f * fragment;
+        size_t chunk = std::min(fragment, len - std::min(len, offset));
+        frame->pieces.push_back({ &frame->headers[f * 10], header_len[f] });
+        if (chunk > 0) frame->pieces.push_back({ payload->data() + offset, chunk });
+        frame->total += header_len[f] + chunk;
+    }
+    return frame;
+}
+
+WebSocketServer::FramePtr WebSocketServer::buildFrame(uint8_t opcode, const uint8_t* data, size_t len, size_t max_fragment) {
+    Payload payload = std::make_shared<const std::vector<uint8_t>>(data, data + len);
+    return buildFrame(opcode, payload, max_fragment);
 }
 
-void WebSocketServer::sendFrame(SOCKET client, const std::vector<uint8_t>& data, bool isBinary) {
-    std::vector<uint8_t> frame;
-    frame.push_back(isBinary ? 0x82 : 0x81);
+WebSocketServer::FramePtr WebSocketServer::buildRaw(const std::string& bytes) {
+    std::shared_ptr<OutFrame> frame = std::make_shared<OutFrame>();
+    frame->payload = std::make_shared<const std::vector<uint8_t>>(bytes.begin(), bytes.end());
+    frame->pieces.push_back({ frame->payload->data(), frame->payload->size() });
+    frame->total = frame->payload->size();
+    return frame;
+}
 
-    if (data.size() <= 125) {
-        frame.push_back((uint8_t)data.size());
-    } else if (data.size() <= 65535) {
-        frame.push_back(126);
-        frame.push_back((data.size() >> 8) & 0xFF);
-        frame.push_back(data.size() & 0xFF);
-    } else {
-        return; 
+void WebSocketServer::broadcastFrame(const FramePtr& frame, StreamKind kind, uint32_t group) {
+    std::lock_guard<std::mutex> lock(clientMutex);
+    for (auto& c : clients) {
+        if (!c->open || c->closing) continue;
+        if (group != ALL_GROUPS && c->group != group) continue;
+        bool ready;
+        {
+            std::lock_guard<std::mutex> out_lock(c->out_mutex);
+            ready = enqueue(*c, frame, kind);
+        }
+        if (ready) {
+            IOLoop& loop = *loops[c->loop];
+            std::lock_guard<std::mutex> ready_lock(loop.ready_mutex);
+            loop.ready.push_back(c.get());
+            loopsToWake[c->loop] = true;
+        }
     }
 
-    frame.insert(frame.end(), data.begin(), data.end());
-    send(client, (char*)frame.data(), frame.size(), 0);
-}
\ No newline at end of file
+    // Um único despertar por thread de I/O, não por cliente
+    for (size_t i = 0; i < loopsToWake.size(); i++) {
+        if (!loopsToWake[i]) continue;
+        loopsToWake[i] = false;
+        wakeLoop(i);
+    }
+}
+
+void WebSocketServer::broadcast(const Payload& payload, StreamKind kind) {
+    if (numClients() == 0) return;
+    // Cabeçalhos montados uma vez por broadcast; o payload não é copiado
+    broadcastFrame(buildFrame(0x2, payload, maxFragment), kind);
+}
+
+void WebSocketServer::broadcast(const std::vector<uint8_t>& data, StreamKind kind) {
+    broadcast(data.data(), data.size(), kind);
+}
+
+void WebSocketServer::broadcast(const uint8_t* data, size_t len, StreamKind kind) {
+    if (numClients() == 0) return;
+    broadcastFrame(buildFrame(0x2, data, len, maxFragment), kind);
+}
+
+void WebSocketServer::broadcastToGroup(uint32_t group, const uint8_t* data, size_t len, StreamKind kind) {
+    if (numClientsInGroup(group) == 0) return;
+    broadcastFrame(buildFrame(0x2, data, len, maxFragment), kind, group);
+}
+
+void WebSocketServer::broadcastText(const std::string& text, StreamKind kind) {
+    if (numClients() == 0) return;
+    broadcastFrame(buildFrame(0x1, reinterpret_cast<const uint8_t*>(text.data()), text.size(), maxFragment), kind);
+}
+
+bool WebSocketServer::sendText(uint32_t client_id, const std::string& text, StreamKind kind) {
+    return sendFrame(client_id, buildFrame(0x1, reinterpret_cast<const uint8_t*>(text.data()), text.size(), maxFragment),
+                     kind);
+}
+
+bool WebSocketServer::sendBinary(uint32_t client_id, const uint8_t* data, size_t len, StreamKind kind) {
+    return sendFrame(client_id, buildFrame(0x2, data, len, maxFragment), kind);
+}
+
+bool WebSocketServer::sendFrame(uint32_t client_id, const FramePtr& frame, StreamKind kind) {
+    std::lock_guard<std::mutex> lock(clientMutex);
+    for (auto& c : clients) {
+        if (c->id != client_id || !c->open) continue;
+        if (c->closing) return false;
+        bool ready;
+        {
+            std::lock_guard<std::mutex> out_lock(c->out_mutex);
+            ready = enqueue(*c, frame, kind);
+        }
+        if (ready) {
+            IOLoop& loop = *loops[c->loop];
+            {
+                std::lock_guard<std::mutex> ready_lock(loop.ready_mutex);
+                loop.ready.push_back(c.get());
+            }
+            wakeLoop(c->loop);
+        }
+        return true;
+    }
+    return false;
+}
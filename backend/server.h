@@ -1,5 +1,6 @@
 #pragma once
 
+#ifdef _WIN32
 // Força o Winsock2 a ser o principal e evita conflito
 #ifndef WIN32_LEAN_AND_MEAN
 #define WIN32_LEAN_AND_MEAN
@@ -8,33 +9,169 @@
 #include <winsock2.h>
 #include <ws2tcpip.h>
 #include <windows.h> // Incluir DEPOIS do winsock2
+
+#pragma comment (lib, "Ws2_32.lib")
+
+typedef SOCKET socket_t;
+#else
+typedef int socket_t;
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <vector>
 #include <string>
 #include <thread>
 #include <mutex>
+#include <memory>
 #include <functional>
+#include "pipeline_stats.h"
 
-#pragma comment (lib, "Ws2_32.lib")
+// Tipo de tráfego de cada mensagem; decide a política quando a fila enche
+enum class StreamKind {
+    CONTROL = 0,   // Handshake, pong, close e respostas JSON: nunca descartados
+    AUDIO = 1,
+    SPECTRUM = 2,
+    DATA = 3
+};
 
+enum class DropPolicy {
+    DROP_OLDEST = 0,   // Descarta a mensagem mais antiga do mesmo tipo ainda não enviada
+    COALESCE = 1,      // Mantém só a mais recente do tipo na fila (substitui a pendente)
+    DISCONNECT = 2     // Desconecta o cliente
+};
+
+// Limites da fila de saída de cada cliente
+struct SendQueueLimits {
+    size_t max_messages = 256;
+    size_t max_bytes = 2 << 20;
+    DropPolicy audio = DropPolicy::DROP_OLDEST;
+    DropPolicy spectrum = DropPolicy::COALESCE;
+    DropPolicy data = DropPolicy::DISCONNECT;
+};
+
+// Métricas de atraso de um cliente
+struct ClientStats {
+    uint32_t id;
+    std::string address;
+    size_t queued_messages;
+    size_t queued_bytes;
+    size_t max_queued_messages;  // Pico desde a conexão
+    double lag_ms;               // Idade da mensagem mais antiga na fila
+    uint64_t sent_messages;
+    uint64_t sent_bytes;
+    uint64_t dropped;            // Descartadas por DROP_OLDEST / fila cheia
+    uint64_t coalesced;          // Substituídas por COALESCE
+    uint32_t group;
+};
+
+// Servidor WebSocket orientado a eventos: sockets não-bloqueantes e poucas
+// threads de I/O (epoll no Linux, poll/WSAPoll nos demais), cada uma
+// atendendo uma fatia dos clientes. broadcast() só enfileira: cada cliente
+// tem uma fila limitada, drenada pela sua thread de I/O, e um cliente lento
+// perde mensagens (ou a conexão) sem atrasar os demais nem a thread de DSP.
 class WebSocketServer {
 public:
-    WebSocketServer(int port);
+    explicit WebSocketServer(int port, int io_threads = 2);
     ~WebSocketServer();
+
     void start();
-    void broadcast(const std::vector<uint8_t>& data);
+    void stop();
+
+    // Vale para as mensagens enfileiradas a partir daqui
+    void setSendQueueLimits(const SendQueueLimits& limits);
+
+    // Payload compartilhado entre as filas dos clientes, sem cópia
+    typedef std::shared_ptr<const std::vector<uint8_t>> Payload;
+
+    // Payloads acima disso saem em vários frames (continuação); 0 = nunca fragmenta
+    void setMaxFragmentSize(size_t bytes);
+
+    // Frame binário para todos os clientes conectados. As versões com
+    // ponteiro copiam o payload uma vez; a com Payload não copia nada.
+    void broadcast(const std::vector<uint8_t>& data, StreamKind kind = StreamKind::DATA);
+    void broadcast(const uint8_t* data, size_t len, StreamKind kind = StreamKind::DATA);
+    void broadcast(const Payload& payload, StreamKind kind = StreamKind::DATA);
+    // Só para os clientes de um grupo (ex.: codificação de áudio escolhida)
+    void broadcastToGroup(uint32_t group, const uint8_t* data, size_t len, StreamKind kind = StreamKind::DATA);
+    // Frame de texto (respostas JSON). CONTROL não tem limite de fila:
+    // estado enviado sem pedido (RDS, scanner) vai como DATA
+    void broadcastText(const std::string& text, StreamKind kind = StreamKind::CONTROL);
+    // Frames para um cliente só; false se ele não existe mais
+    bool sendText(uint32_t client_id, const std::string& text, StreamKind kind = StreamKind::CONTROL);
+    bool sendBinary(uint32_t client_id, const uint8_t* data, size_t len, StreamKind kind = StreamKind::DATA);
+
+    // Chamados na thread de I/O para cada mensagem completa recebida
     void setOnMessage(std::function<void(std::string)> callback);
+    void setOnClientMessage(std::function<void(uint32_t, std::string)> callback);
+    // Chamado na thread de I/O depois do handshake, com o alvo da requisição
+    // (ex.: "/?audio=adpcm"): permite configurar o cliente já na conexão
+    void setOnConnect(std::function<void(uint32_t, std::string)> callback);
+    // GET comum (sem Upgrade) na mesma porta, ex.: "/metrics" para o
+    // Prometheus: o handler preenche o corpo (text/plain); false = 404.
+    // A conexão fecha depois da resposta.
+    void setHttpHandler(std::function<bool(const std::string&, std::string&)> handler);
+
+    // Grupo do cliente (padrão 0); false se ele não existe mais
+    bool setClientGroup(uint32_t client_id, uint32_t group);
+    size_t numClientsInGroup(uint32_t group) const;
+
+    size_t numClients() const;
+    std::vector<ClientStats> getClientStats() const;
+
+    // Duração de cada sendmsg/WSASend e tempo de cada mensagem na fila
+    // (enfileirada -> último byte entregue ao socket), todos os clientes
+    LatencyHistogram::Snapshot socketWriteLatency() const { return writeLatency.snapshot(); }
+    LatencyHistogram::Snapshot queueWaitLatency() const { return queueLatency.snapshot(); }
 
 private:
+    struct Client;
+    struct IOLoop;
+    struct OutFrame;
+    typedef std::shared_ptr<const OutFrame> FramePtr;
+
     int port;
-    SOCKET serverSocket;
-    std::vector<SOCKET> clients;
-    std::mutex clientMutex;
+    int num_loops;
+    socket_t serverSocket;
+    std::vector<std::unique_ptr<IOLoop>> loops;
+    std::vector<std::unique_ptr<Client>> clients;
+    mutable std::mutex clientMutex;
     std::function<void(std::string)> onMessageCallback;
-    bool running;
+    std::function<void(uint32_t, std::string)> onClientMessageCallback;
+    std::function<void(uint32_t, std::string)> onConnectCallback;
+    std::function<bool(const std::string&, std::string&)> httpHandler;
+    LatencyHistogram writeLatency;
+    LatencyHistogram queueLatency;
+    std::atomic<bool> running;
+    size_t nextLoop;
+    uint32_t nextClientId;
+    SendQueueLimits limits;             // Sob clientMutex
+    std::atomic<size_t> maxFragment;
+    std::vector<bool> loopsToWake;      // Sob clientMutex
+
+    void ioLoop(size_t index);
+    void acceptClients();
+    void serviceClient(Client& client, bool readable, bool writable);
+    bool handleReadable(Client& client);
+    void flushClient(Client& client);
+    void flushReady(IOLoop& loop);
+    void closeClient(Client& client);
+
+    bool handshake(Client& client);
+    void parseFrames(Client& client);
+    bool enqueue(Client& client, const FramePtr& frame, StreamKind kind);
+    void sendControl(Client& client, const FramePtr& frame);
+    void wakeLoop(size_t index);
+    void setWriteInterest(Client& client, bool enabled);
+    static const uint32_t ALL_GROUPS = 0xFFFFFFFF;
+    void broadcastFrame(const FramePtr& frame, StreamKind kind, uint32_t group = ALL_GROUPS);
+    bool sendFrame(uint32_t client_id, const FramePtr& frame, StreamKind kind);
 
-    void acceptLoop();
-    void handleClient(SOCKET clientSocket);
-    bool handshake(SOCKET clientSocket);
     std::string base64_encode(const unsigned char* input, int length);
-    void sendFrame(SOCKET client, const std::vector<uint8_t>& data, bool isBinary);
-};
\ No newline at end of file
+    // Cabeçalhos montados uma vez; o payload fica compartilhado
+    static FramePtr buildFrame(uint8_t opcode, const Payload& payload, size_t max_fragment = 0);
+    static FramePtr buildFrame(uint8_t opcode, const uint8_t* data, size_t len, size_t max_fragment = 0);
+    static FramePtr buildRaw(const std::string& bytes);
+};
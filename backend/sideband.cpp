@@ -0,0 +1,191 @@
+#include "sideband.h"
+#include "cpu_features.h"
+#include "resampler.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(SPEEDSDR_X86)
+#include <immintrin.h>
+#endif
+#if defined(SPEEDSDR_NEON)
+#include <arm_neon.h>
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// Transição das bordas da banda passante: ~200 taps a 16 kHz, 60 dB
+static const float EDGE_TRANSITION_HZ = 300.0f;
+static const float STOPBAND_DB = 60.0f;
+
+// Os taps são completados com zeros até um múltiplo disto (8 floats = AVX)
+static const size_t TAP_ALIGN = 8;
+
+// ============ Kernels ============
+// Todos calculam out[j] = sum_k xi[j+k]*hi[k] + xq[j+k]*hq[k], k em [0, taps)
+
+static void dotScalar(const float* xi, const float* xq, const float* hi, const float* hq,
+                      size_t taps, size_t n, float* out) {
+    for (size_t j = 0; j < n; j++) {
+        float acc = 0.0f;
+        for (size_t k = 0; k < taps; k++) acc += xi[j + k] * hi[k] + xq[j + k] * hq[k];
+        out[j] = acc;
+    }
+}
+
+#if defined(SPEEDSDR_X86)
+SPEEDSDR_TARGET_SSE2
+static void dotSSE2(const float* xi, const float* xq, const float* hi, const float* hq,
+                    size_t taps, size_t n, float* out) {
+    for (size_t j = 0; j < n; j++) {
+        __m128 a0 = _mm_setzero_ps(), a1 = _mm_setzero_ps();
+        for (size_t k = 0; k < taps; k += 4) {
+            a0 = _mm_add_ps(a0, _mm_mul_ps(_mm_loadu_ps(xi + j + k), _mm_load_ps(hi + k)));
+            a1 = _mm_add_ps(a1, _mm_mul_ps(_mm_loadu_ps(xq + j + k), _mm_load_ps(hq + k)));
+        }
+        __m128 s = _mm_add_ps(a0, a1);
+        s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+        s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+        out[j] = _mm_cvtss_f32(s);
+    }
+}
+
+SPEEDSDR_TARGET_AVX2
+static void dotAVX2(const float* xi, const float* xq, const float* hi, const float* hq,
+                    size_t taps, size_t n, float* out) {
+    for (size_t j = 0; j < n; j++) {
+        // Dois acumuladores por canal: cadeias de FMA independentes
+        __m256 a0 = _mm256_setzero_ps(), a1 = _mm256_setzero_ps();
+        for (size_t k = 0; k < taps; k += 8) {
+            a0 = _mm256_fmadd_ps(_mm256_loadu_ps(xi + j + k), _mm256_load_ps(hi + k), a0);
+            a1 = _mm256_fmadd_ps(_mm256_loadu_ps(xq + j + k), _mm256_load_ps(hq + k), a1);
+        }
+        __m256 s8 = _mm256_add_ps(a0, a1);
+        __m128 s = _mm_add_ps(_mm256_castps256_ps128(s8), _mm256_extractf128_ps(s8, 1));
+        s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+        s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+        out[j] = _mm_cvtss_f32(s);
+    }
+}
+#endif
+
+#if defined(SPEEDSDR_NEON)
+static void dotNEON(const float* xi, const float* xq, const float* hi, const float* hq,
+                    size_t taps, size_t n, float* out) {
+    for (size_t j = 0; j < n; j++) {
+        float32x4_t a0 = vdupq_n_f32(0.0f), a1 = vdupq_n_f32(0.0f);
+        for (size_t k = 0; k < taps; k += 4) {
+            a0 = vmlaq_f32(a0, vld1q_f32(xi + j + k), vld1q_f32(hi + k));
+            a1 = vmlaq_f32(a1, vld1q_f32(xq + j + k), vld1q_f32(hq + k));
+        }
+        float32x4_t s = vaddq_f32(a0, a1);
+        float32x2_t p = vadd_f32(vget_low_f32(s), vget_high_f32(s));
+        out[j] = vget_lane_f32(vpadd_f32(p, p), 0);
+    }
+}
+#endif
+
+// ============ SidebandDemodulator Implementation ============
+
+SidebandDemodulator::SidebandDemodulator(int rate)
+    : sample_rate(rate),
+      sideband(Sideband::UPPER),
+      low(300.0f),
+      high(2700.0f),
+      bfo(0.0f),
+      bfo_nco(rate),
+      num_taps(0),
+      group_delay(0.0),
+      dot_fn(dotScalar) {
+    const CpuFeatures& cpu = getCpuFeatures();
+#if defined(SPEEDSDR_X86)
+    if (cpu.avx2 && cpu.fma) dot_fn = dotAVX2;
+    else if (cpu.sse2) dot_fn = dotSSE2;
+#endif
+#if defined(SPEEDSDR_NEON)
+    if (cpu.neon) dot_fn = dotNEON;
+#endif
+    (void)cpu;
+    redesign();
+}
+
+bool SidebandDemodulator::isVectorized() const {
+    return dot_fn != dotScalar;
+}
+
+void SidebandDemodulator::configure(Sideband sb, float low_hz, float high_hz, float bfo_hz) {
+    // Limites: banda dentro da Nyquist depois do deslocamento pelo BFO
+    float nyquist = 0.5f * sample_rate;
+    low_hz = std::max(low_hz, 0.0f);
+    high_hz = std::min(high_hz, 0.95f * nyquist);
+    if (high_hz - low_hz < 50.0f) high_hz = low_hz + 50.0f;
+    if (sb == sideband && low_hz == low && high_hz == high && bfo_hz == bfo) return;
+
+    sideband = sb;
+    low = low_hz;
+    high = high_hz;
+    bfo = bfo_hz;
+    redesign();
+}
+
+void SidebandDemodulator::redesign() {
+    // Passa-baixa protótipo com meia largura da banda, deslocado para o
+    // centro dela: positivo na USB, negativo (espelho) na LSB
+    float half = 0.5f * (high - low);
+    float center = 0.5f * (high + low);
+    if (sideband == Sideband::LOWER) center = -center;
+    std::vector<float> proto = designLowpassFIR(half / sample_rate, EDGE_TRANSITION_HZ / sample_rate, STOPBAND_DB);
+
+    const size_t taps = proto.size();
+    num_taps = (taps + TAP_ALIGN - 1) / TAP_ALIGN * TAP_ALIGN;
+    group_delay = (taps - 1) * 0.5;
+
+    // Invertidos, com os zeros de alinhamento no lado das amostras mais antigas
+    taps_i.assign(num_taps, 0.0f);
+    taps_q.assign(num_taps, 0.0f);
+    const size_t pad = num_taps - taps;
+    for (size_t k = 0; k < taps; k++) {
+        double w = 2.0 * M_PI * center * (static_cast<double>(k) - group_delay) / sample_rate;
+        float h = proto[k];
+        // Re(x * h) = xr*Re(h) - xi*Im(h)
+        taps_i[pad + taps - 1 - k] = static_cast<float>(h * std::cos(w));
+        taps_q[pad + taps - 1 - k] = static_cast<float>(-h * std::sin(w));
+    }
+
+    // A portadora vai para +bfo (USB/CW) ou -bfo (LSB): o áudio sai com ela em bfo Hz
+    bfo_nco.setOffset(sideband == Sideband::LOWER ? bfo : -bfo);
+    reset();
+}
+
+void SidebandDemodulator::process(const std::complex<float>* in, size_t n, float* out) {
+    const size_t hist = num_taps - 1;
+    if (hist_i.size() < hist) reset();
+    hist_i.resize(hist + n);
+    hist_q.resize(hist + n);
+
+    const std::complex<float>* src = in;
+    if (bfo != 0.0f) {
+        if (mixed.size() < n) mixed.resize(n);
+        bfo_nco.mix(in, n, mixed.data());
+        src = mixed.data();
+    }
+    for (size_t k = 0; k < n; k++) {
+        hist_i[hist + k] = src[k].real();
+        hist_q[hist + k] = src[k].imag();
+    }
+
+    dot_fn(hist_i.data(), hist_q.data(), taps_i.data(), taps_q.data(), num_taps, n, out);
+
+    // Últimas amostras viram o histórico do próximo bloco
+    std::copy(hist_i.end() - hist, hist_i.end(), hist_i.begin());
+    std::copy(hist_q.end() - hist, hist_q.end(), hist_q.begin());
+    hist_i.resize(hist);
+    hist_q.resize(hist);
+}
+
+void SidebandDemodulator::reset() {
+    hist_i.assign(num_taps - 1, 0.0f);
+    hist_q.assign(num_taps - 1, 0.0f);
+    bfo_nco.reset();
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <complex>
+#include <cstddef>
+#include "aligned_buffer.h"
+#include "channel.h"
+
+// Banda lateral que o demodulador entrega
+enum class Sideband {
+    UPPER = 0,   // USB e CW: frequências acima da portadora
+    LOWER = 1    // LSB: espectro espelhado
+};
+
+// Demodulador SSB/CW por filtragem complexa na taxa do canal.
+// Um FIR passa-banda de taps complexos deixa passar só um lado da
+// portadora; a parte real da saída já é o áudio (método de fase, com o
+// Hilbert embutido no filtro). Só a parte real é calculada: dois produtos
+// escalares reais, sobre I e sobre Q, com kernel SIMD escolhido em tempo
+// de execução. O BFO desloca a portadora para bfo Hz no áudio antes do
+// filtro: 0 em SSB, o tom de batimento (~700 Hz) em CW.
+class SidebandDemodulator {
+public:
+    explicit SidebandDemodulator(int sample_rate);
+
+    // Banda passante em Hz de áudio (low < high) e posição da portadora no
+    // áudio. Reprojeta o filtro só se algo mudou (chamar na thread de DSP).
+    void configure(Sideband sideband, float low_hz, float high_hz, float bfo_hz);
+
+    // Escreve n amostras de áudio em out
+    void process(const std::complex<float>* in, size_t n, float* out);
+    void reset();
+
+    // Atraso de grupo do FIR, em amostras da taxa do canal
+    double groupDelay() const { return group_delay; }
+    size_t numTaps() const { return num_taps; }
+    // true se o produto escalar está usando um kernel SIMD
+    bool isVectorized() const;
+
+private:
+    int sample_rate;
+    Sideband sideband;
+    float low;
+    float high;
+    float bfo;
+
+    NCO bfo_nco;
+    size_t num_taps;            // Múltiplo da largura do kernel (zeros à esquerda)
+    double group_delay;
+    AlignedVector<float> taps_i;    // Re(h) invertido
+    AlignedVector<float> taps_q;    // -Im(h) invertido: out = xi.taps_i + xq.taps_q
+    AlignedVector<float> hist_i;    // Histórico + bloco atual, desintercalados
+    AlignedVector<float> hist_q;
+    AlignedVector<std::complex<float>> mixed;
+
+    void (*dot_fn)(const float*, const float*, const float*, const float*, size_t, size_t, float*);
+
+    void redesign();
+};
@@ -0,0 +1,205 @@
+#include "spectrum.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// ============ SpectrumEngine Implementation ============
+
+SpectrumEngine::SpectrumEngine(int rate, const SpectrumSettings& s)
+    : sample_rate(rate),
+      settings(s),
+      requested_fps(s.frame_rate),
+      requested_bins(s.display_bins),
+      requested_fft(0),
+      requested_peak(s.peak_hold),
+      requested_min_db(s.min_db),
+      requested_max_db(s.max_db),
+      power_scale(1.0f),
+      input_start(0),
+      averages(0),
+      frame_samples(0),
+      sequence(0) {
+    configure();
+    requested_fft = settings.fft_size;   // Já arredondado e limitado por configure()
+}
+
+void SpectrumEngine::setFrameRate(float fps) {
+    requested_fps = std::min(std::max(fps, 1.0f), 100.0f);
+}
+
+void SpectrumEngine::setDisplayBins(size_t bins) {
+    requested_bins = std::min<size_t>(std::max<size_t>(bins, 16), SPECTRUM_MAX_FFT);
+}
+
+void SpectrumEngine::setFFTSize(size_t size) {
+    // Potência de 2, como a FFT: applySettings compara com o tamanho em uso
+    size_t n = 64;
+    while (n < size && n < SPECTRUM_MAX_FFT) n <<= 1;
+    requested_fft = n;
+}
+
+void SpectrumEngine::setPeakHold(bool enabled) {
+    requested_peak = enabled;
+}
+
+void SpectrumEngine::setRange(float min_db, float max_db) {
+    if (max_db - min_db < 1.0f) return;
+    requested_min_db = min_db;
+    requested_max_db = max_db;
+}
+
+void SpectrumEngine::configure() {
+    // FFT arredonda para potência de 2
+    fft.reset(new FFT(std::min(settings.fft_size, SPECTRUM_MAX_FFT)));
+    const size_t n = fft->size();
+    settings.fft_size = n;
+    settings.display_bins = std::min(settings.display_bins, n);
+
+    // Blackman-Harris de 4 termos: lóbulos laterais < -92 dB
+    window.resize(n);
+    double sum = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        double x = 2.0 * M_PI * i / n;
+        double w = 0.35875 - 0.48829 * std::cos(x) + 0.14128 * std::cos(2 * x) - 0.01168 * std::cos(3 * x);
+        window[i] = static_cast<float>(w);
+        sum += w;
+    }
+    power_scale = static_cast<float>(1.0 / (sum * sum));
+
+    segment.resize(n);
+    accum.assign(n, 0.0f);
+    averages = 0;
+    frame_samples = 0;
+
+    average_db.assign(settings.display_bins, settings.min_db);
+    peak_db.assign(settings.display_bins, settings.min_db);
+    // frame_data fica: o quadro fechado antes da troca ainda vai ser enviado
+}
+
+void SpectrumEngine::applySettings() {
+    settings.frame_rate = requested_fps.load();
+    settings.peak_hold = requested_peak.load();
+    settings.min_db = requested_min_db.load();
+    settings.max_db = requested_max_db.load();
+
+    size_t fft_size = requested_fft.load();
+    size_t bins = requested_bins.load();
+    if (fft_size != settings.fft_size || std::min(bins, settings.fft_size) != settings.display_bins) {
+        settings.fft_size = fft_size;
+        settings.display_bins = bins;
+        configure();
+    }
+}
+
+bool SpectrumEngine::process(const uint8_t* iq, size_t len) {
+    const size_t n = fft->size();
+    const size_t hop = std::max<size_t>(1, static_cast<size_t>(n * (1.0f - settings.overlap)));
+
+    // Anexar o bloco novo ao que sobrou do anterior
+    size_t count = len / 2;
+    size_t pending = input.size() - input_start;
+    if (input_start > 0) {
+        std::copy(input.begin() + input_start, input.end(), input.begin());
+        input_start = 0;
+    }
+    input.resize(pending + count);
+    converter.toComplex(iq, count, input.data() + pending);
+
+    const size_t samples_per_frame = static_cast<size_t>(sample_rate / settings.frame_rate);
+    bool produced = false;
+
+    while (input.size() - input_start >= n) {
+        // Welch: janela + FFT + |X|^2 acumulado; segmentos além de
+        // max_averages só avançam o tempo (economia de CPU em quadros longos)
+        if (averages < settings.max_averages) {
+            const std::complex<float>* x = &input[input_start];
+            for (size_t i = 0; i < n; i++) segment[i] = x[i] * window[i];
+            fft->forward(segment.data());
+
+            // Reordenar com DC no centro: saída [-fs/2, +fs/2)
+            const size_t half = n / 2;
+            for (size_t k = 0; k < n; k++) {
+                accum[k] += std::norm(segment[(k + half) & (n - 1)]);
+            }
+            averages++;
+        }
+
+        input_start += hop;
+        frame_samples += hop;
+
+        if (frame_samples >= samples_per_frame) {
+            finishFrame();
+            produced = true;
+            applySettings();
+            if (fft->size() != n) return produced;  // Buffers refeitos; próximo bloco já usa o tamanho novo
+        }
+    }
+    return produced;
+}
+
+void SpectrumEngine::finishFrame() {
+    const size_t n = fft->size();
+    const size_t bins = settings.display_bins;
+    const float scale = power_scale / std::max<size_t>(averages, 1);
+
+    // Redução: máximo de cada grupo (portadoras estreitas não somem)
+    for (size_t j = 0; j < bins; j++) {
+        size_t begin = j * n / bins;
+        size_t end = std::max(begin + 1, (j + 1) * n / bins);
+        float p = 0.0f;
+        for (size_t k = begin; k < end; k++) p = std::max(p, accum[k]);
+        average_db[j] = 10.0f * std::log10(p * scale + 1e-20f);
+    }
+
+    if (settings.peak_hold) {
+        for (size_t j = 0; j < bins; j++) {
+            peak_db[j] = std::max(peak_db[j] - settings.peak_decay_db, average_db[j]);
+        }
+    } else {
+        std::copy(average_db.begin(), average_db.end(), peak_db.begin());
+    }
+
+    // Quadro: cabeçalho + linha média (+ linha de pico)
+    const size_t rows = settings.peak_hold ? 2 : 1;
+    frame_data.resize(sizeof(SpectrumFrameHeader) + rows * bins);
+
+    SpectrumFrameHeader header;
+    header.magic[0] = 'S';
+    header.magic[1] = 'D';
+    header.type = SPECTRUM_FRAME_TYPE;
+    header.flags = settings.peak_hold ? SPECTRUM_FLAG_PEAK : 0;
+    header.bins = static_cast<uint16_t>(bins);
+    header.min_db = static_cast<int16_t>(std::lround(settings.min_db));
+    header.max_db = static_cast<int16_t>(std::lround(settings.max_db));
+    header.reserved = 0;
+    header.sequence = sequence++;
+    std::memcpy(frame_data.data(), &header, sizeof(header));
+
+    const float q = 255.0f / (settings.max_db - settings.min_db);
+    uint8_t* row = frame_data.data() + sizeof(header);
+    for (size_t r = 0; r < rows; r++) {
+        const std::vector<float>& src = r == 0 ? average_db : peak_db;
+        for (size_t j = 0; j < bins; j++) {
+            float v = (src[j] - settings.min_db) * q;
+            row[j] = static_cast<uint8_t>(std::min(std::max(v, 0.0f), 255.0f) + 0.5f);
+        }
+        row += bins;
+    }
+
+    std::fill(accum.begin(), accum.end(), 0.0f);
+    averages = 0;
+    frame_samples = 0;
+}
+
+void SpectrumEngine::reset() {
+    input.clear();
+    input_start = 0;
+    std::fill(accum.begin(), accum.end(), 0.0f);
+    averages = 0;
+    frame_samples = 0;
+    std::fill(peak_db.begin(), peak_db.end(), settings.min_db);
+}
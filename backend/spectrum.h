@@ -0,0 +1,105 @@
+#pragma once
+#include <atomic>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "fft.h"
+#include "iq_convert.h"
+#include "aligned_buffer.h"
+
+// Parâmetros do espectro/waterfall. Alterações feitas por outra thread
+// (setters do SpectrumEngine) valem a partir do próximo quadro.
+struct SpectrumSettings {
+    size_t fft_size = 2048;        // Potência de 2
+    size_t display_bins = 1024;    // <= fft_size; bins agrupados pelo máximo
+    float frame_rate = 25.0f;      // Quadros por segundo
+    float overlap = 0.5f;          // Sobreposição dos segmentos de Welch
+    size_t max_averages = 16;      // Segmentos por quadro (o resto é pulado)
+    bool peak_hold = false;
+    float peak_decay_db = 0.5f;    // Queda do peak-hold por quadro
+    float min_db = -120.0f;        // Faixa mapeada para 0..255
+    float max_db = 0.0f;
+};
+
+// Cabeçalho dos quadros binários de espectro (little-endian, 16 bytes),
+// seguido de display_bins bytes da média e, com peak-hold, de mais
+// display_bins bytes do pico. Byte = (dB - min_db) * 255 / (max_db - min_db).
+#pragma pack(push, 1)
+struct SpectrumFrameHeader {
+    uint8_t magic[2];      // 'S', 'D'
+    uint8_t type;          // SPECTRUM_FRAME_TYPE
+    uint8_t flags;         // bit 0: linha de peak-hold presente
+    uint16_t bins;
+    int16_t min_db;
+    int16_t max_db;
+    uint16_t reserved;
+    uint32_t sequence;
+};
+#pragma pack(pop)
+
+static const uint8_t SPECTRUM_FRAME_TYPE = 0x02;
+static const uint8_t SPECTRUM_FLAG_PEAK = 0x01;
+static const size_t SPECTRUM_MAX_FFT = 32768;   // bins vai em uint16_t no cabeçalho
+
+// Espectro no servidor: janela Blackman-Harris, FFT, média de Welch
+// (potência), redução para os bins de exibição, peak-hold e quantização
+// em dB. O cliente recebe alguns KB por quadro em vez do IQ bruto.
+class SpectrumEngine {
+public:
+    SpectrumEngine(int sample_rate, const SpectrumSettings& settings = SpectrumSettings());
+
+    // Podem ser chamados de outra thread
+    void setFrameRate(float fps);
+    void setDisplayBins(size_t bins);
+    void setFFTSize(size_t size);
+    void setPeakHold(bool enabled);
+    void setRange(float min_db, float max_db);
+
+    // Alimenta IQ bruto (uint8 intercalado). Retorna true se um quadro novo
+    // ficou pronto durante a chamada (o último fica em frame()).
+    bool process(const uint8_t* iq, size_t len);
+
+    // Último quadro completo (cabeçalho + linhas), pronto para envio
+    const uint8_t* frame() const { return frame_data.data(); }
+    size_t frameSize() const { return frame_data.size(); }
+
+    // Último espectro médio em dBFS, antes da quantização (display_bins valores)
+    const std::vector<float>& spectrumDb() const { return average_db; }
+
+    void reset();
+
+private:
+    int sample_rate;
+    SpectrumSettings settings;
+
+    // Pedidos de outra thread, aplicados entre quadros
+    std::atomic<float> requested_fps;
+    std::atomic<size_t> requested_bins;
+    std::atomic<size_t> requested_fft;
+    std::atomic<bool> requested_peak;
+    std::atomic<float> requested_min_db;
+    std::atomic<float> requested_max_db;
+
+    std::unique_ptr<FFT> fft;
+    IQConverter converter;
+    std::vector<float> window;
+    float power_scale;               // 1 / (sum w)^2: tom em fundo de escala = 0 dBFS
+
+    AlignedVector<std::complex<float>> input;   // Amostras ainda não consumidas
+    size_t input_start;
+    AlignedVector<std::complex<float>> segment;
+    std::vector<float> accum;        // Soma de |X|^2 por bin (ordem com DC no centro)
+    size_t averages;
+    size_t frame_samples;            // Amostras consumidas no quadro atual
+
+    std::vector<float> average_db;
+    std::vector<float> peak_db;
+    std::vector<uint8_t> frame_data;
+    uint32_t sequence;
+
+    void applySettings();
+    void configure();
+    void finishFrame();
+};
@@ -0,0 +1,83 @@
+#include "spsc_ring.h"
+#include <chrono>
+
+SPSCSlotRing::SPSCSlotRing(size_t num_slots, size_t size, size_t alignment)
+    : slot_size((size + alignment - 1) / alignment * alignment),
+      base(nullptr),
+      head(0), cached_tail(0), tail(0), cached_head(0),
+      overrun_count(0), consumer_waiting(false) {
+    size_t slots = 2;
+    while (slots < num_slots) slots <<= 1;
+    mask = slots - 1;
+
+    // AlignedVector garante SPSC_CACHE_LINE; folga para alinhamentos maiores
+    size_t extra = alignment > SPSC_CACHE_LINE ? alignment : 0;
+    storage.assign(slots * slot_size + extra, 0);
+    uintptr_t addr = reinterpret_cast<uintptr_t>(storage.data());
+    base = storage.data() + ((alignment - addr % alignment) % alignment);
+    lengths.assign(slots, 0);
+    timestamps.assign(slots, 0);
+}
+
+uint8_t* SPSCSlotRing::acquireWrite() {
+    size_t h = head.load(std::memory_order_relaxed);
+    if (h - cached_tail > mask) {
+        cached_tail = tail.load(std::memory_order_acquire);
+        if (h - cached_tail > mask) {
+            overrun_count.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+    }
+    return base + (h & mask) * slot_size;
+}
+
+void SPSCSlotRing::commitWrite(size_t len, uint64_t timestamp) {
+    size_t h = head.load(std::memory_order_relaxed);
+    lengths[h & mask] = len < slot_size ? len : slot_size;
+    timestamps[h & mask] = timestamp;
+    head.store(h + 1);  // seq_cst: ordena com a leitura de consumer_waiting abaixo
+
+    // Só acorda o consumidor se ele estiver dormindo (notify não bloqueia)
+    if (consumer_waiting.load()) {
+        wait_cv.notify_one();
+    }
+}
+
+const uint8_t* SPSCSlotRing::acquireRead(size_t& len) {
+    size_t t = tail.load(std::memory_order_relaxed);
+    if (t == cached_head) {
+        cached_head = head.load(std::memory_order_acquire);
+        if (t == cached_head) {
+            len = 0;
+            return nullptr;
+        }
+    }
+    len = lengths[t & mask];
+    return base + (t & mask) * slot_size;
+}
+
+const uint8_t* SPSCSlotRing::acquireRead(size_t& len, uint64_t& timestamp) {
+    const uint8_t* slot = acquireRead(len);
+    timestamp = slot ? timestamps[tail.load(std::memory_order_relaxed) & mask] : 0;
+    return slot;
+}
+
+void SPSCSlotRing::releaseRead() {
+    tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+bool SPSCSlotRing::waitForData(int timeout_ms) {
+    if (size() > 0) return true;
+
+    std::unique_lock<std::mutex> lock(wait_mutex);
+    consumer_waiting.store(true);
+    // Um notify perdido entre o teste e o wait só custa o timeout
+    bool ready = wait_cv.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                                  [this] { return size() > 0; });
+    consumer_waiting.store(false, std::memory_order_relaxed);
+    return ready;
+}
+
+size_t SPSCSlotRing::size() const {
+    return head.load() - tail.load(std::memory_order_acquire);
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "aligned_buffer.h"
+
+#define SPSC_CACHE_LINE 64
+
+// Anel single-producer/single-consumer de slots pré-alocados.
+// O produtor (callback USB) e o consumidor (thread de áudio) trabalham
+// direto no slot (acquire/commit, acquire/release), sem mutex e sem
+// alocação. Se o consumidor atrasar e o anel encher, o bloco novo é
+// descartado e contado como overrun.
+class SPSCSlotRing {
+public:
+    // num_slots é arredondado para potência de 2; slot_size para múltiplo de
+    // alignment (potência de 2), que também alinha o início de cada slot
+    // (ex.: 4096 para escrita com O_DIRECT)
+    SPSCSlotRing(size_t num_slots, size_t slot_size, size_t alignment = SPSC_CACHE_LINE);
+
+    // ---- Produtor ----
+    // Slot livre para escrita ou nullptr se o anel estiver cheio (overrun)
+    uint8_t* acquireWrite();
+    // Publica o slot adquirido com len bytes válidos; timestamp (ex.:
+    // monotonicNs() da captura) segue junto com o slot
+    void commitWrite(size_t len, uint64_t timestamp = 0);
+
+    // ---- Consumidor ----
+    // Próximo slot com dados ou nullptr se vazio
+    const uint8_t* acquireRead(size_t& len);
+    const uint8_t* acquireRead(size_t& len, uint64_t& timestamp);
+    // Devolve o slot lido ao produtor
+    void releaseRead();
+    // Espera até haver dados ou até o timeout (só o consumidor bloqueia)
+    bool waitForData(int timeout_ms);
+
+    size_t size() const;
+    size_t capacity() const { return mask + 1; }
+    size_t slotSize() const { return slot_size; }
+    uint64_t overruns() const { return overrun_count.load(std::memory_order_relaxed); }
+
+private:
+    const size_t slot_size;
+    size_t mask;
+    AlignedVector<uint8_t> storage;
+    uint8_t* base;                   // Início alinhado dentro de storage
+    std::vector<size_t> lengths;
+    std::vector<uint64_t> timestamps;
+
+    // Índices monotônicos; cada lado lê o do outro e guarda uma cópia local
+    alignas(SPSC_CACHE_LINE) std::atomic<size_t> head;   // Escrito pelo produtor
+    size_t cached_tail;
+    alignas(SPSC_CACHE_LINE) std::atomic<size_t> tail;   // Escrito pelo consumidor
+    size_t cached_head;
+    alignas(SPSC_CACHE_LINE) std::atomic<uint64_t> overrun_count;
+    std::atomic<bool> consumer_waiting;
+
+    std::mutex wait_mutex;
+    std::condition_variable wait_cv;
+};
@@ -0,0 +1,96 @@
+#include "squelch.h"
+#include <algorithm>
+#include <cmath>
+
+static const float LEVEL_TAU_S = 0.01f;       // Suavização da potência (blocos de ~2 ms são ruidosos)
+static const float FLOOR_FALL_TAU_S = 0.2f;   // Piso acompanha quedas rápido
+static const float FLOOR_RISE_DB_S = 2.0f;    // e sobe no máximo isto por segundo
+static const float MIN_POWER = 1e-12f;        // -120 dBFS
+
+// ============ Squelch Implementation ============
+
+Squelch::Squelch() {
+    configure(SquelchConfig());
+    reset();
+}
+
+void Squelch::configure(const SquelchConfig& config) {
+    requested_threshold.store(std::max(config.threshold_db, 0.0f));
+    requested_hysteresis.store(std::max(config.hysteresis_db, 0.0f));
+    requested_attack.store(std::max(config.attack_s, 0.0f));
+    requested_release.store(std::max(config.release_s, 0.0f));
+    requested_enabled.store(config.enabled);
+}
+
+SquelchConfig Squelch::getConfig() const {
+    SquelchConfig config;
+    config.enabled = requested_enabled.load();
+    config.threshold_db = requested_threshold.load();
+    config.hysteresis_db = requested_hysteresis.load();
+    config.attack_s = requested_attack.load();
+    config.release_s = requested_release.load();
+    return config;
+}
+
+bool Squelch::update(float power, double seconds) {
+    const float dt = static_cast<float>(seconds);
+    const float p = std::max(power, MIN_POWER);
+    level = has_floor ? level + (p - level) * std::min(1.0f, dt / LEVEL_TAU_S) : p;
+    const float db = 10.0f * std::log10(std::max(level, MIN_POWER));
+    level_db.store(db, std::memory_order_relaxed);
+
+    // O piso é estimado mesmo com o squelch desligado: ligar já encontra o valor certo
+    const bool enabled = requested_enabled.load(std::memory_order_relaxed);
+    float fl = floor_db.load(std::memory_order_relaxed);
+    bool is_open = enabled && open.load(std::memory_order_relaxed);
+    if (!has_floor) {
+        fl = db;
+        has_floor = true;
+    } else if (db < fl) {
+        fl += (db - fl) * std::min(1.0f, dt / FLOOR_FALL_TAU_S);
+    } else if (!is_open) {
+        fl += std::min(db - fl, FLOOR_RISE_DB_S * dt);
+    }
+    floor_db.store(fl, std::memory_order_relaxed);
+
+    if (!enabled) {
+        above_time = 0.0f;
+        below_time = 0.0f;
+        open.store(true, std::memory_order_relaxed);
+        return true;
+    }
+
+    const float snr = db - fl;
+    const float threshold = requested_threshold.load(std::memory_order_relaxed);
+    if (!is_open) {
+        // Abre depois de attack_s contínuos acima do limiar; o nível entra no
+        // teste junto com o tempo, senão attack 0 abriria com o contador zerado
+        const bool above = snr >= threshold;
+        above_time = above ? above_time + dt : 0.0f;
+        if (above && above_time >= requested_attack.load(std::memory_order_relaxed)) {
+            is_open = true;
+            below_time = 0.0f;
+        }
+    } else {
+        // Fecha depois de release_s contínuos abaixo do limiar menos a histerese
+        // (idem para release 0)
+        const bool below = snr < threshold - requested_hysteresis.load(std::memory_order_relaxed);
+        below_time = below ? below_time + dt : 0.0f;
+        if (below && below_time >= requested_release.load(std::memory_order_relaxed)) {
+            is_open = false;
+            above_time = 0.0f;
+        }
+    }
+    open.store(is_open, std::memory_order_relaxed);
+    return is_open;
+}
+
+void Squelch::reset() {
+    level = MIN_POWER;
+    has_floor = false;
+    above_time = 0.0f;
+    below_time = 0.0f;
+    open.store(!requested_enabled.load(), std::memory_order_relaxed);
+    level_db.store(-120.0f, std::memory_order_relaxed);
+    floor_db.store(-120.0f, std::memory_order_relaxed);
+}
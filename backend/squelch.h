@@ -0,0 +1,51 @@
+#pragma once
+#include <atomic>
+
+// Configuração do squelch (SET_SQUELCH)
+struct SquelchConfig {
+    bool enabled = false;       // Desligado = sempre aberto
+    float threshold_db = 10.0f; // Abre com o canal este tanto acima do piso de ruído
+    float hysteresis_db = 3.0f; // Fecha só abaixo de threshold - hysteresis
+    float attack_s = 0.01f;     // Tempo acima do limiar antes de abrir
+    float release_s = 0.25f;    // Tempo abaixo do limiar antes de fechar (hang)
+};
+
+// Squelch por potência do canal contra um piso de ruído estimado.
+// O piso desce rápido (acompanha o mínimo) e sobe devagar, limitado em dB/s,
+// e fica congelado com o squelch aberto: uma transmissão longa não vira
+// "ruído". Opera por bloco: uma chamada de update() por processIQ.
+class Squelch {
+public:
+    Squelch();
+
+    // Pode ser chamado de outra thread; vale a partir do próximo update()
+    void configure(const SquelchConfig& config);
+    SquelchConfig getConfig() const;
+
+    // power: potência média do canal no bloco (|iq|^2, fundo de escala = 1);
+    // seconds: duração do bloco. Retorna true se o squelch está aberto.
+    bool update(float power, double seconds);
+
+    bool isOpen() const { return open.load(std::memory_order_relaxed); }
+    float levelDb() const { return level_db.load(std::memory_order_relaxed); }
+    float noiseFloorDb() const { return floor_db.load(std::memory_order_relaxed); }
+
+    void reset();
+
+private:
+    std::atomic<bool> requested_enabled;
+    std::atomic<float> requested_threshold;
+    std::atomic<float> requested_hysteresis;
+    std::atomic<float> requested_attack;
+    std::atomic<float> requested_release;
+
+    float level;                // Potência suavizada (linear)
+    bool has_floor;
+    float above_time;           // Segundos contínuos acima do limiar de abertura
+    float below_time;           // Segundos contínuos abaixo do limiar de fechamento
+
+    // Leitura de outras threads (GET_SQUELCH)
+    std::atomic<bool> open;
+    std::atomic<float> level_db;
+    std::atomic<float> floor_db;
+};
@@ -0,0 +1,153 @@
+// Verifica as codificações de áudio (µ-law e IMA-ADPCM) num ciclo
+// codifica/decodifica com um tom, contra um SNR mínimo, e a continuidade
+// de sequência e timestamp dos quadros do AudioPacketizer.
+#include "audio_processor.h"
+#include "audio_packetizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+static const int SAMPLE_RATE = 48000;
+
+static int failures = 0;
+
+static void check(bool ok, const char* what, double value) {
+    std::printf("[%s] %s: %.1f\n", ok ? "OK" : "FALHA", what, value);
+    if (!ok) failures++;
+}
+
+static std::vector<int16_t> tone(size_t n, double freq, double amplitude) {
+    std::vector<int16_t> pcm(n);
+    for (size_t i = 0; i < n; i++) {
+        pcm[i] = static_cast<int16_t>(std::lround(amplitude * std::sin(2.0 * M_PI * freq * i / SAMPLE_RATE)));
+    }
+    return pcm;
+}
+
+static double snrDb(const std::vector<int16_t>& ref, const std::vector<int16_t>& out) {
+    double signal = 0.0, noise = 0.0;
+    for (size_t i = 0; i < ref.size(); i++) {
+        double d = static_cast<double>(out[i]) - ref[i];
+        signal += static_cast<double>(ref[i]) * ref[i];
+        noise += d * d;
+    }
+    return 10.0 * std::log10(signal / std::max(noise, 1e-9));
+}
+
+// ============ Codecs ============
+
+static void testMuLaw() {
+    // µ-law: SNR quase constante com o nível (companding logarítmico)
+    const double amplitudes[] = { 16000.0, 500.0 };
+    for (double amplitude : amplitudes) {
+        std::vector<int16_t> pcm = tone(SAMPLE_RATE, 1000.0, amplitude);
+        std::vector<uint8_t> encoded(AudioProcessor::encodedBytes(AudioEncoding::MULAW, pcm.size()));
+        std::vector<int16_t> decoded(pcm.size());
+        size_t bytes = AudioProcessor::encodeMuLaw(pcm.data(), pcm.size(), encoded.data());
+        size_t samples = AudioProcessor::decodeMuLaw(encoded.data(), bytes, decoded.data());
+
+        char what[64];
+        std::snprintf(what, sizeof(what), "mu-law, tom de amplitude %.0f, SNR dB", amplitude);
+        double snr = snrDb(pcm, decoded);
+        check(bytes == pcm.size() && samples == pcm.size() && snr > 33.0, what, snr);
+    }
+}
+
+static void testImaAdpcm() {
+    // Em blocos de 20 ms com o estado encadeado, como no empacotador;
+    // cada bloco decodifica sozinho a partir do seu cabeçalho
+    const size_t block = SAMPLE_RATE / 50;
+    std::vector<int16_t> pcm = tone(50 * block, 1000.0, 16000.0);
+    std::vector<int16_t> decoded(pcm.size());
+    std::vector<uint8_t> encoded(AudioProcessor::encodedBytes(AudioEncoding::IMA_ADPCM, block));
+    ImaAdpcmState state;
+    bool sizes_ok = true;
+
+    for (size_t pos = 0; pos < pcm.size(); pos += block) {
+        size_t bytes = AudioProcessor::encodeImaAdpcm(&pcm[pos], block, state, encoded.data());
+        size_t samples = AudioProcessor::decodeImaAdpcm(encoded.data(), bytes, block, &decoded[pos]);
+        sizes_ok = sizes_ok && bytes == encoded.size() && samples == block;
+    }
+
+    // O primeiro bloco parte do preditor zerado: a adaptação fica fora da medida
+    std::vector<int16_t> ref(pcm.begin() + block, pcm.end());
+    std::vector<int16_t> out(decoded.begin() + block, decoded.end());
+    double snr = snrDb(ref, out);
+    check(sizes_ok && snr > 30.0, "IMA-ADPCM, tom de amplitude 16000, SNR dB", snr);
+}
+
+// ============ Empacotador ============
+
+static void testPacketizer() {
+    AudioPacketizer packetizer(SAMPLE_RATE, 20);
+    packetizer.setEncodings(AudioPacketizer::encodingBit(AudioEncoding::PCM16) |
+                            AudioPacketizer::encodingBit(AudioEncoding::MULAW) |
+                            AudioPacketizer::encodingBit(AudioEncoding::IMA_ADPCM));
+    const size_t frame = packetizer.samplesPerFrame();
+    const AudioEncoding encodings[] = { AudioEncoding::PCM16, AudioEncoding::MULAW, AudioEncoding::IMA_ADPCM };
+
+    std::vector<int16_t> pcm = tone(100 * frame, 440.0, 12000.0);
+    std::vector<int16_t> adpcm_out;
+    uint32_t expected_sequence = 0;
+    uint64_t expected_timestamp = 0;
+    size_t frames = 0;
+    bool continuous = true;
+
+    auto collect = [&](size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            for (AudioEncoding e : encodings) {
+                AudioFrameHeader header;
+                std::memcpy(&header, packetizer.frame(i, e), sizeof(header));
+                continuous = continuous && header.sequence == expected_sequence &&
+                             header.timestamp == expected_timestamp && header.samples == frame &&
+                             header.encoding == static_cast<uint8_t>(e) &&
+                             packetizer.frameBytes(i, e) == sizeof(header) + AudioProcessor::encodedBytes(e, frame);
+                if (e == AudioEncoding::IMA_ADPCM) {
+                    size_t at = adpcm_out.size();
+                    adpcm_out.resize(at + frame);
+                    AudioProcessor::decodeImaAdpcm(packetizer.frame(i, e) + sizeof(header),
+                                                   packetizer.frameBytes(i, e) - sizeof(header),
+                                                   frame, &adpcm_out[at]);
+                }
+            }
+            expected_sequence++;
+            expected_timestamp += frame;
+            frames++;
+        }
+    };
+
+    // Blocos de tamanho irregular, como os do demodulador
+    const size_t chunks[] = { 137, 911, 1500, 64, 2048 };
+    size_t pos = 0;
+    for (size_t k = 0; pos < pcm.size(); k++) {
+        size_t n = std::min(chunks[k % 5], pcm.size() - pos);
+        collect(packetizer.push(&pcm[pos], n, true));
+        pos += n;
+    }
+    check(continuous && frames == 100, "empacotador: quadros com sequencia e timestamp continuos", frames);
+
+    std::vector<int16_t> ref(pcm.begin() + frame, pcm.end());
+    std::vector<int16_t> out(adpcm_out.begin() + frame, adpcm_out.end());
+    double snr = snrDb(ref, out);
+    check(snr > 30.0, "empacotador: IMA-ADPCM dos quadros, SNR dB", snr);
+
+    // Perda de blocos IQ: o timestamp pula, a sequência não
+    const uint64_t gap = 3 * frame + 17;
+    packetizer.advanceClock(gap);
+    expected_timestamp += gap;
+    collect(packetizer.push(pcm.data(), frame, true));
+    check(continuous && frames == 101, "empacotador: timestamp salta com advanceClock, sequencia segue", frames);
+}
+
+int main() {
+    testMuLaw();
+    testImaAdpcm();
+    testPacketizer();
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,109 @@
+// Verifica que Demodulator::processIQ e AudioProcessor não alocam memória
+// em regime permanente (depois do primeiro bloco), em todos os modos.
+#include "demodulator.h"
+#include "audio_processor.h"
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <malloc.h>
+#endif
+
+// ============ Alocador global com contagem ============
+
+static std::atomic<bool> counting(false);
+static std::atomic<size_t> allocations(0);
+
+static void* countedAlloc(size_t size, size_t alignment) {
+    if (counting) allocations++;
+    if (size == 0) size = 1;
+    void* p = nullptr;
+    if (alignment <= alignof(std::max_align_t)) {
+        p = std::malloc(size);
+    } else {
+        size = (size + alignment - 1) / alignment * alignment;
+#if defined(_MSC_VER)
+        p = _aligned_malloc(size, alignment);
+#else
+        p = std::aligned_alloc(alignment, size);
+#endif
+    }
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+static void countedFree(void* p, size_t alignment) {
+#if defined(_MSC_VER)
+    if (alignment > alignof(std::max_align_t)) { _aligned_free(p); return; }
+#endif
+    (void)alignment;
+    std::free(p);
+}
+
+void* operator new(size_t size) { return countedAlloc(size, 0); }
+void* operator new[](size_t size) { return countedAlloc(size, 0); }
+void* operator new(size_t size, std::align_val_t al) { return countedAlloc(size, static_cast<size_t>(al)); }
+void* operator new[](size_t size, std::align_val_t al) { return countedAlloc(size, static_cast<size_t>(al)); }
+void operator delete(void* p) noexcept { countedFree(p, 0); }
+void operator delete[](void* p) noexcept { countedFree(p, 0); }
+void operator delete(void* p, size_t) noexcept { countedFree(p, 0); }
+void operator delete[](void* p, size_t) noexcept { countedFree(p, 0); }
+void operator delete(void* p, std::align_val_t al) noexcept { countedFree(p, static_cast<size_t>(al)); }
+void operator delete[](void* p, std::align_val_t al) noexcept { countedFree(p, static_cast<size_t>(al)); }
+void operator delete(void* p, size_t, std::align_val_t al) noexcept { countedFree(p, static_cast<size_t>(al)); }
+void operator delete[](void* p, size_t, std::align_val_t al) noexcept { countedFree(p, static_cast<size_t>(al)); }
+
+// ============ Teste ============
+
+static const size_t BLOCK_BYTES = 16384;
+
+int main() {
+    // Portadora com FM de 1 kHz em 2.048 Msps
+    std::vector<uint8_t> iq(BLOCK_BYTES);
+    double phase = 0.0;
+    for (size_t k = 0; k < BLOCK_BYTES / 2; k++) {
+        phase += 2.0 * M_PI * 5000.0 * std::sin(2.0 * M_PI * 1000.0 * k / 2048000.0) / 2048000.0;
+        iq[2 * k] = static_cast<uint8_t>(127.5 + 100.0 * std::cos(phase));
+        iq[2 * k + 1] = static_cast<uint8_t>(127.5 + 100.0 * std::sin(phase));
+    }
+
+    Demodulator demod;
+    AudioProcessor agc;
+    demod.reserve(BLOCK_BYTES);
+
+    std::vector<float> audio(demod.maxOutputSamples(BLOCK_BYTES));
+    std::vector<int16_t> pcm(audio.size());
+
+    const DemodMode modes[] = { DemodMode::NFM, DemodMode::WFM, DemodMode::AM,
+                                DemodMode::USB, DemodMode::LSB, DemodMode::CW };
+    int failures = 0;
+
+    for (DemodMode mode : modes) {
+        demod.setMode(mode);
+
+        // Aquecimento: os buffers internos atingem o tamanho do bloco
+        demod.processIQ(iq.data(), iq.size(), audio.data(), audio.size());
+
+        size_t produced = 0;
+        allocations = 0;
+        counting = true;
+        for (int block = 0; block < 200; block++) {
+            size_t n = demod.processIQ(iq.data(), iq.size(), audio.data(), audio.size());
+            agc.processAudio(audio.data(), n);
+            agc.floatToPCM16(audio.data(), n, pcm.data());
+            produced += n;
+        }
+        counting = false;
+
+        bool ok = allocations == 0 && produced > 0;
+        std::printf("[%s] modo %d: %zu alocacoes, %zu amostras de audio\n",
+                    ok ? "OK" : "FALHA", static_cast<int>(mode), allocations.load(), produced);
+        if (!ok) failures++;
+    }
+
+    return failures == 0 ? 0 : 1;
+}
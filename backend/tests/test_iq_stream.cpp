@@ -0,0 +1,146 @@
+// Verifica a codificação dos quadros de IQ (delta + zigzag + Rice) sem
+// perdas: quadros int16/int8 aleatórios, de fundo de escala e com valores
+// que caem no escape voltam bit a bit iguais em IQStreamer::decode, e
+// quadros truncados retornam 0.
+#include "iq_stream.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    std::printf("[%s] %s\n", ok ? "OK" : "FALHA", what);
+    if (!ok) failures++;
+}
+
+// Codifica, decodifica e compara; depois trunca o quadro em vários pontos
+static void roundTrip(const char* name, const std::vector<int16_t>& iq, uint8_t format, bool compress) {
+    IQFrameHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.format = format;
+    header.coding = compress ? IQ_CODING_DELTA_RICE : IQ_CODING_RAW;
+    header.samples = static_cast<uint32_t>(iq.size() / 2);
+    header.sample_rate = 64000;
+
+    std::vector<uint8_t> frame(IQStreamer::maxFrameBytes(header.samples, format, compress));
+    size_t len = IQStreamer::encode(header, iq.data(), frame.data());
+
+    std::vector<int16_t> out(iq.size(), 0x5A5A);
+    size_t samples = IQStreamer::decode(frame.data(), len, out.data());
+    char what[128];
+    std::snprintf(what, sizeof(what), "%s %s %s: %zu bytes", name, format == IQ_FORMAT_INT8 ? "int8" : "int16",
+                  compress ? "delta+Rice" : "cru", len);
+    check(len <= frame.size() && samples == header.samples && out == iq, what);
+
+    const size_t cuts[] = { len - 1, len / 2 + sizeof(IQFrameHeader) / 2, sizeof(IQFrameHeader), sizeof(IQFrameHeader) - 1, 0 };
+    bool rejected = true;
+    for (size_t cut : cuts) {
+        if (cut >= len) continue;
+        rejected = rejected && IQStreamer::decode(frame.data(), cut, out.data()) == 0;
+    }
+    std::snprintf(what, sizeof(what), "%s %s %s truncado retorna 0", name, format == IQ_FORMAT_INT8 ? "int8" : "int16",
+                  compress ? "delta+Rice" : "cru");
+    check(rejected, what);
+}
+
+static void allCodings(const char* name, const std::vector<int16_t>& iq, uint8_t format) {
+    roundTrip(name, iq, format, true);
+    roundTrip(name, iq, format, false);
+}
+
+int main() {
+    std::mt19937 rng(12345);
+    const size_t values = 2 * 1280;
+
+    // Aleatório uniforme: resíduos grandes, k alto
+    {
+        std::uniform_int_distribution<int> full16(-32768, 32767), full8(-128, 127);
+        std::vector<int16_t> a(values), b(values);
+        for (size_t i = 0; i < values; i++) {
+            a[i] = static_cast<int16_t>(full16(rng));
+            b[i] = static_cast<int16_t>(full8(rng));
+        }
+        allCodings("aleatorio", a, IQ_FORMAT_INT16);
+        allCodings("aleatorio", b, IQ_FORMAT_INT8);
+    }
+
+    // Fundo de escala alternando: o maior delta possível (zigzag = 2^17 - 1)
+    {
+        std::vector<int16_t> a(values), b(values);
+        for (size_t i = 0; i < values; i++) {
+            bool high = (i / 2) % 2 == 0;
+            a[i] = high ? 32767 : -32768;
+            b[i] = high ? 127 : -128;
+        }
+        allCodings("fundo de escala", a, IQ_FORMAT_INT16);
+        allCodings("fundo de escala", b, IQ_FORMAT_INT8);
+    }
+
+    // Sinal pequeno (k baixo) com picos raros: os picos saem pelo escape
+    {
+        std::normal_distribution<double> noise(0.0, 4.0);
+        std::vector<int16_t> a(values), b(values);
+        for (size_t i = 0; i < values; i++) {
+            double v = 40.0 * std::sin(2.0 * M_PI * (i / 2) / 64.0) + noise(rng);
+            a[i] = static_cast<int16_t>(std::lround(v));
+            b[i] = static_cast<int16_t>(std::lround(v / 2));
+        }
+        for (size_t i = 100; i < values; i += 331) {
+            a[i] = (i & 2) ? 32767 : -32768;
+            b[i] = (i & 2) ? 127 : -128;
+        }
+        allCodings("picos no escape", a, IQ_FORMAT_INT16);
+        allCodings("picos no escape", b, IQ_FORMAT_INT8);
+    }
+
+    // Quadros de uma amostra e de zeros (menor payload possível)
+    {
+        allCodings("uma amostra", std::vector<int16_t>{ -32768, 32767 }, IQ_FORMAT_INT16);
+        allCodings("zeros", std::vector<int16_t>(values, 0), IQ_FORMAT_INT8);
+    }
+
+    // Ponta a ponta: com e sem compressão, os mesmos valores saem do IQStreamer
+    {
+        std::vector<uint8_t> raw(16384);
+        double phase = 0.0;
+        for (size_t k = 0; k < raw.size() / 2; k++) {
+            phase += 2.0 * M_PI * 12000.0 / 2048000.0;
+            raw[2 * k] = static_cast<uint8_t>(127.5 + 90.0 * std::cos(phase));
+            raw[2 * k + 1] = static_cast<uint8_t>(127.5 + 90.0 * std::sin(phase));
+        }
+        IQStreamSettings settings;
+        settings.bandwidth_hz = 25000.0f;
+        IQStreamer plain(2048000, settings);
+        settings.compress = true;
+        IQStreamer packed(2048000, settings);
+
+        size_t frames = 0;
+        bool equal = true;
+        std::vector<int16_t> a, b;
+        for (int block = 0; block < 40; block++) {
+            bool fa = plain.process(raw.data(), raw.size());
+            bool fb = packed.process(raw.data(), raw.size());
+            equal = equal && fa == fb;
+            if (!fa || !fb) continue;
+            IQFrameHeader ha, hb;
+            std::memcpy(&ha, plain.frame(), sizeof(ha));
+            std::memcpy(&hb, packed.frame(), sizeof(hb));
+            a.assign(2 * ha.samples, 0);
+            b.assign(2 * hb.samples, 1);
+            equal = equal && IQStreamer::decode(plain.frame(), plain.frameSize(), a.data()) == ha.samples &&
+                    IQStreamer::decode(packed.frame(), packed.frameSize(), b.data()) == hb.samples &&
+                    a == b && ha.sequence == hb.sequence;
+            frames++;
+        }
+        check(equal && frames > 0, "IQStreamer: quadros comprimidos iguais aos crus");
+    }
+
+    return failures == 0 ? 0 : 1;
+}
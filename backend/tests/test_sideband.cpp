@@ -0,0 +1,124 @@
+// Verifica a banda lateral do Demodulator: um tom +f acima do centro sai
+// como áudio em f no USB e some no LSB; um tom -f, o contrário. No CW, uma
+// portadora no centro vira o tom de batimento configurado (setCWPitch).
+#include "demodulator.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+static const int INPUT_RATE = 2048000;
+static const int AUDIO_RATE = 48000;
+static const size_t BLOCK_BYTES = 16384;
+static const int BLOCKS = 100;               // ~0.4 s de IQ
+static const int WARMUP_BLOCKS = 20;         // Filtros e resampler assentando
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    std::printf("[%s] %s\n", ok ? "OK" : "FALHA", what);
+    if (!ok) failures++;
+}
+
+// Potência do áudio em freq (Goertzel normalizado pelo tamanho)
+static double tonePower(const std::vector<float>& audio, double freq) {
+    const double w = 2.0 * M_PI * freq / AUDIO_RATE;
+    const double coeff = 2.0 * std::cos(w);
+    double s1 = 0.0, s2 = 0.0;
+    for (float x : audio) {
+        double s0 = x + coeff * s1 - s2;
+        s2 = s1;
+        s1 = s0;
+    }
+    double power = s1 * s1 + s2 * s2 - coeff * s1 * s2;
+    return power / (static_cast<double>(audio.size()) * audio.size());
+}
+
+static double toDb(double power) {
+    return 10.0 * std::log10(std::max(power, 1e-30));
+}
+
+struct Peak {
+    double freq;
+    double power;
+};
+
+// Pico do áudio entre 100 Hz e 4 kHz, em passos de 10 Hz
+static Peak findPeak(const std::vector<float>& audio) {
+    Peak best = { 0.0, 0.0 };
+    for (double f = 100.0; f <= 4000.0; f += 10.0) {
+        double p = tonePower(audio, f);
+        if (p > best.power) best = { f, p };
+    }
+    return best;
+}
+
+// Áudio demodulado de uma portadora em offset_hz do centro
+static std::vector<float> demodulate(DemodMode mode, double offset_hz, float cw_pitch = 0.0f) {
+    Demodulator demod(INPUT_RATE);
+    demod.setMode(mode);
+    if (cw_pitch > 0.0f) demod.setCWPitch(cw_pitch);
+    demod.reserve(BLOCK_BYTES);
+
+    std::vector<uint8_t> iq(BLOCK_BYTES);
+    std::vector<float> block(demod.maxOutputSamples(BLOCK_BYTES));
+    std::vector<float> audio;
+    double phase = 0.0;
+    const double step = 2.0 * M_PI * offset_hz / INPUT_RATE;
+
+    for (int b = 0; b < BLOCKS; b++) {
+        for (size_t k = 0; k < BLOCK_BYTES / 2; k++) {
+            iq[2 * k] = static_cast<uint8_t>(std::lround(127.5 + 60.0 * std::cos(phase)));
+            iq[2 * k + 1] = static_cast<uint8_t>(std::lround(127.5 + 60.0 * std::sin(phase)));
+            phase = std::fmod(phase + step, 2.0 * M_PI);
+        }
+        size_t n = demod.processIQ(iq.data(), iq.size(), block.data(), block.size());
+        if (b >= WARMUP_BLOCKS) audio.insert(audio.end(), block.begin(), block.begin() + n);
+    }
+    return audio;
+}
+
+int main() {
+    const double tone = 1000.0;
+    char what[128];
+
+    // Tom acima do centro: USB entrega f, LSB rejeita
+    std::vector<float> usb_upper = demodulate(DemodMode::USB, +tone);
+    std::vector<float> lsb_upper = demodulate(DemodMode::LSB, +tone);
+    Peak peak = findPeak(usb_upper);
+    double rejection = toDb(tonePower(usb_upper, tone)) - toDb(tonePower(lsb_upper, tone));
+    std::snprintf(what, sizeof(what), "USB, tom +%.0f Hz: pico em %.0f Hz, LSB %.1f dB abaixo", tone, peak.freq, rejection);
+    check(std::fabs(peak.freq - tone) <= 10.0 && rejection > 30.0, what);
+
+    // Tom abaixo do centro: LSB entrega f (espelhado), USB rejeita
+    std::vector<float> lsb_lower = demodulate(DemodMode::LSB, -tone);
+    std::vector<float> usb_lower = demodulate(DemodMode::USB, -tone);
+    peak = findPeak(lsb_lower);
+    rejection = toDb(tonePower(lsb_lower, tone)) - toDb(tonePower(usb_lower, tone));
+    std::snprintf(what, sizeof(what), "LSB, tom -%.0f Hz: pico em %.0f Hz, USB %.1f dB abaixo", tone, peak.freq, rejection);
+    check(std::fabs(peak.freq - tone) <= 10.0 && rejection > 30.0, what);
+
+    // CW: portadora no centro sai no tom do BFO
+    const float pitches[] = { 700.0f, 1000.0f };
+    for (float pitch : pitches) {
+        std::vector<float> cw = demodulate(DemodMode::CW, 0.0, pitch);
+        peak = findPeak(cw);
+        std::snprintf(what, sizeof(what), "CW, BFO %.0f Hz: pico em %.0f Hz", pitch, peak.freq);
+        check(std::fabs(peak.freq - pitch) <= 10.0 && toDb(peak.power) > -40.0, what);
+    }
+
+    // CW: portadora fora da banda de 500 Hz em volta do tom fica atenuada
+    {
+        std::vector<float> inside = demodulate(DemodMode::CW, 0.0, 700.0f);
+        std::vector<float> outside = demodulate(DemodMode::CW, 1500.0, 700.0f);
+        double drop = toDb(tonePower(inside, 700.0)) - toDb(tonePower(outside, 2200.0));
+        std::snprintf(what, sizeof(what), "CW, portadora 1.5 kHz fora do filtro: %.1f dB abaixo", drop);
+        check(drop > 30.0, what);
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,68 @@
+// Verifica a abertura e o fechamento do Squelch: com attack/release
+// normais e com attack/release 0 (SET_SQUELCH {"attack_ms":0}), ruído
+// sozinho não abre e uma portadora forte não fecha a cada bloco.
+#include "squelch.h"
+#include <cstdio>
+#include <random>
+
+static const double BLOCK_S = 0.002;          // Blocos de ~2 ms, como no processIQ
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    std::printf("[%s] %s\n", ok ? "OK" : "FALHA", what);
+    if (!ok) failures++;
+}
+
+struct Transitions {
+    int opens;
+    int closes;
+    bool open;
+};
+
+// Roda blocos com potência em volta de power (ruído de ±1 dB) e conta transições
+static Transitions run(Squelch& squelch, float power, int blocks, std::mt19937& rng) {
+    std::uniform_real_distribution<float> jitter(0.8f, 1.25f);
+    Transitions t = { 0, 0, squelch.isOpen() };
+    for (int b = 0; b < blocks; b++) {
+        bool open = squelch.update(power * jitter(rng), BLOCK_S);
+        if (open && !t.open) t.opens++;
+        if (!open && t.open) t.closes++;
+        t.open = open;
+    }
+    return t;
+}
+
+static void scenario(const char* name, float attack_s, float release_s) {
+    std::mt19937 rng(7);
+    Squelch squelch;
+    SquelchConfig cfg;
+    cfg.enabled = true;
+    cfg.attack_s = attack_s;
+    cfg.release_s = release_s;
+    squelch.configure(cfg);
+    char what[128];
+
+    // Ligado começa aberto: fecha no ruído e não volta a abrir
+    run(squelch, 1e-6f, 500, rng);
+    Transitions noise = run(squelch, 1e-6f, 1000, rng);
+    std::snprintf(what, sizeof(what), "%s: ruido mantem fechado (%d aberturas)", name, noise.opens);
+    check(!noise.open && noise.opens == 0, what);
+
+    // Portadora 30 dB acima: abre uma vez e fica aberta
+    Transitions carrier = run(squelch, 1e-3f, 1000, rng);
+    std::snprintf(what, sizeof(what), "%s: portadora abre uma vez e nao fecha (%d/%d)", name, carrier.opens,
+                  carrier.closes);
+    check(carrier.open && carrier.opens == 1 && carrier.closes == 0, what);
+
+    // Volta o ruído: fecha uma vez e fica fechado
+    Transitions after = run(squelch, 1e-6f, 1000, rng);
+    std::snprintf(what, sizeof(what), "%s: fim da portadora fecha uma vez (%d/%d)", name, after.opens, after.closes);
+    check(!after.open && after.opens == 0 && after.closes == 1, what);
+}
+
+int main() {
+    scenario("attack 10 ms, release 250 ms", 0.01f, 0.25f);
+    scenario("attack 0, release 0", 0.0f, 0.0f);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,198 @@
+// Verifica o StereoDecoder e o RdsDecoder com um composto sintético: piloto
+// de 19 kHz, um tom só no canal esquerdo e grupos 0A de RDS (PI e PS) em
+// 57 kHz, tudo amarrado ao piloto com um erro de relógio de 50 ppm. O
+// estéreo tem de travar e separar L de R; o RDS tem de sincronizar e
+// entregar PI e PS. Sem piloto, o decodificador fica em mono.
+#include "fm_stereo.h"
+#include "rds_decoder.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+static const int COMPOSITE_RATE = 256000;    // Canal WFM a partir de 2.048 Msps
+static const int AUDIO_RATE = 48000;
+static const size_t BLOCK = 4096;
+static const double DURATION_S = 3.0;
+static const double WARMUP_S = 1.0;          // PLL, blend e filtros assentando
+static const double CLOCK_PPM = 50.0;
+
+// Desvios em Hz; o discriminador entrega 2 * desvio / taxa
+static const double PILOT_DEV = 6750.0;
+static const double TONE_DEV = 40000.0;      // L; R mudo
+static const double RDS_DEV = 2000.0;
+static const double TONE_HZ = 1000.0;
+
+static const uint16_t TEST_PI = 0x7A12;
+static const uint8_t TEST_PTY = 10;
+static const char TEST_PS[] = "SPEEDSDR";
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    std::printf("[%s] %s\n", ok ? "OK" : "FALHA", what);
+    if (!ok) failures++;
+}
+
+// ---- Codificador RDS (IEC 62106), independente do decodificador ----
+
+static uint16_t rdsCheckword(uint16_t data) {
+    // Resto de m(x) x^10 / g(x), g(x) = x^10 + x^8 + x^7 + x^5 + x^4 + x^3 + 1
+    uint32_t reg = static_cast<uint32_t>(data) << 10;
+    for (int bit = 25; bit >= 10; bit--) {
+        if (reg & (1u << bit)) reg ^= 0x5B9u << (bit - 10);
+    }
+    return static_cast<uint16_t>(reg & 0x3FF);
+}
+
+static void appendBlock(std::vector<int>& bits, uint16_t data, uint16_t offset) {
+    uint32_t block = (static_cast<uint32_t>(data) << 10) | (rdsCheckword(data) ^ offset);
+    for (int bit = 25; bit >= 0; bit--) bits.push_back((block >> bit) & 1);
+}
+
+// Grupos 0A em sequência (endereços 0..3 do PS), repetidos até n_groups
+static std::vector<int> rdsBits(int n_groups) {
+    std::vector<int> bits;
+    for (int g = 0; g < n_groups; g++) {
+        uint16_t addr = static_cast<uint16_t>(g % 4);
+        uint16_t b = static_cast<uint16_t>((TEST_PTY << 5) | addr);   // Tipo 0, versão A
+        uint16_t d = static_cast<uint16_t>((static_cast<uint8_t>(TEST_PS[2 * addr]) << 8) |
+                                           static_cast<uint8_t>(TEST_PS[2 * addr + 1]));
+        appendBlock(bits, TEST_PI, 0x0FC);
+        appendBlock(bits, b, 0x198);
+        appendBlock(bits, 0xE0CD, 0x168);   // Frequências alternativas: não decodificadas
+        appendBlock(bits, d, 0x1B4);
+    }
+    return bits;
+}
+
+// ---- Composto ----
+
+struct Result {
+    bool locked;
+    float pilot_level;
+    double left_db;
+    double right_db;
+    bool rds_synced;
+    uint16_t pi;
+    uint8_t pty;
+    std::string ps;
+    uint64_t groups;
+};
+
+// Potência do tom em freq (Goertzel normalizado pelo tamanho)
+static double toneDb(const std::vector<float>& audio, double freq) {
+    const double w = 2.0 * M_PI * freq / AUDIO_RATE;
+    const double coeff = 2.0 * std::cos(w);
+    double s1 = 0.0, s2 = 0.0;
+    for (float x : audio) {
+        double s0 = x + coeff * s1 - s2;
+        s2 = s1;
+        s1 = s0;
+    }
+    double power = (s1 * s1 + s2 * s2 - coeff * s1 * s2) / (static_cast<double>(audio.size()) * audio.size());
+    return 10.0 * std::log10(std::max(power, 1e-30));
+}
+
+static Result run(bool with_pilot) {
+    StereoDecoder stereo(COMPOSITE_RATE, AUDIO_RATE);
+    RdsDecoder rds(COMPOSITE_RATE);
+    stereo.reserve(BLOCK);
+    rds.reserve(BLOCK);
+
+    const size_t total = static_cast<size_t>(DURATION_S * COMPOSITE_RATE);
+    const size_t warmup_out = static_cast<size_t>(WARMUP_S * AUDIO_RATE);
+    const double scale = 2.0 / COMPOSITE_RATE;
+    const double pilot_hz = 19000.0 * (1.0 + CLOCK_PPM * 1e-6);
+    const double bit_rate = pilot_hz / 16.0;
+    const double theta0 = 1.0;   // Fase inicial qualquer: o PLL tem de puxar
+    const std::vector<int> bits = rdsBits(static_cast<int>(DURATION_S * bit_rate / 104.0) + 1);
+
+    std::vector<float> mpx(BLOCK);
+    std::vector<float> out(2 * stereo.maxOutput(BLOCK));
+    std::vector<float> left, right;
+    size_t produced = 0;
+    size_t bit_index = 0;
+    int level = 1;   // Nível diferencial corrente (+1/-1)
+
+    for (size_t start = 0; start < total; start += BLOCK) {
+        const size_t n = std::min(BLOCK, total - start);
+        for (size_t k = 0; k < n; k++) {
+            const double t = static_cast<double>(start + k) / COMPOSITE_RATE;
+            const double theta = 2.0 * M_PI * pilot_hz * t + theta0;
+
+            // L-only: soma e diferença iguais; diferença em 38 kHz = sen(2 theta)
+            const double l = TONE_DEV * std::sin(2.0 * M_PI * TONE_HZ * t);
+            double x = 0.5 * l + 0.5 * l * std::sin(2.0 * theta);
+            if (with_pilot) x += PILOT_DEV * std::sin(theta);
+
+            // RDS: codificação diferencial e símbolo bifásico em 57 kHz = 3 theta
+            const double bit_pos = t * bit_rate;
+            const size_t b = static_cast<size_t>(bit_pos);
+            while (bit_index <= b) {
+                if (bits[bit_index % bits.size()]) level = -level;
+                bit_index++;
+            }
+            const double half = (bit_pos - static_cast<double>(b)) < 0.5 ? 1.0 : -1.0;
+            x += RDS_DEV * level * half * std::sin(3.0 * theta);
+
+            mpx[k] = static_cast<float>(x * scale);
+        }
+
+        size_t count = stereo.process(mpx.data(), n, out.data());
+        rds.process(mpx.data(), stereo.pilotPhasor(), n);
+        for (size_t i = 0; i < count; i++, produced++) {
+            if (produced < warmup_out) continue;
+            left.push_back(out[2 * i]);
+            right.push_back(out[2 * i + 1]);
+        }
+    }
+
+    Result r;
+    r.locked = stereo.isLocked();
+    r.pilot_level = stereo.pilotLevel();
+    r.left_db = toneDb(left, TONE_HZ);
+    r.right_db = toneDb(right, TONE_HZ);
+    r.rds_synced = rds.isSynced();
+    r.pi = rds.programId();
+    r.pty = rds.programType();
+    r.ps = rds.programService();
+    r.groups = rds.groups();
+    return r;
+}
+
+int main() {
+    char what[160];
+
+    Result st = run(true);
+    std::snprintf(what, sizeof(what), "Piloto travado (nível %.2f)", st.pilot_level);
+    check(st.locked && st.pilot_level > 0.8f && st.pilot_level < 1.2f, what);
+
+    double separation = st.left_db - st.right_db;
+    std::snprintf(what, sizeof(what), "Tom só em L: L %.1f dB, R %.1f dB (separação %.1f dB)",
+                  st.left_db, st.right_db, separation);
+    check(separation > 30.0, what);
+
+    std::snprintf(what, sizeof(what), "RDS sincronizado (%llu grupos)", static_cast<unsigned long long>(st.groups));
+    check(st.rds_synced && st.groups > 20, what);
+
+    std::snprintf(what, sizeof(what), "RDS PI 0x%04X, PTY %u", st.pi, st.pty);
+    check(st.pi == TEST_PI && st.pty == TEST_PTY, what);
+
+    std::snprintf(what, sizeof(what), "RDS PS \"%s\"", st.ps.c_str());
+    check(st.ps == TEST_PS, what);
+
+    // Sem piloto: não trava e L = R (mono)
+    Result mono = run(false);
+    double imbalance = std::fabs(mono.left_db - mono.right_db);
+    std::snprintf(what, sizeof(what), "Sem piloto: mono (travado %d, L %.1f dB, R %.1f dB)",
+                  mono.locked, mono.left_db, mono.right_db);
+    check(!mono.locked && imbalance < 0.5, what);
+
+    return failures == 0 ? 0 : 1;
+}
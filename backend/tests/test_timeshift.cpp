@@ -0,0 +1,150 @@
+// Verifica a captura por squelch do IQTimeShift: ruído, depois sinal; na
+// abertura do Squelch o trigger grava a janela pré-trigger (já no anel) e a
+// pós-trigger (que ainda vai chegar), byte a byte, com a anotação do motivo.
+// Também: fonte parada no pós-trigger e post maior que o anel.
+#include "iq_timeshift.h"
+#include "squelch.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const int SAMPLE_RATE = 100000;
+static const size_t BLOCK_SAMPLES = 1000;       // 10 ms por bloco
+static const double PRE_S = 1.0;
+static const double POST_S = 0.5;
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    std::printf("[%s] %s\n", ok ? "OK" : "FALHA", what);
+    if (!ok) failures++;
+}
+
+// Conteúdo conhecido de cada byte do fluxo (sem período curto)
+static uint8_t streamByte(uint64_t pos) {
+    uint64_t x = pos * 0x9E3779B97F4A7C15ull;
+    return static_cast<uint8_t>(x >> 56);
+}
+
+static std::vector<uint8_t> readFile(const std::string& path) {
+    std::ifstream f(path, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+}
+
+int main() {
+    const std::string base = "test_timeshift_squelch";
+    IQTimeShift timeshift(SAMPLE_RATE, 30.0, false);
+
+    Squelch squelch;
+    SquelchConfig cfg;
+    cfg.enabled = true;
+    squelch.configure(cfg);
+
+    RecordingInfo info;
+    info.sample_rate = SAMPLE_RATE;
+    info.center_freq = 145000000;
+    info.gain_db = 0.0f;
+
+    std::vector<uint8_t> block(2 * BLOCK_SAMPLES);
+    uint64_t written = 0;
+    uint64_t trigger_at = 0;
+    bool was_open = true;        // Ligado, o squelch começa aberto e fecha depois do release
+    bool triggered = false;
+    const double block_s = static_cast<double>(BLOCK_SAMPLES) / SAMPLE_RATE;
+
+    // 3 s de ruído, depois sinal 30 dB acima até o fim da janela pós-trigger
+    for (int b = 0; b < 600; b++) {
+        for (size_t i = 0; i < block.size(); i++) block[i] = streamByte(written + i);
+        timeshift.write(block.data(), block.size());
+        written += block.size();
+
+        bool open = squelch.update(b < 300 ? 1e-6f : 1e-3f, block_s);
+        if (open && !was_open && !triggered) {
+            triggered = timeshift.trigger(base, PRE_S, POST_S, info, "squelch");
+            trigger_at = written;
+        }
+        was_open = open;
+        if (triggered && written > trigger_at + static_cast<uint64_t>(POST_S * SAMPLE_RATE * 2)) break;
+    }
+    check(triggered && trigger_at > 300 * block.size(), "squelch abriu com o sinal e disparou a captura");
+
+    for (int i = 0; i < 500 && timeshift.isCapturing(); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    check(!timeshift.isCapturing(), "captura concluida");
+
+    const uint64_t pre_bytes = static_cast<uint64_t>(PRE_S * SAMPLE_RATE) * 2;
+    const uint64_t post_bytes = static_cast<uint64_t>(POST_S * SAMPLE_RATE) * 2;
+    std::vector<uint8_t> data = readFile(base + ".sigmf-data");
+    check(data.size() == pre_bytes + post_bytes, "arquivo com a janela pre + pos-trigger");
+
+    bool pre_ok = data.size() >= pre_bytes;
+    for (uint64_t i = 0; pre_ok && i < pre_bytes; i++) {
+        pre_ok = data[i] == streamByte(trigger_at - pre_bytes + i);
+    }
+    check(pre_ok, "janela pre-trigger gravada byte a byte (ruido antes da abertura)");
+
+    bool post_ok = data.size() == pre_bytes + post_bytes;
+    for (uint64_t i = 0; post_ok && i < post_bytes; i++) {
+        post_ok = data[pre_bytes + i] == streamByte(trigger_at + i);
+    }
+    check(post_ok, "janela pos-trigger gravada byte a byte");
+
+    std::vector<uint8_t> meta = readFile(base + ".sigmf-meta");
+    std::string meta_text(meta.begin(), meta.end());
+    check(meta_text.find("trigger: squelch") != std::string::npos, "anotacao do trigger com o motivo");
+
+    TimeShiftStats st = timeshift.getStats();
+    check(st.captures == 1 && st.overwritten_bytes == 0, "uma captura, nada sobrescrito");
+
+    std::remove((base + ".sigmf-data").c_str());
+    std::remove((base + ".sigmf-meta").c_str());
+
+    // Fonte parada no meio do pós-trigger: a captura fecha sozinha e o
+    // próximo trigger é aceito
+    {
+        const std::string stalled = "test_timeshift_stall";
+        for (int b = 0; b < 10; b++) timeshift.write(block.data(), block.size());
+        bool started = timeshift.trigger(stalled, 0.05, 60.0, info, "manual");
+        for (int i = 0; i < 400 && timeshift.isCapturing(); i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        check(started && !timeshift.isCapturing(), "fonte parada: captura encerrada sem esperar o pos-trigger");
+
+        std::vector<uint8_t> stall_meta = readFile(stalled + ".sigmf-meta");
+        std::string stall_text(stall_meta.begin(), stall_meta.end());
+        check(stall_text.find("fonte parada") != std::string::npos, "fonte parada: anotada no .sigmf-meta");
+
+        bool again = timeshift.trigger(stalled, 0.05, 0.0, info, "manual");
+        for (int i = 0; i < 400 && timeshift.isCapturing(); i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        check(again, "fonte parada: novo trigger aceito");
+        std::remove((stalled + ".sigmf-data").c_str());
+        std::remove((stalled + ".sigmf-meta").c_str());
+    }
+
+    // post enorme fica limitado ao tamanho do anel (30 s): a captura termina
+    {
+        const std::string capped = "test_timeshift_cap";
+        bool started = timeshift.trigger(capped, 0.0, 1e6, info, "manual");
+        for (int b = 0; b < 3100 && timeshift.isCapturing(); b++) {
+            timeshift.write(block.data(), block.size());
+            if (b % 50 == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        for (int i = 0; i < 400 && timeshift.isCapturing(); i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        std::vector<uint8_t> capped_data = readFile(capped + ".sigmf-data");
+        check(started && !timeshift.isCapturing() && capped_data.size() <= 30 * SAMPLE_RATE * 2 + 4096,
+              "post limitado ao tamanho do anel");
+        std::remove((capped + ".sigmf-data").c_str());
+        std::remove((capped + ".sigmf-meta").c_str());
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,326 @@
+// Verifica o montador e o parser de frames do WebSocketServer pelo socket:
+// tamanhos nas fronteiras do campo de comprimento (125/126/65535/65536),
+// fragmentação acima de setMaxFragmentSize (opcode, FIN e continuação) e
+// mensagens fragmentadas do cliente com ping intercalado.
+#include "server.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+static const int TEST_PORT = 18731;
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    std::printf("[%s] %s\n", ok ? "OK" : "FALHA", what);
+    if (!ok) failures++;
+}
+
+// ============ Cliente mínimo ============
+
+struct Frame {
+    bool fin;
+    uint8_t opcode;
+    size_t header_len;
+    std::vector<uint8_t> payload;
+};
+
+static bool recvAll(int fd, uint8_t* out, size_t len) {
+    size_t got = 0;
+    while (got < len) {
+        ssize_t n = recv(fd, out + got, len - got, 0);
+        if (n <= 0) return false;
+        got += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+static bool sendAll(int fd, const uint8_t* data, size_t len) {
+    size_t sent = 0;
+    while (sent < len) {
+        ssize_t n = send(fd, data + sent, len - sent, 0);
+        if (n <= 0) return false;
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+static bool readFrame(int fd, Frame& frame) {
+    uint8_t h[10];
+    if (!recvAll(fd, h, 2)) return false;
+    frame.fin = (h[0] & 0x80) != 0;
+    frame.opcode = h[0] & 0x0F;
+    if (h[1] & 0x80) return false;   // Servidor nunca mascara
+    uint64_t len = h[1] & 0x7F;
+    frame.header_len = 2;
+    if (len == 126) {
+        if (!recvAll(fd, h + 2, 2)) return false;
+        len = (uint64_t(h[2]) << 8) | h[3];
+        frame.header_len = 4;
+    } else if (len == 127) {
+        if (!recvAll(fd, h + 2, 8)) return false;
+        len = 0;
+        for (int i = 0; i < 8; i++) len = (len << 8) | h[2 + i];
+        frame.header_len = 10;
+    }
+    frame.payload.resize(static_cast<size_t>(len));
+    return len == 0 || recvAll(fd, frame.payload.data(), frame.payload.size());
+}
+
+// Frame do cliente (sempre mascarado)
+static std::vector<uint8_t> clientFrame(uint8_t first, const std::vector<uint8_t>& payload) {
+    std::vector<uint8_t> out;
+    const size_t len = payload.size();
+    out.push_back(first);
+    if (len <= 125) {
+        out.push_back(0x80 | static_cast<uint8_t>(len));
+    } else if (len <= 0xFFFF) {
+        out.push_back(0x80 | 126);
+        out.push_back(static_cast<uint8_t>(len >> 8));
+        out.push_back(static_cast<uint8_t>(len));
+    } else {
+        out.push_back(0x80 | 127);
+        for (int i = 7; i >= 0; i--) out.push_back(static_cast<uint8_t>(uint64_t(len) >> (8 * i)));
+    }
+    const uint8_t mask[4] = { 0x37, 0xFA, 0x21, 0x3D };
+    out.insert(out.end(), mask, mask + 4);
+    for (size_t i = 0; i < len; i++) out.push_back(payload[i] ^ mask[i & 3]);
+    return out;
+}
+
+static std::vector<uint8_t> pattern(size_t len, uint8_t seed) {
+    std::vector<uint8_t> v(len);
+    for (size_t i = 0; i < len; i++) v[i] = static_cast<uint8_t>('a' + (i * 7 + seed) % 26);
+    return v;
+}
+
+static size_t expectedHeader(size_t len) {
+    return len <= 125 ? 2 : (len <= 0xFFFF ? 4 : 10);
+}
+
+static int connectClient() {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(TEST_PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    timeval tv;
+    tv.tv_sec = 5;
+    tv.tv_usec = 0;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    const char* request =
+        "GET / HTTP/1.1\r\nHost: localhost\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+        "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n";
+    sendAll(fd, reinterpret_cast<const uint8_t*>(request), std::strlen(request));
+
+    // Resposta do handshake byte a byte: nada do que vem depois é consumido
+    std::string response;
+    uint8_t c;
+    while (response.size() < 4 || response.compare(response.size() - 4, 4, "\r\n\r\n") != 0) {
+        if (!recvAll(fd, &c, 1)) {
+            close(fd);
+            return -1;
+        }
+        response.push_back(static_cast<char>(c));
+    }
+    if (response.find(" 101 ") == std::string::npos) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// ============ Teste ============
+
+int main() {
+    WebSocketServer server(TEST_PORT, 1);
+
+    std::mutex received_mutex;
+    std::condition_variable received_cv;
+    std::vector<std::string> received;
+    server.setOnClientMessage([&](uint32_t, std::string text) {
+        std::lock_guard<std::mutex> lock(received_mutex);
+        received.push_back(text);
+        received_cv.notify_all();
+    });
+    auto waitMessage = [&](std::string& out) {
+        std::unique_lock<std::mutex> lock(received_mutex);
+        if (!received_cv.wait_for(lock, std::chrono::seconds(5), [&] { return !received.empty(); })) return false;
+        out = received.front();
+        received.erase(received.begin());
+        return true;
+    };
+
+    server.start();
+    int fd = connectClient();
+    if (fd < 0) {
+        std::printf("[FALHA] handshake na porta %d\n", TEST_PORT);
+        server.stop();
+        return 1;
+    }
+    for (int i = 0; i < 100 && server.numClients() == 0; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    // Servidor -> cliente: um frame só, comprimento de 7, 16 ou 64 bits
+    server.setMaxFragmentSize(0);
+    const size_t sizes[] = { 125, 126, 65535, 65536 };
+    for (size_t len : sizes) {
+        std::vector<uint8_t> data = pattern(len, static_cast<uint8_t>(len));
+        server.broadcast(data, StreamKind::DATA);
+        Frame f;
+        bool ok = readFrame(fd, f) && f.fin && f.opcode == 0x2 &&
+                  f.header_len == expectedHeader(len) && f.payload == data;
+        char what[96];
+        std::snprintf(what, sizeof(what), "servidor: frame binario de %zu bytes", len);
+        check(ok, what);
+    }
+
+    {
+        server.broadcastText("{\"type\":\"PING\"}");
+        Frame f;
+        bool ok = readFrame(fd, f) && f.fin && f.opcode == 0x1 &&
+                  std::string(f.payload.begin(), f.payload.end()) == "{\"type\":\"PING\"}";
+        check(ok, "servidor: frame de texto");
+    }
+
+    // Servidor -> cliente: acima do fragmento, opcode só no primeiro, FIN só no último
+    {
+        const size_t fragment = 16384;
+        const size_t len = 2 * fragment + 7232;
+        server.setMaxFragmentSize(fragment);
+        std::vector<uint8_t> data = pattern(len, 3);
+        server.broadcast(data, StreamKind::DATA);
+
+        std::vector<uint8_t> joined;
+        bool ok = true;
+        for (int i = 0; i < 3 && ok; i++) {
+            Frame f;
+            ok = readFrame(fd, f);
+            ok = ok && f.opcode == (i == 0 ? 0x2 : 0x0) && f.fin == (i == 2);
+            ok = ok && f.payload.size() == (i == 2 ? len - 2 * fragment : fragment);
+            ok = ok && f.header_len == expectedHeader(f.payload.size());
+            joined.insert(joined.end(), f.payload.begin(), f.payload.end());
+        }
+        check(ok && joined == data, "servidor: mensagem fragmentada (binario, continuacao, continuacao+FIN)");
+
+        // Exatamente um fragmento: não divide
+        data = pattern(fragment, 5);
+        server.broadcast(data, StreamKind::DATA);
+        Frame f;
+        ok = readFrame(fd, f) && f.fin && f.opcode == 0x2 && f.payload == data;
+        check(ok, "servidor: payload igual ao fragmento sai em um frame");
+    }
+
+    // Cliente -> servidor: mesmos comprimentos, com o primeiro frame chegando em pedaços
+    for (size_t len : sizes) {
+        std::vector<uint8_t> data = pattern(len, static_cast<uint8_t>(len + 1));
+        std::vector<uint8_t> bytes = clientFrame(0x81, data);
+        if (len == 125) {
+            sendAll(fd, bytes.data(), 1);
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            sendAll(fd, bytes.data() + 1, 40);
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            sendAll(fd, bytes.data() + 41, bytes.size() - 41);
+        } else {
+            sendAll(fd, bytes.data(), bytes.size());
+        }
+        std::string text;
+        bool ok = waitMessage(text) && text == std::string(data.begin(), data.end());
+        char what[96];
+        std::snprintf(what, sizeof(what), "parser: frame de texto de %zu bytes", len);
+        check(ok, what);
+    }
+
+    // Cliente -> servidor: texto em três fragmentos com um ping no meio
+    {
+        std::vector<uint8_t> a = pattern(100, 1), b = pattern(300, 2), c = pattern(70000, 3);
+        std::vector<uint8_t> ping = { 'p', 'i', 'n', 'g' };
+        std::vector<uint8_t> bytes = clientFrame(0x01, a);
+        std::vector<uint8_t> more = clientFrame(0x89, ping);
+        bytes.insert(bytes.end(), more.begin(), more.end());
+        more = clientFrame(0x00, b);
+        bytes.insert(bytes.end(), more.begin(), more.end());
+        more = clientFrame(0x80, c);
+        bytes.insert(bytes.end(), more.begin(), more.end());
+        sendAll(fd, bytes.data(), bytes.size());
+
+        Frame pong;
+        bool ok = readFrame(fd, pong) && pong.fin && pong.opcode == 0xA && pong.payload == ping;
+        check(ok, "parser: ping entre fragmentos responde pong");
+
+        std::vector<uint8_t> joined(a);
+        joined.insert(joined.end(), b.begin(), b.end());
+        joined.insert(joined.end(), c.begin(), c.end());
+        std::string text;
+        ok = waitMessage(text) && text == std::string(joined.begin(), joined.end());
+        check(ok, "parser: mensagem fragmentada remontada");
+    }
+
+    // Close: o servidor responde com close e encerra
+    {
+        std::vector<uint8_t> bytes = clientFrame(0x88, std::vector<uint8_t>());
+        sendAll(fd, bytes.data(), bytes.size());
+        Frame f;
+        bool ok = readFrame(fd, f) && f.fin && f.opcode == 0x8 && f.payload.empty();
+        check(ok, "parser: close respondido");
+    }
+
+    close(fd);
+
+    // Fila cheia de áudio (cliente que não lê): uma mensagem DATA abre espaço
+    // descartando áudio em vez de derrubar o ouvinte lento
+    {
+        SendQueueLimits limits;
+        limits.max_messages = 8;
+        limits.max_bytes = 4 << 20;
+        server.setSendQueueLimits(limits);
+        server.setMaxFragmentSize(0);
+        for (int i = 0; i < 100 && server.numClients() > 0; i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        int slow = connectClient();
+        for (int i = 0; i < 100 && slow >= 0 && server.numClients() == 0; i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        std::vector<uint8_t> audio = pattern(256 * 1024, 9);
+        for (int i = 0; i < 64; i++) {
+            server.broadcast(audio, StreamKind::AUDIO);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        std::vector<ClientStats> st = server.getClientStats();
+        bool full = st.size() == 1 && st[0].queued_messages == limits.max_messages && st[0].dropped > 0;
+        check(slow >= 0 && full, "fila lenta: cheia de audio, audio antigo descartado");
+
+        const std::string data = "{\"type\":\"RDS\",\"ps\":\"TESTE\"}";
+        server.broadcastText(data, StreamKind::DATA);
+        bool found = false;
+        Frame f;
+        while (!found && readFrame(slow, f)) {
+            found = f.opcode == 0x1 && std::string(f.payload.begin(), f.payload.end()) == data;
+        }
+        check(found && server.numClients() == 1, "fila lenta: mensagem DATA entregue sem desconectar");
+        if (slow >= 0) close(slow);
+    }
+
+    server.stop();
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,77 @@
+#include "worker_pool.h"
+
+WorkerPool::WorkerPool(size_t num_threads)
+    : job(nullptr), job_count(0), generation(0),
+      next_index(0), remaining(0), active(0), stopping(false) {
+    if (num_threads == 0) {
+        unsigned hw = std::thread::hardware_concurrency();
+        num_threads = hw > 1 ? hw - 1 : 0;
+    }
+    for (size_t i = 0; i < num_threads; i++) {
+        workers.emplace_back(&WorkerPool::workerLoop, this);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    work_cv.notify_all();
+    for (auto& t : workers) t.join();
+}
+
+void WorkerPool::runIndices() {
+    size_t i;
+    while ((i = next_index.fetch_add(1)) < job_count) {
+        (*job)(i);
+        if (remaining.fetch_sub(1) == 1) {
+            std::lock_guard<std::mutex> lock(mutex);
+            done_cv.notify_all();
+        }
+    }
+}
+
+void WorkerPool::workerLoop() {
+    uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        // Só entra em um job ainda em andamento: um worker atrasado nunca
+        // lê os campos de um job que já terminou
+        work_cv.wait(lock, [&] { return stopping || (job && generation != seen); });
+        if (stopping) return;
+        seen = generation;
+        active++;
+
+        lock.unlock();
+        runIndices();
+        lock.lock();
+
+        if (--active == 0) done_cv.notify_all();
+    }
+}
+
+void WorkerPool::parallelFor(size_t count, const std::function<void(size_t)>& fn) {
+    if (count == 0) return;
+    if (workers.empty() || count == 1) {
+        for (size_t i = 0; i < count; i++) fn(i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &fn;
+        job_count = count;
+        next_index = 0;
+        remaining = count;
+        generation++;
+    }
+    work_cv.notify_all();
+
+    // A thread chamadora também processa
+    runIndices();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done_cv.wait(lock, [&] { return remaining.load() == 0 && active == 0; });
+    job = nullptr;
+}
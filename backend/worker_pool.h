@@ -0,0 +1,39 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Pool fixo de threads para paralelismo fork-join por bloco:
+// parallelFor distribui os índices entre as threads (incluindo a chamadora)
+// e só retorna quando todos terminaram.
+class WorkerPool {
+public:
+    // num_threads = 0 -> hardware_concurrency() - 1
+    explicit WorkerPool(size_t num_threads = 0);
+    ~WorkerPool();
+
+    void parallelFor(size_t count, const std::function<void(size_t)>& fn);
+    size_t numThreads() const { return workers.size() + 1; }
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable work_cv;
+    std::condition_variable done_cv;
+
+    const std::function<void(size_t)>* job;
+    size_t job_count;
+    uint64_t generation;
+    std::atomic<size_t> next_index;
+    std::atomic<size_t> remaining;
+    size_t active;           // Workers dentro de runIndices (protegido por mutex)
+    bool stopping;
+
+    void workerLoop();
+    void runIndices();
+};
@@ -2,118 +2,408 @@
 #include <thread>
 #include <atomic>
 #include <vector>
-#include string>
-#include <winsock2.h>
-#include <ws2tcpip.h>
+#include <cstring>
+#include <cstdlib>
+#include <csignal>
 #include <string>
-#include <rtl-sdr.h>
-#include <queue>
+#include <ctime>
 #include <mutex>
-#include dition_variable>
+#include <memory>
+#include <algorithm>
+#include "server.h"
 #include "demodulator.h"
 #include "audio_processor.h"
+#include "spsc_ring.h"
+#include "channelizer.h"
+#include "spectrum.h"
+#include "audio_packetizer.h"
+#include "iq_recorder.h"
+#include "iq_timeshift.h"
+#include "iq_source.h"
+#include "pipeline_stats.h"
+#include "scanner.h"
+#include "iq_stream.h"
 
-#pragma comment(lib, "ws2_32.lib")
+#if defined(_MSC_VER) && !defined(SPEEDSDR_NO_RTLSDR)
 #pragma comment(lib, "rtlsdr.lib")
+#endif
 
 #define PORT 8080
 #define BUFFER_SIZE 8192
 #define SAMPLE_RATE 2048000
+#define IQ_RING_SLOTS 64        // ~128 ms de IQ a 2.048 Msps com BUFFER_SIZE 8192
+#define CHANNELIZER_BINS 64     // 32 kHz por canal a 2.048 Msps
+#define IO_THREADS 2            // Threads de I/O do WebSocketServer
+#define AUDIO_RATE 48000
+#define RECORD_BLOCK_BYTES (1 << 20)
+#define RECORD_BLOCKS 64        // 64 MB: ~16 s de folga se o disco engasgar
+#define TIMESHIFT_SECONDS 60    // Padrão de --timeshift: ~240 MB de IQ bruto para capturas pré-trigger
 
 std::atomic<bool> running(true);
 std::atomic<uint32_t> center_freq(145350000);
 std::atomic<int> rf_gain(40);
 std::atomic<int> demod_mode(1);  // 1=WFM por padrão
 std::atomic<int> quad_mode(0);   // 0=Quadrature
+std::atomic<int> audio_frame_ms(20);  // Duração dos quadros de áudio enviados
+std::atomic<bool> squelch_capture(false);      // Squelch abrindo dispara TRIGGER_CAPTURE
+std::atomic<double> squelch_capture_pre(10.0); // Janela da captura por squelch (s)
+std::atomic<double> squelch_capture_post(5.0);
 
-rtlsdr_dev_t* dev = nullptr;
+IQSource* source = nullptr;                // RTL-SDR, rtl_tcp, arquivo ou sintético (--source)
 Demodulator* demodulator = nullptr;
 AudioProcessor* audio_processor = nullptr;
+MultiChannelReceiver* multi_rx = nullptr;  // Canais extras (ADD_CHANNEL)
+SpectrumEngine* spectrum = nullptr;        // Espectro/waterfall calculado aqui
+WidebandScanner* scanner = nullptr;        // Varredura por janelas de FFT (START_SCANNER)
+WebSocketServer* ws_server = nullptr;
+IQRecorder* recorder = nullptr;            // Gravação SigMF (START_RECORDING)
+IQTimeShift* timeshift = nullptr;          // Últimos segundos de IQ (TRIGGER_CAPTURE); nulo com --timeshift 0
+PipelineStats pipeline_stats;              // Tempos por estágio e contadores (GET_STATS, /metrics)
+PlayoutTracker playout_tracker;            // Captura -> fila -> reprodução no cliente (PLAYOUT)
+std::string recordings_dir = ".";          // Onde START_RECORDING/TRIGGER_CAPTURE gravam (--recordings)
 
-// Thread-safe queue para IQ data
-std::queue<std::vector<uint8_t>> iq_queue;
-std::mutex iq_queue_mutex;
-std::condition_variable iq_queue_cv;
+// Último estado do RDS/estéreo (GET_RDS); escrito pela thread de áudio
+std::mutex rds_mutex;
+std::string rds_state = "{\"type\":\"RDS\",\"synced\":false,\"stereo\":false}";
 
-SOCKET global_client = INVALID_SOCKET;
-std::mutex client_mutex;
+// Último estado do scanner (GET_SCANNER); escrito pela thread de áudio
+std::mutex scanner_mutex;
+std::string scanner_state = "{\"type\":\"SCANNER\",\"running\":false}";
 
-void rtl_callback(unsigned char* buf, uint32_t len, void* ctx) {
-    // Enfileirar dados IQ sem processar aqui (evita overhead)
-    {
-        std::lock_guard<std::mutex> lock(iq_queue_mutex);
-        std::vector<uint8_t> data(buf, buf + len);
-        iq_queue.push(data);
+// Fatias de IQ decimado pedidas por cada cliente (SET_IQ_STREAM); criadas e
+// removidas pela thread de I/O, alimentadas pela thread de áudio. Cada uma
+// roda NCO + FIR a 2 Msps: o número de fatias simultâneas é limitado.
+#define MAX_IQ_STREAMS 4
+struct IQStreamClient {
+    uint32_t client_id;
+    std::unique_ptr<IQStreamer> streamer;
+};
+std::mutex iq_stream_mutex;
+std::vector<IQStreamClient> iq_streams;
+
+// Anel SPSC entre o callback USB e a thread de áudio (slots pré-alocados)
+SPSCSlotRing iq_ring(IQ_RING_SLOTS, BUFFER_SIZE);
+
+DemodMode mode_from_int(int mode) {
+    switch (mode) {
+        case 0: return DemodMode::NFM;
+        case 2: return DemodMode::AM;
+        case 3: return DemodMode::USB;
+        case 4: return DemodMode::LSB;
+        case 5: return DemodMode::CW;
+        default: return DemodMode::WFM;
+    }
+}
+
+// Codificação de áudio pelo nome ("pcm", "adpcm", "ulaw"); COUNT se desconhecida
+AudioEncoding encoding_from_name(const std::string& name) {
+    if (name.compare(0, 3, "pcm") == 0) return AudioEncoding::PCM16;
+    if (name.compare(0, 5, "adpcm") == 0 || name.compare(0, 3, "ima") == 0) return AudioEncoding::IMA_ADPCM;
+    if (name.compare(0, 4, "ulaw") == 0 || name.compare(0, 4, "mulaw") == 0) return AudioEncoding::MULAW;
+    return AudioEncoding::COUNT;
+}
+
+// Conexão nova: "/?audio=adpcm" escolhe a codificação do cliente.
+// O grupo do cliente no servidor é a própria codificação.
+void handle_connect(uint32_t client_id, const std::string& target) {
+    size_t pos = target.find("audio=");
+    if (pos == std::string::npos) return;
+    AudioEncoding enc = encoding_from_name(target.substr(pos + 6));
+    if (enc == AudioEncoding::COUNT) return;
+    ws_server->setClientGroup(client_id, static_cast<uint32_t>(enc));
+    std::cout << "[Audio] Cliente " << client_id << " usa codificacao " << static_cast<int>(enc) << "\n";
+}
+
+void rtl_callback(unsigned char* buf, uint32_t len, void*) {
+    // Copiar para um slot livre do anel: sem mutex e sem alocação.
+    // Anel cheio = consumidor atrasado; o bloco é descartado e contado.
+    if (recorder) recorder->write(buf, len);   // Só copia; o disco fica na thread do gravador
+    if (timeshift) timeshift->write(buf, len);
+    
+    uint8_t* slot = iq_ring.acquireWrite();
+    if (!slot) return;
+    
+    size_t n = len < iq_ring.slotSize() ? len : iq_ring.slotSize();
+    memcpy(slot, buf, n);
+    iq_ring.commitWrite(n, monotonicNs());     // Instante da captura: base da latência fim a fim
+}
+
+// Texto (RDS, caminhos) dentro de uma string JSON
+std::string json_escape(const char* text) {
+    std::string out;
+    for (const char* c = text; *c; c++) {
+        if (*c == '"' || *c == '\\') out += '\\';
+        out += *c;
+    }
+    return out;
+}
+
+// Nome de gravação pedido pelo cliente -> caminho dentro de recordings_dir.
+// Só nome-base: sem separadores, "..", drive nem caracteres de controle.
+bool recording_path(const std::string& name, std::string& path) {
+    if (name.empty() || name.size() > 128 || name.find("..") != std::string::npos) return false;
+    for (char c : name) {
+        if (c == '/' || c == '\\' || c == ':' || static_cast<unsigned char>(c) < 0x20) return false;
+    }
+    path = recordings_dir + "/" + name;
+    return true;
+}
+
+std::string rds_json(RdsDecoder& rds, bool stereo) {
+    char pi[8];
+    snprintf(pi, sizeof(pi), "%04X", rds.programId());
+    return std::string("{\"type\":\"RDS\",\"synced\":") + (rds.isSynced() ? "true" : "false") +
+           ",\"stereo\":" + (stereo ? "true" : "false") +
+           ",\"pi\":\"" + pi + "\"" +
+           ",\"pty\":" + std::to_string(rds.programType()) +
+           ",\"tp\":" + (rds.trafficProgram() ? "true" : "false") +
+           ",\"ps\":\"" + json_escape(rds.programService()) + "\"" +
+           ",\"rt\":\"" + json_escape(rds.radioText()) + "\"" +
+           ",\"groups\":" + std::to_string(rds.groups()) +
+           ",\"errors\":" + std::to_string(rds.blockErrors()) + "}";
+}
+
+std::string scanner_json(const WidebandScanner& sc) {
+    std::string json = std::string("{\"type\":\"SCANNER\",\"running\":") + (sc.isRunning() ? "true" : "false") +
+                       ",\"locked\":" + (sc.isLocked() ? "true" : "false") +
+                       ",\"center\":" + std::to_string(static_cast<uint64_t>(sc.centerFreq()));
+    if (sc.isLocked()) {
+        json += ",\"freq\":" + std::to_string(static_cast<uint64_t>(sc.lockedFreq())) +
+                ",\"level_db\":" + std::to_string(sc.lockedLevel());
+    }
+    json += ",\"windows\":" + std::to_string(sc.numWindows()) +
+            ",\"sweeps\":" + std::to_string(sc.sweeps()) +
+            ",\"sweep_s\":" + std::to_string(sc.lastSweepSeconds()) + ",\"hits\":[";
+    bool first = true;
+    for (const ScanHit& hit : sc.hits()) {
+        if (!first) json += ",";
+        first = false;
+        json += "{\"freq\":" + std::to_string(static_cast<uint64_t>(hit.freq_hz)) +
+                ",\"level_db\":" + std::to_string(hit.level_dbfs) + "}";
     }
-    iq_queue_cv.notify_one();
+    return json + "]}";
 }
 
 void audio_processing_thread() {
     std::cout << "[Audio Thread] Iniciada\n";
     
+    // Buffers de saída alocados uma única vez (processIQ/floatToPCM16 não alocam)
+    size_t max_audio = demodulator ? demodulator->maxOutputSamples(BUFFER_SIZE) : 0;
+    std::vector<float> audio(max_audio);
+    std::vector<int16_t> pcm(max_audio);
+    if (demodulator) demodulator->reserve(BUFFER_SIZE);
+    uint64_t reported_overruns = 0;
+    bool reported_stereo = false;
+    bool squelch_was_open = true;
+    
+    // Retune pedido pelo scanner entre janelas (mesmo caminho do SET_FREQ)
+    const WidebandScanner::RetuneCallback retune_scanner = [](uint32_t hz) {
+        center_freq = hz;
+        source->setCenterFreq(hz);
+        recorder->annotateRetune(hz);
+    };
+    
+    // Quadros de duração fixa com sequência e timestamp: canal 0 = principal,
+    // 1..255 = canais extras (criados quando o canal aparece)
+    AudioPacketizer packetizer(AUDIO_RATE, audio_frame_ms, 0);
+    IQConverter iq_stream_converter;                       // Bloco convertido uma vez para todas as fatias
+    AlignedVector<std::complex<float>> iq_stream_input(BUFFER_SIZE / 2);
+    std::vector<std::unique_ptr<AudioPacketizer>> channel_packetizers(256);
+    const uint64_t audio_per_block = (uint64_t)(BUFFER_SIZE / 2) * AUDIO_RATE / SAMPLE_RATE;
+    
+    // Cada quadro sai uma vez por codificação, só para o grupo que a escolheu
+    const size_t num_encodings = static_cast<size_t>(AudioEncoding::COUNT);
+    auto send_frames = [num_encodings](const AudioPacketizer& p, size_t count) {
+        uint64_t now = count ? monotonicNs() : 0;
+        for (size_t i = 0; i < count; i++) {
+            playout_tracker.frameQueued(p.frameCaptureNs(i), now);
+            for (size_t e = 0; e < num_encodings; e++) {
+                AudioEncoding enc = static_cast<AudioEncoding>(e);
+                if (p.frameBytes(i, enc) == 0) continue;
+                ws_server->broadcastToGroup(static_cast<uint32_t>(e), p.frame(i, enc), p.frameBytes(i, enc),
+                                            StreamKind::AUDIO);
+                pipeline_stats.add(PipelineCounter::AUDIO_FRAMES);
+            }
+        }
+    };
+    
     while (running) {
-        std::vector<uint8_t> iq_data;
-        
         // Esperar por dados IQ
-        {
-            std::unique_lock<std::mutex> lock(iq_queue_mutex);
-            if (iq_queue.empty()) {
-                iq_queue_cv.wait_for(lock, std::chrono::milliseconds(100));
+        if (!iq_ring.waitForData(100)) continue;
+        
+        // Instrumentação: uma leitura do relógio por estágio, encadeadas
+        uint64_t block_start = monotonicNs();
+        size_t depth = iq_ring.size();
+        size_t iq_len = 0;
+        uint64_t capture_ns = 0;
+        const uint8_t* iq_data = iq_ring.acquireRead(iq_len, capture_ns);
+        if (!iq_data) continue;
+        uint64_t t = pipeline_stats.stage(PipelineStage::IQ_DEQUEUE).recordSince(block_start);
+        pipeline_stats.recordQueueDepth(depth);
+        pipeline_stats.add(PipelineCounter::IQ_BLOCKS);
+        pipeline_stats.add(PipelineCounter::IQ_BYTES, iq_len);
+        
+        uint64_t overruns = iq_ring.overruns();
+        if (overruns != reported_overruns) {
+            pipeline_stats.set(PipelineCounter::IQ_OVERRUNS, overruns);
+            std::cout << "[Audio Thread] Overrun: " << (overruns - reported_overruns)
+                      << " bloco(s) IQ descartado(s) (total " << overruns << ")\n";
+            // O relógio de áudio pula o tempo perdido: o cliente vê o buraco
+            send_frames(packetizer, packetizer.advanceClock((overruns - reported_overruns) * audio_per_block));
+            reported_overruns = overruns;
+        }
+        
+        if (iq_len == 0 || !demodulator || !audio_processor) {
+            iq_ring.releaseRead();
+            continue;
+        }
+        
+        // Scanner: mede todos os canais da janela; com atividade, o
+        // demodulador vai para o canal por offset (sem retune)
+        if (scanner && scanner->process(iq_data, iq_len, capture_ns, retune_scanner)) {
+            if (scanner->isLocked()) demodulator->setOffset(scanner->lockedOffset());
+            std::string json = scanner_json(*scanner);
+            {
+                std::lock_guard<std::mutex> lock(scanner_mutex);
+                scanner_state = json;
             }
-            
-            if (iq_queue.empty()) continue;
-            
-            iq_data = iq_queue.front();
-            iq_queue.pop();
+            ws_server->broadcastText(json, StreamKind::DATA);
         }
+        const bool sweeping = scanner && scanner->isRunning() && !scanner->isLocked();
         
-        if (iq_data.empty() || !demodulator || !audio_processor) continue;
+        // Demodular direto do slot (sem cópia) e devolver o slot ao produtor
+        size_t num_audio = demodulator->processIQ(iq_data, iq_len, audio.data(), audio.size());
+        t = pipeline_stats.stage(PipelineStage::DEMOD).recordSince(t);
+        const int channels = demodulator->outputChannels();
         
-        // Demodular
-        auto audio = demodulator->processIQ(iq_data.data(), iq_data.size());
-        if (audio.empty()) continue;
+        // Squelch abriu: grava os segundos antes da transmissão que acabou de
+        // começar (trigger() só marca o instante; o disco fica na thread do anel)
+        const bool squelch_open = demodulator->squelchOpen();
+        if (squelch_open && !squelch_was_open && squelch_capture && timeshift) {
+            std::string path;
+            recording_path("squelch_" + std::to_string(center_freq.load()) + "_" + std::to_string(std::time(nullptr)), path);
+            RecordingInfo info;
+            info.sample_rate = SAMPLE_RATE;
+            info.center_freq = center_freq;
+            info.gain_db = static_cast<float>(rf_gain.load());
+            timeshift->trigger(path, squelch_capture_pre, squelch_capture_post, info, "squelch");
+        }
+        squelch_was_open = squelch_open;
         
-        // Aplicar AGC
-        audio_processor->processAudio(audio);
+        // RDS novo ou piloto travou/perdeu: avisa todos (só quando muda)
+        RdsDecoder* rds = demodulator->rds();
+        bool stereo = demodulator->stereoLocked();
+        if (rds && (rds->takeChanged() || stereo != reported_stereo)) {
+            reported_stereo = stereo;
+            std::string json = rds_json(*rds, stereo);
+            {
+                std::lock_guard<std::mutex> lock(rds_mutex);
+                rds_state = json;
+            }
+            ws_server->broadcastText(json, StreamKind::DATA);
+        }
         
-        // Converter para PCM 16-bit
-        auto pcm = audio_processor->floatToPCM16(audio);
-        if (pcm.empty()) continue;
+        int frame_ms = audio_frame_ms;
+        packetizer.setFrameDuration(frame_ms);
+        
+        // Só codifica o que algum cliente ouve
+        uint32_t encodings = 0;
+        for (size_t e = 0; e < num_encodings; e++) {
+            if (ws_server->numClientsInGroup(static_cast<uint32_t>(e)) > 0)
+                encodings |= AudioPacketizer::encodingBit(static_cast<AudioEncoding>(e));
+        }
+        packetizer.setEncodings(encodings);
+        
+        // Canais extras: um channelizer para todos, demodulação em paralelo.
+        // Cada canal tem seu packetizer; o id vai no campo channel do cabeçalho.
+        if (multi_rx) {
+            multi_rx->process(iq_data, iq_len, [&](int id, const int16_t* data, size_t n, bool open, bool first) {
+                std::unique_ptr<AudioPacketizer>& p = channel_packetizers[id & 0xFF];
+                if (first) p.reset();   // Id reaproveitado: sequência e timestamp recomeçam
+                if (!p) p.reset(new AudioPacketizer(AUDIO_RATE, frame_ms, static_cast<uint8_t>(id)));
+                p->setFrameDuration(frame_ms);
+                p->setEncodings(encodings);
+                send_frames(*p, open ? p->push(data, n, true) : p->skipClosed(n));
+            });
+            t = pipeline_stats.stage(PipelineStage::CHANNELS).recordSince(t);
+        }
         
-        // Enviar para cliente
+        // Espectro: só sai um quadro na taxa configurada (alguns KB cada)
+        if (spectrum && spectrum->process(iq_data, iq_len)) {
+            ws_server->broadcast(spectrum->frame(), spectrum->frameSize(), StreamKind::SPECTRUM);
+            pipeline_stats.add(PipelineCounter::SPECTRUM_FRAMES);
+        }
+        t = pipeline_stats.stage(PipelineStage::SPECTRUM).recordSince(t);
+        
+        // IQ decimado só para quem pediu; cliente que saiu perde a fatia.
+        // uint8 -> complexo uma vez por bloco, não uma vez por fatia
         {
-            std::lock_guard<std::mutex> lock(client_mutex);
-            if (global_client == INVALID_SOCKET) continue;
-            
-            // WebSocket binary frame
-            size_t data_len = pcm.size() * sizeof(int16_t);
-            unsigned char ws_header[10];
-            ws_header[0] = 0x82;  // FIN + Binary
-            
-            if (data_len < 126) {
-                ws_header[1] = static_cast<unsigned char>(data_len);
-                send(global_client, (char*)ws_header, 2, 0);
-            } else if (data_len < 65536) {
-                ws_header[1] = 126;
-                ws_header[2] = (data_len >> 8) & 0xFF;
-                ws_header[3] = data_len & 0xFF;
-                send(global_client, (char*)ws_header, 4, 0);
-            } else {
-                continue;
+            std::lock_guard<std::mutex> lock(iq_stream_mutex);
+            const size_t n = iq_len / 2;
+            if (!iq_streams.empty()) {
+                if (iq_stream_input.size() < n) iq_stream_input.resize(n);
+                iq_stream_converter.toComplex(iq_data, n, iq_stream_input.data());
+            }
+            for (size_t i = 0; i < iq_streams.size();) {
+                IQStreamer& iq = *iq_streams[i].streamer;
+                if (iq.processBaseband(iq_stream_input.data(), n) &&
+                    !ws_server->sendBinary(iq_streams[i].client_id, iq.frame(), iq.frameSize(), StreamKind::DATA)) {
+                    iq_streams.erase(iq_streams.begin() + i);
+                    continue;
+                }
+                i++;
             }
-            
-            send(global_client, (char*)pcm.data(), data_len, 0);
         }
+        iq_ring.releaseRead();
+        if (num_audio == 0) {
+            pipeline_stats.stage(PipelineStage::BLOCK).recordSince(block_start);
+            continue;
+        }
+        pipeline_stats.add(PipelineCounter::AUDIO_SAMPLES, num_audio);
+        
+        // Squelch fechado (ou scanner entre canais): sem AGC, PCM nem
+        // codificação; só o marcador
+        if (!squelch_open || sweeping) {
+            pipeline_stats.add(PipelineCounter::AUDIO_SQUELCHED, num_audio);
+            send_frames(packetizer, packetizer.skipClosed(num_audio));
+            pipeline_stats.stage(PipelineStage::BLOCK).recordSince(block_start);
+            continue;
+        }
+        
+        // Aplicar AGC (estéreo: um ganho só para L e R)
+        audio_processor->processAudio(audio.data(), num_audio * channels);
+        t = pipeline_stats.stage(PipelineStage::AGC).recordSince(t);
+        
+        // Converter para PCM 16-bit
+        audio_processor->floatToPCM16(audio.data(), num_audio * channels, pcm.data());
+        t = pipeline_stats.stage(PipelineStage::PCM).recordSince(t);
+        
+        // Quadros completos para os clientes (enfileira; cliente lento perde o
+        // áudio mais antigo). Aqui o squelch está aberto.
+        // Captura da 1ª amostra de áudio do bloco: o fim do bloco IQ chegou em
+        // capture_ns; recua o atraso de grupo do demodulador e o bloco de áudio
+        uint64_t first_capture = 0;
+        double back_ns = (demodulator->outputLag() + (num_audio - 1) / (double)AUDIO_RATE) * 1e9;
+        if (capture_ns > back_ns) first_capture = capture_ns - static_cast<uint64_t>(back_ns);
+        send_frames(packetizer, packetizer.push(pcm.data(), num_audio, true, first_capture, channels));
+        pipeline_stats.stage(PipelineStage::SEND).recordSince(t);
+        pipeline_stats.stage(PipelineStage::BLOCK).recordSince(block_start);
     }
     
     std::cout << "[Audio Thread] Finalizada\n";
 }
 
 void rtl_reader_thread() {
-    std::cout << "[RTL-SDR Thread] Iniciada\n";
+    std::cout << "[RTL-SDR Thread] Iniciada (" << source->name() << ")\n";
     
     while (running) {
-        if (rtlsdr_read_async(dev, rtl_callback, nullptr, 0, BUFFER_SIZE) != 0) {
+        int r = source->run(rtl_callback, nullptr, BUFFER_SIZE);
+        if (r == 0 && running) {
+            // Arquivo sem loop chegou ao fim
+            std::cout << "[Fonte] Fim do IQ\n";
+            break;
+        }
+        if (r != 0) {
             std::this_thread::sleep_for(std::chrono::milliseconds(100));
         }
     }
@@ -121,143 +411,658 @@ void rtl_reader_thread() {
     std::cout << "[RTL-SDR Thread] Finalizada\n";
 }
 
-std::string get_websocket_key(const std::string& request) {
-    size_t pos = request.find("Sec-WebSocket-Key: ");
-    if (pos == std::string::npos) return "";
-    size_t end = request.find("\r\n", pos);
-    return request.substr(pos + 19, end - pos - 19);
+void signal_handler(int) {
+    running = false;
 }
 
-std::string generate_accept_key(const std::string& key) {
-    return key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+// Estado do squelch do receptor principal (SQUELCH)
+std::string squelch_json() {
+    Squelch& sq = demodulator->squelch();
+    SquelchConfig cfg = sq.getConfig();
+    return std::string("{\"type\":\"SQUELCH\",\"enabled\":") + (cfg.enabled ? "true" : "false") +
+           ",\"open\":" + (sq.isOpen() ? "true" : "false") +
+           ",\"level_db\":" + std::to_string(sq.levelDb()) +
+           ",\"floor_db\":" + std::to_string(sq.noiseFloorDb()) +
+           ",\"threshold_db\":" + std::to_string(cfg.threshold_db) +
+           ",\"hysteresis_db\":" + std::to_string(cfg.hysteresis_db) +
+           ",\"attack_ms\":" + std::to_string(cfg.attack_s * 1000.0f) +
+           ",\"release_ms\":" + std::to_string(cfg.release_s * 1000.0f) + "}";
 }
 
-void handle_client(SOCKET client) {
-    char buffer[4096];
-    int bytes = recv(client, buffer, sizeof(buffer), 0);
-    
-    if (bytes <= 0) {
-        closesocket(client);
-        return;
+// Métricas de atraso por cliente: array JSON
+std::string client_stats_array() {
+    std::string json = "[";
+    bool first = true;
+    for (const ClientStats& st : ws_server->getClientStats()) {
+        if (!first) json += ",";
+        first = false;
+        json += "{\"id\":" + std::to_string(st.id) +
+                ",\"address\":\"" + st.address + "\"" +
+                ",\"queued\":" + std::to_string(st.queued_messages) +
+                ",\"queued_bytes\":" + std::to_string(st.queued_bytes) +
+                ",\"max_queued\":" + std::to_string(st.max_queued_messages) +
+                ",\"lag_ms\":" + std::to_string(st.lag_ms) +
+                ",\"sent\":" + std::to_string(st.sent_messages) +
+                ",\"sent_bytes\":" + std::to_string(st.sent_bytes) +
+                ",\"dropped\":" + std::to_string(st.dropped) +
+                ",\"coalesced\":" + std::to_string(st.coalesced) +
+                ",\"encoding\":" + std::to_string(st.group) + "}";
     }
+    return json + "]";
+}
+
+std::string client_stats_json() {
+    return "{\"type\":\"CLIENTS\",\"clients\":" + client_stats_array() + "}";
+}
+
+// Valores lidos de outros módulos só na hora de exportar
+void refresh_stats() {
+    pipeline_stats.set(PipelineCounter::IQ_OVERRUNS, iq_ring.overruns());
+    pipeline_stats.set(PipelineGauge::IQ_QUEUE_CAPACITY, iq_ring.capacity());
+    pipeline_stats.set(PipelineGauge::CLIENTS, ws_server->numClients());
+    if (recorder) pipeline_stats.set(PipelineCounter::RECORDER_DROPS, recorder->getStats().dropped_blocks);
+}
+
+// Clientes desconectados saem do rastreador de reprodução
+void prune_playout() {
+    std::vector<uint32_t> ids;
+    for (const ClientStats& st : ws_server->getClientStats()) ids.push_back(st.id);
+    playout_tracker.prune(ids);
+}
+
+// Latência fim a fim: captura -> fila e captura -> reprodução por cliente (GET_LATENCY)
+std::string latency_json() {
+    prune_playout();
+    std::string json = "{\"type\":\"LATENCY\",";
+    playout_tracker.appendJson(json);
+    return json + "}";
+}
+
+// Tempos por estágio, contadores, envio do servidor e clientes (GET_STATS)
+std::string stats_json() {
+    refresh_stats();
+    prune_playout();
+    std::string json = "{\"type\":\"STATS\",";
+    pipeline_stats.appendJson(json);
+    json += ",\"server\":{";
+    appendHistogramJson(json, "socket_write", ws_server->socketWriteLatency());
+    json += ",";
+    appendHistogramJson(json, "queue_wait", ws_server->queueWaitLatency());
+    json += "},\"latency\":{";
+    playout_tracker.appendJson(json);
+    json += "},\"clients\":" + client_stats_array() + "}";
+    return json;
+}
+
+// Mesmo conteúdo no formato de texto do Prometheus (GET /metrics)
+std::string stats_prometheus() {
+    refresh_stats();
+    std::string out;
+    pipeline_stats.appendPrometheus(out);
     
-    std::string request(buffer, bytes);
+    out += "# HELP speedsdr_socket_write_seconds Duracao de cada escrita no socket\n"
+           "# TYPE speedsdr_socket_write_seconds histogram\n";
+    appendHistogramPrometheus(out, "speedsdr_socket_write_seconds", "", ws_server->socketWriteLatency());
+    out += "# HELP speedsdr_queue_wait_seconds Tempo da mensagem na fila do cliente ate o socket\n"
+           "# TYPE speedsdr_queue_wait_seconds histogram\n";
+    appendHistogramPrometheus(out, "speedsdr_queue_wait_seconds", "", ws_server->queueWaitLatency());
+    prune_playout();
+    playout_tracker.appendPrometheus(out);
     
-    // WebSocket handshake
-    if (request.find("Upgrade: websocket") != std::string::npos) {
-        std::string key = get_websocket_key(request);
-        std::string accept = generate_accept_key(key);
-        
-        std::string response = 
-            "HTTP/1.1 101 Switching Protocols\r\n"
-            "Upgrade: websocket\r\n"
-            "Connection: Upgrade\r\n"
-            "Sec-WebSocket-Accept: " + accept + "\r\n\r\n";
-        
-        send(client, response.c_str(), response.length(), 0);
-        std::cout << "[WebSocket] Cliente conectado\n";
-        
-        {
-            std::lock_guard<std::mutex> lock(client_mutex);
-            global_client = client;
+    std::vector<ClientStats> clients = ws_server->getClientStats();
+    auto per_client = [&](const char* name, const char* type, double (*value)(const ClientStats&)) {
+        out += std::string("# TYPE ") + name + " " + type + "\n";
+        for (const ClientStats& st : clients) {
+            char v[32];
+            snprintf(v, sizeof(v), "%.17g", value(st));
+            out += std::string(name) + "{client=\"" + std::to_string(st.id) + "\",address=\"" + st.address + "\"} " + v + "\n";
         }
-        
-        // Processar comandos do cliente
-        while (running) {
-            char msg[512];
-            int len = recv(client, msg, sizeof(msg), 0);
-            
-            if (len <= 0) break;
+    };
+    per_client("speedsdr_client_sent_bytes_total", "counter", [](const ClientStats& s) { return (double)s.sent_bytes; });
+    per_client("speedsdr_client_sent_messages_total", "counter", [](const ClientStats& s) { return (double)s.sent_messages; });
+    per_client("speedsdr_client_dropped_total", "counter", [](const ClientStats& s) { return (double)s.dropped; });
+    per_client("speedsdr_client_queued_messages", "gauge", [](const ClientStats& s) { return (double)s.queued_messages; });
+    per_client("speedsdr_client_queued_bytes", "gauge", [](const ClientStats& s) { return (double)s.queued_bytes; });
+    per_client("speedsdr_client_lag_seconds", "gauge", [](const ClientStats& s) { return s.lag_ms / 1000.0; });
+    return out;
+}
+
+// Requisições HTTP comuns na porta do WebSocket
+bool handle_http(const std::string& target, std::string& body) {
+    if (target.compare(0, 8, "/metrics") != 0) return false;
+    body = stats_prometheus();
+    return true;
+}
+
+// Comandos JSON do cliente (chamado pelas threads de I/O do servidor)
+void handle_command(uint32_t client_id, const std::string& payload) {
+    try {
+        // SET_FREQ
+        if (payload.find("\"type\":\"SET_FREQ\"") != std::string::npos) {
+            size_t pos = payload.find("\"freq\":");
+            if (pos != std::string::npos) {
+                uint32_t freq = std::stoul(payload.substr(pos + 7));
+                if (scanner) scanner->stop();   // Sintonia manual encerra a varredura
+                center_freq = freq;
+                source->setCenterFreq(freq);
+                recorder->annotateRetune(freq);
+                std::cout << "[RTL] Freq: " << freq << " Hz\n";
+            }
+        }
+        // SET_OFFSET: sintonia dentro da banda capturada (NCO), sem retune USB
+        else if (payload.find("\"type\":\"SET_OFFSET\"") != std::string::npos) {
+            size_t pos = payload.find("\"offset\":");
+            if (pos != std::string::npos) {
+                double offset = std::stod(payload.substr(pos + 9));
+                double limit = SAMPLE_RATE * 0.5;
+                if (offset > -limit && offset < limit && demodulator) {
+                    demodulator->setOffset(offset);
+                    std::cout << "[Demod] Offset: " << offset << " Hz\n";
+                }
+            }
+        }
+        // SET_GAIN
+        else if (payload.find("\"type\":\"SET_GAIN\"") != std::string::npos) {
+            size_t pos = payload.find("\"gain\":");
+            if (pos != std::string::npos) {
+                int gain = std::stoi(payload.substr(pos + 6));
+                rf_gain = gain;
+                source->setGain(gain * 10);
+                recorder->annotate("ganho " + std::to_string(gain) + " dB");
+                std::cout << "[RTL] Gain: " << gain << " dB\n";
+            }
+        }
+        // SET_MODE
+        else if (payload.find("\"type\":\"SET_MODE\"") != std::string::npos) {
+            size_t pos = payload.find("\"mode\":");
+            if (pos != std::string::npos) {
+                int mode = std::stoi(payload.substr(pos + 6));
+                demod_mode = mode;
             
-            if (len > 6 && (msg[0] & 0x81) == 0x81) {
-                int payload_len = msg[1] & 0x7F;
-                int mask_offset = 2;
-                
-                if (payload_len == 126) {
-                    payload_len = (msg[2] << 8) | msg[3];
-                    mask_offset = 4;
+                if (demodulator && mode >= 0 && mode <= 5) {
+                    demodulator->setMode(mode_from_int(mode));
                 }
-                
-                if (mask_offset + 4 > len) continue;
-                
-                unsigned char mask[4];
-                memcpy(mask, &msg[mask_offset], 4);
-                
-                std::string payload;
-                for (int i = 0; i < payload_len && (mask_offset + 4 + i) < len; i++) {
-                    payload += msg[mask_offset + 4 + i] ^ mask[i % 4];
+                std::cout << "[Demod] Mode: " << mode << "\n";
+            }
+        }
+        // SET_PASSBAND: banda de áudio do SSB em Hz ({"low":300,"high":2700})
+        else if (payload.find("\"type\":\"SET_PASSBAND\"") != std::string::npos) {
+            size_t lpos = payload.find("\"low\":");
+            size_t hpos = payload.find("\"high\":");
+            if (lpos != std::string::npos && hpos != std::string::npos && demodulator) {
+                float low = std::stof(payload.substr(lpos + 6));
+                float high = std::stof(payload.substr(hpos + 7));
+                demodulator->setSSBPassband(low, high);
+                std::cout << "[Demod] Passband SSB: " << low << "-" << high << " Hz\n";
+            }
+        }
+        // SET_BFO: tom de batimento do CW em Hz
+        else if (payload.find("\"type\":\"SET_BFO\"") != std::string::npos) {
+            size_t pos = payload.find("\"bfo\":");
+            if (pos != std::string::npos && demodulator) {
+                float bfo = std::stof(payload.substr(pos + 6));
+                demodulator->setCWPitch(bfo);
+                std::cout << "[Demod] BFO CW: " << bfo << " Hz\n";
+            }
+        }
+        // SET_STEREO: {"stereo":false} força mono no WFM (o RDS continua)
+        else if (payload.find("\"type\":\"SET_STEREO\"") != std::string::npos) {
+            size_t pos = payload.find("\"stereo\":");
+            if (pos != std::string::npos && demodulator) {
+                bool enabled = payload.compare(pos + 9, 4, "true") == 0 || payload.compare(pos + 9, 1, "1") == 0;
+                demodulator->setStereo(enabled);
+                std::cout << "[Demod] Estereo: " << (enabled ? "on" : "off") << "\n";
+            }
+        }
+        // GET_RDS: último PI/PS/RadioText e estado do piloto (só para quem pediu)
+        else if (payload.find("\"type\":\"GET_RDS\"") != std::string::npos) {
+            std::string json;
+            {
+                std::lock_guard<std::mutex> lock(rds_mutex);
+                json = rds_state;
+            }
+            ws_server->sendText(client_id, json);
+        }
+        // SET_SQUELCH: {"enabled":true,"threshold_db":10,"hysteresis_db":3,"attack_ms":10,
+        // "release_ms":250}; com "id", vale para o canal extra (campos omitidos = padrão),
+        // senão para o receptor principal (campos omitidos = valor atual)
+        else if (payload.find("\"type\":\"SET_SQUELCH\"") != std::string::npos && demodulator) {
+            size_t pos;
+            int id = 0;
+            if ((pos = payload.find("\"id\":")) != std::string::npos) id = std::stoi(payload.substr(pos + 5));
+            SquelchConfig cfg = id == 0 ? demodulator->squelch().getConfig() : SquelchConfig();
+            if ((pos = payload.find("\"enabled\":")) != std::string::npos)
+                cfg.enabled = payload.compare(pos + 10, 4, "true") == 0 || payload.compare(pos + 10, 1, "1") == 0;
+            if ((pos = payload.find("\"threshold_db\":")) != std::string::npos)
+                cfg.threshold_db = std::stof(payload.substr(pos + 15));
+            if ((pos = payload.find("\"hysteresis_db\":")) != std::string::npos)
+                cfg.hysteresis_db = std::stof(payload.substr(pos + 16));
+            if ((pos = payload.find("\"attack_ms\":")) != std::string::npos)
+                cfg.attack_s = std::stof(payload.substr(pos + 12)) / 1000.0f;
+            if ((pos = payload.find("\"release_ms\":")) != std::string::npos)
+                cfg.release_s = std::stof(payload.substr(pos + 13)) / 1000.0f;
+            if (id == 0) {
+                demodulator->squelch().configure(cfg);
+                ws_server->sendText(client_id, squelch_json());
+            } else if (multi_rx) {
+                multi_rx->setChannelSquelch(id, cfg);
+            }
+            std::cout << "[Squelch] " << (id == 0 ? "Principal" : "Canal " + std::to_string(id)) << ": "
+                      << (cfg.enabled ? "on, " + std::to_string(cfg.threshold_db) + " dB" : std::string("off")) << "\n";
+        }
+        // GET_SQUELCH: nível, piso de ruído e estado do receptor principal
+        else if (payload.find("\"type\":\"GET_SQUELCH\"") != std::string::npos && demodulator) {
+            ws_server->sendText(client_id, squelch_json());
+        }
+        // START_SCANNER: campos do ScannerConfig do frontend ({"startFreq":..,"endFreq":..,
+        // "step":..,"dwellTime":ms,"squelchLevel":0..100}); "threshold_db" (dBFS) e
+        // "bandwidth" (Hz) opcionais. squelchLevel usa a mesma escala do frontend.
+        else if (payload.find("\"type\":\"START_SCANNER\"") != std::string::npos && scanner) {
+            ScanRange range;
+            size_t pos;
+            if ((pos = payload.find("\"startFreq\":")) != std::string::npos) range.start_hz = std::stod(payload.substr(pos + 12));
+            if ((pos = payload.find("\"endFreq\":")) != std::string::npos) range.end_hz = std::stod(payload.substr(pos + 10));
+            if ((pos = payload.find("\"step\":")) != std::string::npos) range.step_hz = std::stod(payload.substr(pos + 7));
+            if ((pos = payload.find("\"dwellTime\":")) != std::string::npos)
+                range.dwell_s = std::stof(payload.substr(pos + 12)) / 1000.0f;
+            if ((pos = payload.find("\"squelchLevel\":")) != std::string::npos)
+                range.threshold_dbfs = -120.0f + 0.8f * std::stof(payload.substr(pos + 15));
+            if ((pos = payload.find("\"threshold_db\":")) != std::string::npos)
+                range.threshold_dbfs = std::stof(payload.substr(pos + 15));
+            if ((pos = payload.find("\"bandwidth\":")) != std::string::npos)
+                range.channel_bw_hz = std::stof(payload.substr(pos + 12));
+            if (range.start_hz > 0.0 && range.end_hz > 0.0) {
+                scanner->start(range);
+                std::cout << "[Scanner] " << range.start_hz << " - " << range.end_hz << " Hz, passo "
+                          << range.step_hz << " Hz, limiar " << range.threshold_dbfs << " dBFS\n";
+            }
+        }
+        // STOP_SCANNER: o hardware fica na última janela
+        else if (payload.find("\"type\":\"STOP_SCANNER\"") != std::string::npos && scanner) {
+            scanner->stop();
+            std::cout << "[Scanner] Parado\n";
+        }
+        // GET_SCANNER: estado, canal travado e atividade da última varredura
+        else if (payload.find("\"type\":\"GET_SCANNER\"") != std::string::npos) {
+            std::string json;
+            {
+                std::lock_guard<std::mutex> lock(scanner_mutex);
+                json = scanner_state;
+            }
+            ws_server->sendText(client_id, json);
+        }
+        // ADD_CHANNEL: demodulador extra em outro offset da mesma banda
+        else if (payload.find("\"type\":\"ADD_CHANNEL\"") != std::string::npos) {
+            size_t pos = payload.find("\"offset\":");
+            size_t mpos = payload.find("\"mode\":");
+            if (pos != std::string::npos && multi_rx) {
+                double offset = std::stod(payload.substr(pos + 9));
+                int mode = mpos != std::string::npos ? std::stoi(payload.substr(mpos + 7)) : 0;
+                int id = multi_rx->addChannel(offset, mode_from_int(mode));
+                ws_server->broadcastText("{\"type\":\"CHANNEL_ADDED\",\"id\":" + std::to_string(id) +
+                                         ",\"offset\":" + std::to_string(offset) + "}");
+                std::cout << "[Multi] Canal " << id << " em " << offset << " Hz\n";
+            }
+        }
+        // REMOVE_CHANNEL
+        else if (payload.find("\"type\":\"REMOVE_CHANNEL\"") != std::string::npos) {
+            size_t pos = payload.find("\"id\":");
+            if (pos != std::string::npos && multi_rx) {
+                int id = std::stoi(payload.substr(pos + 5));
+                if (multi_rx->removeChannel(id)) {
+                    std::cout << "[Multi] Canal " << id << " removido\n";
                 }
-                
-                // SET_FREQ
-                if (payload.find("\"type\":\"SET_FREQ\"") != std::string::npos) {
-                    size_t pos = payload.find("\"freq\":");
-                    if (pos != std::string::npos) {
-                        uint32_t freq = std::stoul(payload.substr(pos + 7));
-                        center_freq = freq;
-                        rtlsdr_set_center_freq(dev, freq);
-                        std::cout << "[RTL] Freq: " << freq << " Hz\n";
-                    }
+            }
+        }
+        // SET_SPECTRUM: {"fps":25,"bins":1024,"fft":2048,"peak_hold":1,"min_db":-120,"max_db":0}
+        else if (payload.find("\"type\":\"SET_SPECTRUM\"") != std::string::npos && spectrum) {
+            size_t pos;
+            if ((pos = payload.find("\"fps\":")) != std::string::npos)
+                spectrum->setFrameRate(std::stof(payload.substr(pos + 6)));
+            if ((pos = payload.find("\"bins\":")) != std::string::npos)
+                spectrum->setDisplayBins(std::stoul(payload.substr(pos + 7)));
+            if ((pos = payload.find("\"fft\":")) != std::string::npos)
+                spectrum->setFFTSize(std::stoul(payload.substr(pos + 6)));
+            if ((pos = payload.find("\"peak_hold\":")) != std::string::npos)
+                spectrum->setPeakHold(payload.compare(pos + 12, 4, "true") == 0 ||
+                                      payload.compare(pos + 12, 1, "1") == 0);
+            size_t min_pos = payload.find("\"min_db\":");
+            size_t max_pos = payload.find("\"max_db\":");
+            if (min_pos != std::string::npos && max_pos != std::string::npos)
+                spectrum->setRange(std::stof(payload.substr(min_pos + 9)), std::stof(payload.substr(max_pos + 9)));
+            std::cout << "[Spectrum] Configuracao atualizada\n";
+        }
+        // SET_IQ_STREAM: fatia de IQ decimado só para este cliente
+        // ({"offset": Hz, "bandwidth": Hz, "format": 8|16, "compress": bool, "enabled": bool})
+        else if (payload.find("\"type\":\"SET_IQ_STREAM\"") != std::string::npos) {
+            bool enabled = payload.find("\"enabled\":false") == std::string::npos;
+            auto find_stream = [client_id]() {
+                return std::find_if(iq_streams.begin(), iq_streams.end(),
+                                    [client_id](const IQStreamClient& s) { return s.client_id == client_id; });
+            };
+            // Projeto dos filtros fora do lock: a thread de áudio não espera
+            std::unique_ptr<IQStreamer> created;
+            if (enabled) {
+                bool exists;
+                {
+                    std::lock_guard<std::mutex> lock(iq_stream_mutex);
+                    exists = find_stream() != iq_streams.end();
                 }
-                // SET_GAIN
-                else if (payload.find("\"type\":\"SET_GAIN\"") != std::string::npos) {
-                    size_t pos = payload.find("\"gain\":");
-                    if (pos != std::string::npos) {
-                        int gain = std::stoi(payload.substr(pos + 6));
-                        rf_gain = gain;
-                        rtlsdr_set_tuner_gain(dev, gain * 10);
-                        std::cout << "[RTL] Gain: " << gain << " dB\n";
-                    }
+                if (!exists) created.reset(new IQStreamer(SAMPLE_RATE));
+            }
+            std::unique_ptr<IQStreamer> removed;   // Destruído fora do lock
+            std::lock_guard<std::mutex> lock(iq_stream_mutex);
+            auto it = find_stream();
+            if (!enabled) {
+                if (it != iq_streams.end()) {
+                    removed = std::move(it->streamer);
+                    iq_streams.erase(it);
                 }
-                // SET_MODE
-                else if (payload.find("\"type\":\"SET_MODE\"") != std::string::npos) {
-                    size_t pos = payload.find("\"mode\":");
-                    if (pos != std::string::npos) {
-                        int mode = std::stoi(payload.substr(pos + 6));
-                        demod_mode = mode;
-                        
-                        if (demodulator) {
-                            switch (mode) {
-                                case 0: demodulator->setMode(DemodMode::NFM); break;
-                                case 1: demodulator->setMode(DemodMode::WFM); break;
-                                case 2: demodulator->setMode(DemodMode::AM); break;
-                                case 3: demodulator->setMode(DemodMode::USB); break;
-                                case 4: demodulator->setMode(DemodMode::LSB); break;
-                                case 5: demodulator->setMode(DemodMode::CW); break;
-                            }
-                        }
-                        std::cout << "[Demod] Mode: " << mode << "\n";
+            } else {
+                if (it == iq_streams.end()) {
+                    if (iq_streams.size() >= MAX_IQ_STREAMS || !created) {
+                        ws_server->sendText(client_id, "{\"type\":\"IQ_STREAM\",\"enabled\":false,\"error\":\"too many streams\"}");
+                        return;
                     }
+                    iq_streams.push_back({ client_id, std::move(created) });
+                    it = iq_streams.end() - 1;
                 }
-                // SET_QUAD_MODE
-                else if (payload.find("\"type\":\"SET_QUAD_MODE\"") != std::string::npos) {
-                    size_t pos = payload.find("\"quad_mode\":");
-                    if (pos != std::string::npos) {
-                        int qmode = std::stoi(payload.substr(pos + 11));
-                        quad_mode = qmode;
-                        
-                        if (demodulator) {
-                            demodulator->setQuadMode(
-                                qmode == 0 ? QuadMode::QUADRATURE : QuadMode::Q_DIRECT
-                            );
-                        }
-                        std::cout << "[Demod] Quad: " << (qmode == 0 ? "Quad" : "Direct") << "\n";
-                    }
+                IQStreamer& iq = *it->streamer;
+                size_t pos;
+                if ((pos = payload.find("\"offset\":")) != std::string::npos)
+                    iq.setOffset(std::stod(payload.substr(pos + 9)));
+                if ((pos = payload.find("\"bandwidth\":")) != std::string::npos)
+                    iq.setBandwidth(std::stof(payload.substr(pos + 12)));
+                if ((pos = payload.find("\"format\":")) != std::string::npos)
+                    iq.setFormat(std::stoi(payload.substr(pos + 9)) == 8 ? IQ_FORMAT_INT8 : IQ_FORMAT_INT16);
+                if ((pos = payload.find("\"compress\":")) != std::string::npos)
+                    iq.setCompression(payload.compare(pos + 11, 4, "true") == 0);
+            }
+            ws_server->sendText(client_id, std::string("{\"type\":\"IQ_STREAM\",\"enabled\":") +
+                                (enabled ? "true" : "false") + "}");
+            std::cout << "[IQ] Cliente " << client_id << ": streaming " << (enabled ? "ligado" : "desligado") << "\n";
+        }
+        // SET_AUDIO_FRAME: duração dos quadros de áudio (ms)
+        else if (payload.find("\"type\":\"SET_AUDIO_FRAME\"") != std::string::npos) {
+            size_t pos = payload.find("\"ms\":");
+            if (pos != std::string::npos) {
+                int ms = std::stoi(payload.substr(pos + 5));
+                if (ms >= 5 && ms <= 200) {
+                    audio_frame_ms = ms;
+                    std::cout << "[Audio] Quadros de " << ms << " ms\n";
                 }
             }
         }
-        
-        {
-            std::lock_guard<std::mutex> lock(client_mutex);
-            if (global_client == client) {
-                global_client = INVALID_SOCKET;
+        // SET_AUDIO_ENCODING: codificação do áudio deste cliente (pcm/adpcm/ulaw)
+        else if (payload.find("\"type\":\"SET_AUDIO_ENCODING\"") != std::string::npos) {
+            size_t pos = payload.find("\"encoding\":\"");
+            if (pos != std::string::npos) {
+                AudioEncoding enc = encoding_from_name(payload.substr(pos + 12));
+                if (enc != AudioEncoding::COUNT) {
+                    ws_server->setClientGroup(client_id, static_cast<uint32_t>(enc));
+                    ws_server->sendText(client_id, "{\"type\":\"AUDIO_ENCODING\",\"encoding\":" +
+                                        std::to_string(static_cast<int>(enc)) + "}");
+                }
+            }
+        }
+        // START_RECORDING: {"path":"base"} grava base.sigmf-data/.sigmf-meta em recordings_dir
+        else if (payload.find("\"type\":\"START_RECORDING\"") != std::string::npos) {
+            std::string name = "speedsdr_" + std::to_string(std::time(nullptr));
+            size_t pos = payload.find("\"path\":\"");
+            if (pos != std::string::npos) {
+                size_t end = payload.find('"', pos + 8);
+                if (end != std::string::npos && end > pos + 8) name = payload.substr(pos + 8, end - pos - 8);
             }
+            std::string path;
+            if (!recording_path(name, path)) {
+                ws_server->sendText(client_id, "{\"type\":\"RECORDING\",\"recording\":false,\"error\":\"invalid path\"}");
+                std::cerr << "[Recorder] Nome de gravacao recusado\n";
+                return;
+            }
+            RecordingInfo info;
+            info.sample_rate = SAMPLE_RATE;
+            info.center_freq = center_freq;
+            info.gain_db = static_cast<float>(rf_gain.load());
+            bool ok = recorder->start(path, info);
+            ws_server->sendText(client_id, std::string("{\"type\":\"RECORDING\",\"recording\":") +
+                                (ok ? "true" : "false") + ",\"path\":\"" + json_escape(path.c_str()) + "\"}");
+        }
+        // STOP_RECORDING / GET_RECORDING: estado e blocos descartados
+        else if (payload.find("\"type\":\"STOP_RECORDING\"") != std::string::npos ||
+                 payload.find("\"type\":\"GET_RECORDING\"") != std::string::npos) {
+            if (payload.find("STOP_RECORDING") != std::string::npos) recorder->stop();
+            RecorderStats st = recorder->getStats();
+            ws_server->sendText(client_id, std::string("{\"type\":\"RECORDING\",\"recording\":") +
+                                (st.recording ? "true" : "false") +
+                                ",\"path\":\"" + json_escape(st.path.c_str()) + "\"" +
+                                ",\"bytes\":" + std::to_string(st.bytes_written) +
+                                ",\"dropped_blocks\":" + std::to_string(st.dropped_blocks) +
+                                ",\"dropped_bytes\":" + std::to_string(st.dropped_bytes) +
+                                ",\"queued\":" + std::to_string(st.queued_blocks) +
+                                ",\"capacity\":" + std::to_string(st.capacity_blocks) + "}");
         }
+        // TRIGGER_CAPTURE: {"pre": s, "post": s, "path": "base"} grava a janela
+        // em volta de agora, incluindo o que já passou, em recordings_dir
+        else if (payload.find("\"type\":\"TRIGGER_CAPTURE\"") != std::string::npos) {
+            double pre = 10.0, post = 5.0;
+            size_t pos;
+            if ((pos = payload.find("\"pre\":")) != std::string::npos) pre = std::stod(payload.substr(pos + 6));
+            if ((pos = payload.find("\"post\":")) != std::string::npos) post = std::stod(payload.substr(pos + 7));
+            std::string name = "captura_" + std::to_string(std::time(nullptr));
+            if ((pos = payload.find("\"path\":\"")) != std::string::npos) {
+                size_t end = payload.find('"', pos + 8);
+                if (end != std::string::npos && end > pos + 8) name = payload.substr(pos + 8, end - pos - 8);
+            }
+            std::string path;
+            if (!timeshift) {
+                ws_server->sendText(client_id, "{\"type\":\"CAPTURE\",\"started\":false,\"error\":\"timeshift disabled\"}");
+                return;
+            }
+            if (!recording_path(name, path)) {
+                ws_server->sendText(client_id, "{\"type\":\"CAPTURE\",\"started\":false,\"error\":\"invalid path\"}");
+                std::cerr << "[TimeShift] Nome de captura recusado\n";
+                return;
+            }
+            RecordingInfo info;
+            info.sample_rate = SAMPLE_RATE;
+            info.center_freq = center_freq;
+            info.gain_db = static_cast<float>(rf_gain.load());
+            bool ok = timeshift->trigger(path, pre, post, info, "manual");
+            ws_server->sendText(client_id, std::string("{\"type\":\"CAPTURE\",\"started\":") +
+                                (ok ? "true" : "false") + ",\"path\":\"" + json_escape(path.c_str()) + "\"}");
+        }
+        // SET_CAPTURE_TRIGGER: {"squelch": bool, "pre": s, "post": s} captura
+        // automática a cada abertura do squelch do receptor principal
+        else if (payload.find("\"type\":\"SET_CAPTURE_TRIGGER\"") != std::string::npos) {
+            size_t pos;
+            if ((pos = payload.find("\"pre\":")) != std::string::npos) squelch_capture_pre = std::stod(payload.substr(pos + 6));
+            if ((pos = payload.find("\"post\":")) != std::string::npos) squelch_capture_post = std::stod(payload.substr(pos + 7));
+            if ((pos = payload.find("\"squelch\":")) != std::string::npos)
+                squelch_capture = payload.compare(pos + 10, 4, "true") == 0 || payload.compare(pos + 10, 1, "1") == 0;
+            ws_server->sendText(client_id, std::string("{\"type\":\"CAPTURE_TRIGGER\",\"squelch\":") +
+                                (squelch_capture ? "true" : "false") +
+                                ",\"pre\":" + std::to_string(squelch_capture_pre.load()) +
+                                ",\"post\":" + std::to_string(squelch_capture_post.load()) + "}");
+            std::cout << "[TimeShift] Captura por squelch " << (squelch_capture ? "ligada" : "desligada") << "\n";
+        }
+        // GET_TIMESHIFT: quanto passado está disponível e estado da captura
+        else if (payload.find("\"type\":\"GET_TIMESHIFT\"") != std::string::npos) {
+            if (!timeshift) {
+                ws_server->sendText(client_id, "{\"type\":\"TIMESHIFT\",\"enabled\":false}");
+                return;
+            }
+            TimeShiftStats st = timeshift->getStats();
+            ws_server->sendText(client_id, std::string("{\"type\":\"TIMESHIFT\",\"enabled\":true") +
+                                ",\"capacity_s\":" + std::to_string(st.capacity_seconds) +
+                                ",\"buffered_s\":" + std::to_string(st.buffered_seconds) +
+                                ",\"capturing\":" + (st.capturing ? "true" : "false") +
+                                ",\"captures\":" + std::to_string(st.captures) +
+                                ",\"squelch_trigger\":" + (squelch_capture ? "true" : "false") +
+                                ",\"last_path\":\"" + json_escape(st.last_path.c_str()) + "\"" +
+                                ",\"overwritten_bytes\":" + std::to_string(st.overwritten_bytes) + "}");
+        }
+        // GET_CLIENTS: métricas de fila/atraso de cada ouvinte (só para quem pediu)
+        else if (payload.find("\"type\":\"GET_CLIENTS\"") != std::string::npos) {
+            ws_server->sendText(client_id, client_stats_json());
+        }
+        // GET_STATS: tempos por estágio, contadores e clientes (só para quem pediu)
+        else if (payload.find("\"type\":\"GET_STATS\"") != std::string::npos) {
+            ws_server->sendText(client_id, stats_json());
+        }
+        // PLAYOUT: eco do cliente com o capture_us de um quadro e há quantos ms
+        // ele começou a tocar ({"type":"PLAYOUT","capture":..,"delay_ms":..}). Sem resposta.
+        else if (payload.find("\"type\":\"PLAYOUT\"") != std::string::npos) {
+            size_t pos = payload.find("\"capture\":");
+            if (pos != std::string::npos) {
+                uint64_t capture_us = std::stoull(payload.substr(pos + 10));
+                double delay_ms = 0.0;
+                size_t dpos = payload.find("\"delay_ms\":");
+                if (dpos != std::string::npos) delay_ms = std::stod(payload.substr(dpos + 11));
+                playout_tracker.playout(client_id, capture_us, delay_ms, monotonicNs());
+            }
+        }
+        // GET_LATENCY: percentis de latência fim a fim (só para quem pediu)
+        else if (payload.find("\"type\":\"GET_LATENCY\"") != std::string::npos) {
+            ws_server->sendText(client_id, latency_json());
+        }
+        // RESET_STATS: zera histogramas e contadores (ex.: depois de mudar buffers)
+        else if (payload.find("\"type\":\"RESET_STATS\"") != std::string::npos) {
+            pipeline_stats.reset();
+            playout_tracker.reset();
+            ws_server->sendText(client_id, stats_json());
+        }
+        // SET_QUAD_MODE
+        else if (payload.find("\"type\":\"SET_QUAD_MODE\"") != std::string::npos) {
+            size_t pos = payload.find("\"quad_mode\":");
+            if (pos != std::string::npos) {
+                int qmode = std::stoi(payload.substr(pos + 11));
+                quad_mode = qmode;
+            
+                if (demodulator) {
+                    demodulator->setQuadMode(
+                        qmode == 0 ? QuadMode::QUADRATURE : QuadMode::Q_DIRECT
+                    );
+                }
+                std::cout << "[Demod] Quad: " << (qmode == 0 ? "Quad" : "Direct") << "\n";
+            }
+        }
+    } catch (const std::exception&) {
+        std::cerr << "[WebSocket] Comando invalido: " << payload << "\n";
     }
-    
-    closesocket(client);
 }
 
-int main() {
+int main(int argc, char** argv) {
     std::cout << "\n=== SpeedSDR Pro Backend v3.0 ===\n";
     std::cout << "Processamento otimizado com AGC\n";
-    std::cout << "Demodulacao: NFM,
+    std::cout << "Demodulacao: NFM, WFM, AM, USB, LSB, CW\n\n";
+    
+    std::signal(SIGINT, signal_handler);
+    std::signal(SIGTERM, signal_handler);
+    
+    // Fonte de IQ: --source rtlsdr[:N] | rtltcp:host[:porta] | file:caminho[:fast][:loop] | synth[:fast]
+    // Gravações e capturas: --recordings diretório (já existente; padrão ".")
+    // Anel de time-shift: --timeshift segundos (0 desliga; padrão 60 s)
+    std::string source_spec = "rtlsdr";
+    double timeshift_seconds = TIMESHIFT_SECONDS;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--source" && i + 1 < argc) source_spec = argv[++i];
+        else if (arg.compare(0, 9, "--source=") == 0) source_spec = arg.substr(9);
+        else if (arg == "--recordings" && i + 1 < argc) recordings_dir = argv[++i];
+        else if (arg.compare(0, 13, "--recordings=") == 0) recordings_dir = arg.substr(13);
+        else if (arg == "--timeshift" && i + 1 < argc) timeshift_seconds = std::atof(argv[++i]);
+        else if (arg.compare(0, 12, "--timeshift=") == 0) timeshift_seconds = std::atof(arg.c_str() + 12);
+    }
+    
+    source = createIQSource(source_spec, SAMPLE_RATE).release();
+    if (!source) {
+        std::cerr << "[Erro] Fonte de IQ invalida: " << source_spec << "\n";
+        return 1;
+    }
+    if (!source->open()) {
+        std::cerr << "[Erro] Falha ao abrir a fonte " << source_spec << "\n";
+        delete source;
+        return 1;
+    }
+    if (source->getSampleRate() != SAMPLE_RATE) {
+        std::cerr << "[Aviso] Fonte a " << source->getSampleRate() << " Hz; o pipeline assume "
+                  << SAMPLE_RATE << " Hz\n";
+    }
+    
+    source->setCenterFreq(center_freq);
+    source->setGain(rf_gain * 10);
+    
+    std::cout << "[RTL-SDR] Fonte: " << source_spec << "\n";
+    std::cout << "[RTL-SDR] Sample Rate: " << SAMPLE_RATE << " Hz\n";
+    std::cout << "[RTL-SDR] Freq: " << center_freq << " Hz\n";
+    std::cout << "[RTL-SDR] Gain: " << rf_gain << " dB\n";
+    std::cout << "[Recorder] Diretorio: " << recordings_dir << "\n";
+    if (timeshift_seconds > 0.0) std::cout << "[TimeShift] Anel de " << timeshift_seconds << " s\n\n";
+    else std::cout << "[TimeShift] Desligado\n\n";
+    
+    demodulator = new Demodulator();
+    audio_processor = new AudioProcessor();
+    multi_rx = new MultiChannelReceiver(SAMPLE_RATE, CHANNELIZER_BINS);
+    spectrum = new SpectrumEngine(SAMPLE_RATE);
+    scanner = new WidebandScanner(SAMPLE_RATE);
+    recorder = new IQRecorder(RECORD_BLOCK_BYTES, RECORD_BLOCKS);
+    if (timeshift_seconds > 0.0) timeshift = new IQTimeShift(SAMPLE_RATE, timeshift_seconds);
+    
+    // Servidor WebSocket: sockets não-bloqueantes, poucas threads de I/O
+    ws_server = new WebSocketServer(PORT, IO_THREADS);
+    ws_server->setOnClientMessage(handle_command);
+    ws_server->setOnConnect(handle_connect);
+    ws_server->setHttpHandler(handle_http);
+    ws_server->start();
+    
+    std::thread audio_thread(audio_processing_thread);
+    std::thread rtl_thread(rtl_reader_thread);
+    
+    // Relatório periódico dos clientes que estão perdendo mensagens
+    // e dos blocos descartados pelo gravador
+    std::vector<uint64_t> last_dropped;
+    uint64_t last_record_drops = 0;
+    int ticks = 0;
+    while (running) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        if (++ticks % 50 != 0) continue;
+        
+        for (const ClientStats& st : ws_server->getClientStats()) {
+            if (st.id >= last_dropped.size()) last_dropped.resize(st.id + 1, 0);
+            if (st.dropped == last_dropped[st.id]) continue;
+            std::cout << "[WebSocket] Cliente " << st.id << " (" << st.address << ") atrasado: "
+                      << (st.dropped - last_dropped[st.id]) << " descartes, fila " << st.queued_messages
+                      << ", lag " << st.lag_ms << " ms\n";
+            last_dropped[st.id] = st.dropped;
+        }
+        
+        RecorderStats rec = recorder->getStats();
+        if (rec.recording && rec.dropped_blocks != last_record_drops) {
+            std::cout << "[Recorder] Disco atrasado: " << (rec.dropped_blocks - last_record_drops)
+                      << " bloco(s) descartado(s), fila " << rec.queued_blocks << "/" << rec.capacity_blocks << "\n";
+        }
+        last_record_drops = rec.dropped_blocks;
+    }
+    
+    // Cleanup
+    source->stop();
+    if (rtl_thread.joinable()) rtl_thread.join();
+    if (audio_thread.joinable()) audio_thread.join();
+    recorder->stop();
+    
+    ws_server->stop();
+    source->close();
+    
+    delete demodulator;
+    delete audio_processor;
+    delete multi_rx;
+    delete spectrum;
+    delete scanner;
+    delete recorder;
+    delete timeshift;
+    delete ws_server;
+    delete source;
+    
+    std::cout << "\n[Backend] Encerrado\n";
+    return 0;
+}
@@ -281,6 +281,10 @@ export default function App() {
         console.log(`[WS] Conectado porta ${port}`);
         setIsConnected(true);
         
+        // O áudio e o waterfall ainda saem do IQ bruto demodulado aqui; o
+        // backend só manda IQ cu8 quando pedido (o padrão é o espectro pronto)
+        ws.send(JSON.stringify({ type: 'SET_RAW_IQ', enabled: true }));
+        
         setTimeout(() => {
           wsRef.current?.send(JSON.stringify({ type: 'SET_MODE', mode: sampleMode === SampleMode.DIRECT_Q ? 'direct_q' : 'quadrature' }));
         }, 100);